@@ -0,0 +1,125 @@
+/* Benchmark for base64 encoding and decoding in the base library
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+   This file is part of the GNUstep Base Library.
+
+   Usage: base64bench [size-in-bytes [iterations]]
+*/
+
+#include	<Foundation/Foundation.h>
+#include	<GNUstepBase/GSMime.h>
+
+static void
+report(const char *what, NSDate *start, NSUInteger bytes)
+{
+  NSTimeInterval	t = -[start timeIntervalSinceNow];
+
+  printf("%-40s %8.3f sec %9.1f MB/s\n",
+    what, t, (t > 0.0) ? bytes / t / (1024.0 * 1024.0) : 0.0);
+}
+
+int
+main(int argc, char **argv)
+{
+  NSUInteger		size = 16 * 1024 * 1024;
+  NSUInteger		count = 10;
+  NSMutableData		*raw;
+  NSData		*enc;
+  NSData		*lines;
+  NSData		*dec;
+  NSDate		*start;
+  unsigned char		*ptr;
+  NSUInteger		i;
+
+  ENTER_POOL
+  if (argc > 1)
+    {
+      size = (NSUInteger)atol(argv[1]);
+    }
+  if (argc > 2)
+    {
+      count = (NSUInteger)atol(argv[2]);
+    }
+  raw = [NSMutableData dataWithLength: size];
+  ptr = [raw mutableBytes];
+  for (i = 0; i < size; i++)
+    {
+      ptr[i] = (unsigned char)(i * 2654435761U >> 13);
+    }
+  printf("%lu bytes, %lu iterations\n",
+    (unsigned long)size, (unsigned long)count);
+
+  start = [NSDate date];
+  for (i = 0; i < count; i++)
+    {
+      ENTER_POOL
+      enc = [raw base64EncodedDataWithOptions: 0];
+      LEAVE_POOL
+    }
+  report("NSData encode", start, size * count);
+
+  start = [NSDate date];
+  for (i = 0; i < count; i++)
+    {
+      ENTER_POOL
+      lines = [raw base64EncodedDataWithOptions:
+	NSDataBase64Encoding76CharacterLineLength];
+      LEAVE_POOL
+    }
+  report("NSData encode (76 character lines)", start, size * count);
+
+  enc = [raw base64EncodedDataWithOptions: 0];
+  start = [NSDate date];
+  for (i = 0; i < count; i++)
+    {
+      ENTER_POOL
+      dec = [[NSData alloc] initWithBase64EncodedData: enc options: 0];
+      [dec release];
+      LEAVE_POOL
+    }
+  report("NSData decode", start, size * count);
+
+  lines = [raw base64EncodedDataWithOptions:
+    NSDataBase64Encoding76CharacterLineLength];
+  start = [NSDate date];
+  for (i = 0; i < count; i++)
+    {
+      ENTER_POOL
+      dec = [[NSData alloc] initWithBase64EncodedData: lines
+	options: NSDataBase64DecodingIgnoreUnknownCharacters];
+      [dec release];
+      LEAVE_POOL
+    }
+  report("NSData decode (76 character lines)", start, size * count);
+
+  start = [NSDate date];
+  for (i = 0; i < count; i++)
+    {
+      ENTER_POOL
+      [GSMimeDocument encodeBase64: raw];
+      LEAVE_POOL
+    }
+  report("GSMimeDocument encode", start, size * count);
+
+  start = [NSDate date];
+  for (i = 0; i < count; i++)
+    {
+      ENTER_POOL
+      dec = [GSMimeDocument decodeBase64: lines];
+      LEAVE_POOL
+    }
+  report("GSMimeDocument decode", start, size * count);
+
+  dec = [GSMimeDocument decodeBase64: lines];
+  if (NO == [dec isEqual: raw])
+    {
+      printf("ERROR: decoded data does not match original\n");
+    }
+  LEAVE_POOL
+  return 0;
+}
@@ -0,0 +1,127 @@
+/* Load generator for gdomap and NSSocketPortNameServer
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+   This file is part of the GNUstep Base Library.
+
+   Starts a number of processes at once, each of which registers a name
+   with the local gdomap and then looks up the names registered by the
+   other processes, simulating many programs starting together.
+
+   Usage: gdomapbench [processes [lookups-per-process]]
+   Add -GSPortLookupCache 5 to measure with lookups cached.
+*/
+
+#include	<Foundation/Foundation.h>
+
+static int
+child(NSString *prefix, unsigned index, unsigned processes, unsigned lookups)
+{
+  NSSocketPortNameServer	*ns = [NSSocketPortNameServer sharedInstance];
+  NSPort			*port = [NSSocketPort port];
+  NSString			*name;
+  NSDate			*start;
+  unsigned			found = 0;
+  unsigned			i;
+
+  name = [NSString stringWithFormat: @"%@%u", prefix, index];
+  start = [NSDate date];
+  if ([ns registerPort: port forName: name] == NO)
+    {
+      printf("%u: failed to register %s\n", index, [name UTF8String]);
+      return 1;
+    }
+  for (i = 0; i < lookups; i++)
+    {
+      ENTER_POOL
+      NSString	*other;
+
+      other = [NSString stringWithFormat: @"%@%u",
+	prefix, (index + i + 1) % processes];
+      if ([ns portForName: other onHost: @""] != nil)
+	{
+	  found++;
+	}
+      LEAVE_POOL
+    }
+  printf("%u: %u of %u lookups found in %.3f sec\n",
+    index, found, lookups, -[start timeIntervalSinceNow]);
+  [ns removePortForName: name];
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  NSMutableArray	*tasks;
+  NSString		*prefix;
+  NSString		*path;
+  NSDate		*start;
+  unsigned		processes = 100;
+  unsigned		lookups = 50;
+  unsigned		failed = 0;
+  unsigned		i;
+  int			result = 0;
+
+  ENTER_POOL
+  if (argc > 1 && strcmp(argv[1], "-child") == 0 && argc == 6)
+    {
+      result = child([NSString stringWithUTF8String: argv[2]],
+	(unsigned)atoi(argv[3]), (unsigned)atoi(argv[4]),
+	(unsigned)atoi(argv[5]));
+    }
+  else
+    {
+      if (argc > 1)
+	{
+	  processes = (unsigned)atoi(argv[1]);
+	}
+      if (argc > 2)
+	{
+	  lookups = (unsigned)atoi(argv[2]);
+	}
+      if (processes == 0)
+	{
+	  processes = 1;
+	}
+      prefix = [NSString stringWithFormat: @"gdomapbench%d-",
+	[[NSProcessInfo processInfo] processIdentifier]];
+      path = [[NSBundle mainBundle] executablePath];
+      tasks = [NSMutableArray arrayWithCapacity: processes];
+      printf("%u processes, %u lookups each\n", processes, lookups);
+
+      start = [NSDate date];
+      for (i = 0; i < processes; i++)
+	{
+	  NSTask	*t;
+	  NSArray	*args;
+
+	  args = [NSArray arrayWithObjects: @"-child", prefix,
+	    [NSString stringWithFormat: @"%u", i],
+	    [NSString stringWithFormat: @"%u", processes],
+	    [NSString stringWithFormat: @"%u", lookups],
+	    nil];
+	  t = [NSTask launchedTaskWithLaunchPath: path arguments: args];
+	  [tasks addObject: t];
+	}
+      for (i = 0; i < processes; i++)
+	{
+	  NSTask	*t = [tasks objectAtIndex: i];
+
+	  [t waitUntilExit];
+	  if ([t terminationStatus] != 0)
+	    {
+	      failed++;
+	    }
+	}
+      printf("%u processes finished (%u failed) in %.3f sec\n",
+	processes, failed, -[start timeIntervalSinceNow]);
+      result = (failed > 0) ? 1 : 0;
+    }
+  LEAVE_POOL
+  return result;
+}
@@ -0,0 +1,123 @@
+/* Benchmark for retain and release from many threads
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+   This file is part of the GNUstep Base Library.
+
+   Starts a number of threads which all retain and release the same
+   object (as happens with a shared singleton) and then does the same
+   with each thread using an object of its own, reporting the time
+   taken for each.
+
+   Usage: retainbench [threads [iterations]]
+*/
+
+#include	<Foundation/Foundation.h>
+
+static NSCondition	*cond = nil;
+static NSUInteger	iterations = 1000000;
+static NSUInteger	running = 0;
+static BOOL		go = NO;
+static id		shared = nil;
+
+@interface	Worker : NSObject
++ (void) run: (id)useShared;
+@end
+
+@implementation	Worker
++ (void) run: (id)useShared
+{
+  id		o;
+  NSUInteger	i;
+
+  ENTER_POOL
+  o = (nil == useShared) ? [[NSObject new] autorelease] : shared;
+  [cond lock];
+  while (NO == go)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  for (i = 0; i < iterations; i++)
+    {
+      [o retain];
+      [o release];
+    }
+  [cond lock];
+  if (--running == 0)
+    {
+      [cond broadcast];
+    }
+  [cond unlock];
+  LEAVE_POOL
+}
+@end
+
+static double
+timeThreads(NSUInteger threads, id useShared)
+{
+  NSDate	*start;
+  NSUInteger	i;
+
+  [cond lock];
+  go = NO;
+  running = threads;
+  [cond unlock];
+  for (i = 0; i < threads; i++)
+    {
+      [NSThread detachNewThreadSelector: @selector(run:)
+			       toTarget: [Worker class]
+			     withObject: useShared];
+    }
+  /* Give the threads a moment to get ready so that they start together.
+   */
+  [NSThread sleepForTimeInterval: 0.1];
+  start = [NSDate date];
+  [cond lock];
+  go = YES;
+  [cond broadcast];
+  while (running > 0)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  return -[start timeIntervalSinceNow];
+}
+
+int
+main(int argc, char **argv)
+{
+  NSUInteger	threads = 64;
+  double	t;
+
+  ENTER_POOL
+  if (argc > 1)
+    {
+      threads = (NSUInteger)strtoull(argv[1], 0, 10);
+    }
+  if (argc > 2)
+    {
+      iterations = (NSUInteger)strtoull(argv[2], 0, 10);
+    }
+  if (threads < 1)
+    {
+      threads = 1;
+    }
+  cond = [NSCondition new];
+  shared = [NSObject new];
+
+  printf("%lu threads, %lu retain/release pairs each\n",
+    (unsigned long)threads, (unsigned long)iterations);
+  t = timeThreads(threads, shared);
+  printf("shared object:   %8.3f sec (%.1f ns per pair)\n",
+    t, t * 1e9 / (threads * iterations));
+  t = timeThreads(threads, nil);
+  printf("private objects: %8.3f sec (%.1f ns per pair)\n",
+    t, t * 1e9 / (threads * iterations));
+  LEAVE_POOL
+  return 0;
+}
@@ -0,0 +1,86 @@
+/* Benchmark for sorting large arrays
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+   This file is part of the GNUstep Base Library.
+
+   Sorts arrays of random numbers with and without NSSortConcurrent,
+   and with a sort descriptor, for a range of sizes, reporting the time
+   taken for each.
+
+   Usage: sortbench [smallest-count [largest-count]]
+*/
+
+#include	<Foundation/Foundation.h>
+
+static double
+timeSort(NSArray *a, NSSortOptions options)
+{
+  NSDate	*start = [NSDate date];
+
+  ENTER_POOL
+  [a sortedArrayWithOptions: options
+	    usingComparator: ^ NSComparisonResult (id x, id y) {
+    return [x compare: y];
+  }];
+  LEAVE_POOL
+  return -[start timeIntervalSinceNow];
+}
+
+int
+main(int argc, char **argv)
+{
+  NSUInteger	smallest = 1000000;
+  NSUInteger	largest = 100000000;
+  NSUInteger	count;
+
+  ENTER_POOL
+  if (argc > 1)
+    {
+      smallest = (NSUInteger)strtoull(argv[1], 0, 10);
+    }
+  if (argc > 2)
+    {
+      largest = (NSUInteger)strtoull(argv[2], 0, 10);
+    }
+  if (smallest < 1)
+    {
+      smallest = 1;
+    }
+
+  printf("%12s %10s %10s %10s %10s\n", "count",
+    "serial", "concurrent", "stable", "descriptor");
+  for (count = smallest; count <= largest; count *= 10)
+    {
+      ENTER_POOL
+      NSMutableArray	*a = [NSMutableArray arrayWithCapacity: count];
+      NSArray		*d;
+      NSDate		*start;
+      double		serial;
+      double		concurrent;
+      double		stable;
+      NSUInteger	i;
+
+      srandom(1);
+      for (i = 0; i < count; i++)
+	{
+	  [a addObject: [NSNumber numberWithLong: random()]];
+	}
+      serial = timeSort(a, 0);
+      concurrent = timeSort(a, NSSortConcurrent);
+      stable = timeSort(a, NSSortConcurrent | NSSortStable);
+      d = [NSArray arrayWithObject:
+	[NSSortDescriptor sortDescriptorWithKey: @"longValue" ascending: YES]];
+      start = [NSDate date];
+      [a sortUsingDescriptors: d];
+      printf("%12lu %10.3f %10.3f %10.3f %10.3f\n", (unsigned long)count,
+	serial, concurrent, stable, -[start timeIntervalSinceNow]);
+      LEAVE_POOL
+    }
+  LEAVE_POOL
+  return 0;
+}
@@ -0,0 +1,213 @@
+/* Benchmark for concurrent NSURLSession transfers
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+  Copying and distribution of this file, with or without modification,
+  are permitted in any medium without royalty provided the copyright
+  notice and this notice are preserved.
+
+   This file is part of the GNUstep Base Library.
+
+   Runs a minimal HTTP server on the loopback interface in a background
+   thread and fetches from it with many data tasks at once, reporting
+   the time taken.  Run it with and without -GSURLSessionRunLoop YES
+   to compare the libdispatch and run loop drivers.
+
+   Usage: urlsessionbench [tasks [response-size]]
+*/
+
+#include	<Foundation/Foundation.h>
+#include	<netinet/in.h>
+#include	<sys/socket.h>
+#include	<poll.h>
+
+#define	MAX_CONNECTIONS	4096
+
+static int		listener = -1;
+static NSData		*response = nil;
+
+/* Answer every request on every connection with the same response,
+ * supporting keep-alive, using a single poll() loop.
+ */
+static void
+serve(void)
+{
+  struct pollfd	fds[MAX_CONNECTIONS];
+  int		count = 1;
+
+  fds[0].fd = listener;
+  fds[0].events = POLLIN;
+  for (;;)
+    {
+      int	i;
+
+      if (poll(fds, count, -1) <= 0)
+	{
+	  continue;
+	}
+      for (i = count - 1; i > 0; i--)
+	{
+	  char		buf[8192];
+	  ssize_t	len;
+
+	  if (fds[i].revents == 0)
+	    {
+	      continue;
+	    }
+	  len = read(fds[i].fd, buf, sizeof(buf));
+	  if (len <= 0)
+	    {
+	      close(fds[i].fd);
+	      fds[i] = fds[--count];
+	    }
+	  else
+	    {
+	      ssize_t	pos;
+
+	      /* One response for each end of request headers seen.
+	       */
+	      for (pos = 3; pos < len; pos++)
+		{
+		  if (buf[pos] == '\n' && buf[pos-1] == '\r'
+		    && buf[pos-2] == '\n' && buf[pos-3] == '\r')
+		    {
+		      (void)write(fds[i].fd, [response bytes],
+			[response length]);
+		    }
+		}
+	    }
+	}
+      if ((fds[0].revents & POLLIN) && count < MAX_CONNECTIONS)
+	{
+	  int	s = accept(listener, 0, 0);
+
+	  if (s >= 0)
+	    {
+	      fds[count].fd = s;
+	      fds[count].events = POLLIN;
+	      count++;
+	    }
+	}
+    }
+}
+
+@interface	Server : NSObject
++ (void) run: (id)ignored;
+@end
+@implementation	Server
++ (void) run: (id)ignored
+{
+  serve();
+}
+@end
+
+@interface	Counter : NSObject <NSURLSessionDataDelegate>
+{
+@public
+  NSUInteger	completed;
+  NSUInteger	failed;
+  unsigned long long	bytes;
+}
+@end
+@implementation	Counter
+- (void) URLSession: (NSURLSession*)session
+	   dataTask: (NSURLSessionDataTask*)dataTask
+     didReceiveData: (NSData*)data
+{
+  bytes += [data length];
+}
+- (void) URLSession: (NSURLSession*)session
+	       task: (NSURLSessionTask*)task
+didCompleteWithError: (NSError*)error
+{
+  if (error != nil)
+    {
+      failed++;
+    }
+  completed++;
+}
+@end
+
+int
+main(int argc, char **argv)
+{
+  NSURLSessionConfiguration	*config;
+  NSURLSession			*session;
+  NSOperationQueue		*queue;
+  Counter			*counter;
+  NSMutableString		*body;
+  NSString			*head;
+  NSURL				*url;
+  NSDate			*start;
+  struct sockaddr_in		sin;
+  socklen_t			len = sizeof(sin);
+  unsigned			tasks = 2000;
+  unsigned			size = 1024;
+  unsigned			i;
+
+  ENTER_POOL
+  if (argc > 1)
+    {
+      tasks = (unsigned)atoi(argv[1]);
+    }
+  if (argc > 2)
+    {
+      size = (unsigned)atoi(argv[2]);
+    }
+
+  body = [NSMutableString stringWithCapacity: size];
+  for (i = 0; i < size; i++)
+    {
+      [body appendString: @"x"];
+    }
+  head = [NSString stringWithFormat: @"HTTP/1.1 200 OK\r\n"
+    @"Content-Type: text/plain\r\nContent-Length: %u\r\n\r\n", size];
+  response = RETAIN([[head stringByAppendingString: body]
+    dataUsingEncoding: NSASCIIStringEncoding]);
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0
+    || bind(listener, (struct sockaddr*)&sin, sizeof(sin)) < 0
+    || listen(listener, 1024) < 0
+    || getsockname(listener, (struct sockaddr*)&sin, &len) < 0)
+    {
+      printf("Unable to start local HTTP server\n");
+      return 1;
+    }
+  [NSThread detachNewThreadSelector: @selector(run:)
+			   toTarget: [Server class]
+			 withObject: nil];
+  url = [NSURL URLWithString: [NSString stringWithFormat:
+    @"http://127.0.0.1:%d/", ntohs(sin.sin_port)]];
+
+  counter = AUTORELEASE([Counter new]);
+  queue = AUTORELEASE([NSOperationQueue new]);
+  [queue setMaxConcurrentOperationCount: 1];
+  config = [NSURLSessionConfiguration defaultSessionConfiguration];
+  [config setHTTPMaximumConnectionsPerHost: 64];
+  session = [NSURLSession sessionWithConfiguration: config
+					  delegate: counter
+				     delegateQueue: queue];
+
+  printf("%u tasks fetching %u bytes each (%s driver)\n", tasks, size,
+    [[NSUserDefaults standardUserDefaults] boolForKey: @"GSURLSessionRunLoop"]
+    ? "run loop" : "libdispatch");
+  start = [NSDate date];
+  for (i = 0; i < tasks; i++)
+    {
+      [[session dataTaskWithURL: url] resume];
+    }
+  while (counter->completed < tasks)
+    {
+      [NSThread sleepForTimeInterval: 0.001];
+    }
+  printf("%u completed (%u failed), %llu bytes in %.3f sec\n",
+    (unsigned)counter->completed, (unsigned)counter->failed,
+    counter->bytes, -[start timeIntervalSinceNow]);
+  [session finishTasksAndInvalidate];
+  LEAVE_POOL
+  return 0;
+}
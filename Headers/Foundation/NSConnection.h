@@ -33,6 +33,7 @@
 #import	<Foundation/NSTimer.h>
 #import	<Foundation/NSRunLoop.h>
 #import	<Foundation/NSMapTable.h>
+#import	<GNUstepBase/GSBlocks.h>
 
 #if	defined(__cplusplus)
 extern "C" {
@@ -160,6 +161,40 @@ GS_NSConnection_IVARS;
 - (NSDictionary*) statistics;
 @end
 
+#if	OS_API_VERSION(GS_API_NONE,GS_API_NONE)
+
+/**
+ * Block called when a request sent by
+ * [NSConnection-sendInvocation:completion:] has finished.<br />
+ * The exception argument is nil on success (in which case the return
+ * value and any values returned by reference have been stored in the
+ * invocation), or the exception raised by the remote end or by the
+ * connection failing.
+ */
+DEFINE_BLOCK_TYPE(GSConnectionCompletionBlock, void, NSInvocation*,
+  NSException*);
+
+@interface	NSConnection (GSAsynchronous)
+/**
+ * Sends the invocation (whose target must be a proxy for an object
+ * at the other end of the receiver) to the remote process without
+ * waiting for the reply, so that many requests may be outstanding on
+ * a connection at once.<br />
+ * When the reply arrives (as the run loop of the connection handles
+ * incoming messages), it is decoded into the invocation and the
+ * completion block is called.  For oneway void methods the block is
+ * called as soon as the request has been sent.<br />
+ * Any memory which the invocation arguments point to for values
+ * returned by reference must remain valid until the block is called.
+ * If the connection is invalidated, outstanding blocks are called with
+ * an exception.  There is no timeout for an individual request.
+ */
+- (void) sendInvocation: (NSInvocation*)inv
+	     completion: (GSConnectionCompletionBlock)block;
+@end
+
+#endif
+
 
 /**
  * This category represents an informal protocol to which NSConnection
@@ -784,5 +784,9 @@ GS_EXPORT NSString* const NSFileSystemFreeNodes;
 }
 #endif
 
+#if     !NO_GNUSTEP && !defined(GNUSTEP_BASE_INTERNAL)
+#import <GNUstepBase/NSFileManager+GNUstepBase.h>
+#endif
+
 #endif
 #endif /* __NSFileManager_h_GNUSTEP_BASE_INCLUDE */
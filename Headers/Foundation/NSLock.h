@@ -352,6 +352,44 @@ GS_EXPORT NSLock_error_handler  *_NSLock_error_handler;
  */
 + (NSRecursiveLock*) tracedRecursiveLock;
 @end
+
+@class NSDictionary;
+
+/** Controls sampling of the use of locks, to find out which locks are
+ * contended or held for long periods.  NSLock, NSRecursiveLock,
+ * NSCondition (and so NSConditionLock) are profiled, as is @synchronized
+ * where the base library implements it.<br />
+ * Setting the GNUSTEP_LOCK_PROFILE environment variable to YES starts
+ * profiling when the process starts, and makes the SIGUSR2 signal write
+ * the profile to stderr.
+ */
+@interface      NSObject (GSLockProfile)
+/** Returns the profile gathered so far.  The keys are the names of the
+ * locks (locks with the same name are counted together), or the class
+ * names of unnamed locks and of objects used with @synchronized.  Each
+ * value is a dictionary containing:<br />
+ * Acquisitions: the estimated number of times the lock was taken<br />
+ * Contended: the number of times a thread had to wait for the lock<br />
+ * WaitTime: the total number of seconds spent waiting<br />
+ * HoldTimes: an array of sixteen counts of sampled hold times, the first
+ * being of times less than a microsecond and each other being of times
+ * up to double those of the one before, the last counting all longer
+ * times.
+ */
++ (NSDictionary*) lockProfile;
+
+/** Sets all the counts in the lock profile back to zero.
+ */
++ (void) resetLockProfile;
+
+/** Turns lock profiling on by setting a non-zero interval (the number of
+ * uncontended lock acquisitions for each one sampled) or off by setting
+ * zero.  Contended acquisitions are always recorded while profiling is
+ * on.<br />
+ * Returns the old setting.
+ */
++ (NSUInteger) setLockProfileSampleInterval: (NSUInteger)interval;
+@end
 #endif
 
 #if  defined(__cplusplus)
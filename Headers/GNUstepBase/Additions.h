@@ -48,6 +48,7 @@
 #import	<GNUstepBase/NSData+GNUstepBase.h>
 #import	<GNUstepBase/NSDebug+GNUstepBase.h>
 #import	<GNUstepBase/NSFileHandle+GNUstepBase.h>
+#import	<GNUstepBase/NSFileManager+GNUstepBase.h>
 #import	<GNUstepBase/NSLock+GNUstepBase.h>
 #import	<GNUstepBase/NSMutableString+GNUstepBase.h>
 #import	<GNUstepBase/NSNetServices+GNUstepBase.h>
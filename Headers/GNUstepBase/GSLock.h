@@ -56,6 +56,56 @@ extern "C" {
 - (void) _becomeThreaded: (NSNotification*)n;
 @end
 
+/**
+ * A lock which may be held by any number of readers at once, or by a
+ * single writer.  Use it to protect data which is read far more often
+ * than it is changed, so that readers do not have to wait for each other.
+ * The -lock method locks for writing.<br />
+ * A thread must not lock the receiver again while it holds it, not even
+ * for reading, as that may deadlock if a writer is waiting.
+ */
+@interface	GSReadWriteLock : NSObject <NSLocking>
+{
+#if	GS_EXPOSE(GSReadWriteLock)
+@private
+  void		*_rwlock;
+  NSString	*_name;
+#endif
+}
+
+/** Blocks until the receiver can be locked for reading (ie until there is
+ * no writer holding or waiting for it), then locks it.<br />
+ * Each call must be balanced by a call to -unlock.
+ */
+- (void) lockForReading;
+
+/** Blocks until nothing else holds the receiver, then locks it for writing.
+ */
+- (void) lockForWriting;
+
+/** Returns the name of the receiver or nil if none has been set.
+ */
+- (NSString*) name;
+
+/** Sets the name of the receiver (for use in debugging).
+ */
+- (void) setName: (NSString*)name;
+
+/** Locks the receiver for reading if that can be done immediately,
+ * returning YES on success and NO otherwise.
+ */
+- (BOOL) tryLockForReading;
+
+/** Locks the receiver for writing if that can be done immediately,
+ * returning YES on success and NO otherwise.
+ */
+- (BOOL) tryLockForWriting;
+
+/** Releases one read lock or the write lock held by the current thread.
+ */
+- (void) unlock;
+@end
+
 /** Global lock to be used by classes when operating on any global
     data that invoke other methods which also access global; thus,
     creating the potential for deadlock. */
@@ -130,6 +130,7 @@ extern "C" {
 #if	GS_EXPOSE(GSMimeDocument)
   NSMutableArray	*headers;
   id			content;
+  NSMapTable		*headerIndex;
 #endif
 #if	!GS_NONFRAGILE
   void			*_unused;
@@ -242,12 +243,14 @@ extern "C" {
     unsigned int	excessData:1;
     unsigned int	headersOnly:1;
     unsigned int        encodedWord:1;
+    unsigned int        partStreamed:1;
   } flags;
   NSData		*boundary;	// Also overloaded to hold excess
   GSMimeDocument	*document;
   GSMimeParser		*child;
   GSMimeCodingContext	*context;
   NSStringEncoding	_defaultEncoding;
+  id			delegate;
 #endif
 #if	!GS_NONFRAGILE
   void			*_unused;
@@ -263,6 +266,9 @@ extern "C" {
 	  fromRange: (NSRange)aRange
 	   intoData: (NSMutableData*)dData
 	withContext: (GSMimeCodingContext*)con;
+/** Returns the current delegate (nil if the parser is not streaming).
+ */
+- (id) delegate;
 - (NSData*) excess;
 - (void) expectNoHeaders;
 - (BOOL) isComplete;
@@ -288,10 +294,44 @@ extern "C" {
 - (NSString*) scanToken: (NSScanner*)scanner;
 - (void) setBuggyQuotes: (BOOL)flag;
 - (void) setDefaultCharset: (NSString*)aName;
+/** Sets a delegate (not retained) to receive the document as it is parsed
+ * (see the GSMimeParser informal protocol), and puts the parser into
+ * streaming mode.<br />
+ * In streaming mode the decoded body data of each part is passed to the
+ * delegate as soon as it is available rather than being accumulated,
+ * and the parts of a multipart document are not added to the content of
+ * the document, so the memory used is independent of the size of the
+ * document being parsed.
+ */
+- (void) setDelegate: (id)d;
 - (void) setHeadersOnly;
 - (void) setIsHttp;
 @end
 
+/** Informal protocol for delegates of the GSMimeParser class.
+ * The parser argument is always the parser whose delegate was set,
+ * and the part argument is the (top level or nested) document which
+ * is being parsed.<br />
+ * The default implementations of these methods do nothing.
+ */
+@interface	NSObject (GSMimeParser)
+/** Called when all the headers of a part have been parsed.
+ */
+- (void) mimeParser: (GSMimeParser*)parser
+        headersDone: (GSMimeDocument*)part;
+/** Called with each piece of decoded body data of a part which is not
+ * itself multipart.  The data object is re-used by the parser, so the
+ * delegate must copy its contents if it needs to keep them.
+ */
+- (void) mimeParser: (GSMimeParser*)parser
+	       part: (GSMimeDocument*)part
+	    addData: (NSData*)data;
+/** Called when the body of a part has been completely parsed.
+ */
+- (void) mimeParser: (GSMimeParser*)parser
+           partDone: (GSMimeDocument*)part;
+@end
+
 /** Instances of the GSMimeSerializer class are used to serialise
  * GSMimeDocument objects to NSMutableData objects, producing data
  * in a form suitable for sending as an Email over the SMTP protocol
@@ -400,7 +440,14 @@ typedef enum {
 @class	NSTimer;
 
 /** The GSMimeSMTPClient class provides the ability to send EMails
- * ([GSMimeDocument] instances) via an SMTP server.
+ * ([GSMimeDocument] instances) via an SMTP server.<br />
+ * When the server advertises the PIPELINING extension (RFC 2920) the
+ * client sends the commands for several queued messages without waiting
+ * for each reply, and when it advertises CHUNKING (RFC 3030) message
+ * bodies are sent with BDAT rather than DATA, so they need no dot
+ * escaping and no separate round trip before the body.<br />
+ * Each client uses a single connection; to send over several connections
+ * at once, use several clients.
  */
 @interface	GSMimeSMTPClient : NSObject
 {
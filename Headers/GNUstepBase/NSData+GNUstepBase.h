@@ -47,6 +47,14 @@ extern "C" {
  */
 + (id) dataWithRandomBytesOfLength: (NSUInteger)length;
 
+/** Returns an NSString object containing the receiver encoded using the
+ * URL and filename safe base64 alphabet of RFC 4648 (where '-' and '_'
+ * replace the '+' and '/' of standard base64), with no line breaks.<br />
+ * The trailing '=' padding is only added if pad is YES, since it is
+ * usually omitted where the encoding is used (eg in JSON web tokens).
+ */
+- (NSString*) base64URLEncodedStringWithPadding: (BOOL)pad;
+
 /** Returns an NSString object containing a backslash escaped representation
  * of the receiver.
  */
@@ -98,6 +106,14 @@ extern "C" {
  */
 - (char*) hexadecimalRepresentation: (NSUInteger*)length;
 
+/** Initialises the receiver with the bytes encoded in string using the
+ * URL and filename safe base64 alphabet of RFC 4648, with or without the
+ * trailing '=' padding.<br />
+ * Returns nil if the string contains white space or any other character
+ * not in that alphabet, or if its length is not possible for base64.
+ */
+- (id) initWithBase64URLEncodedString: (NSString*)string;
+
 /**
  * Initialises the receiver with the supplied string data which contains
  * a hexadecimal coding of the bytes.  The parsing of the string is
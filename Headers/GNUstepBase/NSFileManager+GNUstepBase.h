@@ -0,0 +1,75 @@
+/** Declaration of extension methods for base additions
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNUstep Base Library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+   
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02111 USA.
+
+*/
+
+#ifndef	INCLUDED_NSFileManager_GNUstepBase_h
+#define	INCLUDED_NSFileManager_GNUstepBase_h
+
+#import <GNUstepBase/GSVersionMacros.h>
+#import <Foundation/NSFileManager.h>
+
+#if	defined(__cplusplus)
+extern "C" {
+#endif
+
+#if	OS_API_VERSION(GS_API_NONE,GS_API_LATEST)
+
+@class	NSArray;
+
+@interface NSFileManager (GNUstepBase)
+
+/** Returns the number of seconds for which file attributes may be
+ * cached (zero, the default, if caching is disabled).
+ */
++ (NSTimeInterval) attributesCacheInterval;
+
+/** Sets the number of seconds for which the attributes returned by
+ * [NSFileManager-fileAttributesAtPath:traverseLink:] and
+ * [NSFileManager-attributesOfItemAtPath:error:] may be reused for
+ * the same path rather than being read from the filesystem again.<br />
+ * The cache is emptied whenever a file is created, changed, moved or
+ * removed using NSFileManager, but changes made in other ways (or by
+ * other processes) will not be seen until the interval has passed.
+ * Setting an interval of zero disables the cache.
+ */
++ (void) setAttributesCacheInterval: (NSTimeInterval)seconds;
+
+/** Returns an array containing the attributes of the file at each
+ * of the paths, or NSNull for each file which could not be examined.<br />
+ * If keys is not nil, each dictionary contains only the attributes
+ * named in it, and the system is asked only for the information
+ * needed to provide them, which is faster on some filesystems.<br />
+ * If flag is YES, symbolic links are followed.
+ */
+- (NSArray*) attributesOfItemsAtPaths: (NSArray*)paths
+				 keys: (NSArray*)keys
+			 traverseLink: (BOOL)flag;
+
+@end
+
+#endif	/* OS_API_VERSION */
+
+#if	defined(__cplusplus)
+}
+#endif
+
+#endif	/* INCLUDED_NSFileManager_GNUstepBase_h */
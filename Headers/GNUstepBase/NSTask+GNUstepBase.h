@@ -56,6 +56,35 @@ extern "C" {
  * Returns the path found, or nil if the tool could not be located.
  */
 + (NSString*) launchPathForTool: (NSString*)name;
+
+#if	!defined(_WIN32)
+/** Launches each of the tasks in the array (none of which may have been
+ * launched already), with no more than max of them running at any one
+ * time (or all at once if max is zero), and waits until all of them
+ * have terminated.<br />
+ * The standard output and standard error of every task are set to pipes
+ * and captured in memory.  The pipes of all the tasks are read by a
+ * single loop in the calling thread, so the run loop is not used.<br />
+ * Returns an array holding a dictionary for each task (in the same order
+ * as the tasks) containing:
+ * <deflist>
+ *   <term>StandardOutput</term>
+ *   <desc>NSData holding everything the task wrote to standard output</desc>
+ *   <term>StandardError</term>
+ *   <desc>NSData holding everything the task wrote to standard error</desc>
+ *   <term>TerminationStatus</term>
+ *   <desc>NSNumber holding the -terminationStatus of the task</desc>
+ *   <term>TerminationReason</term>
+ *   <desc>NSNumber holding the -terminationReason of the task</desc>
+ *   <term>Duration</term>
+ *   <desc>NSNumber holding the seconds from launch to termination</desc>
+ *   <term>Exception</term>
+ *   <desc>The exception raised if the task could not be launched
+ *   (in which case there are no other entries)</desc>
+ * </deflist>
+ */
++ (NSArray*) runTasks: (NSArray*)tasks maxConcurrent: (NSUInteger)max;
+#endif
 @end
 
 #endif	/* OS_API_VERSION */
@@ -27,12 +27,15 @@
 
 #import "common.h"
 #define	EXPOSE_GSLock_IVARS	1
+#define	EXPOSE_GSReadWriteLock_IVARS	1
 #import "Foundation/NSException.h"
 #import "Foundation/NSLock.h"
 #import "Foundation/NSNotification.h"
 #import "Foundation/NSThread.h"
 #import "GNUstepBase/GSLock.h"
 
+#include <pthread.h>
+
 /**
  * This implements a class which, when used in single-threaded mode,
  * acts like a lock while avoiding the overheads of actually using
@@ -300,6 +303,133 @@
 
 @end
 
+
+
+/**
+ * This implements a reader-writer lock using the pthread rwlock of the
+ * system.  Where the system allows it we ask for writers to be preferred,
+ * so that a steady stream of readers cannot keep a writer waiting forever.
+ */
+@implementation	GSReadWriteLock
+
+- (void) dealloc
+{
+  if (_rwlock != 0)
+    {
+      pthread_rwlock_destroy((pthread_rwlock_t*)_rwlock);
+      free(_rwlock);
+    }
+  [_name release];
+  [super dealloc];
+}
+
+- (NSString*) description
+{
+  if (_name == nil)
+    {
+      return [super description];
+    }
+  return [NSString stringWithFormat: @"%@ '%@'", [super description], _name];
+}
+
+- (id) init
+{
+  if (nil != (self = [super init]))
+    {
+      pthread_rwlockattr_t	attr;
+      int			err;
+
+      _rwlock = malloc(sizeof(pthread_rwlock_t));
+      if (0 == _rwlock)
+	{
+	  DESTROY(self);
+	  return nil;
+	}
+      pthread_rwlockattr_init(&attr);
+#if	defined(__GLIBC__) && defined(__USE_GNU)
+      pthread_rwlockattr_setkind_np(&attr,
+	PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+      err = pthread_rwlock_init((pthread_rwlock_t*)_rwlock, &attr);
+      pthread_rwlockattr_destroy(&attr);
+      if (0 != err)
+	{
+	  free(_rwlock);
+	  _rwlock = 0;
+	  DESTROY(self);
+	}
+    }
+  return self;
+}
+
+- (void) lock
+{
+  [self lockForWriting];
+}
+
+- (void) lockForReading
+{
+  int	err = pthread_rwlock_rdlock((pthread_rwlock_t*)_rwlock);
+
+  if (EDEADLK == err)
+    {
+      (*_NSLock_error_handler)(self, _cmd, YES, @"deadlock");
+    }
+  else if (0 != err)
+    {
+      [NSException raise: NSGenericException
+		  format: @"failed to lock %@ for reading", self];
+    }
+}
+
+- (void) lockForWriting
+{
+  int	err = pthread_rwlock_wrlock((pthread_rwlock_t*)_rwlock);
+
+  if (EDEADLK == err)
+    {
+      (*_NSLock_error_handler)(self, _cmd, YES, @"deadlock");
+    }
+  else if (0 != err)
+    {
+      [NSException raise: NSGenericException
+		  format: @"failed to lock %@ for writing", self];
+    }
+}
+
+- (NSString*) name
+{
+  return _name;
+}
+
+- (void) setName: (NSString*)newName
+{
+  ASSIGNCOPY(_name, newName);
+}
+
+- (BOOL) tryLockForReading
+{
+  return (0 == pthread_rwlock_tryrdlock((pthread_rwlock_t*)_rwlock))
+    ? YES : NO;
+}
+
+- (BOOL) tryLockForWriting
+{
+  return (0 == pthread_rwlock_trywrlock((pthread_rwlock_t*)_rwlock))
+    ? YES : NO;
+}
+
+- (void) unlock
+{
+  if (0 != pthread_rwlock_unlock((pthread_rwlock_t*)_rwlock))
+    {
+      [NSException raise: NSGenericException
+		  format: @"failed to unlock %@", self];
+    }
+}
+
+@end
+
 /* Global lock to be used by classes when operating on any global
    data that invoke other methods which also access global; thus,
    creating the potential for deadlock. */
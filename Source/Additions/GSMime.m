@@ -67,8 +67,10 @@
   NSString		*username;\
   NSTimer		*timer;\
   GSMimeDocument	*current;\
-  GSMimeHeader		*version;\
   NSMutableArray	*queue;\
+  NSMutableArray	*expect;\
+  NSUInteger		inflight;\
+  NSUInteger		extensions;\
   NSUInteger		maximum;\
   NSMutableArray	*pending;\
   NSInputStream		*istream;\
@@ -80,6 +82,9 @@
   unsigned		woffset;\
   BOOL			readable;\
   BOOL			writable;\
+  BOOL			dataReady;\
+  BOOL			failed;\
+  int			step;\
   int			cState
 
 
@@ -148,6 +153,7 @@ isWSP(int c)
 }
 
 @interface GSMimeDocument (Private)
+- (void) _buildHeaderIndex;
 - (GSMimeHeader*) _lastHeaderNamed: (NSString*)name;
 - (NSUInteger) _indexOfHeaderNamed: (NSString*)name;
 @end
@@ -164,40 +170,294 @@ decodebase64(unsigned char *dst, const unsigned char *src)
   dst[2] = ((src[2] & 0x03) << 6) |  (src[3] & 0x3F);
 }
 
+/* Tables mapping characters to the six bit values they represent in the
+ * standard base64 alphabet (b64Strict), in the URL and filename safe
+ * alphabet of RFC 4648 (b64URL) or in either of them (b64Any).  Characters
+ * which are not part of the alphabet map to 0xff.
+ */
+static const uint8_t b64Strict[256] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+  0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+static const uint8_t b64URL[256] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+  0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3f,
+  0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+static const uint8_t b64Any[256] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0x3e, 0xff, 0x3f,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+  0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3f,
+  0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+static const char	b64[]
+  = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char	b64url[]
+  = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+NSUInteger
+GSPrivateBase64EncodedLength(NSUInteger length, NSUInteger lineLength,
+  NSUInteger eolLength)
+{
+  NSUInteger	groups = (length + 2) / 3;
+  NSUInteger	size = groups * 4;
+
+  if (lineLength >= 4)
+    {
+      size += (groups / (lineLength / 4)) * eolLength;
+    }
+  return size;
+}
+
+static NSUInteger
+decodeQuads(const uint8_t **srcRef, const uint8_t *end, uint8_t *dst,
+  const uint8_t *table)
+{
+  const uint8_t	*src = *srcRef;
+  uint8_t	*start = dst;
+
+  while (end - src >= 4)
+    {
+      uint32_t	a = table[src[0]];
+      uint32_t	b = table[src[1]];
+      uint32_t	c = table[src[2]];
+      uint32_t	d = table[src[3]];
+      uint32_t	v;
+
+      if ((a | b | c | d) & 0x80)
+	{
+	  break;	// Not four characters from the alphabet.
+	}
+      v = (a << 18) | (b << 12) | (c << 6) | d;
+      dst[0] = (uint8_t)(v >> 16);
+      dst[1] = (uint8_t)(v >> 8);
+      dst[2] = (uint8_t)v;
+      dst += 3;
+      src += 4;
+    }
+  *srcRef = src;
+  return dst - start;
+}
+
+NSUInteger
+GSPrivateDecodeBase64Quads(const uint8_t **srcRef, const uint8_t *end,
+  uint8_t *dst, BOOL strict)
+{
+  return decodeQuads(srcRef, end, dst, (YES == strict) ? b64Strict : b64Any);
+}
+
+NSUInteger
+GSPrivateDecodeBase64URL(const uint8_t *src, NSUInteger length, uint8_t *dst)
+{
+  const uint8_t	*end;
+  uint8_t	*start = dst;
+  NSUInteger	tail;
+
+  /* Padding is optional, but if present it must make the length a
+   * multiple of four.
+   */
+  if (length % 4 == 0)
+    {
+      if (length > 0 && '=' == src[length - 1])
+	{
+	  length--;
+	  if ('=' == src[length - 1])
+	    {
+	      length--;
+	    }
+	}
+    }
+  tail = length % 4;
+  if (1 == tail)
+    {
+      return NSNotFound;
+    }
+  end = src + length - tail;
+  dst += decodeQuads(&src, end, dst, b64URL);
+  if (src != end)
+    {
+      return NSNotFound;	// Not in the URL and filename safe alphabet
+    }
+  if (tail > 0)
+    {
+      uint32_t	a = b64URL[src[0]];
+      uint32_t	b = b64URL[src[1]];
+      uint32_t	c = (3 == tail) ? b64URL[src[2]] : 0;
+
+      if ((a | b | c) & 0x80)
+	{
+	  return NSNotFound;
+	}
+      *dst++ = (uint8_t)((a << 2) | (b >> 4));
+      if (3 == tail)
+	{
+	  *dst++ = (uint8_t)((b << 4) | (c >> 2));
+	}
+    }
+  return dst - start;
+}
+
 void
 GSPrivateEncodeBase64(const uint8_t *src, NSUInteger length, uint8_t *dst)
 {
-  int	dIndex = 0;
-  int	sIndex;
+  GSPrivateEncodeBase64Lines(src, length, dst, 0, 0);
+}
+
+static NSUInteger
+encodeBase64(const uint8_t *src, NSUInteger length, uint8_t *dst,
+  NSUInteger lineLength, const char *eol, const char *alphabet, BOOL pad)
+{
+  const uint8_t	*end = src + (length - length % 3);
+  uint8_t	*start = dst;
+  NSUInteger	perLine = (lineLength >= 4) ? lineLength / 4 : 0;
+  NSUInteger	eolLength = (0 == eol) ? 0 : strlen(eol);
+  NSUInteger	col = 0;
+
+  if (0 == eolLength)
+    {
+      perLine = 0;
+    }
+  while (src < end)
+    {
+      NSUInteger	n = (end - src) / 3;
+
+      /* Encode whole groups of three bytes, as many as will fit on the
+       * current line, without any per-byte checks.
+       */
+      if (perLine > 0 && n > perLine - col)
+	{
+	  n = perLine - col;
+	}
+      col += n;
+      while (n-- > 0)
+	{
+	  uint32_t	v = (src[0] << 16) | (src[1] << 8) | src[2];
 
-  for (sIndex = 0; sIndex < length; sIndex += 3)
+	  dst[0] = alphabet[v >> 18];
+	  dst[1] = alphabet[(v >> 12) & 0x3f];
+	  dst[2] = alphabet[(v >> 6) & 0x3f];
+	  dst[3] = alphabet[v & 0x3f];
+	  src += 3;
+	  dst += 4;
+	}
+      if (perLine > 0 && col == perLine)
+	{
+	  memcpy(dst, eol, eolLength);
+	  dst += eolLength;
+	  col = 0;
+	}
+    }
+
+  /* If length was not a multiple of 3, encode the remaining one or two
+   * bytes, padding with '=' characters if wanted.
+   */
+  if (length % 3 > 0)
     {
-      static char b64[]
-        = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-      int	c0 = src[sIndex];
-      int	c1 = (sIndex+1 < length) ? src[sIndex+1] : 0;
-      int	c2 = (sIndex+2 < length) ? src[sIndex+2] : 0;
+      int	c0 = src[0];
+      int	c1 = (length % 3 == 2) ? src[1] : 0;
 
-      dst[dIndex++] = b64[(c0 >> 2) & 077];
-      dst[dIndex++] = b64[((c0 << 4) & 060) | ((c1 >> 4) & 017)];
-      dst[dIndex++] = b64[((c1 << 2) & 074) | ((c2 >> 6) & 03)];
-      dst[dIndex++] = b64[c2 & 077];
+      *dst++ = alphabet[(c0 >> 2) & 077];
+      *dst++ = alphabet[((c0 << 4) & 060) | ((c1 >> 4) & 017)];
+      if (length % 3 == 2)
+	{
+	  *dst++ = alphabet[(c1 << 2) & 074];
+	}
+      else if (YES == pad)
+	{
+	  *dst++ = '=';
+	}
+      if (YES == pad)
+	{
+	  *dst++ = '=';
+	}
+      if (perLine > 0 && ++col == perLine)
+	{
+	  memcpy(dst, eol, eolLength);
+	  dst += eolLength;
+	}
     }
+  return dst - start;
+}
+
+NSUInteger
+GSPrivateEncodeBase64Lines(const uint8_t *src, NSUInteger length,
+  uint8_t *dst, NSUInteger lineLength, const char *eol)
+{
+  return encodeBase64(src, length, dst, lineLength, eol, b64, YES);
+}
+
+NSUInteger
+GSPrivateEncodeBase64URL(const uint8_t *src, NSUInteger length,
+  uint8_t *dst, BOOL pad)
+{
+  return encodeBase64(src, length, dst, 0, 0, b64url, pad);
+}
 
-   /* If len was not a multiple of 3, then we have encoded too
-    * many characters.  Adjust appropriately.
-    */
-   if (sIndex == length + 1)
-     {
-       /* There were only 2 bytes in that last group */
-       dst[dIndex - 1] = '=';
-     }
-   else if (sIndex == length + 2)
-     {
-       /* There was only 1 byte in that last group */
-       dst[dIndex - 1] = '=';
-       dst[dIndex - 2] = '=';
-     }
+/* Appends data base64 encoded in CRLF terminated lines of 76 characters
+ * (as used in MIME bodies) to md.
+ */
+static void
+appendBase64Lines(NSMutableData *md, NSData *d)
+{
+  NSUInteger	length = [d length];
+  NSUInteger	size = [md length];
+  uint8_t	*dst;
+
+  if (0 == length)
+    {
+      return;
+    }
+  [md setLength: size + GSPrivateBase64EncodedLength(length, 76, 2) + 2];
+  dst = (uint8_t*)[md mutableBytes] + size;
+  size += GSPrivateEncodeBase64Lines((const uint8_t*)[d bytes], length,
+    dst, 76, "\r\n");
+  dst = (uint8_t*)[md mutableBytes];
+  if (dst[size - 1] != '\n')
+    {
+      dst[size++] = '\r';	// Terminate the final (short) line.
+      dst[size++] = '\n';
+    }
+  [md setLength: size];
 }
 
 static void
@@ -601,8 +861,21 @@ wordData(NSString *word, BOOL *encoded)
    */
   while (src < end)
     {
-      int	cc = *src++;
+      int	cc;
 
+      if (0 == pos)
+	{
+	  /* Decode complete groups quickly, dropping back to the code below
+	   * for padding, line breaks and the like.
+	   */
+	  dst += GSPrivateDecodeBase64Quads((const uint8_t**)&src, end,
+	    dst, YES);
+	  if (src == end)
+	    {
+	      break;
+	    }
+	}
+      cc = *src++;
       if (isupper(cc))
 	{
 	  cc -= 'A';
@@ -839,6 +1112,25 @@ wordData(NSString *word, BOOL *encoded)
 - (BOOL) _scanHeaderParameters: (NSScanner*)scanner into: (GSMimeHeader*)info;
 @end
 
+@implementation	NSObject (GSMimeParser)
+- (void) mimeParser: (GSMimeParser*)parser
+        headersDone: (GSMimeDocument*)part
+{
+  return;
+}
+- (void) mimeParser: (GSMimeParser*)parser
+	       part: (GSMimeDocument*)part
+	    addData: (NSData*)data
+{
+  return;
+}
+- (void) mimeParser: (GSMimeParser*)parser
+           partDone: (GSMimeDocument*)part
+{
+  return;
+}
+@end
+
 /**
  * <p>
  *   This class provides support for parsing MIME messages
@@ -1007,6 +1299,10 @@ wordData(NSString *word, BOOL *encoded)
 
 - (void) dealloc
 {
+  if (child != nil)
+    {
+      [child setDelegate: nil];
+    }
   RELEASE(data);
   RELEASE(child);
   RELEASE(context);
@@ -1289,6 +1585,11 @@ wordData(NSString *word, BOOL *encoded)
   return result;
 }
 
+- (id) delegate
+{
+  return delegate;
+}
+
 - (NSString*) description
 {
   NSString	*desc;
@@ -1404,6 +1705,29 @@ wordData(NSString *word, BOOL *encoded)
   return document;
 }
 
+/* A parser streaming a multipart document is the delegate of the child
+ * parsers it uses for the parts, and passes their callbacks on to its
+ * own delegate as if it had parsed the parts itself.
+ */
+- (void) mimeParser: (GSMimeParser*)parser
+        headersDone: (GSMimeDocument*)part
+{
+  [delegate mimeParser: self headersDone: part];
+}
+
+- (void) mimeParser: (GSMimeParser*)parser
+	       part: (GSMimeDocument*)part
+	    addData: (NSData*)d
+{
+  [delegate mimeParser: self part: part addData: d];
+}
+
+- (void) mimeParser: (GSMimeParser*)parser
+           partDone: (GSMimeDocument*)part
+{
+  [delegate mimeParser: self partDone: part];
+}
+
 /**
  * <p>
  *   This method is called repeatedly to pass raw mime data into
@@ -1631,6 +1955,11 @@ wordData(NSString *word, BOOL *encoded)
         }
     }
 
+  if (delegate != nil)
+    {
+      [delegate mimeParser: self headersDone: document];
+    }
+
   /*
    * If there is a zero content length, all parsing is complete,
    * not just header parsing.
@@ -1642,6 +1971,10 @@ wordData(NSString *word, BOOL *encoded)
       [document setContent: @""];
       flags.inBody = 0;
       flags.complete = 1;
+      if (delegate != nil)
+        {
+          [delegate mimeParser: self partDone: document];
+        }
       /* If we have more data after the headers ... it's excess and
        * should become available as excess data.
        */
@@ -2326,6 +2659,19 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
     }
 }
 
+/* Sets the (unretained) delegate.  A child parser already at work on
+ * a part passes its callbacks on through us, so it must stop doing so
+ * if our delegate is removed.
+ */
+- (void) setDelegate: (id)d
+{
+  delegate = d;
+  if (child != nil)
+    {
+      [child setDelegate: (nil == d) ? nil : (id)self];
+    }
+}
+
 /**
  * Method to inform the parser that only the headers should be parsed
  * and any remaining data be treated as excess
@@ -2348,6 +2694,27 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 
 @end
 
+/* Returns the position in buf after any end-of-line following the
+ * boundary marker which introduced a multipart section starting at pos.
+ */
+static inline NSUInteger
+skipBoundaryEOL(const unsigned char *buf, NSUInteger pos, NSUInteger len)
+{
+  if (pos + 1 < len && buf[pos] == '-' && buf[pos+1] == '-')
+    {
+      pos += 2;
+    }
+  if (pos < len && buf[pos] == '\r')
+    {
+      pos++;
+    }
+  if (pos < len && buf[pos] == '\n')
+    {
+      pos++;
+    }
+  return pos;
+}
+
 @implementation	GSMimeParser (Private)
 
 /*
@@ -2369,6 +2736,10 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
    * Tell child parser the default encoding to use.
    */
   child->_defaultEncoding = _defaultEncoding;
+  if (delegate != nil)
+    {
+      [child setDelegate: self];
+    }
 }
 
 /*
@@ -2465,6 +2836,25 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 		  intoData: data
 	       withContext: context];
 
+	  /* When streaming, the decoded data is handed to the delegate
+	   * as soon as we have it (except for uuencoded data, which can
+	   * only be decoded once it is complete).
+	   */
+	  if (delegate != nil && [data length] > 0
+	    && NO == [context isKindOfClass: [GSMimeUUCodingContext class]])
+	    {
+	      NSUInteger	length = [data length];
+
+	      [delegate mimeParser: self part: document addData: data];
+	      if ([context isKindOfClass: [GSMimeChunkedDecoderContext class]])
+		{
+		  /* The chunked context tracks the total decoded size.
+		   */
+		  ((GSMimeChunkedDecoderContext*)context)->size -= length;
+		}
+	      [data setLength: 0];
+	    }
+
 	  if ([context atEnd] == YES
 	    || (expect > 0 && rawBodyLength >= expect))
 	    {
@@ -2474,6 +2864,16 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 	      flags.complete = 1;
 
 	      NSDebugMLLog(@"GSMime", @"%@", @"Parse body complete");
+	      if (delegate != nil)
+		{
+		  if ([data length] > 0)
+		    {
+		      [delegate mimeParser: self part: document addData: data];
+		      [data setLength: 0];
+		    }
+		  [delegate mimeParser: self partDone: document];
+		  return NO;
+		}
 	      /*
 	       * If no content type is supplied, we assume text ... unless
 	       * we have something that's known to be a file.
@@ -2656,6 +3056,44 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 	    }
 	  if (found == NO)
 	    {
+	      BOOL	streamed = NO;
+
+	      /* When streaming, everything in the section except for a
+	       * tail which might be the start of the next boundary is
+	       * passed on to the child parser rather than being buffered.
+	       * We never split a line ending, so the tail can not start
+	       * with a boundary.
+	       */
+	      if (delegate != nil && child != nil)
+		{
+		  NSUInteger	cut;
+
+		  if (0 == flags.partStreamed)
+		    {
+		      sectionStart = skipBoundaryEOL(buf, sectionStart, len);
+		      flags.partStreamed = 1;
+		    }
+		  cut = (len > bLength + 2) ? len - bLength - 2 : 0;
+		  while (cut > sectionStart
+		    && (buf[cut-1] == '\r' || buf[cut-1] == '\n'))
+		    {
+		      cut--;
+		    }
+		  if (cut > sectionStart)
+		    {
+		      NSData	*chunk;
+
+		      chunk = [[NSData alloc]
+			initWithBytesNoCopy: (void*)(buf + sectionStart)
+				     length: cut - sectionStart
+			       freeWhenDone: NO];
+		      [child parse: chunk];
+		      [chunk release];
+		      sectionStart = cut;
+		      streamed = YES;
+		    }
+		}
+
 	      /* Need more data ... so, if we have none buffered we must
 	       * buffer any unused data, otherwise we can copy data within
 	       * the buffer.
@@ -2671,11 +3109,15 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 	      else if (sectionStart > 0)
 		{
 		  len -= sectionStart;
-		  memcpy(bytes, buf + sectionStart, len);
+		  memmove(bytes, buf + sectionStart, len);
 		  sectionStart = lineStart = 0;
 		  [data setLength: len];
 		  dataEnd = len;
 		}
+	      if (YES == streamed)
+		{
+		  lineStart = 1;	// Buffer does not start a line
+		}
 	      done = YES;	/* Needs more data.	*/
 	    }
 	  else if (child == nil)
@@ -2713,19 +3155,11 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 	       * Skip past line terminator for boundary at start of section
 	       * or past marker for end of multipart document.
 	       */
-	      if (buf[sectionStart] == '-' && sectionStart < len
-		&& buf[sectionStart+1] == '-')
+	      if (0 == flags.partStreamed)
 		{
-		  sectionStart += 2;
-		}
-	      if (buf[sectionStart] == '\r')
-		{
-		  sectionStart++;
-		}
-	      if (buf[sectionStart] == '\n')
-		{
-		  sectionStart++;
+		  sectionStart = skipBoundaryEOL(buf, sectionStart, len);
 		}
+	      flags.partStreamed = 0;
 
 	      /*
 	       * Create data object for this section and pass it to the
@@ -2770,7 +3204,7 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 		   * create a new parser for the next section.
 	           */
 		  doc = [child mimeDocument];
-		  if (doc != nil)
+		  if (doc != nil && nil == delegate)
 		    {
 		      [document addContent: doc];
 		    }
@@ -2817,6 +3251,10 @@ NSDebugMLLog(@"GSMime", @"Header parsed - %@", info);
 	  flags.complete = 1;
 	  flags.inBody = 0;
 	  needsMore = NO;
+	  if (delegate != nil)
+	    {
+	      [delegate mimeParser: self partDone: document];
+	    }
 	}
     }
   return needsMore;
@@ -3355,6 +3793,13 @@ unfold(const unsigned char *src, const unsigned char *end, BOOL *folded)
 static NSCharacterSet	*nonToken = nil;
 static NSCharacterSet	*tokenSet = nil;
 
+/* Case-insensitive map from commonly used header names to the shared
+ * lowercase strings used as the names of headers, so that documents
+ * with many headers share a single copy of each name and lookups of
+ * well known names need not build a new lowercase string.
+ */
+static NSMutableDictionary	*knownNames = nil;
+
 + (void) _defaultsChanged: (NSNotification*)n
 {
   oldStyleFolding = [[NSUserDefaults standardUserDefaults]
@@ -3385,6 +3830,30 @@ static NSCharacterSet	*tokenSet = nil;
       RELEASE(ms);
       nonToken = RETAIN([tokenSet invertedSet]);
       [[NSObject leakAt: &nonToken] release];
+      if (knownNames == nil)
+	{
+	  static NSString	*names[] = {
+	    @"accept", @"authorization", @"bcc", @"cache-control", @"cc",
+	    @"connection", @"content-description", @"content-disposition",
+	    @"content-encoding", @"content-id", @"content-length",
+	    @"content-location", @"cookie", @"date", @"etag", @"expires",
+	    @"from", @"host", @"http", @"in-reply-to", @"keep-alive",
+	    @"last-modified", @"location", @"message-id", @"mime-version",
+	    @"pragma", @"received", @"references", @"reply-to",
+	    @"return-path", @"sender", @"server", @"set-cookie", @"subject",
+	    @"to", @"transfer-encoding", @"user-agent", @"www-authenticate",
+	    @"content-transfer-encoding"
+	  };
+	  NSUInteger	i;
+
+	  knownNames = [_GSMutableInsensitiveDictionary new];
+	  for (i = 0; i < sizeof(names)/sizeof(*names); i++)
+	    {
+	      [knownNames setObject: names[i] forKey: names[i]];
+	    }
+	  [knownNames setObject: CteContentType forKey: CteContentType];
+	  [[NSObject leakAt: &knownNames] release];
+	}
       if (NSArrayClass == 0)
 	{
 	  NSArrayClass = [NSArray class];
@@ -3636,16 +4105,7 @@ static NSCharacterSet	*tokenSet = nil;
       n = @"unknown";
     }
   ASSIGN(name, n);
-  if ([CteContentType caseInsensitiveCompare: name] == NSOrderedSame)
-    {
-      n = CteContentType;
-    }
-  else if ([@"content-transfer-encoding" caseInsensitiveCompare: name]
-    == NSOrderedSame)
-    {
-      n = @"content-transfer-encoding";
-    }
-  else
+  if ((n = [knownNames objectForKey: name]) == nil)
     {
       n = [name lowercaseString];
     }
@@ -4881,8 +5341,17 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 
   while ((src != end) && *src != '\0')
     {
-      int	c = *src++;
+      int	c;
 
+      if (0 == pos)
+	{
+	  dst += GSPrivateDecodeBase64Quads(&src, end, dst, NO);
+	  if (src == end || *src == '\0')
+	    {
+	      break;
+	    }
+	}
+      c = *src++;
       if (isupper(c))
 	{
 	  c -= 'A';
@@ -5537,6 +6006,10 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
       if (index != NSNotFound)
 	{
 	  [headers replaceObjectAtIndex: index withObject: info];
+	  if (headerIndex != 0)
+	    {
+	      NSMapInsert(headerIndex, name, info);
+	    }
 	}
       else if ([name isEqualToString: @"mime-version"] == YES)
 	{
@@ -5559,15 +6032,27 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 	      index = tmp;
 	    }
 	  [headers insertObject: info atIndex: index];
+	  if (headerIndex != 0)
+	    {
+	      NSMapInsert(headerIndex, name, info);
+	    }
 	}
       else
 	{
 	  [headers addObject: info];
+	  if (headerIndex != 0)
+	    {
+	      NSMapInsertIfAbsent(headerIndex, name, info);
+	    }
 	}
     }
   else
     {
       [headers addObject: info];
+      if (headerIndex != 0)
+	{
+	  NSMapInsertIfAbsent(headerIndex, name, info);
+	}
     }
 }
 
@@ -6124,6 +6609,7 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 
   c->headers = [[NSMutableArray allocWithZone: z] initWithArray: headers
 						      copyItems: YES];
+  [c _buildHeaderIndex];
 
   if ([content isKindOfClass: NSArrayClass] == YES)
     {
@@ -6139,6 +6625,11 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 
 - (void) dealloc
 {
+  if (headerIndex != 0)
+    {
+      NSFreeMapTable(headerIndex);
+      headerIndex = 0;
+    }
   RELEASE(headers);
   RELEASE(content);
   [super dealloc];
@@ -6179,7 +6670,25 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
  */
 - (void) deleteHeader: (GSMimeHeader*)aHeader
 {
+  NSString	*name = [aHeader name];
+
   [headers removeObjectIdenticalTo: aHeader];
+  if (headerIndex != 0 && name != nil
+    && NSMapGet(headerIndex, name) == (void*)aHeader)
+    {
+      NSUInteger	index = [self _indexOfHeaderNamed: name];
+
+      /* A later header of the same name may now be the first.
+       */
+      if (index == NSNotFound)
+	{
+	  NSMapRemove(headerIndex, name);
+	}
+      else
+	{
+	  NSMapInsert(headerIndex, name, [headers objectAtIndex: index]);
+	}
+    }
 }
 
 /**
@@ -6209,6 +6718,10 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 	      [headers removeObjectAtIndex: count];
 	    }
 	}
+      if (headerIndex != 0)
+	{
+	  NSMapRemove(headerIndex, name);
+	}
     }
 }
 
@@ -6333,27 +6846,21 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
  */
 - (GSMimeHeader*) headerNamed: (NSString*)name
 {
-  NSUInteger	count = [headers count];
-
-  if (count > 0)
+  if ([headers count] > 0)
     {
-      NSUInteger	index;
-      oaiIMP		imp1;
-      boolIMP		imp2;
+      NSString	*key;
 
-      name = [headerClass makeToken: name preservingCase: NO];
-      imp1 = (oaiIMP)[headers methodForSelector: @selector(objectAtIndex:)];
-      imp2 = (boolIMP)[name methodForSelector: @selector(isEqualToString:)];
-      for (index = 0; index < count; index++)
+      if ((key = [knownNames objectForKey: name]) == nil)
 	{
-	  GSMimeHeader	*info;
+	  key = [headerClass makeToken: name preservingCase: NO];
+	}
+      if (headerIndex == 0)
+	{
+	  NSUInteger	index = [self _indexOfHeaderNamed: key];
 
-	  info = (*imp1)(headers, @selector(objectAtIndex:), index);
-	  if ((*imp2)(name, @selector(isEqualToString:), [info name]))
-	    {
-	      return info;
-	    }
+	  return (index == NSNotFound) ? nil : [headers objectAtIndex: index];
 	}
+      return (GSMimeHeader*)NSMapGet(headerIndex, key);
     }
   return nil;
 }
@@ -6364,22 +6871,24 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
  */
 - (NSArray*) headersNamed: (NSString*)name
 {
-  NSUInteger	count;
+  GSMimeHeader	*first = [self headerNamed: name];
 
-  name = [headerClass makeToken: name preservingCase: NO];
-  count = [headers count];
-  if (count > 0)
+  if (first != nil)
     {
+      NSUInteger	count = [headers count];
       NSUInteger	index;
       NSMutableArray	*array;
       oaiIMP		imp1;
       boolIMP		imp2;
 
+      name = [first name];
       imp1 = (oaiIMP)[headers methodForSelector: @selector(objectAtIndex:)];
       imp2 = (boolIMP)[name methodForSelector: @selector(isEqualToString:)];
       array = [NSMutableArray array];
+      [array addObject: first];
 
-      for (index = 0; index < count; index++)
+      for (index = [headers indexOfObjectIdenticalTo: first] + 1;
+	index < count; index++)
 	{
 	  GSMimeHeader	*info;
 
@@ -6399,6 +6908,7 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
   if ((self = [super init]) != nil)
     {
       headers = [NSMutableArray new];
+      [self _buildHeaderIndex];
     }
   return self;
 }
@@ -6999,25 +7509,7 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 	}
       else if ([CteBase64 caseInsensitiveCompare: v] == NSOrderedSame)
         {
-	  const char	*ptr;
-	  NSUInteger	len;
-	  NSUInteger	pos = 0;
-
-	  d = [documentClass encodeBase64: d];
-	  ptr = [d bytes];
-	  len = [d length];
-
-	  while (len - pos > 76)
-	    {
-	      [md appendBytes: &ptr[pos] length: 76];
-	      [md appendBytes: "\r\n" length: 2];
-	      pos += 76;
-	    }
-	  if (pos < len)
-	    {
-	      [md appendBytes: &ptr[pos] length: len-pos];
-	      [md appendBytes: "\r\n" length: 2];
-	    }
+	  appendBase64Lines(md, d);
 	}
       else if ([CteQuotedPrintable caseInsensitiveCompare: v] == NSOrderedSame)
         {
@@ -7280,6 +7772,32 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 @end
 
 @implementation GSMimeDocument (Private)
+/**
+ * Builds the map from lowercase header names to the first header of
+ * each name, used to look headers up without scanning the headers array.
+ * This is done when the document is created or copied, and the map is
+ * then kept up to date as headers are added and removed, so that looking
+ * up a header never modifies the document.
+ */
+- (void) _buildHeaderIndex
+{
+  NSUInteger	count = [headers count];
+  NSUInteger	index;
+
+  if (headerIndex != 0)
+    {
+      NSFreeMapTable(headerIndex);
+    }
+  headerIndex = NSCreateMapTable(NSObjectMapKeyCallBacks,
+    NSNonOwnedPointerMapValueCallBacks, count);
+  for (index = 0; index < count; index++)
+    {
+      GSMimeHeader	*info = [headers objectAtIndex: index];
+
+      NSMapInsertIfAbsent(headerIndex, [info name], info);
+    }
+}
+
 /**
  * Returns the index of the first header matching the specified name
  * or NSNotFound if no match is found.<br />
@@ -7782,25 +8300,7 @@ appendString(NSMutableData *m, NSUInteger offset, NSUInteger fold,
 
       if (CteBase64 == enc)
         {
-	  const char	*ptr;
-	  NSUInteger	len;
-	  NSUInteger	pos = 0;
-
-	  d = [documentClass encodeBase64: d];
-	  ptr = [d bytes];
-	  len = [d length];
-
-	  while (len - pos > 76)
-	    {
-	      [md appendBytes: &ptr[pos] length: 76];
-	      [md appendBytes: "\r\n" length: 2];
-	      pos += 76;
-	    }
-	  if (pos < len)
-	    {
-	      [md appendBytes: &ptr[pos] length: len-pos];
-	      [md appendBytes: "\r\n" length: 2];
-	    }
+	  appendBase64Lines(md, d);
 	}
       else if (CteQuotedPrintable == enc)
         {
@@ -7950,8 +8450,17 @@ typedef	enum	{
 
 typedef	enum	{
   SMTPE_DSN,		// delivery status notification extension
+  SMTPE_PIPELINING,	// command pipelining extension
+  SMTPE_CHUNKING,	// BDAT command extension
 } SMTPE;
 
+#define	SMTPE_HAS(X)	((internal->extensions & (1 << (X))) ? YES : NO)
+
+/* Maximum number of messages whose commands may be outstanding on a
+ * pipelining connection.
+ */
+#define	SMTP_WINDOW	16
+
 NSString *
 eventText(NSStreamEvent e)
 {
@@ -7970,6 +8479,15 @@ eventText(NSStreamEvent e)
   return @"unknown event";
 }
 
+static NSString *
+commandName(int s)
+{
+  if (s == TP_FROM) return @"FROM";
+  if (s == TP_TO) return @"TO";
+  if (s == TP_DATA) return @"DATA";
+  return @"body";
+}
+
 NSString *
 statusText(NSStreamStatus s)
 {
@@ -8019,6 +8537,8 @@ static void makeBase64(GSMimeDocument *doc)
 - (NSError*) _commsEnd;
 - (NSError*) _commsError;
 - (void) _doMessage;
+- (void) _expect: (int)s;
+- (void) _finished: (BOOL)sent;
 - (NSString*) _identity;
 - (void) _performIO;
 - (void) _recvData: (NSData*)m;
@@ -8102,6 +8622,7 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
       DESTROY(internal->wdata);
       DESTROY(internal->rdata);
       DESTROY(internal->pending);
+      DESTROY(internal->expect);
       DESTROY(internal->queue);
       DESTROY(internal->username);
       DESTROY(internal->port);
@@ -8125,7 +8646,7 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
     {
       limit = [NSDate distantFuture];
     }
-  while ([internal->queue count] > 0)
+  while ([internal->queue count] > 0 && [limit timeIntervalSinceNow] > 0.0)
     {
       [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
 			       beforeDate: limit];
@@ -8139,6 +8660,8 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
     {
       GS_CREATE_INTERNAL(GSMimeSMTPClient);
       internal->queue = [NSMutableArray new];
+      internal->expect = [NSMutableArray new];
+      internal->step = TP_MESG;
     }
   return self;
 }
@@ -8179,7 +8702,7 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 	}
       [self _startup];
     }
-  else if (internal->cState == TP_MESG)
+  else if (internal->cState >= TP_MESG)
     {
       [self _doMessage];
     }
@@ -8326,26 +8849,71 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 }
 
 /** Initiates sending of the next message (or the next stage of the
- * current message).
+ * current message).<br />
+ * Without pipelining each command is sent only once the reply to the
+ * previous one has arrived.  With pipelining the commands for as many
+ * queued messages as the window allows are sent at once, stopping only
+ * after a DATA command (the body may not be sent until the server has
+ * accepted that command).
  */
 - (void) _doMessage
 {
-  if ([internal->queue count] > 0)
-    {
-      NSString		*tmp;
-
-      internal->current = [internal->queue objectAtIndex: 0];
-      internal->version = [internal->current headerNamed: @"mime-version"];
+  BOOL	pipelining = SMTPE_HAS(SMTPE_PIPELINING);
+  BOOL	chunking = SMTPE_HAS(SMTPE_CHUNKING);
 
-      if (internal->cState == TP_IDLE)
+  if (internal->cState == TP_IDLE)
+    {
+      if ([internal->queue count] > 0)
 	{
 	  [self _startup];
 	}
-      else if (internal->cState == TP_MESG)
+      return;
+    }
+  if (internal->cState < TP_MESG)
+    {
+      NSLog(@"_doMessage called in unexpected state.");
+      [self _shutdown: nil];
+      return;
+    }
+  if ([internal->queue count] == 0)
+    {
+      if ([internal->expect count] == 0)
+	{
+	  [self _shutdown: nil];
+	}
+      return;
+    }
+
+  for (;;)
+    {
+      GSMimeDocument	*doc;
+      GSMimeHeader	*version;
+      NSString		*tmp;
+
+      if (internal->step == TP_MESG)
 	{
 	  NSString	*from = internal->originator;
 
-	  DESTROY(internal->lastError);
+	  /* Start on the next message if we have one and either there is
+	   * no message in progress or we may pipeline another.
+	   */
+	  if (internal->inflight >= [internal->queue count])
+	    {
+	      break;
+	    }
+	  if (internal->inflight > 0
+	    && (NO == pipelining || internal->inflight >= SMTP_WINDOW))
+	    {
+	      break;
+	    }
+	  doc = [internal->queue objectAtIndex: internal->inflight++];
+	  version = [doc headerNamed: @"mime-version"];
+	  if (1 == internal->inflight)
+	    {
+	      internal->current = doc;
+	      internal->failed = NO;
+	      DESTROY(internal->lastError);
+	    }
 	  if (from == nil)
 	    {
 	      from = [[NSUserDefaults standardUserDefaults]
@@ -8353,7 +8921,7 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 	    }
 	  if ([from length] == 0)
 	    {
-	      from = [[internal->current headerNamed: @"from"] value];
+	      from = [[doc headerNamed: @"from"] value];
 	    }
 	  if ([from length] == 0)
 	    {
@@ -8363,7 +8931,7 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 		[self _identity]];
 	    }
 
-	  tmp = [internal->version objectForKey: @"ENVID"];
+	  tmp = [version objectForKey: @"ENVID"];
 	  if (nil == tmp)
 	    {
 	      tmp = [NSString stringWithFormat: @"MAIL FROM: <%@>\r\n", from];
@@ -8378,14 +8946,24 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 		@"MAIL FROM: <%@> RET=HDRS ENVID=%@\r\n", from, tmp];
 	    }
 	  NSDebugMLLog(@"GSMime", @"Initiating new mail message - %@", tmp);
-	  internal->cState = TP_FROM;
+	  internal->step = TP_TO;
+	  [self _expect: TP_FROM];
 	  [self _timer: 20.0];
 	  [self _sendData: [tmp dataUsingEncoding: NSUTF8StringEncoding]];
+	  continue;
+	}
+
+      if (NO == pipelining && [internal->expect count] > 0)
+	{
+	  break;	// Must wait for the reply to the last command.
 	}
-      else if (internal->cState == TP_FROM)
+
+      doc = [internal->queue objectAtIndex: internal->inflight - 1];
+      version = [doc headerNamed: @"mime-version"];
+      if (internal->step == TP_TO)
 	{
-	  tmp = [[internal->current headerNamed: @"to"] value];
-	  if (nil == [internal->version objectForKey: @"ENVID"])
+	  tmp = [[doc headerNamed: @"to"] value];
+	  if (nil == [version objectForKey: @"ENVID"])
 	    {
 	      tmp = [NSString stringWithFormat: @"RCPT TO: <%@>\r\n", tmp];
 	    }
@@ -8397,18 +8975,39 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 		@"RCPT TO: <%@> NOTIFY=SUCCESS,FAILURE\r\n", tmp];
 	    }
 	  NSDebugMLLog(@"GSMime", @"Destination - %@", tmp);
-	  internal->cState = TP_TO;
+	  internal->step = TP_DATA;
+	  [self _expect: TP_TO];
 	  [self _timer: 20.0];
 	  [self _sendData: [tmp dataUsingEncoding: NSUTF8StringEncoding]];
-        }
-      else if (internal->cState == TP_TO)
+	}
+      else if (internal->step == TP_DATA && YES == chunking)
 	{
-	  internal->cState = TP_DATA;
+	  NSData	*data;
+
+	  /* With BDAT the body is sent as it is, immediately after the
+	   * command giving its length, so no escaping is needed and we
+	   * need not wait for the server before sending it.
+	   */
+          makeBase64(doc);
+          data = [doc rawMimeData];
+	  tmp = [NSString stringWithFormat: @"BDAT %"PRIuPTR" LAST\r\n",
+	    [data length]];
+	  internal->step = TP_MESG;
+	  [self _expect: TP_BODY];
+	  [self _timer: 60.0];
+	  [self _sendData: [tmp dataUsingEncoding: NSUTF8StringEncoding]];
+	  [self _sendData: data];
+	}
+      else if (internal->step == TP_DATA)
+	{
+	  internal->step = TP_BODY;
+	  internal->dataReady = NO;
           tmp = @"DATA\r\n";
+	  [self _expect: TP_DATA];
 	  [self _timer: 20.0];
 	  [self _sendData: [tmp dataUsingEncoding: NSUTF8StringEncoding]];
 	}
-      else if (internal->cState == TP_DATA)
+      else if (internal->step == TP_BODY)
 	{
 	  NSMutableData	*md;
 	  NSData	*data;
@@ -8421,10 +9020,15 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 	  unsigned	ipos = 0;
 	  unsigned	opos = 0;
 
-	  internal->cState = TP_BODY;
+	  if (NO == internal->dataReady)
+	    {
+	      break;	// Wait for the server to accept the DATA command.
+	    }
+	  internal->dataReady = NO;
+	  internal->step = TP_MESG;
 
-          makeBase64(internal->current);
-          data = [internal->current rawMimeData];
+          makeBase64(doc);
+          data = [doc rawMimeData];
 
 	  /*
 	   * Any line in the message which begins with a dot must have
@@ -8471,20 +9075,65 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 	  obuf[opos++] = '\r';
 	  obuf[opos++] = '\n';
 	  [md setLength: opos];
+	  [self _expect: TP_BODY];
 	  [self _timer: 60.0];
 	  [self _sendData: md];
 	  RELEASE(md);
         }
+    }
+}
+
+/** Records that a reply to a command of the type given by s is expected.
+ * Replies arrive in the order the commands were sent, so the state of the
+ * receiver is that of the oldest command awaiting a reply.
+ */
+- (void) _expect: (int)s
+{
+  [internal->expect addObject: [NSNumber numberWithInt: s]];
+  if (1 == [internal->expect count])
+    {
+      internal->cState = s;
+    }
+}
+
+/** Removes the oldest message in progress from the queue once all the
+ * replies for it have been received, and informs the delegate.
+ */
+- (void) _finished: (BOOL)sent
+{
+  GSMimeDocument	*d = [[internal->queue objectAtIndex: 0] retain];
+
+  internal->current = nil;
+  internal->failed = NO;
+  internal->inflight--;
+  [internal->queue removeObjectAtIndex: 0];
+  if (internal->inflight > 0)
+    {
+      internal->current = [internal->queue objectAtIndex: 0];
+    }
+  if (YES == sent)
+    {
+      if (nil == internal->delegate)
+	{
+	  NSDebugMLLog(@"GSMime", @"-smtpClient:mimeSent: %@ %@", self, d);
+	}
       else
 	{
-	  NSLog(@"_doMessage called in unexpected state.");
-	  [self _shutdown: nil];
+	  [internal->delegate smtpClient: self mimeSent: d];
 	}
     }
   else
     {
-      [self _shutdown: nil];
+      if (nil == internal->delegate)
+	{
+	  NSDebugMLLog(@"GSMime", @"-smtpClient:mimeFailed: %@ %@", self, d);
+	}
+      else
+	{
+	  [internal->delegate smtpClient: self mimeFailed: d];
+	}
     }
+  [d release];
 }
 
 - (NSString*) _identity
@@ -8687,6 +9336,30 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 	  return;
 	}
 
+      /*
+       * Each line after the first of a reply to EHLO names an extension
+       * supported by the server.
+       */
+      if (internal->cState == TP_EHLO && [internal->reply length] > 0)
+	{
+	  NSString	*ext;
+
+	  ext = [[[s substringFromIndex: 4] componentsSeparatedByString: @" "]
+	    objectAtIndex: 0];
+	  if ([ext caseInsensitiveCompare: @"PIPELINING"] == NSOrderedSame)
+	    {
+	      internal->extensions |= (1 << SMTPE_PIPELINING);
+	    }
+	  else if ([ext caseInsensitiveCompare: @"CHUNKING"] == NSOrderedSame)
+	    {
+	      internal->extensions |= (1 << SMTPE_CHUNKING);
+	    }
+	  else if ([ext caseInsensitiveCompare: @"DSN"] == NSOrderedSame)
+	    {
+	      internal->extensions |= (1 << SMTPE_DSN);
+	    }
+	}
+
       /*
        * Accumulate multiline replies in the 'reply' ivar.
        */
@@ -8721,9 +9394,10 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 	  {
 	    NSString	*tmp;
 
-	    tmp = [NSString stringWithFormat: @"HELO %@\r\n", [self _identity]];
-	    NSDebugMLLog(@"GSMime", @"Intro OK - sending helo");
-	    internal->cState = TP_HELO;
+	    tmp = [NSString stringWithFormat: @"EHLO %@\r\n", [self _identity]];
+	    NSDebugMLLog(@"GSMime", @"Intro OK - sending ehlo");
+	    internal->extensions = 0;
+	    internal->cState = TP_EHLO;
 	    [self _timer: 30.0];
 	    [self _sendData: [tmp dataUsingEncoding: NSUTF8StringEncoding]];
 	  }
@@ -8735,7 +9409,7 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 	break;
 
       case TP_EHLO:
-	if (c == 220)
+	if (c == 250)
 	  {
 	    NSDebugMLLog(@"GSMime", @"System acknowledged EHLO");
 	    if ([internal->username length] == 0)
@@ -8761,6 +9435,7 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 
 	    tmp = [NSString stringWithFormat: @"HELO %@\r\n", [self _identity]];
 	    NSDebugMLLog(@"GSMime", @"Ehlo failed - sending helo");
+	    internal->extensions = 0;
 	    internal->cState = TP_HELO;
 	    [self _timer: 30.0];
 	    [self _sendData: [tmp dataUsingEncoding: NSUTF8StringEncoding]];
@@ -8810,71 +9485,78 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
 	break;
 
       case TP_FROM:
-	if (c != 250)
-	  {
-	    NSLog(@"Server nacked FROM... %@", s);
-	    [self _shutdown: [self _response: s]];
-	  }
-	else
-	  {
-	    NSDebugMLLog(@"GSMime", @"System acknowledged FROM");
-	    [self _doMessage];
-	  }
-	break;
-
       case TP_TO:
-	if (c != 250)
-	  {
-	    NSLog(@"Server nacked TO... %@", s);
-	    [self _shutdown: [self _response: s]];
-	  }
-	else
-	  {
-	    NSDebugMLLog(@"GSMime", @"System acknowledged TO");
-	    [self _doMessage];
-	  }
-	break;
-
       case TP_DATA:
-	if (c != 354)
-	  {
-	    NSLog(@"Server nacked DATA... %@", s);
-	    [self _shutdown: [self _response: s]];
-	  }
-	else
-	  {
-	    [self _doMessage];
-	  }
-	break;
-
       case TP_BODY:
-	if (c != 250)
-	  {
-	    NSLog(@"Server nacked body ... %@", s);
-	    [self _shutdown: [self _response: s]];
-	  }
-	else
-	  {
-            internal->cState = TP_MESG;
-	    if (internal->current != nil)
-	      {
-		GSMimeDocument	*d = [internal->current retain];
+	{
+	  int		expected = internal->cState;
+	  NSError	*e = nil;
 
-		internal->current = nil;
-		[internal->queue removeObjectAtIndex: 0];
-		if (nil == internal->delegate)
-		  {
-		    NSDebugMLLog(@"GSMime", @"-smtpClient:mimeSent: %@ %@",
-		      self, d);
-		  }
-		else
-		  {
-		    [internal->delegate smtpClient: self mimeSent: d];
-		  }
-		[d release];
-	      }
-            [self _doMessage];
-	  }
+	  if (c != ((expected == TP_DATA) ? 354 : 250))
+	    {
+	      NSLog(@"Server nacked %@ ... %@", commandName(expected), s);
+	      e = [self _response: s];
+	    }
+	  [internal->expect removeObjectAtIndex: 0];
+	  if ([internal->expect count] > 0)
+	    {
+	      internal->cState = [[internal->expect objectAtIndex: 0] intValue];
+	    }
+	  else
+	    {
+	      internal->cState = TP_MESG;
+	    }
+	  if (nil == e)
+	    {
+	      NSDebugMLLog(@"GSMime", @"System acknowledged %@",
+		commandName(expected));
+	      if (expected == TP_DATA)
+		{
+		  if (YES == internal->failed)
+		    {
+		      /* The server should have rejected DATA after failing
+		       * the earlier command, so we can't trust it.
+		       */
+		      NSLog(@"Server accepted DATA after failure ... %@", s);
+		      [self _shutdown: internal->lastError];
+		      return;
+		    }
+		  internal->dataReady = YES;
+		}
+	      else if (expected == TP_BODY)
+		{
+		  [self _finished: (NO == internal->failed) ? YES : NO];
+		}
+	    }
+	  else if (NO == SMTPE_HAS(SMTPE_PIPELINING))
+	    {
+	      [self _shutdown: e];
+	      return;
+	    }
+	  else
+	    {
+	      /* The commands following the failed one have already been
+	       * sent, so rather than dropping the connection we note that
+	       * the message failed and wait for the remaining replies.
+	       * The server fails everything up to the end of the message.
+	       */
+	      ASSIGN(internal->lastError, e);
+	      internal->failed = YES;
+	      if (expected == TP_DATA || expected == TP_BODY)
+		{
+		  if (expected == TP_DATA)
+		    {
+		      internal->step = TP_MESG;	// No body to send
+		    }
+		  [self _finished: NO];
+		}
+	    }
+	  [self _doMessage];
+	  if ([internal->expect count] > 0)
+	    {
+	      [self _timer: 60.0];
+	    }
+	}
 	break;
 
       case TP_MESG:
@@ -8956,6 +9638,16 @@ GS_PRIVATE_INTERNAL(GSMimeSMTPClient)
   internal->writable = NO;
   internal->cState = TP_IDLE;
 
+  /* Messages other than the current one which were in progress have not
+   * been accepted by the server, so they stay queued for another try.
+   */
+  [internal->expect removeAllObjects];
+  internal->inflight = 0;
+  internal->step = TP_MESG;
+  internal->dataReady = NO;
+  internal->failed = NO;
+  internal->extensions = 0;
+
   [internal->pending removeAllObjects];
   ASSIGN(internal->lastError, e);
   if (nil == internal->current)
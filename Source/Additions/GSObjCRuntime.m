@@ -526,6 +526,8 @@ GSObjCBehaviorDebug(int setget)
   return old;
 }
 
+unsigned	GSPrivateMethodsGeneration = 0;
+
 void
 GSObjCAddMethods(Class cls, Method *list, BOOL replace)
 {
@@ -564,6 +566,7 @@ GSObjCAddMethods(Class cls, Method *list, BOOL replace)
           BDBGPrintf("    skipped %c%s\n", c, sel_getName(n));
 	}
     }
+  GSPrivateMethodsGeneration++;
 }
 
 GSMethod
@@ -28,6 +28,7 @@
 #import "Foundation/NSException.h"
 #import "GNUstepBase/NSData+GNUstepBase.h"
 #import "GNUstepBase/NSString+GNUstepBase.h"
+#import "GSPrivate.h"
 
 #include <ctype.h>
 
@@ -116,6 +117,23 @@ randombytes(uint8_t *buf, unsigned len)
   return AUTORELEASE(d);
 }
 
+- (NSString*) base64URLEncodedStringWithPadding: (BOOL)pad
+{
+  NSUInteger	length = [self length];
+  uint8_t	*buf;
+  NSString	*string;
+
+  buf = NSZoneMalloc(NSDefaultMallocZone(),
+    GSPrivateBase64EncodedLength(length, 0, 0) + 1);
+  length = GSPrivateEncodeBase64URL((const uint8_t*)[self bytes], length,
+    buf, pad);
+  string = [[NSString alloc] initWithBytesNoCopy: buf
+                                          length: length
+                                        encoding: NSASCIIStringEncoding
+                                    freeWhenDone: YES];
+  return AUTORELEASE(string);
+}
+
 - (NSString*) escapedRepresentation
 {
   char          *buf;
@@ -348,6 +366,42 @@ randombytes(uint8_t *buf, unsigned len)
   return nil;
 }
 
+/**
+ * Initialises the receiver with the bytes of a base64url coding, with or
+ * without padding, returning nil if the string is not a valid coding.
+ */
+- (id) initWithBase64URLEncodedString: (NSString*)string
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSData		*d;
+  uint8_t		*dst;
+  NSUInteger		length;
+
+  d = [string dataUsingEncoding: NSASCIIStringEncoding];
+  length = [d length];
+  dst = NSZoneMalloc(NSDefaultMallocZone(), length / 4 * 3 + 2);
+  if (nil == d)
+    {
+      length = NSNotFound;	// Not even ASCII
+    }
+  else
+    {
+      length = GSPrivateDecodeBase64URL((const uint8_t*)[d bytes],
+	length, dst);
+    }
+  if (NSNotFound == length)
+    {
+      NSZoneFree(NSDefaultMallocZone(), dst);
+      DESTROY(self);
+    }
+  else
+    {
+      self = [self initWithBytesNoCopy: dst length: length freeWhenDone: YES];
+    }
+  [arp drain];
+  return self;
+}
+
 /**
  * Initialises the receiver with the supplied string data which contains
  * a hexadecimal coding of the bytes.  The parsing of the string is
@@ -23,13 +23,59 @@
 
 */
 #import "common.h"
+#import "Foundation/NSData.h"
+#import "Foundation/NSDate.h"
+#import "Foundation/NSDictionary.h"
+#import "Foundation/NSException.h"
+#import "Foundation/NSFileHandle.h"
 #import "Foundation/NSFileManager.h"
 #import "Foundation/NSPathUtilities.h"
 #import "Foundation/NSProcessInfo.h"
 #import "Foundation/NSSet.h"
+#import "Foundation/NSValue.h"
 #import "GNUstepBase/NSString+GNUstepBase.h"
 #import "GNUstepBase/NSTask+GNUstepBase.h"
 
+#if	!defined(_WIN32)
+#include <poll.h>
+
+/* State of one task being run by +runTasks:maxConcurrent:
+ */
+typedef struct {
+  NSTask		*task;
+  NSFileHandle		*out;		/* Nil once end of file is read	*/
+  NSFileHandle		*err;		/* Nil once end of file is read	*/
+  NSMutableData		*outData;
+  NSMutableData		*errData;
+  NSTimeInterval	start;
+  NSDictionary		*result;
+} GSTaskRun;
+
+/* Read what is available from a pipe, closing it at end of file.
+ */
+static void
+readPipe(NSFileHandle **handle, NSMutableData *data)
+{
+  char		buf[BUFSIZ * 8];
+  ssize_t	len;
+
+  len = read([*handle fileDescriptor], buf, sizeof(buf));
+  if (len > 0)
+    {
+      [data appendBytes: buf length: len];
+    }
+  else if (len < 0 && (errno == EINTR || errno == EAGAIN))
+    {
+      return;
+    }
+  else
+    {
+      [*handle closeFile];
+      DESTROY(*handle);
+    }
+}
+#endif
+
 @implementation	NSTask (GNUstepBase)
 
 + (NSSet*) executableExtensions
@@ -179,4 +225,177 @@ executablePath(NSFileManager *mgr, NSString *path)
     }
   return nil;
 }
+
+#if	!defined(_WIN32)
++ (NSArray*) runTasks: (NSArray*)tasks maxConcurrent: (NSUInteger)max
+{
+  NSUInteger		count = [tasks count];
+  NSMutableArray	*results;
+  GSTaskRun		*runs;
+  NSUInteger		*active;	/* Indexes of running tasks	*/
+  NSUInteger		activeCount = 0;
+  struct pollfd		*fds;
+  NSUInteger		*owners;	/* Task index for each pollfd	*/
+  NSUInteger		next = 0;
+  NSUInteger		done = 0;
+  int			wait = 1;	/* Milliseconds to wait for exit */
+  NSUInteger		i;
+
+  results = [NSMutableArray arrayWithCapacity: count];
+  if (count == 0)
+    {
+      return results;
+    }
+  if (max == 0 || max > count)
+    {
+      max = count;
+    }
+  runs = calloc(count, sizeof(GSTaskRun));
+  active = malloc(max * sizeof(NSUInteger));
+  fds = malloc(2 * max * sizeof(struct pollfd));
+  owners = malloc(2 * max * sizeof(NSUInteger));
+
+  while (done < count)
+    {
+      ENTER_POOL
+      NSUInteger	nfds = 0;
+      int		timeout = -1;
+
+      /* Start as many more tasks as we are allowed to.
+       */
+      while (next < count && activeCount < max)
+	{
+	  GSTaskRun	*r = &runs[next];
+	  NSPipe	*outPipe = [NSPipe pipe];
+	  NSPipe	*errPipe = [NSPipe pipe];
+
+	  r->task = [tasks objectAtIndex: next];
+	  [r->task setStandardOutput: outPipe];
+	  [r->task setStandardError: errPipe];
+	  r->start = [NSDate timeIntervalSinceReferenceDate];
+	  NS_DURING
+	    {
+	      [r->task launch];
+	      r->out = RETAIN([outPipe fileHandleForReading]);
+	      r->err = RETAIN([errPipe fileHandleForReading]);
+	      r->outData = [NSMutableData new];
+	      r->errData = [NSMutableData new];
+	      active[activeCount++] = next;
+	    }
+	  NS_HANDLER
+	    {
+	      r->result = [[NSDictionary alloc] initWithObjectsAndKeys:
+		localException, @"Exception", nil];
+	      done++;
+	    }
+	  NS_ENDHANDLER
+	  next++;
+	}
+
+      /* Gather the pipes still open, and deal with tasks whose pipes
+       * are all closed, which must have terminated or be about to.
+       */
+      i = 0;
+      while (i < activeCount)
+	{
+	  GSTaskRun	*r = &runs[active[i]];
+
+	  if (r->out != nil)
+	    {
+	      fds[nfds].fd = [r->out fileDescriptor];
+	      fds[nfds].events = POLLIN;
+	      owners[nfds++] = active[i];
+	    }
+	  if (r->err != nil)
+	    {
+	      fds[nfds].fd = [r->err fileDescriptor];
+	      fds[nfds].events = POLLIN;
+	      owners[nfds++] = active[i];
+	    }
+	  if (r->out == nil && r->err == nil)
+	    {
+	      if ([r->task isRunning] == YES)
+		{
+		  timeout = wait;
+		}
+	      else
+		{
+		  NSTimeInterval	t;
+
+		  t = [NSDate timeIntervalSinceReferenceDate] - r->start;
+		  r->result = [[NSDictionary alloc] initWithObjectsAndKeys:
+		    r->outData, @"StandardOutput",
+		    r->errData, @"StandardError",
+		    [NSNumber numberWithInt: [r->task terminationStatus]],
+		    @"TerminationStatus",
+		    [NSNumber numberWithInt: [r->task terminationReason]],
+		    @"TerminationReason",
+		    [NSNumber numberWithDouble: t], @"Duration",
+		    nil];
+		  DESTROY(r->outData);
+		  DESTROY(r->errData);
+		  active[i] = active[--activeCount];
+		  done++;
+		  continue;
+		}
+	    }
+	  i++;
+	}
+      if (next < count && activeCount < max)
+	{
+	  timeout = 0;	// Go straight back to start more tasks.
+	}
+
+      /* A task which has closed its pipes may run on for a long time,
+       * so we wait longer each time we find it still running (up to a
+       * tenth of a second) rather than spin until it exits.
+       */
+      if (timeout > 0)
+	{
+	  wait = (wait < 50) ? wait * 2 : 100;
+	}
+      else
+	{
+	  wait = 1;
+	}
+
+      if (nfds > 0 || timeout > 0)
+	{
+	  if (poll(fds, nfds, timeout) > 0)
+	    {
+	      for (i = 0; i < nfds; i++)
+		{
+		  GSTaskRun	*r = &runs[owners[i]];
+
+		  if (fds[i].revents == 0)
+		    {
+		      continue;
+		    }
+		  if (r->out != nil && fds[i].fd == [r->out fileDescriptor])
+		    {
+		      readPipe(&r->out, r->outData);
+		    }
+		  else if (r->err != nil
+		    && fds[i].fd == [r->err fileDescriptor])
+		    {
+		      readPipe(&r->err, r->errData);
+		    }
+		}
+	    }
+	}
+      LEAVE_POOL
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      [results addObject: runs[i].result];
+      RELEASE(runs[i].result);
+    }
+  free(owners);
+  free(fds);
+  free(active);
+  free(runs);
+  return results;
+}
+#endif
 @end
@@ -0,0 +1,351 @@
+/* Implementation of concurrent sorting for GNUStep
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNUstep Base Library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110 USA.
+   */
+
+#import "common.h"
+#import "Foundation/NSSortDescriptor.h"
+
+#import "Foundation/NSException.h"
+
+#import "GNUstepBase/GSObjCRuntime.h"
+#import "GSPrivate.h"
+#import "GSSorting.h"
+
+/*
+ * About this implementation.
+ *
+ * The range is cut into chunks which are sorted at the same time using
+ * the normal (stable or unstable) sort.  The sorted chunks are then
+ * merged in pairs, alternating between the original buffer and a
+ * temporary one, until a single run is left.  So that every thread has
+ * work even when only a few runs remain, each merge is split into parts
+ * at points found by binary search, each part being merged independently.
+ * Merging always takes from the left run first when values are equal, so
+ * the result is stable if the chunk sort is.
+ *
+ * The work of each round is shared between the calling thread and the
+ * worker threads of GSPrivateParallelApply().  The caller has promised
+ * (by asking for a concurrent sort) that the comparison may be performed
+ * in several threads at once.
+ */
+
+/* Ranges smaller than this are sorted in the calling thread only.
+ */
+#define	GS_CONCURRENT_SORT_MIN	16384
+
+typedef struct {
+  NSRange	a;	/* Range to sort, or first run to merge */
+  NSRange	b;	/* Second run to merge (empty if sorting) */
+  NSUInteger	at;	/* Where the merge output starts */
+} GSSortTask;
+
+typedef struct {
+  id			*from;		/* Input to the current round */
+  id			*to;		/* Output of the current round */
+  id			comparisonEntity;
+  GSComparisonType	comparisonType;
+  void			*context;
+  BOOL			stable;
+  BOOL			sorting;	/* Tasks sort rather than merge */
+  GSSortTask		*tasks;
+} GSConcurrentSortState;
+
+@interface GSConcurrentSortPlaceHolder : NSObject
+@end
+
+static void
+_GSConcurrentSort(id *objects,
+  NSRange sortRange,
+  id comparisonEntity,
+  GSComparisonType comparisonType,
+  void *context);
+
+static void
+_GSConcurrentSortUnstable(id *objects,
+  NSRange sortRange,
+  id comparisonEntity,
+  GSComparisonType comparisonType,
+  void *context);
+
+@implementation GSConcurrentSortPlaceHolder
++ (void) load
+{
+  _GSSortStableConcurrent = _GSConcurrentSort;
+  _GSSortUnstableConcurrent = _GSConcurrentSortUnstable;
+}
+@end
+
+/* Performs one task, merging from the input buffer to the output or
+ * sorting a chunk of the input in place.
+ */
+static void
+performTask(void *context, NSUInteger item)
+{
+  GSConcurrentSortState	*s = (GSConcurrentSortState*)context;
+  GSSortTask		*t = &s->tasks[item];
+
+  if (YES == s->sorting)
+    {
+      if (YES == s->stable)
+	{
+	  GSSortStable(s->from, t->a, s->comparisonEntity, s->comparisonType,
+	    s->context);
+	}
+      else
+	{
+	  GSSortUnstable(s->from, t->a, s->comparisonEntity, s->comparisonType,
+	    s->context);
+	}
+    }
+  else
+    {
+      id		*from = s->from;
+      id		*to = s->to;
+      NSUInteger	i = t->a.location;
+      NSUInteger	ie = NSMaxRange(t->a);
+      NSUInteger	j = t->b.location;
+      NSUInteger	je = NSMaxRange(t->b);
+      NSUInteger	k = t->at;
+
+      while (i < ie && j < je)
+	{
+	  if (GSCompareUsingDescriptorOrComparator(from[j], from[i],
+	    s->comparisonEntity, s->comparisonType, s->context)
+	    == NSOrderedAscending)
+	    {
+	      to[k++] = from[j++];
+	    }
+	  else
+	    {
+	      to[k++] = from[i++];
+	    }
+	}
+      if (i < ie)
+	{
+	  memcpy(to + k, from + i, (ie - i) * sizeof(id));
+	}
+      else if (j < je)
+	{
+	  memcpy(to + k, from + j, (je - j) * sizeof(id));
+	}
+    }
+}
+
+/* Returns the index of the first object in run which is not ordered
+ * before key, so that equal objects from the left run stay first.
+ */
+static NSUInteger
+splitRun(GSConcurrentSortState *s, NSRange run, id key)
+{
+  NSUInteger	lo = run.location;
+  NSUInteger	hi = NSMaxRange(run);
+
+  while (lo < hi)
+    {
+      NSUInteger	mid = lo + (hi - lo) / 2;
+
+      if (GSCompareUsingDescriptorOrComparator(s->from[mid], key,
+	s->comparisonEntity, s->comparisonType, s->context)
+	== NSOrderedAscending)
+	{
+	  lo = mid + 1;
+	}
+      else
+	{
+	  hi = mid;
+	}
+    }
+  return lo;
+}
+
+static void
+sortObjects(GSConcurrentSortState *s, id *objects, NSUInteger count,
+  NSUInteger nChunks)
+{
+  NSUInteger	nRuns = nChunks;
+  NSRange	*runs;
+  id		*temp;
+  NSUInteger	i;
+
+  temp = (id*)malloc(count * sizeof(id));
+  runs = (NSRange*)malloc(nRuns * sizeof(NSRange));
+  s->tasks = (GSSortTask*)malloc(2 * nChunks * sizeof(GSSortTask));
+  if (NULL == temp || NULL == runs || NULL == s->tasks)
+    {
+      free(temp);
+      free(runs);
+      free(s->tasks);
+      [NSException raise: NSMallocException
+		  format: @"Unable to allocate memory for sorting"];
+    }
+  s->from = objects;
+  s->to = temp;
+
+  NS_DURING
+    {
+      /* Sort each chunk.
+       */
+      s->sorting = YES;
+      for (i = 0; i < nRuns; i++)
+	{
+	  NSUInteger	start = count * i / nRuns;
+
+	  runs[i] = NSMakeRange(start, count * (i + 1) / nRuns - start);
+	  s->tasks[i].a = runs[i];
+	  s->tasks[i].b = NSMakeRange(0, 0);
+	  s->tasks[i].at = 0;
+	}
+      GSPrivateParallelApply(nRuns, performTask, s);
+
+      /* Merge pairs of runs, splitting each merge into enough parts to
+       * keep all the threads busy.
+       */
+      s->sorting = NO;
+      while (nRuns > 1)
+	{
+	  NSUInteger	pairs = nRuns / 2;
+	  NSUInteger	parts = (nChunks + pairs - 1) / pairs;
+	  NSUInteger	n = 0;
+	  NSUInteger	r;
+	  id		*swap;
+
+	  for (r = 0; r < pairs; r++)
+	    {
+	      NSRange		a = runs[2 * r];
+	      NSRange		b = runs[2 * r + 1];
+	      NSUInteger	bStart = b.location;
+	      NSUInteger	p;
+
+	      for (p = 0; p < parts; p++)
+		{
+		  NSUInteger	aStart = a.location + a.length * p / parts;
+		  NSUInteger	aEnd = a.location + a.length * (p + 1) / parts;
+		  NSUInteger	bEnd;
+
+		  if (p + 1 < parts)
+		    {
+		      bEnd = splitRun(s,
+			NSMakeRange(bStart, NSMaxRange(b) - bStart),
+			s->from[aEnd]);
+		    }
+		  else
+		    {
+		      bEnd = NSMaxRange(b);
+		    }
+		  s->tasks[n].a = NSMakeRange(aStart, aEnd - aStart);
+		  s->tasks[n].b = NSMakeRange(bStart, bEnd - bStart);
+		  s->tasks[n].at = aStart + (bStart - b.location);
+		  n++;
+		  bStart = bEnd;
+		}
+	      runs[r] = NSMakeRange(a.location, a.length + b.length);
+	    }
+	  if (nRuns % 2 == 1)
+	    {
+	      /* Copy the odd run over unchanged.
+	       */
+	      s->tasks[n].a = runs[nRuns - 1];
+	      s->tasks[n].b = NSMakeRange(NSMaxRange(runs[nRuns - 1]), 0);
+	      s->tasks[n].at = runs[nRuns - 1].location;
+	      n++;
+	      runs[pairs] = runs[nRuns - 1];
+	    }
+	  nRuns = (nRuns + 1) / 2;
+	  GSPrivateParallelApply(n, performTask, s);
+	  swap = s->from;
+	  s->from = s->to;
+	  s->to = swap;
+	}
+    }
+  NS_HANDLER
+    {
+      /* The input to the failed round is complete, so make sure that is
+       * what the caller is left with.
+       */
+      if (s->from != objects)
+	{
+	  memcpy(objects, s->from, count * sizeof(id));
+	}
+      free(temp);
+      free(runs);
+      free(s->tasks);
+      [localException raise];
+    }
+  NS_ENDHANDLER
+
+  if (s->from != objects)
+    {
+      memcpy(objects, s->from, count * sizeof(id));
+    }
+  free(temp);
+  free(runs);
+  free(s->tasks);
+}
+
+static void
+sortConcurrently(id *objects, NSRange sortRange, id comparisonEntity,
+  GSComparisonType comparisonType, void *context, BOOL stable)
+{
+  GSConcurrentSortState	s;
+  NSUInteger		nChunks;
+
+  nChunks = sortRange.length / (GS_CONCURRENT_SORT_MIN / 2);
+  if (nChunks > GSPrivateParallelWidth())
+    {
+      nChunks = GSPrivateParallelWidth();
+    }
+  if (nChunks < 2)
+    {
+      if (YES == stable)
+	{
+	  GSSortStable(objects, sortRange, comparisonEntity, comparisonType,
+	    context);
+	}
+      else
+	{
+	  GSSortUnstable(objects, sortRange, comparisonEntity, comparisonType,
+	    context);
+	}
+      return;
+    }
+
+  memset(&s, '\0', sizeof(s));
+  s.comparisonEntity = comparisonEntity;
+  s.comparisonType = comparisonType;
+  s.context = context;
+  s.stable = stable;
+  sortObjects(&s, objects + sortRange.location, sortRange.length, nChunks);
+}
+
+static void
+_GSConcurrentSort(id *objects, NSRange sortRange, id comparisonEntity,
+  GSComparisonType comparisonType, void *context)
+{
+  sortConcurrently(objects, sortRange, comparisonEntity, comparisonType,
+    context, YES);
+}
+
+static void
+_GSConcurrentSortUnstable(id *objects, NSRange sortRange,
+  id comparisonEntity, GSComparisonType comparisonType, void *context)
+{
+  sortConcurrently(objects, sortRange, comparisonEntity, comparisonType,
+    context, NO);
+}
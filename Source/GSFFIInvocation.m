@@ -137,6 +137,14 @@ static IMP gs_objc_msg_forward2 (id receiver, SEL sel)
 
   if (NULL != (types = GSTypesFromSelector(sel)))
     {
+      /* The closure for a set of types does not depend on the receiver,
+       * so if we already have one there is no need for a signature.
+       */
+      memory = cifframe_cached_closure(types, GSFFIInvocationCallback);
+      if (nil != memory)
+	{
+	  return (IMP)[memory executable];
+	}
       sig = [NSMethodSignature signatureWithObjCTypes: types];
     }
 
@@ -312,8 +320,8 @@ static id gs_objc_proxy_lookup(id receiver, SEL op)
 }
 
 /* Initializer used when we get a callback. uses the data provided by
-   the callback. The cifframe was allocated by the forwarding function,
-   but we own it now so we can free it */
+   the callback. The cifframe belongs to the closure and may be in use
+   by other calls at the same time, so we work with a copy of it */
 - (id) initWithCallback: (ffi_cif *)cif
 		 values: (void **)vals
 		  frame: (void *)frame
@@ -325,7 +333,7 @@ static id gs_objc_proxy_lookup(id receiver, SEL op)
   _sig = RETAIN(aSignature);
   _numArgs = [aSignature numberOfArguments];
   _info = [aSignature methodInfo];
-  _frame = (NSMutableData*)frame;
+  _frame = cifframe_copy((NSMutableData*)frame);
   [_frame retain];
   _cframe = [_frame mutableBytes];
   f = (cifframe_t *)_cframe;
@@ -97,6 +97,7 @@ struct sockaddr_in;
 - (id) initWithStandardOutput;
 - (id) initWithNullDevice;
 
+- (void) cancelRead;
 - (void) checkAccept;
 - (void) checkConnect;
 - (void) checkRead;
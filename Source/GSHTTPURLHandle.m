@@ -29,6 +29,7 @@
 #import "Foundation/NSEnumerator.h"
 #import "Foundation/NSByteOrder.h"
 #import "Foundation/NSData.h"
+#import "Foundation/NSDate.h"
 #import "Foundation/NSException.h"
 #import "Foundation/NSFileHandle.h"
 #import "Foundation/NSHost.h"
@@ -48,6 +49,7 @@
 #import "GNUstepBase/NSString+GNUstepBase.h"
 #import "GNUstepBase/NSURL+GNUstepBase.h"
 #import "NSCallBacks.h"
+#import "GSFileHandle.h"
 #import "GSURLPrivate.h"
 #import "GSPrivate.h"
 
@@ -113,6 +115,7 @@ static NSString	*httpVersion = @"1.1";
   NSFileHandle          *sock;
   NSTimeInterval        cacheAge;
   NSString              *urlKey;
+  NSString              *poolKey;
   NSURL                 *url;
   NSURL                 *u;
   NSMutableData         *dat;
@@ -135,10 +138,43 @@ static NSString	*httpVersion = @"1.1";
   NSString      *out;
 }
 + (void) setMaxCached: (NSUInteger)limit;
++ (void) setMaxPooled: (NSUInteger)limit;
++ (void) setPoolTimeout: (NSTimeInterval)seconds;
++ (NSDictionary*) poolStatistics;
+- (NSString*) _poolKeyForHost: (NSString*)host port: (NSString*)port;
+- (void) _poolSocket;
 - (void) _tryLoadInBackground: (NSURL*)fromURL;
 - (id<GSLogDelegate>) setDebugLogDelegate: (id<GSLogDelegate>)d;
 @end
 
+/* An idle keep-alive connection which has been given up by the handle
+ * that created it and is waiting in the pool to be adopted by another
+ * handle wanting to talk to the same server.
+ */
+@interface GSHTTPPooledSocket : NSObject
+{
+@public
+  NSFileHandle          *sock;
+  NSString              *in;
+  NSString              *out;
+  NSTimeInterval        when;
+}
+@end
+
+@implementation GSHTTPPooledSocket
+- (void) dealloc
+{
+  if (sock != nil)
+    {
+      [sock closeFile];
+      DESTROY(sock);
+    }
+  DESTROY(in);
+  DESTROY(out);
+  [super dealloc];
+}
+@end
+
 /**
  * <p>
  *   This is a <em>PRIVATE</em> subclass of NSURLHandle.
@@ -224,6 +260,17 @@ static NSString	*httpVersion = @"1.1";
  *   &quot;GSHTTPPropertyLocalHostKey&quot;  which must contain the
  *   IP address of a network interface on the local host.
  * </p>
+ * <p>
+ *   When a handle is destroyed (or changed to a different URL) while
+ *   it holds an idle keep-alive connection, the connection is placed
+ *   in a per-server pool rather than being closed, and the next handle
+ *   needing to talk to the same server will adopt it instead of having
+ *   to establish (and possibly negotiate TLS for) a new connection.
+ *   Connections made via a proxy or using a client certificate are
+ *   never pooled.  Pooled connections are checked to make sure the
+ *   remote end has not closed them before re-use, and are discarded
+ *   once they have been idle for longer than the pool timeout.
+ * </p>
  */
 @implementation GSHTTPURLHandle
 
@@ -232,6 +279,16 @@ static NSMutableArray		*urlOrder = nil;
 static NSLock			*urlLock = nil;
 static NSUInteger               maxCached = 16;
 
+static NSMutableDictionary	*connPool = nil;
+static NSLock			*poolLock = nil;
+static NSUInteger               maxPooled = 4;
+static NSTimeInterval           poolTimeout = 30.0;
+static NSUInteger               poolHits = 0;
+static NSUInteger               poolMisses = 0;
+static NSUInteger               poolStale = 0;
+static NSUInteger               poolAdded = 0;
+static NSUInteger               poolDiscarded = 0;
+
 static Class			sslClass = 0;
 
 static void
@@ -330,6 +387,10 @@ debugWrite(GSHTTPURLHandle *handle, NSData *data)
       [[NSObject leakAt: &urlOrder] release];
       urlLock = [NSLock new];
       [[NSObject leakAt: &urlLock] release];
+      connPool = [NSMutableDictionary new];
+      [[NSObject leakAt: &connPool] release];
+      poolLock = [NSLock new];
+      [[NSObject leakAt: &poolLock] release];
 #if	!defined(_WIN32)
       sslClass = [NSFileHandle sslClass];
 #endif
@@ -341,19 +402,184 @@ debugWrite(GSHTTPURLHandle *handle, NSData *data)
   maxCached = limit;
 }
 
+/* Sets the maximum number of idle connections kept in the pool for
+ * any one server.  Setting a limit of zero disables pooling.
+ */
++ (void) setMaxPooled: (NSUInteger)limit
+{
+  NSEnumerator          *e;
+  NSMutableArray        *a;
+
+  [poolLock lock];
+  maxPooled = limit;
+  e = [connPool objectEnumerator];
+  while ((a = [e nextObject]) != nil)
+    {
+      while ([a count] > maxPooled)
+        {
+          [a removeObjectAtIndex: 0];
+          poolDiscarded++;
+        }
+    }
+  [poolLock unlock];
+}
+
+/* Sets the length of time for which an idle connection may remain in
+ * the pool before it is considered stale and closed.
+ */
++ (void) setPoolTimeout: (NSTimeInterval)seconds
+{
+  poolTimeout = seconds;
+}
+
+/* Returns the counters describing how effective the connection pool has
+ * been: the number of new connections needed when nothing suitable was
+ * pooled (misses), the number of pooled connections re-used (hits),
+ * the number found to be timed out or closed by the remote end (stale),
+ * the number given up to the pool (added), the number closed because
+ * the pool for their server was full (discarded), the number currently
+ * idle in the pool, and the proportion of connection requests satisfied
+ * from the pool (reuseRate).
+ */
++ (NSDictionary*) poolStatistics
+{
+  NSMutableDictionary   *d = [NSMutableDictionary dictionaryWithCapacity: 7];
+  NSEnumerator          *e;
+  NSArray               *a;
+  NSUInteger            idleCount = 0;
+  double                rate = 0.0;
+
+  [poolLock lock];
+  e = [connPool objectEnumerator];
+  while ((a = [e nextObject]) != nil)
+    {
+      idleCount += [a count];
+    }
+  if (poolHits + poolMisses > 0)
+    {
+      rate = (double)poolHits / (double)(poolHits + poolMisses);
+    }
+  [d setObject: [NSNumber numberWithUnsignedInteger: poolHits]
+        forKey: @"hits"];
+  [d setObject: [NSNumber numberWithUnsignedInteger: poolMisses]
+        forKey: @"misses"];
+  [d setObject: [NSNumber numberWithUnsignedInteger: poolStale]
+        forKey: @"stale"];
+  [d setObject: [NSNumber numberWithUnsignedInteger: poolAdded]
+        forKey: @"added"];
+  [d setObject: [NSNumber numberWithUnsignedInteger: poolDiscarded]
+        forKey: @"discarded"];
+  [d setObject: [NSNumber numberWithUnsignedInteger: idleCount]
+        forKey: @"idle"];
+  [d setObject: [NSNumber numberWithDouble: rate]
+        forKey: @"reuseRate"];
+  [poolLock unlock];
+  return d;
+}
+
+/* Returns YES if the remote end appears to have closed the connection.
+ */
+static BOOL
+poolSocketIsClosed(NSFileHandle *s)
+{
+#if	defined(_WIN32)
+  /* Peeking is not reliable on windows ... we rely on the write failure
+   * retry logic for re-used connections instead.
+   */
+  return NO;
+#else
+  int	fd = [s fileDescriptor];
+  int	result;
+  unsigned char	c;
+
+  if (fd < 0)
+    {
+      return YES;
+    }
+#if     !defined(MSG_DONTWAIT)
+#define MSG_DONTWAIT    0
+#endif
+  result = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (result == 0 || (result < 0 && errno != EAGAIN && errno != EINTR))
+    {
+      return YES;
+    }
+  return NO;
+#endif
+}
+
+/* Removes the most recently used live connection for key from the pool
+ * and returns it (retained) or returns nil if there is none.
+ * Stale entries encountered along the way are discarded.  An entry is
+ * only checked for closure by the remote end after it has been removed,
+ * so the lock is not held while we ask the system.
+ */
+static GSHTTPPooledSocket *
+poolTake(NSString *key)
+{
+  GSHTTPPooledSocket    *entry = nil;
+  NSTimeInterval        now = [NSDate timeIntervalSinceReferenceDate];
+
+  for (;;)
+    {
+      NSMutableArray    *a;
+
+      [poolLock lock];
+      a = [connPool objectForKey: key];
+      while (nil == entry && [a count] > 0)
+        {
+          entry = RETAIN([a lastObject]);
+          [a removeLastObject];
+          if (now - entry->when > poolTimeout)
+            {
+              poolStale++;
+              DESTROY(entry);
+            }
+        }
+      if (nil == entry)
+        {
+          poolMisses++;
+          [poolLock unlock];
+          return nil;
+        }
+      [poolLock unlock];
+
+      if (NO == poolSocketIsClosed(entry->sock))
+        {
+          break;
+        }
+      [poolLock lock];
+      poolStale++;
+      [poolLock unlock];
+      DESTROY(entry);
+    }
+  [poolLock lock];
+  poolHits++;
+  [poolLock unlock];
+  return entry;
+}
+
 - (void) dealloc
 {
   if (sock != nil)
     {
       NSNotificationCenter	*nc = [NSNotificationCenter defaultCenter];
 
-      [nc removeObserver: self name: nil object: sock];
-      [sock closeFile];
-      DESTROY(sock);
+      if (connectionState == idle && poolKey != nil)
+        {
+          [self _poolSocket];
+        }
+      else
+        {
+          [nc removeObserver: self name: nil object: sock];
+          [sock closeFile];
+          DESTROY(sock);
+        }
     }
   DESTROY(out);
   DESTROY(in);
   DESTROY(u);
+  DESTROY(poolKey);
   DESTROY(urlKey);
   DESTROY(url);
   DESTROY(dat);
@@ -736,6 +962,13 @@ debugWrite(GSHTTPURLHandle *handle, NSData *data)
 
 	  connectionState = idle;
 	  [nc removeObserver: self name: nil object: sock];
+	  if ([sock readInProgress] == YES)
+	    {
+	      /* Stop watching the connection from our run loop, so it can
+	       * be kept for reuse, perhaps by a handle in another thread.
+	       */
+	      [(GSFileHandle*)sock cancelRead];
+	    }
 
 	  ver = [[[document headerNamed: @"http"] value] floatValue];
 	  if (ver < 1.1)
@@ -1459,12 +1692,21 @@ debugWrite(GSHTTPURLHandle *handle, NSData *data)
           [urlLock unlock];
           if (sock != nil)
             {
-              NSNotificationCenter	*nc;
+              if (poolKey != nil)
+                {
+                  /* The connection may still be useful to another handle.
+                   */
+                  [self _poolSocket];
+                }
+              else
+                {
+                  NSNotificationCenter	*nc;
 
-              nc = [NSNotificationCenter defaultCenter];
-              [nc removeObserver: self name: nil object: sock];
-              [sock closeFile];
-              DESTROY(sock);
+                  nc = [NSNotificationCenter defaultCenter];
+                  [nc removeObserver: self name: nil object: sock];
+                  [sock closeFile];
+                  DESTROY(sock);
+                }
             }
           ASSIGN(urlKey, k);
         }
@@ -1472,6 +1714,109 @@ debugWrite(GSHTTPURLHandle *handle, NSData *data)
     }
 }
 
+/* Returns the key used to share idle connections to the specified
+ * server between handles, or nil if a connection for the current request
+ * must not be shared (because it goes via a proxy or carries client
+ * specific TLS settings).
+ */
+- (NSString*) _poolKeyForHost: (NSString*)host port: (NSString*)port
+{
+  NSString      *scheme = [[u scheme] lowercaseString];
+  NSString      *bind;
+
+  if (0 == maxPooled
+    || [[request objectForKey: GSHTTPPropertyProxyHostKey] length] > 0)
+    {
+      return nil;
+    }
+  if ([scheme isEqualToString: @"https"])
+    {
+      NSEnumerator      *e = [request keyEnumerator];
+      NSString          *k;
+
+      while ((k = [e nextObject]) != nil)
+        {
+          if ([k hasPrefix: @"GSTLS"]
+            || [k isEqualToString: GSHTTPPropertyCertificateFileKey]
+            || [k isEqualToString: GSHTTPPropertyKeyFileKey]
+            || [k isEqualToString: GSHTTPPropertyPasswordKey])
+            {
+              return nil;
+            }
+        }
+    }
+  bind = [request objectForKey: GSHTTPPropertyLocalHostKey];
+  if (nil == bind)
+    {
+      bind = @"";
+    }
+  return [NSString stringWithFormat: @"%@://%@:%@/%@",
+    scheme, [host lowercaseString], port, bind];
+}
+
+/* Gives up our idle connection, placing it in the pool of connections
+ * available to other handles.
+ */
+- (void) _poolSocket
+{
+  NSNotificationCenter	*nc = [NSNotificationCenter defaultCenter];
+  GSHTTPPooledSocket    *entry;
+  NSMutableArray        *a;
+
+  NSAssert(connectionState == idle, NSInternalInconsistencyException);
+  [nc removeObserver: self name: nil object: sock];
+  if ([sock readInProgress] || [sock writeInProgress])
+    {
+      /* The I/O is watched by the run loop of the thread which started
+       * it, and could only be cancelled from there, so we must not let
+       * another handle adopt the connection.
+       */
+      if (debug)
+        {
+          NSLog(@"%@ %p close busy connection for %@",
+            NSStringFromSelector(_cmd), self, poolKey);
+        }
+      [sock closeFile];
+      DESTROY(sock);
+      DESTROY(in);
+      DESTROY(out);
+      DESTROY(poolKey);
+      return;
+    }
+  if (debug)
+    {
+      NSLog(@"%@ %p pool connection for %@",
+        NSStringFromSelector(_cmd), self, poolKey);
+    }
+  entry = [GSHTTPPooledSocket new];
+  entry->sock = sock;
+  sock = nil;
+  entry->in = in;
+  in = nil;
+  entry->out = out;
+  out = nil;
+  entry->when = [NSDate timeIntervalSinceReferenceDate];
+
+  [poolLock lock];
+  a = [connPool objectForKey: poolKey];
+  if (nil == a)
+    {
+      a = [NSMutableArray new];
+      [connPool setObject: a forKey: poolKey];
+      RELEASE(a);
+    }
+  [a addObject: entry];
+  poolAdded++;
+  while ([a count] > maxPooled)
+    {
+      [a removeObjectAtIndex: 0];
+      poolDiscarded++;
+    }
+  [poolLock unlock];
+  RELEASE(entry);
+  DESTROY(poolKey);
+}
+
 - (void) _tryLoadInBackground: (NSURL*)fromURL
 {
   NSNotificationCenter	*nc;
@@ -1604,6 +1949,33 @@ debugWrite(GSHTTPURLHandle *handle, NSData *data)
 	}
     }
 
+  if (sock == nil)
+    {
+      GSHTTPPooledSocket        *entry = nil;
+
+      /* See if another handle left behind an idle connection to the
+       * same server which we can adopt.
+       */
+      ASSIGN(poolKey, [self _poolKeyForHost: host port: port]);
+      if (poolKey != nil)
+        {
+          entry = poolTake(poolKey);
+        }
+      if (entry != nil)
+        {
+          sock = entry->sock;
+          entry->sock = nil;
+          ASSIGN(in, entry->in);
+          ASSIGN(out, entry->out);
+          RELEASE(entry);
+          if (debug)
+            {
+              NSLog(@"%@ %p adopted pooled connection for %@",
+                NSStringFromSelector(_cmd), self, poolKey);
+            }
+        }
+    }
+
   if (sock == nil)
     {
       keepalive = NO;	// New connection
@@ -0,0 +1,548 @@
+/* Sampling of lock contention and hold times
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNUstep Base Library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110 USA.
+   */
+
+#import "common.h"
+#import "Foundation/NSArray.h"
+#import "Foundation/NSDictionary.h"
+#import "Foundation/NSLock.h"
+#import "Foundation/NSValue.h"
+#import "GSPrivate.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+
+/*
+ * About this implementation.
+ *
+ * When profiling is turned on, every lock operation costs one check of
+ * GSPrivateLockProfiling and (for acquisitions and releases) a look at
+ * some per-thread state.  One in every GSPrivateLockProfiling uncontended
+ * acquisitions is sampled, while every contended acquisition is recorded
+ * since it is slow anyway.  Only sampled and contended acquisitions look
+ * up the record for their lock and time how long the lock is held, so
+ * the acquisition counts are estimates but cost little to gather.
+ *
+ * Records are kept per lock name (or per class for unnamed locks and for
+ * objects used with @synchronized) in a hash table which is never shrunk,
+ * so that a record may be updated and reported without holding a lock.
+ * The record for an acquisition is found before the lock is taken, and
+ * the table itself is keyed by plain C data, so that no Objective-C
+ * message is sent while the profiled lock or the table lock is held
+ * (a message could need the same lock, in a class' +initialize say).
+ */
+
+/* Number of buckets in the hold time histogram.  Bucket 0 counts holds of
+ * less than 1024 nanoseconds and each further bucket counts holds of up
+ * to twice as long as the previous one, the last bucket counting all
+ * longer holds.
+ */
+#define	GS_LOCK_BUCKETS	16
+
+/* Number of hash table buckets, and the number of records we make before
+ * we stop recording locks by name and just record them by class.
+ */
+#define	GS_LOCK_TABLE	256
+#define	GS_LOCK_MAX	4096
+
+typedef struct gs_lock_stats {
+  struct gs_lock_stats	*next;
+  NSUInteger		hash;
+  Class			cls;	/* Class of an unnamed lock or object */
+  BOOL			named;	/* Label is the name of the lock */
+  BOOL			sync;	/* Records @synchronized */
+  char			*label;	/* For reports */
+  volatile uint64_t	acquisitions;
+  volatile uint64_t	contended;
+  volatile uint64_t	waited;	/* Nanoseconds */
+  volatile uint64_t	holds[GS_LOCK_BUCKETS];
+} gs_lock_stats;
+
+typedef struct {
+  id		lock;		/* Lock whose hold time is being sampled */
+  id		waiting;	/* Condition sampled when its wait began */
+  gs_lock_stats	*stats;
+  uint64_t	start;
+  NSUInteger	countdown;	/* Acquisitions to the next sample */
+  BOOL		busy;		/* Looking up a record */
+} gs_lock_sample;
+
+volatile NSUInteger	GSPrivateLockProfiling = 0;
+
+static gs_lock_stats * volatile	table[GS_LOCK_TABLE];
+static unsigned			tableCount = 0;
+static pthread_mutex_t		tableLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t		sampleKey;
+static pthread_once_t		sampleOnce = PTHREAD_ONCE_INIT;
+static BOOL			sampleKeyOK = NO;
+
+uint64_t
+GSPrivateLockProfileClock(void)
+{
+#if	defined(CLOCK_MONOTONIC)
+  struct timespec	ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+  return (uint64_t)(GSPrivateTimeNow() * 1e9);
+#endif
+}
+
+static void
+sampleSetup(void)
+{
+  if (0 == pthread_key_create(&sampleKey, free))
+    {
+      sampleKeyOK = YES;
+    }
+}
+
+static gs_lock_sample *
+sampleForThread(void)
+{
+  gs_lock_sample	*t;
+
+  if (NO == sampleKeyOK)
+    {
+      return 0;
+    }
+  t = (gs_lock_sample*)pthread_getspecific(sampleKey);
+  if (0 == t)
+    {
+      t = (gs_lock_sample*)calloc(1, sizeof(gs_lock_sample));
+      if (0 != t)
+	{
+	  pthread_setspecific(sampleKey, t);
+	}
+    }
+  return t;
+}
+
+static BOOL
+statsMatch(gs_lock_stats *s, NSUInteger hash, const char *name, Class cls,
+  BOOL sync)
+{
+  if (s->hash != hash || s->sync != sync)
+    {
+      return NO;
+    }
+  if (0 == name)
+    {
+      return (NO == s->named && s->cls == cls) ? YES : NO;
+    }
+  return (YES == s->named && strcmp(s->label, name) == 0) ? YES : NO;
+}
+
+/* Finds (or makes) the record for a lock with the given (UTF-8) name, or
+ * for the class of an unnamed lock or synchronized object.  This uses
+ * only C so that it is safe with the table lock held.
+ */
+static gs_lock_stats *
+statsFor(const char *name, Class cls, BOOL sync)
+{
+  NSUInteger	hash;
+  gs_lock_stats	*s;
+
+  if (0 == name)
+    {
+      hash = ((NSUInteger)(uintptr_t)cls >> 4) ^ sync;
+    }
+  else
+    {
+      const unsigned char	*p = (const unsigned char*)name;
+
+      hash = 5381;
+      while (*p != 0)
+	{
+	  hash = hash * 33 + *p++;
+	}
+    }
+  for (s = table[hash % GS_LOCK_TABLE]; s != 0; s = s->next)
+    {
+      if (YES == statsMatch(s, hash, name, cls, sync))
+	{
+	  return s;
+	}
+    }
+
+  if (0 != name && tableCount >= GS_LOCK_MAX)
+    {
+      return statsFor(0, cls, sync);
+    }
+
+  pthread_mutex_lock(&tableLock);
+  for (s = table[hash % GS_LOCK_TABLE]; s != 0; s = s->next)
+    {
+      if (YES == statsMatch(s, hash, name, cls, sync))
+	{
+	  pthread_mutex_unlock(&tableLock);
+	  return s;
+	}
+    }
+  s = (gs_lock_stats*)calloc(1, sizeof(gs_lock_stats));
+  if (0 != s)
+    {
+      const char	*n = class_getName(cls);
+
+      s->hash = hash;
+      s->cls = cls;
+      s->sync = sync;
+      if (0 == name)
+	{
+	  size_t	len = strlen(n) + 16;
+
+	  s->label = malloc(len);
+	  if (0 != s->label)
+	    {
+	      snprintf(s->label, len, (YES == sync) ? "@synchronized(%s)"
+		: "%s (unnamed)", n);
+	    }
+	}
+      else
+	{
+	  s->label = strdup(name);
+	  s->named = (0 == s->label) ? NO : YES;
+	}
+      if (0 == s->label)
+	{
+	  s->label = (char*)n;
+	}
+      s->next = table[hash % GS_LOCK_TABLE];
+      __sync_synchronize();
+      table[hash % GS_LOCK_TABLE] = s;
+      tableCount++;
+    }
+  pthread_mutex_unlock(&tableLock);
+  return s;
+}
+
+static unsigned
+bucketFor(uint64_t ns)
+{
+  unsigned	b = 0;
+
+  ns >>= 10;
+  while (ns > 0 && b < GS_LOCK_BUCKETS - 1)
+    {
+      ns >>= 1;
+      b++;
+    }
+  return b;
+}
+
+void *
+GSPrivateLockProfileSample(id lock, NSString *name, BOOL sync,
+  BOOL contended)
+{
+  NSUInteger		interval = GSPrivateLockProfiling;
+  gs_lock_sample	*t;
+  gs_lock_stats		*s;
+
+  if (0 == interval || 0 == (t = sampleForThread()) || YES == t->busy)
+    {
+      return 0;
+    }
+  if (NO == contended)
+    {
+      if (t->countdown > 1)
+	{
+	  t->countdown--;
+	  return 0;
+	}
+      t->countdown = interval;
+    }
+  /* Getting the name may use other (profiled) locks, so we make sure
+   * that they do not look up records of their own meanwhile.
+   */
+  t->busy = YES;
+  if (nil == name)
+    {
+      s = statsFor(0, object_getClass(lock), sync);
+    }
+  else
+    {
+      ENTER_POOL
+      s = statsFor([name UTF8String], object_getClass(lock), sync);
+      LEAVE_POOL
+    }
+  t->busy = NO;
+  return s;
+}
+
+void
+GSPrivateLockProfileAcquired(id lock, void *sample, BOOL contended,
+  uint64_t waited)
+{
+  gs_lock_stats		*s = (gs_lock_stats*)sample;
+  gs_lock_sample	*t;
+
+  if (0 == s || 0 == (t = sampleForThread()))
+    {
+      return;
+    }
+  __sync_fetch_and_add(&s->acquisitions,
+    (YES == contended) ? 1 : GSPrivateLockProfiling);
+  if (YES == contended)
+    {
+      __sync_fetch_and_add(&s->contended, 1);
+      __sync_fetch_and_add(&s->waited, waited);
+    }
+  if (nil == t->lock)
+    {
+      t->lock = lock;
+      t->stats = s;
+      t->start = GSPrivateLockProfileClock();
+    }
+}
+
+void
+GSPrivateLockProfileReleased(id lock)
+{
+  gs_lock_sample	*t;
+
+  if (YES == sampleKeyOK
+    && 0 != (t = (gs_lock_sample*)pthread_getspecific(sampleKey))
+    && t->lock == lock && nil != lock)
+    {
+      uint64_t	held = GSPrivateLockProfileClock() - t->start;
+
+      __sync_fetch_and_add(&t->stats->holds[bucketFor(held)], 1);
+      t->lock = nil;
+    }
+}
+
+void
+GSPrivateLockProfileWaiting(id lock)
+{
+  gs_lock_sample	*t;
+
+  if (YES == sampleKeyOK
+    && 0 != (t = (gs_lock_sample*)pthread_getspecific(sampleKey))
+    && t->lock == lock && nil != lock)
+    {
+      GSPrivateLockProfileReleased(lock);
+      t->waiting = lock;
+    }
+}
+
+void
+GSPrivateLockProfileWoken(id lock)
+{
+  gs_lock_sample	*t;
+
+  if (YES == sampleKeyOK
+    && 0 != (t = (gs_lock_sample*)pthread_getspecific(sampleKey))
+    && t->waiting == lock && nil != lock)
+    {
+      t->waiting = nil;
+      if (nil == t->lock)
+	{
+	  t->lock = lock;
+	  t->start = GSPrivateLockProfileClock();
+	}
+    }
+}
+
+/* Writes a number to buf, returning the number of characters written.
+ */
+static unsigned
+formatNumber(char *buf, uint64_t v)
+{
+  char		tmp[24];
+  unsigned	len = 0;
+  unsigned	i;
+
+  do
+    {
+      tmp[len++] = '0' + (v % 10);
+      v /= 10;
+    }
+  while (v > 0);
+  for (i = 0; i < len; i++)
+    {
+      buf[i] = tmp[len - i - 1];
+    }
+  return len;
+}
+
+static void
+writeString(int fd, const char *str)
+{
+  size_t	len = strlen(str);
+
+  while (len > 0)
+    {
+      ssize_t	done = write(fd, str, len);
+
+      if (done <= 0)
+	{
+	  return;
+	}
+      str += done;
+      len -= done;
+    }
+}
+
+static void
+writeNumber(int fd, const char *before, uint64_t v)
+{
+  char	buf[24];
+
+  writeString(fd, before);
+  buf[formatNumber(buf, v)] = '\0';
+  writeString(fd, buf);
+}
+
+/* Writes the profile to a file descriptor, using only functions which
+ * are safe in a signal handler.
+ */
+static void
+dumpProfile(int fd)
+{
+  unsigned	i;
+
+  writeString(fd, "Lock profile (acquisitions, contended, wait us,"
+    " hold time histogram from <1us doubling)\n");
+  for (i = 0; i < GS_LOCK_TABLE; i++)
+    {
+      gs_lock_stats	*s;
+
+      for (s = table[i]; s != 0; s = s->next)
+	{
+	  unsigned	b;
+
+	  if (0 == s->acquisitions)
+	    {
+	      continue;
+	    }
+	  writeString(fd, s->label);
+	  writeNumber(fd, ": ", s->acquisitions);
+	  writeNumber(fd, " ", s->contended);
+	  writeNumber(fd, " ", s->waited / 1000);
+	  writeString(fd, " [");
+	  for (b = 0; b < GS_LOCK_BUCKETS; b++)
+	    {
+	      writeNumber(fd, (0 == b) ? "" : " ", s->holds[b]);
+	    }
+	  writeString(fd, "]\n");
+	}
+    }
+}
+
+static void
+dumpOnSignal(int sig)
+{
+  dumpProfile(2);
+}
+
+void
+GSPrivateLockProfileSetup(void)
+{
+  if (YES == GSPrivateEnvironmentFlag("GNUSTEP_LOCK_PROFILE", NO))
+    {
+#if	defined(SIGUSR2)
+      struct sigaction	old;
+
+      /* Only take the signal if nothing else wants it.
+       */
+      if (0 == sigaction(SIGUSR2, 0, &old) && SIG_DFL == old.sa_handler)
+	{
+	  signal(SIGUSR2, dumpOnSignal);
+	}
+#endif
+      [NSObject setLockProfileSampleInterval: 64];
+    }
+}
+
+@implementation	NSObject (GSLockProfile)
+
++ (NSDictionary*) lockProfile
+{
+  NSMutableDictionary	*d = [NSMutableDictionary dictionary];
+  unsigned		i;
+
+  for (i = 0; i < GS_LOCK_TABLE; i++)
+    {
+      gs_lock_stats	*s;
+
+      for (s = table[i]; s != 0; s = s->next)
+	{
+	  NSNumber	*holds[GS_LOCK_BUCKETS];
+	  unsigned	b;
+
+	  if (0 == s->acquisitions)
+	    {
+	      continue;
+	    }
+	  for (b = 0; b < GS_LOCK_BUCKETS; b++)
+	    {
+	      holds[b] = [NSNumber numberWithUnsignedLongLong: s->holds[b]];
+	    }
+	  [d setObject: [NSDictionary dictionaryWithObjectsAndKeys:
+	    [NSNumber numberWithUnsignedLongLong: s->acquisitions],
+	    @"Acquisitions",
+	    [NSNumber numberWithUnsignedLongLong: s->contended],
+	    @"Contended",
+	    [NSNumber numberWithDouble: s->waited / 1e9],
+	    @"WaitTime",
+	    [NSArray arrayWithObjects: holds count: GS_LOCK_BUCKETS],
+	    @"HoldTimes",
+	    nil]
+		forKey: [NSString stringWithUTF8String: s->label]];
+	}
+    }
+  return d;
+}
+
++ (void) resetLockProfile
+{
+  unsigned	i;
+
+  for (i = 0; i < GS_LOCK_TABLE; i++)
+    {
+      gs_lock_stats	*s;
+
+      for (s = table[i]; s != 0; s = s->next)
+	{
+	  unsigned	b;
+
+	  s->acquisitions = 0;
+	  s->contended = 0;
+	  s->waited = 0;
+	  for (b = 0; b < GS_LOCK_BUCKETS; b++)
+	    {
+	      s->holds[b] = 0;
+	    }
+	}
+    }
+}
+
++ (NSUInteger) setLockProfileSampleInterval: (NSUInteger)interval
+{
+  NSUInteger	old = GSPrivateLockProfiling;
+
+  pthread_once(&sampleOnce, sampleSetup);
+  GSPrivateLockProfiling = interval;
+  return old;
+}
+
+@end
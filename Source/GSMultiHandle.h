@@ -19,6 +19,12 @@
  * non-blocking and all code to run on the same thread 
  * thus keeping is simple.
  *
+ * If the GSURLSessionRunLoop user default is set, the sockets and the
+ * timeout are instead watched by the run loop of a dedicated I/O thread
+ * shared by all multi handles, which avoids a dispatch source for each
+ * socket.  Curl is still driven on the work queue of each handle, so
+ * one busy session does not hold up the others.
+ *
  * - SeeAlso: GSEasyHandle
  */
 @interface GSMultiHandle : NSObject
@@ -33,6 +39,11 @@
 - (void) removeHandle: (GSEasyHandle*)easyHandle;
 - (void) updateTimeoutTimerToValue: (NSInteger)value;
 
+/* Stop watching sockets in the I/O thread (if used).  This is done
+ * anyway when the handle is deallocated.
+ */
+- (void) invalidate;
+
 @end
 
 // What read / write ready event to register / unregister.
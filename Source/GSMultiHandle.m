@@ -7,6 +7,9 @@
 @interface GSMultiHandle ()
 - (void) performActionForSocket: (int)socket;
 - (void) readAndWriteAvailableDataOnSocket: (int)socket;
+- (void) readAndWriteAvailableDataOnSocket: (int)socket events: (int)mask;
+- (void) watchSocket: (curl_socket_t)socket events: (int)what;
+- (void) ioSocket: (curl_socket_t)socket events: (int)mask;
 - (void) readMessages;
 - (void) completedTransferForEasyHandle: (CURL*)rawEasyHandle 
                                easyCode: (int)easyCode;
@@ -15,6 +18,32 @@
                socketSourcePtr: (void *)socketSourcePtr;
 @end
 
+/*
+ * The part of a multi handle which lives in the I/O thread when the
+ * GSURLSessionRunLoop option is used.  The run loop and the timer retain
+ * this object rather than the multi handle, which it refers to without
+ * retaining, so the owner of the handle may release it at any time.
+ * Apart from being created, it is only used in the I/O thread.
+ */
+@interface GSMultiHandleIO : NSObject <RunLoopEvents>
+{
+@public
+  GSMultiHandle *handle;    // Not retained, protected by ioLock
+  NSMapTable    *watched;   // Socket to CURL_POLL_* wanted by curl
+  NSMapTable    *paused;    // Socket to CURL_POLL_* being dealt with
+  NSTimer       *timer;
+}
+- (void) invalidate;
+- (void) resume: (NSNumber*)n;
+- (void) setTimer: (NSNumber*)n;
+- (void) watch: (NSNumber*)n;
+@end
+
+/* Protects the handle of each GSMultiHandleIO, so that it is cleared
+ * before the handle can be deallocated.
+ */
+static NSLock   *ioLock = nil;
+
 static void handleEasyCode(int code)
 {
   if (CURLE_OK != code)
@@ -69,6 +98,56 @@ static int curl_timer_function(CURL *easyHandle, int timeout, void *userdata) {
   NSMutableArray    *_easyHandles;
   dispatch_queue_t  _queue;
   GSTimeoutSource   *_timeoutSource;
+  NSThread          *_ioThread;     // Run loop driving curl, or nil
+  GSMultiHandleIO   *_io;           // Watches sockets in the I/O thread
+  BOOL              _ioInvalidated;
+}
+
+static NSThread *ioThread = nil;
+
++ (void) initialize
+{
+  if (self == [GSMultiHandle class])
+    {
+      ioLock = [NSLock new];
+    }
+}
+
+/* The thread whose run loop watches the sockets of all multi handles
+ * using the GSURLSessionRunLoop option.
+ */
++ (NSThread*) ioThread
+{
+  static dispatch_once_t once;
+
+  dispatch_once(&once, ^{
+    ioThread = [[NSThread alloc] initWithTarget: self
+                                       selector: @selector(runIOThread:)
+                                         object: nil];
+    [ioThread setName: @"GSMultiHandle I/O"];
+    [ioThread start];
+  });
+  return ioThread;
+}
+
++ (void) runIOThread: (id)ignored
+{
+  NSRunLoop *loop = [NSRunLoop currentRunLoop];
+
+  /* Keep the run loop from returning while there is nothing to watch.
+   */
+  [loop addTimer: [NSTimer timerWithTimeInterval: 1.0e6
+                                          target: self
+                                        selector: @selector(class)
+                                        userInfo: nil
+                                         repeats: YES]
+         forMode: NSDefaultRunLoopMode];
+  for (;;)
+    {
+      ENTER_POOL
+      [loop runMode: NSDefaultRunLoopMode beforeDate: [NSDate distantFuture]];
+      LEAVE_POOL
+    }
 }
 
 - (CURLM*) rawHandle
@@ -91,6 +170,13 @@ static int curl_timer_function(CURL *easyHandle, int timeout, void *userdata) {
 	DISPATCH_QUEUE_SERIAL);
       dispatch_set_target_queue(_queue, aQueue);
 #endif
+      if ([[NSUserDefaults standardUserDefaults]
+        boolForKey: @"GSURLSessionRunLoop"] == YES)
+        {
+          _ioThread = RETAIN([GSMultiHandle ioThread]);
+          _io = [GSMultiHandleIO new];
+          _io->handle = self;
+        }
       [self setupCallbacks];
       [self configureWithConfiguration: conf];
     }
@@ -103,6 +189,9 @@ static int curl_timer_function(CURL *easyHandle, int timeout, void *userdata) {
   NSEnumerator   *e;
   GSEasyHandle   *handle;
 
+  /* Nothing more may be passed to the I/O thread once deallocating.
+   */
+  _ioInvalidated = YES;
   DESTROY(_timeoutSource);
 
   e = [_easyHandles objectEnumerator];
@@ -114,9 +203,53 @@ static int curl_timer_function(CURL *easyHandle, int timeout, void *userdata) {
 
   curl_multi_cleanup(_rawHandle);
 
+  if (nil != _io)
+    {
+      [_io performSelector: @selector(invalidate)
+                  onThread: _ioThread
+                withObject: nil
+             waitUntilDone: NO];
+      RELEASE(_io);
+    }
+  RELEASE(_ioThread);
   [super dealloc];
 }
 
+- (void) invalidate
+{
+  if (nil != _io)
+    {
+      _ioInvalidated = YES;
+      [_io performSelector: @selector(invalidate)
+                  onThread: _ioThread
+                withObject: nil
+             waitUntilDone: NO];
+    }
+}
+
+/* The I/O thread only refers to the handle through _io, which must
+ * stop doing so (under ioLock) once the handle is to be deallocated.
+ */
+- (oneway void) release
+{
+  if (nil == _io)
+    {
+      [super release];
+      return;
+    }
+  [ioLock lock];
+  if (NSDecrementExtraRefCountWasZero(self))
+    {
+      _io->handle = nil;
+      [ioLock unlock];
+      [self dealloc];
+    }
+  else
+    {
+      [ioLock unlock];
+    }
+}
+
 - (void) configureWithConfiguration: (NSURLSessionConfiguration*)configuration 
 {
   handleEasyCode(curl_multi_setopt(_rawHandle, CURLMOPT_MAX_HOST_CONNECTIONS, [configuration HTTPMaximumConnectionsPerHost])); 
@@ -186,7 +319,17 @@ static int curl_timer_function(CURL *easyHandle, int timeout, void *userdata) {
   // A timeout_ms value of -1 passed to this callback means you should delete 
   // the timer. All other values are valid expire times in number 
   // of milliseconds.
-  if (-1 == value)
+  if (nil != _io)
+    {
+      if (NO == _ioInvalidated)
+        {
+          [_io performSelector: @selector(setTimer:)
+                      onThread: _ioThread
+                    withObject: [NSNumber numberWithInteger: value]
+                 waitUntilDone: NO];
+        }
+    }
+  else if (-1 == value)
     {
       DESTROY(_timeoutSource);
     }   
@@ -223,10 +366,15 @@ static int curl_timer_function(CURL *easyHandle, int timeout, void *userdata) {
 }
 
 - (void) readAndWriteAvailableDataOnSocket: (int)socket 
+{
+  [self readAndWriteAvailableDataOnSocket: socket events: 0];
+}
+
+- (void) readAndWriteAvailableDataOnSocket: (int)socket events: (int)mask
 {
   int runningHandlesCount = 0;
   
-  handleMultiCode(curl_multi_socket_action(_rawHandle, socket, 0, &runningHandlesCount));
+  handleMultiCode(curl_multi_socket_action(_rawHandle, socket, mask, &runningHandlesCount));
   
   [self readMessages];
 }
@@ -316,6 +464,12 @@ static int curl_timer_function(CURL *easyHandle, int timeout, void *userdata) {
   GSSocketRegisterAction  *action;
   GSSocketSources         *socketSources;
 
+  if (nil != _ioThread)
+    {
+      [self watchSocket: socket events: what];
+      return 0;
+    }
+
   action = [[GSSocketRegisterAction alloc] initWithRawValue: what];
   socketSources = [GSSocketSources from: socketSourcePtr];
 
@@ -348,6 +502,245 @@ static int curl_timer_function(CURL *easyHandle, int timeout, void *userdata) {
   return 0;
 }
 
+/* Pass the CURL_POLL_* events wanted for a socket to the I/O thread.
+ */
+- (void) watchSocket: (curl_socket_t)socket events: (int)what
+{
+  if (NO == _ioInvalidated)
+    {
+      [_io performSelector: @selector(watch:)
+                  onThread: _ioThread
+                withObject: [NSNumber numberWithLongLong:
+                  ((long long)socket << 3) | what]
+             waitUntilDone: NO];
+    }
+}
+
+/* Called in the I/O thread when a socket is ready (or with
+ * CURL_SOCKET_TIMEOUT when the timeout expires).  Curl is driven on the
+ * work queue, so that a session whose queue is busy does not hold up
+ * the others, and the I/O thread then watches the socket again.
+ */
+- (void) ioSocket: (curl_socket_t)socket events: (int)mask
+{
+  GSMultiHandleIO   *io = _io;
+
+  dispatch_async(_queue, ^{
+    [self readAndWriteAvailableDataOnSocket: socket events: mask];
+    if (CURL_SOCKET_TIMEOUT != socket)
+      {
+        [io performSelector: @selector(resume:)
+                   onThread: ioThread
+                 withObject: [NSNumber numberWithLongLong:
+                   ((long long)socket << 3) | mask]
+              waitUntilDone: NO];
+      }
+  });
+}
+
+@end
+
+@implementation GSMultiHandleIO
+
+static void
+ioEvents(NSRunLoop *loop, GSMultiHandleIO *io, intptr_t socket,
+  int old, int want)
+{
+  if ((want & CURL_POLL_IN) && !(old & CURL_POLL_IN))
+    {
+      [loop addEvent: (void*)socket
+                type: ET_RDESC
+             watcher: io
+             forMode: NSDefaultRunLoopMode];
+    }
+  else if (!(want & CURL_POLL_IN) && (old & CURL_POLL_IN))
+    {
+      [loop removeEvent: (void*)socket
+                   type: ET_RDESC
+                forMode: NSDefaultRunLoopMode
+                    all: NO];
+    }
+  if ((want & CURL_POLL_OUT) && !(old & CURL_POLL_OUT))
+    {
+      [loop addEvent: (void*)socket
+                type: ET_WDESC
+             watcher: io
+             forMode: NSDefaultRunLoopMode];
+    }
+  else if (!(want & CURL_POLL_OUT) && (old & CURL_POLL_OUT))
+    {
+      [loop removeEvent: (void*)socket
+                   type: ET_WDESC
+                forMode: NSDefaultRunLoopMode
+                    all: NO];
+    }
+}
+
+- (void) dealloc
+{
+  NSFreeMapTable(watched);
+  NSFreeMapTable(paused);
+  [super dealloc];
+}
+
+/* Returns the multi handle (retained), or nil if it has gone.
+ */
+- (GSMultiHandle*) handle
+{
+  GSMultiHandle *h;
+
+  [ioLock lock];
+  h = RETAIN(handle);
+  [ioLock unlock];
+  return h;
+}
+
+- (id) init
+{
+  if (nil != (self = [super init]))
+    {
+      watched = NSCreateMapTable(NSIntegerMapKeyCallBacks,
+        NSIntegerMapValueCallBacks, 0);
+      paused = NSCreateMapTable(NSIntegerMapKeyCallBacks,
+        NSIntegerMapValueCallBacks, 0);
+    }
+  return self;
+}
+
+- (void) invalidate
+{
+  NSRunLoop         *loop = [NSRunLoop currentRunLoop];
+  NSMapEnumerator   e;
+  void              *k;
+  void              *v;
+
+  [timer invalidate];
+  timer = nil;
+  e = NSEnumerateMapTable(watched);
+  while (NSNextMapEnumeratorPair(&e, &k, &v))
+    {
+      int   p = (int)(intptr_t)NSMapGet(paused, k);
+
+      ioEvents(loop, self, (intptr_t)k, (int)(intptr_t)v & ~p, 0);
+    }
+  NSEndMapTableEnumeration(&e);
+  NSResetMapTable(watched);
+  NSResetMapTable(paused);
+}
+
+/* The run loop keeps telling us about a ready socket until curl has
+ * dealt with it, so we stop watching it (in that direction) meanwhile.
+ */
+- (void) receivedEvent: (void*)data
+                  type: (RunLoopEventType)type
+                 extra: (void*)extra
+               forMode: (NSString*)mode
+{
+  int           bit = (ET_RDESC == type) ? CURL_POLL_IN : CURL_POLL_OUT;
+  int           p = (int)(intptr_t)NSMapGet(paused, data);
+  GSMultiHandle *h;
+
+  [[NSRunLoop currentRunLoop] removeEvent: data
+                                     type: type
+                                  forMode: NSDefaultRunLoopMode
+                                      all: NO];
+  NSMapInsert(paused, data, (void*)(intptr_t)(p | bit));
+  if (nil == (h = [self handle]))
+    {
+      [self invalidate];
+      return;
+    }
+  [h ioSocket: (curl_socket_t)(intptr_t)data
+       events: (ET_RDESC == type) ? CURL_CSELECT_IN : CURL_CSELECT_OUT];
+  RELEASE(h);
+}
+
+/* Curl has dealt with an event, so we watch for the next one if curl
+ * still wants it.
+ */
+- (void) resume: (NSNumber*)n
+{
+  long long     v = [n longLongValue];
+  intptr_t      socket = (intptr_t)(v >> 3);
+  int           bit = (CURL_CSELECT_IN == (v & 7)) ? CURL_POLL_IN
+                  : CURL_POLL_OUT;
+  int           p = (int)(intptr_t)NSMapGet(paused, (void*)socket);
+  int           w = (int)(intptr_t)NSMapGet(watched, (void*)socket);
+
+  if (0 == (p & bit))
+    {
+      return;
+    }
+  if (0 == (p &= ~bit))
+    {
+      NSMapRemove(paused, (void*)socket);
+    }
+  else
+    {
+      NSMapInsert(paused, (void*)socket, (void*)(intptr_t)p);
+    }
+  ioEvents([NSRunLoop currentRunLoop], self, socket, 0, w & bit);
+}
+
+- (void) setTimer: (NSNumber*)n
+{
+  NSInteger value = [n integerValue];
+
+  [timer invalidate];
+  timer = nil;
+  if (value >= 0)
+    {
+      timer = [NSTimer scheduledTimerWithTimeInterval: value / 1000.0
+                                               target: self
+                                             selector: @selector(timerFired:)
+                                             userInfo: nil
+                                              repeats: NO];
+    }
+}
+
+- (void) timerFired: (NSTimer*)t
+{
+  GSMultiHandle *h;
+
+  if (t == timer)
+    {
+      timer = nil;
+    }
+  if (nil == (h = [self handle]))
+    {
+      [self invalidate];
+      return;
+    }
+  [h ioSocket: CURL_SOCKET_TIMEOUT events: 0];
+  RELEASE(h);
+}
+
+- (void) watch: (NSNumber*)n
+{
+  long long     v = [n longLongValue];
+  intptr_t      socket = (intptr_t)(v >> 3);
+  int           want = (int)(v & 7);
+  int           old = (int)(intptr_t)NSMapGet(watched, (void*)socket);
+  int           p = (int)(intptr_t)NSMapGet(paused, (void*)socket);
+
+  if (CURL_POLL_REMOVE == want)
+    {
+      want = 0;
+    }
+  /* Directions paused while curl deals with an event are watched
+   * again by -resume: if they are still wanted.
+   */
+  ioEvents([NSRunLoop currentRunLoop], self, socket, old & ~p, want & ~p);
+  if (0 == want)
+    {
+      NSMapRemove(watched, (void*)socket);
+    }
+  else
+    {
+      NSMapInsert(watched, (void*)socket, (void*)(intptr_t)want);
+    }
+}
+
 @end
 
 @implementation GSSocketRegisterAction
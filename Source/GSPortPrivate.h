@@ -63,5 +63,9 @@
 - (void) removeHandle: (GSTcpHandle*)handle;
 @end
 
+@interface	NSSocketPortNameServer (Private)
++ (void) _forgetPort: (NSSocketPort*)port;	/* Drop cached lookups.	*/
+@end
+
 #endif
 
@@ -370,6 +370,13 @@ GSPrivateBuildStrings(void) GS_ATTRIB_PRIVATE;
 BOOL
 GSPrivateCheckTasks(void) GS_ATTRIB_PRIVATE;
 
+/* Map length bytes from the start of the file open on descriptor fd and
+ * return them as an autoreleased data object.  The descriptor may be
+ * closed once this returns.  Returns nil if the bytes can not be mapped.
+ */
+NSData *
+GSPrivateDataWithDescriptor(int fd, NSUInteger length) GS_ATTRIB_PRIVATE;
+
 /* get the default C-string encoding.
  */
 NSStringEncoding
@@ -391,6 +398,13 @@ GSPrivateDefaultsFlag(GSUserDefaultFlagType type) GS_ATTRIB_PRIVATE;
 NSString *
 GSPrivateEncodingName(NSStringEncoding encoding) GS_ATTRIB_PRIVATE;
 
+/* Performs any releases which other threads have queued for objects
+ * biased towards the current thread (see NSObject.m), returning YES if
+ * there were any.
+ */
+BOOL
+GSPrivateReleaseDeferred(void) GS_ATTRIB_PRIVATE;
+
 /* get a flag from an environment variable - return def if not defined.
  */
 BOOL
@@ -606,5 +620,162 @@ void
 GSPrivateEncodeBase64(const uint8_t *src, NSUInteger length, uint8_t *dst)
   GS_ATTRIB_PRIVATE;
 
+/** Function to base64 encode data, appending the nul terminated eol
+ * sequence after every lineLength characters of output if lineLength is
+ * non-zero (it should be a multiple of four).  The destination buffer
+ * must be at least the size returned by GSPrivateBase64EncodedLength().
+ * Returns the number of bytes written.
+ */
+NSUInteger
+GSPrivateEncodeBase64Lines(const uint8_t *src, NSUInteger length,
+  uint8_t *dst, NSUInteger lineLength, const char *eol)
+  GS_ATTRIB_PRIVATE;
+
+/** Returns the size of the buffer needed by GSPrivateEncodeBase64Lines()
+ * to encode length bytes of data.
+ */
+NSUInteger
+GSPrivateBase64EncodedLength(NSUInteger length, NSUInteger lineLength,
+  NSUInteger eolLength)
+  GS_ATTRIB_PRIVATE;
+
+/** Fast path for base64 decoding.  Decodes groups of four characters
+ * from *srcRef (but not beyond end) for as long as they are all in the
+ * base64 alphabet (the standard one if strict is YES, otherwise also the
+ * URL and filename safe one), writing three bytes to dst for each group.
+ * Stops at the first group containing anything else (padding, white
+ * space etc) so that the caller may deal with it.  Advances *srcRef past
+ * the characters decoded and returns the number of bytes written.
+ */
+NSUInteger
+GSPrivateDecodeBase64Quads(const uint8_t **srcRef, const uint8_t *end,
+  uint8_t *dst, BOOL strict)
+  GS_ATTRIB_PRIVATE;
+
+/** Function to encode data using the URL and filename safe base64
+ * alphabet of RFC 4648, with no line breaks and with the trailing '='
+ * padding only if pad is YES.  The destination buffer must be at least
+ * the size returned by GSPrivateBase64EncodedLength() with no line length.
+ * Returns the number of bytes written.
+ */
+NSUInteger
+GSPrivateEncodeBase64URL(const uint8_t *src, NSUInteger length,
+  uint8_t *dst, BOOL pad)
+  GS_ATTRIB_PRIVATE;
+
+/** Function to decode length characters using the URL and filename safe
+ * base64 alphabet of RFC 4648, with or without trailing padding.  The
+ * destination buffer must be at least three quarters of length (rounded
+ * up).  Returns the number of bytes written, or NSNotFound if the source
+ * contains anything other than characters from that alphabet and padding.
+ */
+NSUInteger
+GSPrivateDecodeBase64URL(const uint8_t *src, NSUInteger length, uint8_t *dst)
+  GS_ATTRIB_PRIVATE;
+
+/* Incremented whenever methods may have been added to (or replaced in)
+ * existing classes by GSObjCAddMethods() or by loading a bundle, so that
+ * caches of method lookups can tell that they may be out of date.
+ */
+extern unsigned	GSPrivateMethodsGeneration GS_ATTRIB_PRIVATE;
+
+/* Calls func(context, item) for each item from 0 to count - 1, sharing
+ * the calls between the calling thread and a pool of worker threads, and
+ * returns when all of them have finished.  If any call raises an
+ * exception, the first is raised again in the calling thread.
+ */
+void
+GSPrivateParallelApply(NSUInteger count,
+  void (*func)(void *context, NSUInteger item), void *context)
+  GS_ATTRIB_PRIVATE;
+
+/* Returns the number of threads (including the caller) which may perform
+ * the items passed to GSPrivateParallelApply() at once.
+ */
+NSUInteger
+GSPrivateParallelWidth(void) GS_ATTRIB_PRIVATE;
+
+/* What the buffer passed to GSPrivateEnumerateConcurrently() holds, and
+ * so the type of block to call for each element.
+ */
+typedef enum {
+  GSEnumerateArray,		/* Objects; GSEnumeratorBlock */
+  GSEnumerateSet,		/* Objects; GSSetEnumeratorBlock */
+  GSEnumerateDictionary,	/* Key and object pairs;
+				 * GSKeysAndObjectsEnumeratorBlock */
+  GSEnumerateIndexes		/* Ranges in ascending order;
+				 * GSIndexSetEnumerationBlock */
+} GSEnumerationKind;
+
+/* Performs an NSEnumerationConcurrent enumeration of the count elements
+ * (objects, pairs or ranges) in items, using GSPrivateParallelApply() to
+ * call the block in chunks (several per thread) of equal size, and stops
+ * early if the block sets its stop argument.  The items buffer must have
+ * been allocated by malloc() and is freed before this returns, even if a
+ * call of the block raises an exception (which is raised again).
+ */
+void
+GSPrivateEnumerateConcurrently(GSEnumerationKind kind, void *items,
+  NSUInteger count, id block) GS_ATTRIB_PRIVATE;
+
+/* Lock profiling (GSLockProfile.m).  GSPrivateLockProfiling is zero when
+ * profiling is off, otherwise it is the number of uncontended acquisitions
+ * for each one sampled.  Before trying to take a lock, lock classes call
+ * GSPrivateLockProfileSample() to get the record (if any) for the attempt,
+ * calling it again with contended set to YES if they find they have to
+ * wait.  Once they have the lock they pass the record to
+ * GSPrivateLockProfileAcquired() (saying whether and for how many
+ * nanoseconds they had to wait), and they call
+ * GSPrivateLockProfileReleased() before releasing it.  A condition calls
+ * GSPrivateLockProfileWaiting() before waiting and
+ * GSPrivateLockProfileWoken() once it has its lock back.
+ * For @synchronized the object is passed as the lock and sync is YES.
+ */
+extern volatile NSUInteger	GSPrivateLockProfiling GS_ATTRIB_PRIVATE;
+
+void
+GSPrivateLockProfileAcquired(id lock, void *sample,
+  BOOL contended, uint64_t waited) GS_ATTRIB_PRIVATE;
+
+uint64_t
+GSPrivateLockProfileClock(void) GS_ATTRIB_PRIVATE;
+
+void
+GSPrivateLockProfileReleased(id lock) GS_ATTRIB_PRIVATE;
+
+void *
+GSPrivateLockProfileSample(id lock, NSString *name, BOOL sync,
+  BOOL contended) GS_ATTRIB_PRIVATE;
+
+void
+GSPrivateLockProfileWaiting(id lock) GS_ATTRIB_PRIVATE;
+
+void
+GSPrivateLockProfileWoken(id lock) GS_ATTRIB_PRIVATE;
+
+/* Turns on lock profiling if GNUSTEP_LOCK_PROFILE is set.
+ */
+void
+GSPrivateLockProfileSetup(void) GS_ATTRIB_PRIVATE;
+
+/* Holds a numeric value obtained by GSPrivateKVCNumberForKey().
+ */
+typedef union {
+  long long		i;
+  unsigned long long	u;
+  double		d;
+} GSPrivateNumber;
+
+/* If obj uses the standard key-value coding methods and has a numeric
+ * accessor method or instance variable for the simple key (of length
+ * bytes), stores the value in *n without boxing it and returns 'i', 'u'
+ * or 'd' to say which member of *n was set.  Otherwise returns zero and
+ * the caller should use -valueForKey: (after which this function will
+ * usually succeed for other objects of the same class).
+ */
+char
+GSPrivateKVCNumberForKey(id obj, const char *key, unsigned length,
+  GSPrivateNumber *n) GS_ATTRIB_PRIVATE;
+
 #endif /* _GSPrivate_h_ */
 
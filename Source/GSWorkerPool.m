@@ -0,0 +1,383 @@
+/* Implementation of a shared pool of worker threads for GNUStep
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNUstep Base Library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110 USA.
+   */
+
+#import "common.h"
+#import "Foundation/NSArray.h"
+#import "Foundation/NSAutoreleasePool.h"
+#import "Foundation/NSDictionary.h"
+#import "Foundation/NSException.h"
+#import "Foundation/NSIndexSet.h"
+#import "Foundation/NSLock.h"
+#import "Foundation/NSProcessInfo.h"
+#import "Foundation/NSSet.h"
+#import "Foundation/NSThread.h"
+#import "GSPrivate.h"
+
+/*
+ * The pool has a thread for each processor beyond the first (up to a
+ * limit), started when first needed and then kept for the life of the
+ * process.  A job is a number of items to be performed by calling a
+ * function with the index of each item.  The thread which submits a
+ * job works on its items too, so a job always completes even if every
+ * worker is busy (for instance if an item itself submits a job).
+ */
+
+/* The greatest number of worker threads to start.
+ */
+#define	GS_WORKER_POOL_MAX	15
+
+typedef struct GSWorkJob {
+  struct GSWorkJob	*next;
+  void			(*func)(void *context, NSUInteger item);
+  void			*context;
+  NSUInteger		count;		/* Number of items */
+  NSUInteger		started;	/* Items handed out */
+  NSUInteger		finished;	/* Items completed */
+  NSException		*exception;	/* First exception raised */
+} GSWorkJob;
+
+@interface	GSWorkerPool : NSObject
++ (void) _worker: (id)ignored;
+@end
+
+static NSCondition	*poolCond = nil;
+static GSWorkJob	*jobs = NULL;	/* Jobs with items not yet started */
+static NSUInteger	maxWorkers = 0;
+static NSUInteger	workers = 0;	/* Worker threads started */
+
+/* Takes the next item of a job, removing the job from the list once all
+ * its items have been handed out.  Must be called with the lock held.
+ */
+static NSUInteger
+takeItem(GSWorkJob *job)
+{
+  NSUInteger	item = job->started++;
+
+  if (job->started == job->count)
+    {
+      GSWorkJob	**p = &jobs;
+
+      while (*p != job)
+	{
+	  p = &(*p)->next;
+	}
+      *p = job->next;
+    }
+  return item;
+}
+
+/* Performs an item of a job with the lock released, recording any
+ * exception, and reacquires the lock to count the item as finished.
+ */
+static void
+performItem(GSWorkJob *job, NSUInteger item)
+{
+  [poolCond unlock];
+  ENTER_POOL
+  NS_DURING
+    {
+      (*job->func)(job->context, item);
+    }
+  NS_HANDLER
+    {
+      [poolCond lock];
+      if (nil == job->exception)
+	{
+	  job->exception = RETAIN(localException);
+	}
+      [poolCond unlock];
+    }
+  NS_ENDHANDLER
+  LEAVE_POOL
+  [poolCond lock];
+  if (++job->finished == job->count)
+    {
+      [poolCond broadcast];
+    }
+}
+
+@implementation	GSWorkerPool
+
++ (void) initialize
+{
+  if (nil == poolCond)
+    {
+      NSUInteger	cpus;
+
+      cpus = [[NSProcessInfo processInfo] activeProcessorCount];
+      maxWorkers = (cpus > GS_WORKER_POOL_MAX)
+	? GS_WORKER_POOL_MAX : ((cpus > 1) ? cpus - 1 : 0);
+      poolCond = [NSCondition new];
+      [poolCond setName: @"GSWorkerPool"];
+    }
+}
+
++ (void) _worker: (id)ignored
+{
+  [poolCond lock];
+  for (;;)
+    {
+      if (NULL == jobs)
+	{
+	  [poolCond wait];
+	}
+      else
+	{
+	  GSWorkJob	*job = jobs;
+
+	  performItem(job, takeItem(job));
+	}
+    }
+}
+
+@end
+
+NSUInteger
+GSPrivateParallelWidth(void)
+{
+  [GSWorkerPool class];
+  return maxWorkers + 1;
+}
+
+void
+GSPrivateParallelApply(NSUInteger count,
+  void (*func)(void *context, NSUInteger item), void *context)
+{
+  GSWorkJob	job;
+
+  [GSWorkerPool class];
+  if (count < 2 || 0 == maxWorkers)
+    {
+      NSUInteger	i;
+
+      for (i = 0; i < count; i++)
+	{
+	  (*func)(context, i);
+	}
+      return;
+    }
+
+  memset(&job, '\0', sizeof(job));
+  job.func = func;
+  job.context = context;
+  job.count = count;
+
+  [poolCond lock];
+  if (NULL == jobs)
+    {
+      jobs = &job;
+    }
+  else
+    {
+      GSWorkJob	*j = jobs;
+
+      while (j->next != NULL)
+	{
+	  j = j->next;
+	}
+      j->next = &job;
+    }
+  while (workers < maxWorkers && workers < count - 1)
+    {
+      [NSThread detachNewThreadSelector: @selector(_worker:)
+			       toTarget: [GSWorkerPool class]
+			     withObject: nil];
+      workers++;
+    }
+  [poolCond broadcast];
+
+  while (job.started < job.count)
+    {
+      performItem(&job, takeItem(&job));
+    }
+  while (job.finished < job.count)
+    {
+      [poolCond wait];
+    }
+  [poolCond unlock];
+
+  if (nil != job.exception)
+    {
+      [AUTORELEASE(job.exception) raise];
+    }
+}
+
+/* The greatest number of chunks a concurrent enumeration is divided into.
+ */
+#define	GS_ENUMERATION_CHUNKS	((GS_WORKER_POOL_MAX + 1) * 4)
+
+/* State shared by the threads of a concurrent enumeration, each of which
+ * calls the block for the elements in one chunk.  Chunks have size or
+ * (for the first extra of them) size + 1 elements, counting each index
+ * of a range as an element.  For ranges, the range and index at which
+ * each chunk starts are found before the enumeration starts.
+ */
+typedef struct {
+  GSEnumerationKind	kind;
+  void			*items;
+  NSUInteger		size;
+  NSUInteger		extra;
+  NSUInteger		pos[GS_ENUMERATION_CHUNKS];
+  NSUInteger		index[GS_ENUMERATION_CHUNKS];
+  id			block;
+  BOOL			stop;
+} GSEnumeration;
+
+static void
+enumerateChunk(void *context, NSUInteger chunk)
+{
+  GSEnumeration	*e = (GSEnumeration*)context;
+  NSUInteger	i = chunk * e->size + MIN(chunk, e->extra);
+  NSUInteger	end = i + e->size + ((chunk < e->extra) ? 1 : 0);
+
+  switch (e->kind)
+    {
+      case GSEnumerateArray:
+	{
+	  GSEnumeratorBlock	block = (GSEnumeratorBlock)e->block;
+	  id			*objects = (id*)e->items;
+
+	  for (; i < end && NO == e->stop; i++)
+	    {
+	      CALL_BLOCK(block, objects[i], i, &e->stop);
+	    }
+	}
+	break;
+
+      case GSEnumerateSet:
+	{
+	  GSSetEnumeratorBlock	block = (GSSetEnumeratorBlock)e->block;
+	  id			*objects = (id*)e->items;
+
+	  for (; i < end && NO == e->stop; i++)
+	    {
+	      CALL_BLOCK(block, objects[i], &e->stop);
+	    }
+	}
+	break;
+
+      case GSEnumerateDictionary:
+	{
+	  GSKeysAndObjectsEnumeratorBlock	block;
+	  id					*pairs = (id*)e->items;
+
+	  block = (GSKeysAndObjectsEnumeratorBlock)e->block;
+	  for (; i < end && NO == e->stop; i++)
+	    {
+	      CALL_BLOCK(block, pairs[2 * i], pairs[2 * i + 1], &e->stop);
+	    }
+	}
+	break;
+
+      case GSEnumerateIndexes:
+	{
+	  GSIndexSetEnumerationBlock	block;
+	  NSRange			*ranges = (NSRange*)e->items;
+	  NSUInteger			pos = e->pos[chunk];
+	  NSUInteger			index = e->index[chunk];
+	  NSUInteger			n = end - i;
+
+	  block = (GSIndexSetEnumerationBlock)e->block;
+	  while (n > 0 && NO == e->stop)
+	    {
+	      if (index >= NSMaxRange(ranges[pos]))
+		{
+		  index = ranges[++pos].location;
+		  continue;
+		}
+	      CALL_BLOCK(block, index, &e->stop);
+	      index++;
+	      n--;
+	    }
+	}
+	break;
+    }
+}
+
+void
+GSPrivateEnumerateConcurrently(GSEnumerationKind kind, void *items,
+  NSUInteger count, id block)
+{
+  GSEnumeration	e;
+  NSUInteger	total = count;
+  NSUInteger	chunks;
+
+  if (GSEnumerateIndexes == kind)
+    {
+      NSRange		*ranges = (NSRange*)items;
+      NSUInteger	i;
+
+      for (total = i = 0; i < count; i++)
+	{
+	  total += ranges[i].length;
+	}
+    }
+  if (0 == total)
+    {
+      free(items);
+      return;
+    }
+  chunks = MIN(total, GSPrivateParallelWidth() * 4);
+  if (chunks > GS_ENUMERATION_CHUNKS)
+    {
+      chunks = GS_ENUMERATION_CHUNKS;
+    }
+  e.kind = kind;
+  e.items = items;
+  e.size = total / chunks;
+  e.extra = total % chunks;
+  e.block = block;
+  e.stop = NO;
+  if (GSEnumerateIndexes == kind)
+    {
+      NSRange		*ranges = (NSRange*)items;
+      NSUInteger	seen = 0;
+      NSUInteger	next = 0;
+      NSUInteger	k = 0;
+      NSUInteger	i;
+
+      /* Find the range containing the first index of each chunk in one
+       * pass over the ranges.
+       */
+      for (i = 0; i < count && k < chunks; i++)
+	{
+	  while (k < chunks && next < seen + ranges[i].length)
+	    {
+	      e.pos[k] = i;
+	      e.index[k] = ranges[i].location + (next - seen);
+	      next += e.size + ((k < e.extra) ? 1 : 0);
+	      k++;
+	    }
+	  seen += ranges[i].length;
+	}
+    }
+  NS_DURING
+    {
+      GSPrivateParallelApply(chunks, enumerateChunk, &e);
+    }
+  NS_HANDLER
+    {
+      free(items);
+      [localException raise];
+    }
+  NS_ENDHANDLER
+  free(items);
+}
@@ -1779,6 +1779,20 @@ compare(id elem1, id elem2, void* context)
   BOOL isReverse = (opts & NSEnumerationReverse);
   id<NSFastEnumeration> enumerator = self;
 
+  /* For a concurrent enumeration, divide the array into chunks (several
+   * per thread, to balance the load) and enumerate them all at once.
+   */
+  if ((opts & NSEnumerationConcurrent) && (count = [self count]) > 1)
+    {
+      id	*objects = malloc(count * sizeof(id));
+
+      [self getObjects: objects];
+      GSPrivateEnumerateConcurrently(GSEnumerateArray, objects, count,
+	(id)aBlock);
+      return;
+    }
+  count = 0;
+
   /* If we are enumerating in reverse, use the reverse enumerator for fast
    * enumeration. */
   if (isReverse)
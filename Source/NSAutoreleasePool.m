@@ -32,6 +32,7 @@
 #import "Foundation/NSAutoreleasePool.h"
 #import "Foundation/NSException.h"
 #import "Foundation/NSThread.h"
+#import "GSPrivate.h"
 
 #if __has_include(<objc/capabilities.h>)
 #  include <objc/capabilities.h>
@@ -444,9 +445,11 @@ pop_pool_from_cache (struct autorelease_thread_vars *tv)
    * objects in the receiver while the receiver remains set as the current
    * autorelease pool ... so if any object which is being deallocated adds
    * any object to the current autorelease pool, we may need to release it
-   * again.
+   * again.  Releases queued by other threads for objects which this thread
+   * owns (see NSObject.m) are performed here too.
    */
-  while (_child != nil || _released_count > 0)
+  while (_child != nil || _released_count > 0
+    || YES == GSPrivateReleaseDeferred())
     {
       volatile struct autorelease_array_list *released;
 
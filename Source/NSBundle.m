@@ -2046,6 +2046,9 @@ IF_NO_GC(
           DESTROY(_loadingFrameworks);
           DESTROY(_currentFrameworkName);
         }
+      /* The bundle may have added categories to existing classes.
+       */
+      GSPrivateMethodsGeneration++;
       [load_lock unlock];
 
       [[NSNotificationCenter defaultCenter]
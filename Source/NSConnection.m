@@ -56,6 +56,8 @@
   GSIMapTable		_localTargets; \
   GSIMapTable		_remoteProxies; \
   GSIMapTable		_replyMap; \
+  GSIMapTable		_asyncMap; \
+  GSIMapTable		_sigCache; \
   NSTimeInterval	_replyTimeout; \
   NSTimeInterval	_requestTimeout; \
   NSMutableArray	*_requestModes; \
@@ -169,6 +171,15 @@ GSRunLoopForThread(NSThread *aThread)
 - (void) finalize;
 - (void) forwardInvocation: (NSInvocation *)inv
 		  forProxy: (NSDistantObject*)object;
+- (NSException*) _decodeReply: (NSPortCoder*)aRmc
+		   invocation: (NSInvocation*)inv
+			 type: (const char*)type
+		    outParams: (BOOL)outParams;
+- (unsigned) _sendInvocation: (NSInvocation*)inv
+		    forProxy: (NSDistantObject*)object
+			type: (const char**)typep
+		   outParams: (BOOL*)outp
+		needsResponse: (BOOL*)needp;
 - (const char *) typeForSelector: (SEL)sel remoteTarget: (unsigned)target;
 @end
 
@@ -200,6 +211,50 @@ static Class	distantObjectClass;
 static Class	sendCoderClass;
 static Class	recvCoderClass;
 static Class	runLoopClass;
+static IMP	defaultSigImp;
+
+/*
+ * Entry in the per-connection cache of method signatures for incoming
+ * requests.  Entries are chained from a map keyed by selector, and record
+ * the class of the target and the types sent by the remote end (in the
+ * form produced by normaliseTypes()), which are known to match the
+ * signature.
+ */
+typedef struct _GSSigCacheEntry {
+  struct _GSSigCacheEntry	*next;
+  Class				cls;
+  NSMethodSignature		*sig;
+  char				types[1];
+} GSSigCacheEntry;
+
+/*
+ * Copies types into buf (which must be at least as long) without the
+ * qualifiers, offsets and structure names which GSSelectorTypesMatch()
+ * ignores.  Type strings which match each other give the same result,
+ * so a remote end cannot grow the signature cache by sending endless
+ * variations of the types for one method.
+ */
+static void
+normaliseTypes(const char *types, char *buf)
+{
+  while (*types != '\0')
+    {
+      types = GSSkipTypeQualifierAndLayoutInfo(types);
+      if ('{' == *types)
+	{
+	  *buf++ = *types++;
+	  while (*types != '\0' && *types != '=' && *types != '}')
+	    {
+	      types++;
+	    }
+	}
+      if (*types != '\0')
+	{
+	  *buf++ = *types++;
+	}
+    }
+  *buf = '\0';
+}
 
 static NSString*
 stringFromMsgType(int type)
@@ -280,6 +335,60 @@ stringFromMsgType(int type)
 
 @end
 
+/*
+ * GSAsyncReply records a request sent by -sendInvocation:completion:
+ * so that the reply can be decoded into the invocation, and the
+ * completion block called, when the reply arrives.
+ */
+@interface	GSAsyncReply : NSObject
+{
+@public
+  NSInvocation			*inv;
+  char				*type;
+  BOOL				outParams;
+  GSConnectionCompletionBlock	block;
+}
++ (id) newWithInvocation: (NSInvocation*)i
+		    type: (const char*)t
+	       outParams: (BOOL)o
+		   block: (GSConnectionCompletionBlock)b;
+@end
+
+@implementation	GSAsyncReply
+
++ (id) newWithInvocation: (NSInvocation*)i
+		    type: (const char*)t
+	       outParams: (BOOL)o
+		   block: (GSConnectionCompletionBlock)b
+{
+  GSAsyncReply	*item;
+  size_t	l = strlen(t) + 1;
+
+  item = (GSAsyncReply*)NSAllocateObject(self, 0, NSDefaultMallocZone());
+  item->inv = RETAIN(i);
+  item->type = NSZoneMalloc(NSDefaultMallocZone(), l);
+  memcpy(item->type, t, l);
+  item->outParams = o;
+  if (b != 0)
+    {
+      item->block = Block_copy(b);
+    }
+  return item;
+}
+
+- (void) dealloc
+{
+  RELEASE(inv);
+  NSZoneFree(NSDefaultMallocZone(), type);
+  if (block != 0)
+    {
+      Block_release(block);
+    }
+  [super dealloc];
+}
+
+@end
+
 
 
 /** <ignore> */
@@ -308,6 +417,8 @@ GS_PRIVATE_INTERNAL(NSConnection)
 #define	IlocalTargets		(internal->_localTargets)
 #define	IremoteProxies		(internal->_remoteProxies)
 #define	IreplyMap		(internal->_replyMap)
+#define	IasyncMap		(internal->_asyncMap)
+#define	IsigCache		(internal->_sigCache)
 #define	IreplyTimeout		(internal->_replyTimeout)
 #define	IrequestTimeout		(internal->_requestTimeout)
 #define	IrequestModes		(internal->_requestModes)
@@ -334,7 +445,11 @@ GS_PRIVATE_INTERNAL(NSConnection)
 - (void) addLocalObject: (NSDistantObject*)anObj;
 - (void) removeLocalObject: (NSDistantObject*)anObj;
 
+- (void) _completeAsync: (GSAsyncReply*)r reply: (NSPortCoder*)rmc;
 - (void) _doneInReply: (NSPortCoder*)c;
+- (NSMethodSignature*) _signatureFor: (id)target
+			    selector: (SEL)sel
+			       types: (const char*)types;
 - (void) _doneInRmc: (NSPortCoder*) NS_CONSUMED c;
 - (void) _failInRmc: (NSPortCoder*)c;
 - (void) _failOutRmc: (NSPortCoder*)c;
@@ -645,6 +760,8 @@ static NSLock	*cached_proxies_gate = nil;
       sendCoderClass = [NSPortCoder class];
       recvCoderClass = [NSPortCoder class];
       runLoopClass = [NSRunLoop class];
+      defaultSigImp = class_getMethodImplementation([NSObject class],
+	@selector(methodSignatureForSelector:));
 
       dummyObject = [NSObject new];
       [[NSObject leakAt: &dummyObject] release];
@@ -1068,6 +1185,20 @@ static NSLock	*cached_proxies_gate = nil;
   IreplyMap = (GSIMapTable)NSZoneMalloc(z, sizeof(GSIMapTable_t));
   GSIMapInitWithZoneAndCapacity(IreplyMap, z, 4);
 
+  /*
+   * This maps request sequence numbers to the GSAsyncReply objects for
+   * requests sent without waiting for the reply.
+   */
+  IasyncMap = (GSIMapTable)NSZoneMalloc(z, sizeof(GSIMapTable_t));
+  GSIMapInitWithZoneAndCapacity(IasyncMap, z, 4);
+
+  /*
+   * This maps selectors to chains of GSSigCacheEntry structures, so that
+   * repeated incoming requests need not look up and check signatures.
+   */
+  IsigCache = (GSIMapTable)NSZoneMalloc(z, sizeof(GSIMapTable_t));
+  GSIMapInitWithZoneAndCapacity(IsigCache, z, 16);
+
   /*
    * This maps (void*)obj to (id)obj.  The obj's are retained.
    * We use this instead of an NSHashTable because we only care about
@@ -1235,7 +1366,49 @@ static NSLock	*cached_proxies_gate = nil;
   NSHashRemove(connection_table, self);
   GSM_UNLOCK(connection_table_gate);
 
-  GSM_UNLOCK(IrefGate);
+  /*
+   * No replies can arrive now, so any requests sent asynchronously
+   * must be told that they have failed.
+   */
+  if (IasyncMap != 0 && IasyncMap->nodeCount > 0)
+    {
+      GSIMapEnumerator_t	enumerator;
+      GSIMapNode 		node;
+      NSMutableArray		*pending;
+      NSException		*exc;
+      NSUInteger		count;
+
+      pending = [[NSMutableArray alloc] initWithCapacity: IasyncMap->nodeCount];
+      enumerator = GSIMapEnumeratorForMap(IasyncMap);
+      node = GSIMapEnumeratorNextNode(&enumerator);
+      while (node != 0)
+	{
+	  [pending addObject: node->value.obj];
+	  RELEASE(node->value.obj);
+	  node = GSIMapEnumeratorNextNode(&enumerator);
+	}
+      GSIMapCleanMap(IasyncMap);
+      GSM_UNLOCK(IrefGate);
+
+      exc = [NSException exceptionWithName: NSGenericException
+	reason: @"connection waiting for request was shut down"
+	userInfo: nil];
+      count = [pending count];
+      while (count-- > 0)
+	{
+	  GSAsyncReply	*r = [pending objectAtIndex: count];
+
+	  if (r->block != 0)
+	    {
+	      CALL_BLOCK(r->block, r->inv, exc);
+	    }
+	}
+      RELEASE(pending);
+    }
+  else
+    {
+      GSM_UNLOCK(IrefGate);
+    }
 
   /*
    * Don't need notifications any more - so remove self as observer.
@@ -1934,6 +2107,40 @@ static NSLock	*cached_proxies_gate = nil;
       NSZoneFree(IreplyMap->zone, (void*)IreplyMap);
       IreplyMap = 0;
     }
+  if (IasyncMap != 0)
+    {
+      /* Any outstanding requests were failed when we were invalidated.
+       */
+      GSIMapEmptyMap(IasyncMap);
+      NSZoneFree(IasyncMap->zone, (void*)IasyncMap);
+      IasyncMap = 0;
+    }
+  if (IsigCache != 0)
+    {
+      GSIMapEnumerator_t	enumerator;
+      GSIMapNode 		node;
+
+      enumerator = GSIMapEnumeratorForMap(IsigCache);
+      node = GSIMapEnumeratorNextNode(&enumerator);
+
+      while (node != 0)
+	{
+	  GSSigCacheEntry	*e = (GSSigCacheEntry*)node->value.ptr;
+
+	  while (e != 0)
+	    {
+	      GSSigCacheEntry	*n = e->next;
+
+	      RELEASE(e->sig);
+	      NSZoneFree(NSDefaultMallocZone(), e);
+	      e = n;
+	    }
+	  node = GSIMapEnumeratorNextNode(&enumerator);
+	}
+      GSIMapEmptyMap(IsigCache);
+      NSZoneFree(IsigCache->zone, (void*)IsigCache);
+      IsigCache = 0;
+    }
 
   DESTROY(IcachedDecoders);
   DESTROY(IcachedEncoders);
@@ -1946,16 +2153,21 @@ static NSLock	*cached_proxies_gate = nil;
 }
 
 /*
- * NSDistantObject's -forwardInvocation: method calls this to send the message
- * over the wire.
+ * Encodes the invocation (whose target is the proxy object) as a request
+ * and sends it over the wire, returning the sequence number used.
+ * On return *typep points to the method type, *outp says whether there
+ * are values to be returned by reference, and *needp says whether the
+ * other end will send a reply.
  */
-- (void) forwardInvocation: (NSInvocation*)inv
-		  forProxy: (NSDistantObject*)object
+- (unsigned) _sendInvocation: (NSInvocation*)inv
+		    forProxy: (NSDistantObject*)object
+			type: (const char**)typep
+		   outParams: (BOOL*)outp
+		needsResponse: (BOOL*)needp
 {
   NSPortCoder	*op;
   BOOL		outParams;
   BOOL		needsResponse;
-  const char	*name;
   const char	*type;
   unsigned	seq;
   NSRunLoop	*runLoop = GSRunLoopForThread(nil);
@@ -2025,9 +2237,8 @@ static NSLock	*cached_proxies_gate = nil;
     }
 
   [self _sendOutRmc: op type: METHOD_REQUEST sequence: seq];
-  name = sel_getName([inv selector]);
   NSDebugMLLog(@"NSConnection", @"Sent message %s RMC %d to 0x%"PRIxPTR,
-    name, seq, (NSUInteger)self);
+    sel_getName([inv selector]), seq, (NSUInteger)self);
 
   if (needsResponse == NO)
     {
@@ -2047,134 +2258,181 @@ static NSLock	*cached_proxies_gate = nil;
 	  [node->value.obj decodeValueOfObjCType: @encode(BOOL)
 					      at: &is_exception];
 	  if (is_exception == YES)
-	    NSLog(@"Got exception with %s", name);
+	    NSLog(@"Got exception with %s", sel_getName([inv selector]));
 	  else
-	    NSLog(@"Got response with %s", name);
+	    NSLog(@"Got response with %s", sel_getName([inv selector]));
 	  [self _doneInRmc: node->value.obj];
 	}
       GSIMapRemoveKey(IreplyMap, (GSIMapKey)(NSUInteger)seq);
       GSM_UNLOCK(IrefGate);
     }
-  else
-    {
-      int		argnum;
-      int		flags;
-      const char	*tmptype;
-      void		*datum;
-      NSPortCoder	*aRmc;
-      BOOL		is_exception;
+  *typep = type;
+  *outp = outParams;
+  *needp = needsResponse;
+  return seq;
+}
 
-      if ([self isValid] == NO)
-	{
-	  [NSException raise: NSGenericException
-	    format: @"connection waiting for request was shut down"];
-	}
-      aRmc = [self _getReplyRmc: seq for: name];
+/*
+ * Decodes the reply to a request into the invocation which was sent,
+ * and disposes of the reply.  If the other end sent back an exception
+ * rather than the return values, the exception is returned, otherwise
+ * this returns nil.
+ */
+- (NSException*) _decodeReply: (NSPortCoder*)aRmc
+		   invocation: (NSInvocation*)inv
+			 type: (const char*)type
+		    outParams: (BOOL)outParams
+{
+  int		argnum;
+  int		flags;
+  const char	*tmptype;
+  void		*datum;
+  BOOL		is_exception;
 
-      /*
-       * Find out if the server is returning an exception instead
-       * of the return values.
-       */
-      [aRmc decodeValueOfObjCType: @encode(BOOL) at: &is_exception];
-      if (is_exception == YES)
-	{
-	  /* Decode the exception object, and raise it. */
-	  id exc = [aRmc decodeObject];
+  /*
+   * Find out if the server is returning an exception instead
+   * of the return values.
+   */
+  [aRmc decodeValueOfObjCType: @encode(BOOL) at: &is_exception];
+  if (is_exception == YES)
+    {
+      /* Decode the exception object, and return it. */
+      id exc = [aRmc decodeObject];
 
-	  [self _doneInReply: aRmc];
-	  [exc raise];
-	}
+      [self _doneInReply: aRmc];
+      return exc;
+    }
 
-      /* Get the return type qualifier flags, and the return type. */
-      flags = objc_get_type_qualifiers(type);
-      tmptype = objc_skip_type_qualifiers(type);
+  /* Get the return type qualifier flags, and the return type. */
+  flags = objc_get_type_qualifiers(type);
+  tmptype = objc_skip_type_qualifiers(type);
 
-      /* Decode the return value and pass-by-reference values, if there
-	 are any.  OUT_PARAMETERS should be the value returned by
-	 cifframe_dissect_call(). */
-      if (outParams || *tmptype != _C_VOID || (flags & _F_ONEWAY) == 0)
-	/* xxx What happens with method declared "- (oneway) foo: (out int*)ip;" */
-	/* xxx What happens with method declared "- (in char *) bar;" */
-	/* xxx Is this right?  Do we also have to check _F_ONEWAY? */
-	{
-	  id	obj;
+  /* Decode the return value and pass-by-reference values, if there
+     are any.  OUT_PARAMETERS should be the value returned by
+     cifframe_dissect_call(). */
+  if (outParams || *tmptype != _C_VOID || (flags & _F_ONEWAY) == 0)
+    /* xxx What happens with method declared "- (oneway) foo: (out int*)ip;" */
+    /* xxx What happens with method declared "- (in char *) bar;" */
+    /* xxx Is this right?  Do we also have to check _F_ONEWAY? */
+    {
+      id	obj;
 
-	  /* If there is a return value, decode it, and put it in datum. */
-	  if (*tmptype != _C_VOID || (flags & _F_ONEWAY) == 0)
+      /* If there is a return value, decode it, and put it in datum. */
+      if (*tmptype != _C_VOID || (flags & _F_ONEWAY) == 0)
+	{
+	  switch (*tmptype)
 	    {
-	      switch (*tmptype)
-		{
-		  case _C_ID:
-		    datum = &obj;
-		    [aRmc decodeValueOfObjCType: tmptype at: datum];
-		    [obj autorelease];
-		    break;
-		  case _C_PTR:
-		    /* We are returning a pointer to something. */
-		    tmptype++;
-		    datum = alloca (objc_sizeof_type (tmptype));
-		    [aRmc decodeValueOfObjCType: tmptype at: datum];
-		    break;
+	      case _C_ID:
+		datum = &obj;
+		[aRmc decodeValueOfObjCType: tmptype at: datum];
+		[obj autorelease];
+		break;
+	      case _C_PTR:
+		/* We are returning a pointer to something. */
+		tmptype++;
+		datum = alloca (objc_sizeof_type (tmptype));
+		[aRmc decodeValueOfObjCType: tmptype at: datum];
+		break;
 
-		  case _C_VOID:
-		    datum = alloca (sizeof (int));
-		    [aRmc decodeValueOfObjCType: @encode(int) at: datum];
-		    break;
+	      case _C_VOID:
+		datum = alloca (sizeof (int));
+		[aRmc decodeValueOfObjCType: @encode(int) at: datum];
+		break;
 
-		  default:
-		    datum = alloca (objc_sizeof_type (tmptype));
-		    [aRmc decodeValueOfObjCType: tmptype at: datum];
-		    break;
-		}
-	    }
-	  else
-	    {
-	      datum = 0;
+	      default:
+		datum = alloca (objc_sizeof_type (tmptype));
+		[aRmc decodeValueOfObjCType: tmptype at: datum];
+		break;
 	    }
-	  [inv setReturnValue: datum];
+	}
+      else
+	{
+	  datum = 0;
+	}
+      [inv setReturnValue: datum];
 
-	  /* Decode the values returned by reference.  Note: this logic
-	     must match exactly the code in _service_forwardForProxy:
-	     */
-	  if (outParams)
+      /* Decode the values returned by reference.  Note: this logic
+	 must match exactly the code in _service_forwardForProxy:
+	 */
+      if (outParams)
+	{
+	  /* Step through all the arguments, finding the ones that were
+	     passed by reference. */
+	  for (tmptype = skip_argspec (tmptype), argnum = 0;
+	    *tmptype != '\0';
+	    tmptype = skip_argspec (tmptype), argnum++)
 	    {
-	      /* Step through all the arguments, finding the ones that were
-		 passed by reference. */
-	      for (tmptype = skip_argspec (tmptype), argnum = 0;
-	        *tmptype != '\0';
-	        tmptype = skip_argspec (tmptype), argnum++)
+	      /* Get the type qualifiers, like IN, OUT, INOUT, ONEWAY. */
+	      flags = objc_get_type_qualifiers(tmptype);
+	      /* Skip over the type qualifiers, so now TYPE is
+		 pointing directly at the char corresponding to the
+		 argument's type. */
+	      tmptype = objc_skip_type_qualifiers(tmptype);
+
+	      if (*tmptype == _C_PTR
+		&& ((flags & _F_OUT) || !(flags & _F_IN)))
 		{
-		  /* Get the type qualifiers, like IN, OUT, INOUT, ONEWAY. */
-		  flags = objc_get_type_qualifiers(tmptype);
-		  /* Skip over the type qualifiers, so now TYPE is
-		     pointing directly at the char corresponding to the
-		     argument's type. */
-		  tmptype = objc_skip_type_qualifiers(tmptype);
-
-		  if (*tmptype == _C_PTR
-		    && ((flags & _F_OUT) || !(flags & _F_IN)))
-		    {
-		      /* If the arg was byref, we obtain its address
-		       * and decode the data directly to it.
-		       */
-		      tmptype++;
-		      [inv getArgument: &datum atIndex: argnum];
-		      [aRmc decodeValueOfObjCType: tmptype at: datum];
-		      if (*tmptype == _C_ID)
-			{
-			  [*(id*)datum autorelease];
-			}
-		    }
-		  else if (*tmptype == _C_CHARPTR
-		    && ((flags & _F_OUT) || !(flags & _F_IN)))
+		  /* If the arg was byref, we obtain its address
+		   * and decode the data directly to it.
+		   */
+		  tmptype++;
+		  [inv getArgument: &datum atIndex: argnum];
+		  [aRmc decodeValueOfObjCType: tmptype at: datum];
+		  if (*tmptype == _C_ID)
 		    {
-		      [aRmc decodeValueOfObjCType: tmptype at: &datum];
-		      [inv setArgument: datum atIndex: argnum];
+		      [*(id*)datum autorelease];
 		    }
 		}
+	      else if (*tmptype == _C_CHARPTR
+		&& ((flags & _F_OUT) || !(flags & _F_IN)))
+		{
+		  [aRmc decodeValueOfObjCType: tmptype at: &datum];
+		  [inv setArgument: datum atIndex: argnum];
+		}
 	    }
 	}
-      [self _doneInReply: aRmc];
+    }
+  [self _doneInReply: aRmc];
+  return nil;
+}
+
+/*
+ * NSDistantObject's -forwardInvocation: method calls this to send the message
+ * over the wire.
+ */
+- (void) forwardInvocation: (NSInvocation*)inv
+		  forProxy: (NSDistantObject*)object
+{
+  BOOL		outParams;
+  BOOL		needsResponse;
+  const char	*type;
+  unsigned	seq;
+
+  seq = [self _sendInvocation: inv
+		     forProxy: object
+			 type: &type
+		    outParams: &outParams
+		needsResponse: &needsResponse];
+
+  if (needsResponse == YES)
+    {
+      NSPortCoder	*aRmc;
+      NSException	*exc;
+
+      if ([self isValid] == NO)
+	{
+	  [NSException raise: NSGenericException
+	    format: @"connection waiting for request was shut down"];
+	}
+      aRmc = [self _getReplyRmc: seq for: sel_getName([inv selector])];
+      exc = [self _decodeReply: aRmc
+		    invocation: inv
+			  type: type
+		     outParams: outParams];
+      if (exc != nil)
+	{
+	  [exc raise];
+	}
     }
 }
 
@@ -2238,6 +2496,92 @@ static NSLock	*cached_proxies_gate = nil;
 
 
 
+@implementation	NSConnection (GSAsynchronous)
+
+- (void) sendInvocation: (NSInvocation*)inv
+	     completion: (GSConnectionCompletionBlock)block
+{
+  NSDistantObject	*object = [inv target];
+  NSPortCoder		*rmc = nil;
+  GSAsyncReply		*r;
+  GSIMapNode		node;
+  BOOL			outParams;
+  BOOL			needsResponse;
+  const char		*type;
+  unsigned		seq;
+
+  if (object == nil || object_getClass(object) != distantObjectClass
+    || [object connectionForProxy] != self)
+    {
+      [NSException raise: NSInvalidArgumentException
+		  format: @"[%@-%@] target is not a proxy for this connection",
+	NSStringFromClass([self class]), NSStringFromSelector(_cmd)];
+    }
+
+  seq = [self _sendInvocation: inv
+		     forProxy: object
+			 type: &type
+		    outParams: &outParams
+		needsResponse: &needsResponse];
+
+  if (needsResponse == NO)
+    {
+      if (block != 0)
+	{
+	  CALL_BLOCK(block, inv, nil);
+	}
+      return;
+    }
+
+  r = [GSAsyncReply newWithInvocation: inv
+				 type: type
+			    outParams: outParams
+				block: block];
+
+  /*
+   * The placeholder added to IreplyMap when the request was built is
+   * no longer needed ... replies for this sequence number will now be
+   * looked for in IasyncMap.  But the reply may already have arrived
+   * while we were sending, in which case we can complete immediately.
+   */
+  GS_M_LOCK(IrefGate);
+  node = GSIMapNodeForKey(IreplyMap, (GSIMapKey)(NSUInteger)seq);
+  if (node != 0 && node->value.obj != dummyObject)
+    {
+      rmc = node->value.obj;
+    }
+  GSIMapRemoveKey(IreplyMap, (GSIMapKey)(NSUInteger)seq);
+  if (rmc == nil && IisValid == YES)
+    {
+      GSIMapAddPair(IasyncMap,
+	(GSIMapKey)(NSUInteger)seq, (GSIMapVal)(id)r);
+      r = nil;
+    }
+  GSM_UNLOCK(IrefGate);
+
+  if (r != nil)
+    {
+      if (rmc != nil)
+	{
+	  [self _completeAsync: r reply: rmc];
+	}
+      else if (block != 0)
+	{
+	  NSException	*exc;
+
+	  exc = [NSException exceptionWithName: NSGenericException
+	    reason: @"connection waiting for request was shut down"
+	    userInfo: nil];
+	  CALL_BLOCK(block, inv, exc);
+	}
+      RELEASE(r);
+    }
+}
+
+@end
+
+
+
 @implementation	NSConnection (Private)
 
 - (void) handlePortMessage: (NSPortMessage*)msg
@@ -2374,6 +2718,24 @@ static NSLock	*cached_proxies_gate = nil;
 	      break;
 	    }
 	  GS_M_LOCK(GSIVar(conn, _refGate));
+	  if (type == METHOD_REPLY && GSIVar(conn, _asyncMap) != 0
+	    && (node = GSIMapNodeForKey(GSIVar(conn, _asyncMap),
+	    (GSIMapKey)(NSUInteger)sequence)) != 0)
+	    {
+	      GSAsyncReply	*r = node->value.obj;
+
+	      /* This is the reply to a request sent without waiting,
+	       * so we complete it now rather than storing it.
+	       */
+	      GSIMapRemoveKey(GSIVar(conn, _asyncMap),
+		(GSIMapKey)(NSUInteger)sequence);
+	      GSM_UNLOCK(GSIVar(conn, _refGate));
+	      NSDebugMLLog(@"NSConnection", @"Completing reply RMC %d on %@",
+		sequence, conn);
+	      [conn _completeAsync: r reply: rmc];
+	      RELEASE(r);
+	      break;
+	    }
 	  node = GSIMapNodeForKey(GSIVar(conn, _replyMap),
 	    (GSIMapKey)(NSUInteger)sequence);
 	  if (node == 0)
@@ -2572,25 +2934,11 @@ static NSLock	*cached_proxies_gate = nil;
 	 as the ENCODED_TYPES string, but it will have different register
 	 and stack locations if the ENCODED_TYPES came from a machine of a
 	 different architecture. */
-      sig = [target methodSignatureForSelector: selector];
-      if (nil == sig)
-	{
-	  [NSException raise: NSInvalidArgumentException
-		       format: @"decoded object %p doesn't handle %s",
-	    target, sel_getName(selector)];
-	}
+      sig = [self _signatureFor: target
+		       selector: selector
+			  types: encoded_types];
       type = [sig methodType];
 
-      /* Make sure we successfully got the method type, and that its
-	 types match the ENCODED_TYPES. */
-      NSCParameterAssert (type);
-      if (GSSelectorTypesMatch(encoded_types, type) == NO)
-	{
-	  [NSException raise: NSInvalidArgumentException
-	    format: @"NSConection types (%s / %s) mismatch for %s",
-	    encoded_types, type, sel_getName(selector)];
-	}
-
       inv = [[NSInvocation alloc] initWithMethodSignature: sig];
 
       tmptype = skip_argspec (type);
@@ -3258,6 +3606,35 @@ static NSLock	*cached_proxies_gate = nil;
   return rmc;
 }
 
+/*
+ * Complete a request sent by -sendInvocation:completion: by decoding
+ * the reply into the invocation and calling the completion block.
+ */
+- (void) _completeAsync: (GSAsyncReply*)r reply: (NSPortCoder*)rmc
+{
+  NSException	*exc;
+
+  NS_DURING
+    {
+      exc = [self _decodeReply: rmc
+		    invocation: r->inv
+			  type: r->type
+		     outParams: r->outParams];
+    }
+  NS_HANDLER
+    {
+      /* The reply could not be decoded, so it has not been disposed of.
+       */
+      [self _failInRmc: rmc];
+      exc = localException;
+    }
+  NS_ENDHANDLER
+  if (r->block != 0)
+    {
+      CALL_BLOCK(r->block, r->inv, exc);
+    }
+}
+
 - (void) _doneInReply: (NSPortCoder*)c
 {
   [self _doneInRmc: c];
@@ -3500,6 +3877,95 @@ static NSLock	*cached_proxies_gate = nil;
     }
 }
 
+/*
+ * Returns the signature to use for an incoming request for sel on target,
+ * raising an exception if there is none or if it does not match the types
+ * sent by the remote end.  Signatures for classes which implement the
+ * method and use the standard -methodSignatureForSelector: are cached,
+ * so repeated requests need neither the lookup nor the type comparison.
+ */
+- (NSMethodSignature*) _signatureFor: (id)target
+			    selector: (SEL)sel
+			       types: (const char*)types
+{
+  Class			c = object_getClass(target);
+  NSMethodSignature	*sig = nil;
+  GSSigCacheEntry	*e;
+  GSIMapNode		node;
+  const char		*type;
+  char			norm[256];
+  BOOL			cacheable;
+
+  /* Unusually long type strings are simply not cached.
+   */
+  cacheable = (strlen(types) < sizeof(norm)) ? YES : NO;
+  if (YES == cacheable)
+    {
+      normaliseTypes(types, norm);
+      GS_M_LOCK(IrefGate);
+      node = GSIMapNodeForKey(IsigCache, (GSIMapKey)(void*)sel);
+      for (e = (node == 0) ? 0 : node->value.ptr; e != 0; e = e->next)
+	{
+	  if (e->cls == c && strcmp(e->types, norm) == 0)
+	    {
+	      sig = e->sig;
+	      break;
+	    }
+	}
+      GSM_UNLOCK(IrefGate);
+      if (sig != nil)
+	{
+	  return sig;
+	}
+    }
+
+  sig = [target methodSignatureForSelector: sel];
+  if (nil == sig)
+    {
+      [NSException raise: NSInvalidArgumentException
+		   format: @"decoded object %p doesn't handle %s",
+	target, sel_getName(sel)];
+    }
+  type = [sig methodType];
+
+  /* Make sure we successfully got the method type, and that its
+     types match the ENCODED_TYPES. */
+  NSCParameterAssert (type);
+  if (GSSelectorTypesMatch(types, type) == NO)
+    {
+      [NSException raise: NSInvalidArgumentException
+	format: @"NSConection types (%s / %s) mismatch for %s",
+	types, type, sel_getName(sel)];
+    }
+
+  if (YES == cacheable
+    && class_getInstanceMethod(c, sel) != 0
+    && class_getMethodImplementation(c,
+      @selector(methodSignatureForSelector:)) == defaultSigImp)
+    {
+      size_t	l = strlen(norm) + 1;
+
+      e = NSZoneMalloc(NSDefaultMallocZone(), sizeof(GSSigCacheEntry) + l);
+      e->cls = c;
+      e->sig = RETAIN(sig);
+      memcpy(e->types, norm, l);
+      GS_M_LOCK(IrefGate);
+      node = GSIMapNodeForKey(IsigCache, (GSIMapKey)(void*)sel);
+      if (node == 0)
+	{
+	  e->next = 0;
+	  GSIMapAddPair(IsigCache, (GSIMapKey)(void*)sel, (GSIMapVal)(void*)e);
+	}
+      else
+	{
+	  e->next = node->value.ptr;
+	  node->value.ptr = e;
+	}
+      GSM_UNLOCK(IrefGate);
+    }
+  return sig;
+}
+
 
 
 /* Managing objects and proxies. */
@@ -143,9 +143,6 @@ decodebase64(unsigned char *dst, const unsigned char *src)
   dst[2] = ((src[2] & 0x03) << 6) |  (src[3] & 0x3F);
 }
 
-static char b64[]
-  = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
 static const int crlf64 = NSDataBase64EncodingEndLineWithCarriageReturn
   | NSDataBase64EncodingEndLineWithLineFeed;
 
@@ -156,11 +153,9 @@ encodebase64(unsigned char **dstRef,
   NSDataBase64EncodingOptions options)
 {
   unsigned char *dst;
-  NSUInteger dIndex = 0;
-  NSUInteger dIndexNoNewLines = 0;
-  NSUInteger sIndex;
   NSUInteger lineLength;
   NSUInteger destLen;
+  const char *eol;
 
   lineLength = 0;
   if (options & NSDataBase64Encoding64CharacterLineLength)
@@ -175,57 +170,17 @@ encodebase64(unsigned char **dstRef,
     {
       options |= crlf64;
     }
+  if ((options & crlf64) == crlf64)
+    eol = "\r\n";
+  else if (options & NSDataBase64EncodingEndLineWithCarriageReturn)
+    eol = "\r";
+  else
+    eol = "\n";
 
-  /* estimate destination length */
-  destLen = 4 * ((length + 2) / 3);
-  /* we need to take in account line-endings */
-  if (lineLength)
-    {
-      if ((options & crlf64) == crlf64)
-        destLen += (destLen / lineLength)*2;    // CR and LF
-      else
-        destLen += (destLen / lineLength);      // CR or LF
-    }
-
+  destLen = GSPrivateBase64EncodedLength(length, lineLength, strlen(eol));
   dst = NSZoneMalloc(NSDefaultMallocZone(), destLen);
-
-  for (sIndex = 0; sIndex < length; sIndex += 3)
-    {
-      int	c0 = src[sIndex];
-      int	c1 = (sIndex+1 < length) ? src[sIndex+1] : 0;
-      int	c2 = (sIndex+2 < length) ? src[sIndex+2] : 0;
-
-      dst[dIndex++] = b64[(c0 >> 2) & 077];
-      dst[dIndex++] = b64[((c0 << 4) & 060) | ((c1 >> 4) & 017)];
-      dst[dIndex++] = b64[((c1 << 2) & 074) | ((c2 >> 6) & 03)];
-      dst[dIndex++] = b64[c2 & 077];
-      dIndexNoNewLines += 4;
-      if (lineLength && !(dIndexNoNewLines % lineLength) )
-        {
-          if (options & NSDataBase64EncodingEndLineWithCarriageReturn)
-            dst[dIndex++] = '\r';
-          if (options & NSDataBase64EncodingEndLineWithLineFeed)
-            dst[dIndex++] = '\n';
-        }
-    }
-
-   /* If len was not a multiple of 3, then we have encoded too
-    * many characters.  Adjust appropriately.
-    */
-   if (sIndex == length + 1)
-     {
-       /* There were only 2 bytes in that last group */
-       dst[dIndex - 1] = '=';
-     }
-   else if (sIndex == length + 2)
-     {
-       /* There was only 1 byte in that last group */
-       dst[dIndex - 1] = '=';
-       dst[dIndex - 2] = '=';
-     }
-
   *dstRef = dst;
-  return dIndex;
+  return GSPrivateEncodeBase64Lines(src, length, dst, lineLength, eol);
 }
 
 static BOOL
@@ -476,6 +431,7 @@ failure:
 
 #ifdef	HAVE_MMAP
 @interface	NSDataMappedFile : NSDataMalloc
+- (id) _initWithMappedBytes: (void*)b length: (NSUInteger)l;
 @end
 #endif
 
@@ -718,8 +674,17 @@ failure:
 
   while (src != end)
     {
-      int	c = *src++;
+      int	c;
 
+      if (0 == pos)
+	{
+	  dst += GSPrivateDecodeBase64Quads(&src, end, dst, YES);
+	  if (src == end)
+	    {
+	      break;
+	    }
+	}
+      c = *src++;
       if (isupper(c))
 	{
 	  c -= 'A';
@@ -3602,6 +3567,15 @@ getBytes(void* dst, void* src, unsigned len, unsigned limit, unsigned *pos)
   [super finalize];
 }
 
+/* Take ownership of bytes already mapped, to be unmapped on deallocation.
+ */
+- (id) _initWithMappedBytes: (void*)b length: (NSUInteger)l
+{
+  bytes = b;
+  length = l;
+  return self;
+}
+
 /**
  *  Initialize with data pointing to contents of file at path.  Bytes are
  *  only "swapped in" as needed.  File should not be moved or deleted for
@@ -3668,6 +3642,30 @@ getBytes(void* dst, void* src, unsigned len, unsigned limit, unsigned *pos)
 
 @end
 #endif	/* HAVE_MMAP	*/
+
+NSData *
+GSPrivateDataWithDescriptor(int fd, NSUInteger length)
+{
+#ifdef	HAVE_MMAP
+  NSDataMappedFile	*d;
+  void			*bytes;
+
+  if (length == 0)
+    {
+      return [NSData data];
+    }
+  bytes = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+  if (bytes == MAP_FAILED)
+    {
+      return nil;
+    }
+  d = [NSDataMappedFile allocWithZone: NSDefaultMallocZone()];
+  d = [d _initWithMappedBytes: bytes length: length];
+  return AUTORELEASE(d);
+#else
+  return nil;
+#endif
+}
 
 #ifdef	HAVE_SHMCTL
 @implementation	NSDataShared
@@ -165,15 +165,36 @@ static SEL	appSel;
 {
   /*
    * NOTE: According to the Cocoa documentation, NSEnumerationReverse is
-   * undefined for NSDictionary. NSEnumerationConcurrent will be handled through
-   * the GS_DISPATCH_* macros if libdispatch is available.
+   * undefined for NSDictionary. NSEnumerationConcurrent is handled by
+   * taking the keys and objects out of the dictionary and enumerating
+   * chunks of them (several per thread) all at once.
    */
    id<NSFastEnumeration> enumerator = [self keyEnumerator];
    SEL objectForKeySelector = @selector(objectForKey:);
    IMP objectForKey = [self methodForSelector: objectForKeySelector];
    BLOCK_SCOPE BOOL shouldStop = NO;
+   NSUInteger count;
    id obj;
 
+   if ((opts & NSEnumerationConcurrent) && (count = [self count]) > 1)
+     {
+       id		*pairs = malloc(2 * count * sizeof(id));
+       NSUInteger	i = 0;
+
+       FOR_IN(id, key, enumerator)
+	 if (i < count)
+	   {
+	     pairs[2 * i] = key;
+	     pairs[2 * i + 1]
+	       = (*objectForKey)(self, objectForKeySelector, key);
+	     i++;
+	   }
+       END_FOR_IN(enumerator)
+       GSPrivateEnumerateConcurrently(GSEnumerateDictionary, pairs, i,
+	 (id)aBlock);
+       return;
+     }
+
    GS_DISPATCH_CREATE_QUEUE_AND_GROUP_FOR_ENUMERATION(enumQueue, opts)
    FOR_IN(id, key, enumerator)
      obj = (*objectForKey)(self, objectForKeySelector, key);
@@ -54,6 +54,8 @@
 		     userInfo: (NSData*)info
 		     selector: (NSString*)aSelector
 			   to: (uint64_t)observer;
+- (oneway void) postNotifications: (NSData*)batch
+			    count: (unsigned)count;
 @end
 
 /**
@@ -531,6 +533,8 @@ static NSDistributedNotificationCenter	*netCenter = nil;
 		  deliverImmediately: (BOOL)deliverImmediately
 			         for: (id<GDNCClient>)client;
 - (void) registerClient: (id<GDNCClient>)client;
+- (void) registerClient: (id<GDNCClient>)client
+	       batching: (BOOL)flag;
 - (void) removeObserver: (uint64_t)anObserver
 		   name: (NSString*)notificationname
 		 object: (NSString*)anObject
@@ -559,6 +563,10 @@ static NSDistributedNotificationCenter	*netCenter = nil;
 - (void) registerClient: (id<GDNCClient>)client
 {
 }
+- (void) registerClient: (id<GDNCClient>)client
+	       batching: (BOOL)flag
+{
+}
 - (void) removeObserver: (uint64_t)anObserver
 		   name: (NSString*)notificationname
 		 object: (NSString*)anObject
@@ -778,7 +786,17 @@ static NSDistributedNotificationCenter	*netCenter = nil;
 	   selector: @selector(_invalidated:)
 	       name: NSConnectionDidDieNotification
 	     object: c];
-      [_remote registerClient: (id<GDNCClient>)self];
+      NS_DURING
+	{
+	  [_remote registerClient: (id<GDNCClient>)self batching: YES];
+	}
+      NS_HANDLER
+	{
+	  /* An older server which sends each notification separately.
+	   */
+	  [_remote registerClient: (id<GDNCClient>)self];
+	}
+      NS_ENDHANDLER
     }
 }
 
@@ -817,5 +835,38 @@ static NSDistributedNotificationCenter	*netCenter = nil;
 		  withObject: notification];
 }
 
+- (oneway void) postNotifications: (NSData*)batch
+			    count: (unsigned)count
+{
+  NSUnarchiver	*u;
+
+  u = [[NSUnarchiver alloc] initForReadingWithData: batch];
+  while (count-- > 0)
+    {
+      NSString	*name = [u decodeObject];
+      NSString	*object = [u decodeObject];
+      NSData	*info = [u decodeObject];
+      NSString	*aSelector = [u decodeObject];
+      uint64_t	observer;
+
+      [u decodeValueOfObjCType: @encode(uint64_t) at: &observer];
+      NS_DURING
+	{
+	  [self postNotificationName: name
+			      object: object
+			    userInfo: info
+			    selector: aSelector
+				  to: observer];
+	}
+      NS_HANDLER
+	{
+	  NSLog(@"Problem posting distributed notification %@: %@",
+	    name, localException);
+	}
+      NS_ENDHANDLER
+    }
+  RELEASE(u);
+}
+
 @end
 
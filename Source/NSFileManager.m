@@ -54,12 +54,15 @@
 #import "Foundation/NSException.h"
 #import "Foundation/NSFileManager.h"
 #import "Foundation/NSLock.h"
+#import "Foundation/NSNull.h"
 #import "Foundation/NSPathUtilities.h"
 #import "Foundation/NSProcessInfo.h"
 #import "Foundation/NSSet.h"
+#import "Foundation/NSThread.h"
 #import "Foundation/NSURL.h"
 #import "Foundation/NSValue.h"
 #import "GSPrivate.h"
+#import "GNUstepBase/NSFileManager+GNUstepBase.h"
 #import "GNUstepBase/NSString+GNUstepBase.h"
 #import "GNUstepBase/NSTask+GNUstepBase.h"
 
@@ -164,6 +167,27 @@
 # include <utime.h>
 #endif
 
+#if	defined(__linux__)
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <sys/sysmacros.h>
+/* Share the extents of one file with another (a reflink copy).
+ * Defined here rather than taken from <linux/fs.h> which may clash
+ * with <sys/mount.h>
+ */
+#  if	!defined(FICLONE)
+#    define	FICLONE	_IOW(0x94, 9, int)
+#  endif
+#endif
+
+/* We can walk directory trees relative to open directories, using
+ * the file type from directory entries to avoid most calls to stat().
+ */
+#if	!defined(_WIN32) && defined(DT_DIR) && defined(AT_SYMLINK_NOFOLLOW) \
+  && defined(HAVE_UTIMENSAT)
+#define	USE_TREE_WALKER	1
+#endif
+
 /*
  * On systems that have the O_BINARY flag, use it for a binary copy.
  */
@@ -190,6 +214,7 @@
 
 - (void) _setSkipHidden: (BOOL)flag;
 - (void) _setErrorHandler: (GSDirEnumErrorHandler) handler;
+- (void) _setPrefetchAttributes: (BOOL)flag;
 @end
 
 /*
@@ -249,15 +274,77 @@
 @interface	GSAttrDictionary : NSDictionary
 {
 @public
-  struct _STATB	statbuf;
-  _CHAR		_path[0];
+  NSSet			*keys;		/* Keys present (nil for all) */
+  NSTimeInterval	fetched;	/* When placed in the cache */
+  struct _STATB		statbuf;
+  _CHAR			_path[0];
 }
 + (NSDictionary*) attributesAt: (NSString *)path
 		  traverseLink: (BOOL)traverse;
++ (NSDictionary*) attributesAt: (NSString *)path
+			  keys: (NSSet*)wanted
+		  traverseLink: (BOOL)traverse;
++ (NSDictionary*) _attributesAt: (NSString *)path
+		   traverseLink: (BOOL)traverse;
+- (NSString*) _fileGroupOwnerAccountName;
+- (NSString*) _fileOwnerAccountName;
+#if	!defined(_WIN32) && defined(AT_SYMLINK_NOFOLLOW)
++ (NSDictionary*) attributesAt: (NSString *)path
+		     directory: (int)dirFd
+			  name: (const char*)name
+		  traverseLink: (BOOL)traverse;
+#endif
 @end
 
 static Class	GSAttrDictionaryClass = 0;
 
+/* Attributes of recently examined files may be cached for a short time
+ * (an interval of zero disables the cache).  The cache is emptied when
+ * files are changed using NSFileManager.
+ */
+static NSTimeInterval		attrCacheInterval = 0.0;
+static NSMutableDictionary	*attrCache[2] = { nil, nil };
+static NSLock			*attrCacheLock = nil;
+
+static inline void
+attrCacheFlush()
+{
+  if (attrCacheInterval > 0.0)
+    {
+      [attrCacheLock lock];
+      [attrCache[0] removeAllObjects];
+      [attrCache[1] removeAllObjects];
+      [attrCacheLock unlock];
+    }
+}
+
+#if	defined(USE_TREE_WALKER)
+/*
+ * GSTreeWalker is a private class used to copy or remove directory
+ * trees using a small pool of threads when there is no handler to
+ * be told about each file.
+ */
+@interface	GSTreeWalker : NSObject
+{
+  NSCondition		*cond;
+  struct _GSTreeNode	*queue;		/* Directories waiting for a thread */
+  struct _GSTreeNode	*all;		/* All nodes (most recent first) */
+  NSUInteger		active;		/* Directories being processed */
+  NSUInteger		threads;	/* Helper threads running */
+  int			error;		/* First failure (an errno value) */
+  BOOL			copying;
+}
+/* Copies the contents of the directory src into the existing directory
+ * dst, returning zero on success or an errno value on failure.
+ */
++ (int) copyTree: (const char*)src to: (const char*)dst;
+/* Removes the directory at path and everything in it, returning zero
+ * on success or an errno value on failure.
+ */
++ (int) removeTree: (const char*)path;
+@end
+#endif
+
 /*
  * We also need a special enumerator class to enumerate the dictionary.
  */
@@ -392,6 +479,9 @@ static NSStringEncoding	defaultEncoding;
     {
       bundleClass = [NSBundle class];
     }
+  /* Cached attributes of relative paths are no longer valid.
+   */
+  attrCacheFlush();
 #if defined(_WIN32)
   return SetCurrentDirectoryW(lpath) == TRUE ? YES : NO;
 #else
@@ -418,11 +508,13 @@ static NSStringEncoding	defaultEncoding;
     {
       return YES;
     }
+  attrCacheFlush();
   old = [self fileAttributesAtPath: path traverseLink: YES];
   lpath = [defaultManager fileSystemRepresentationWithPath: path];
 
 #ifndef _WIN32
-  if (object_getClass(attributes) == GSAttrDictionaryClass)
+  if (object_getClass(attributes) == GSAttrDictionaryClass
+    && nil == ((GSAttrDictionary*)attributes)->keys)
     {
       num = ((GSAttrDictionary*)attributes)->statbuf.st_uid;
     }
@@ -487,7 +579,8 @@ static NSStringEncoding	defaultEncoding;
 	}
     }
 
-  if (object_getClass(attributes) == GSAttrDictionaryClass)
+  if (object_getClass(attributes) == GSAttrDictionaryClass
+    && nil == ((GSAttrDictionary*)attributes)->keys)
     {
       num = ((GSAttrDictionary*)attributes)->statbuf.st_gid;
     }
@@ -920,6 +1013,10 @@ static NSStringEncoding	defaultEncoding;
                                   skipHidden: (mask & NSDirectoryEnumerationSkipsHiddenFiles)
                                 errorHandler: handler
                                          for: self];
+  if ([keys count] > 0)
+    {
+      [direnum _setPrefetchAttributes: YES];
+    }
 
   return direnum;  
 }
@@ -1034,6 +1131,7 @@ static NSStringEncoding	defaultEncoding;
 {
   BOOL  isDir;
 
+  attrCacheFlush();
   /* This is consistent with MacOSX - just return NO for an invalid path. */
   if ([path length] == 0)
     {
@@ -1133,6 +1231,7 @@ static NSStringEncoding	defaultEncoding;
   int	written;
 #endif
 
+  attrCacheFlush();
   /* This is consistent with MacOSX - just return NO for an invalid path. */
   if ([path length] == 0)
     {
@@ -1269,6 +1368,7 @@ static NSStringEncoding	defaultEncoding;
   NSDictionary	*attrs;
   NSString	*fileType;
 
+  attrCacheFlush();
   if ([self fileExistsAtPath: destination] == YES)
     {
       return NO;
@@ -1405,6 +1505,7 @@ static NSStringEncoding	defaultEncoding;
   const _CHAR	*sourcePath;
   const _CHAR	*destPath;
 
+  attrCacheFlush();
   sourcePath = [self fileSystemRepresentationWithPath: source];
   destPath = [self fileSystemRepresentationWithPath: destination];
 
@@ -1526,6 +1627,7 @@ static NSStringEncoding	defaultEncoding;
   NSString	*fileType;
   BOOL		isDir;
 
+  attrCacheFlush();
   if ([self fileExistsAtPath: destination isDirectory: &isDir] == YES
     && isDir == YES)
     {
@@ -1614,6 +1716,7 @@ static NSStringEncoding	defaultEncoding;
   BOOL		is_dir;
   const _CHAR	*lpath;
 
+  attrCacheFlush();
   if ([path isEqualToString: @"."] || [path isEqualToString: @".."])
     {
       [NSException raise: NSInvalidArgumentException
@@ -1658,6 +1761,20 @@ static NSStringEncoding	defaultEncoding;
 #endif /* _WIN32 */
     }
 
+#if	defined(USE_TREE_WALKER)
+  if (is_dir && nil == handler)
+    {
+      int	err = [GSTreeWalker removeTree: lpath];
+
+      if (err != 0)
+	{
+	  errno = err;
+	  return NO;
+	}
+      return YES;
+    }
+#endif
+
   if (!is_dir)
     {
 #if defined(_WIN32)
@@ -2496,6 +2613,7 @@ static NSStringEncoding	defaultEncoding;
   const char* newpath = [self fileSystemRepresentationWithPath: path];
   const char* oldpath = [self fileSystemRepresentationWithPath: otherPath];
 
+  attrCacheFlush();
   return (symlink(oldpath, newpath) == 0);
 #else
   ASSIGN(_lastError, @"symbolic links not supported on this system");
@@ -2598,6 +2716,17 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
 
 #include "GNUstepBase/GSIArray.h"
 
+/* The _stack instance variable points to one of these, so we can keep
+ * more state than the public instance variable layout allows for.
+ */
+typedef struct {
+  GSIArray_t	stack;		/* Must be first */
+  NSDictionary	*attributes;	/* Prefetched for the current file */
+  BOOL		prefetch;
+} GSDirEnumState;
+
+#define	STATE	((GSDirEnumState*)_stack)
+
 
 @implementation NSDirectoryEnumerator
 /*
@@ -2623,6 +2752,18 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
   _errorHandler = handler;
 }
 
+/* When set, the attributes of each file are read relative to the open
+ * directory as it is enumerated, so that -fileAttributes needs no
+ * further system call and the check for subdirectories needs no
+ * separate stat() of the full path.
+ */
+- (void) _setPrefetchAttributes: (BOOL)flag
+{
+#if	!defined(_WIN32) && defined(AT_SYMLINK_NOFOLLOW)
+  STATE->prefetch = flag;
+#endif
+}
+
 - (id) initWithDirectoryPath: (NSString*)path
    recurseIntoSubdirectories: (BOOL)recurse
 	      followSymlinks: (BOOL)follow
@@ -2639,7 +2780,8 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
       const _CHAR	*localPath;
 
       _mgr = RETAIN(mgr);
-      _stack = NSZoneMalloc([self zone], sizeof(GSIArray_t));
+      _stack = NSZoneMalloc([self zone], sizeof(GSDirEnumState));
+      memset(_stack, '\0', sizeof(GSDirEnumState));
       GSIArrayInitWithZoneAndCapacity(_stack, [self zone], 64);
 
       _flags.isRecursive = recurse;
@@ -2712,6 +2854,7 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
 
 - (void) dealloc
 {
+  DESTROY(STATE->attributes);
   GSIArrayEmpty(_stack);
   NSZoneFree([self zone], _stack);
   DESTROY(_topPath);
@@ -2740,6 +2883,10 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
  */
 - (NSDictionary*) fileAttributes
 {
+  if (STATE->attributes != nil)
+    {
+      return STATE->attributes;
+    }
   return [_mgr fileAttributesAtPath: _currentFilePath
 		       traverseLink: _flags.isFollowing];
 }
@@ -2758,6 +2905,7 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
 	{
 	  DESTROY(_currentFilePath);
 	}
+      DESTROY(STATE->attributes);
     }
 }
 
@@ -2780,10 +2928,12 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
     {
       DESTROY(_currentFilePath);
     }
+  DESTROY(STATE->attributes);
 
   while (GSIArrayCount(_stack) > 0)
     {
       GSEnumeratedDirectory dir = GSIArrayLastItem(_stack).ext;
+      struct _DIRENT	*dirbuf = NULL;
       struct _STATB	statbuf;
 #if defined(_WIN32)
       const wchar_t *dirname = NULL;
@@ -2803,7 +2953,7 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
       else if (dir.pointer)
 #endif
       {
-        struct _DIRENT *dirbuf = _READDIR(dir.pointer);
+        dirbuf = _READDIR(dir.pointer);
         if (dirbuf)
 	  {
 	    dirname = dirbuf->d_name;
@@ -2856,8 +3006,42 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
 	    _currentFilePath = RETAIN([_topPath stringByAppendingPathComponent:
 	      returnFileName]);
 
+#if	!defined(_WIN32) && defined(AT_SYMLINK_NOFOLLOW)
+	  if (STATE->prefetch && dirbuf != NULL && _currentFilePath != nil)
+	    {
+	      STATE->attributes = RETAIN([GSAttrDictionaryClass
+		attributesAt: _currentFilePath
+		   directory: dirfd(dir.pointer)
+			name: dirname
+		traverseLink: _flags.isFollowing]);
+	    }
+#endif
+
 	  if (_flags.isRecursive == YES)
 	    {
+#if	!defined(_WIN32) && defined(AT_SYMLINK_NOFOLLOW)
+	      if (STATE->attributes != nil)
+		{
+		  statbuf = ((GSAttrDictionary*)STATE->attributes)->statbuf;
+		}
+	      else
+#endif
+#if	defined(DT_DIR) && !defined(_WIN32)
+	      /* The directory entry usually tells us the file type, so
+	       * we only need to stat it when it doesn't, or when it is
+	       * a link we must follow.
+	       */
+	      if (dirbuf != NULL && dirbuf->d_type != DT_UNKNOWN
+		&& (dirbuf->d_type != DT_LNK || !_flags.isFollowing))
+		{
+		  if (dirbuf->d_type != DT_DIR)
+		    {
+		      break;
+		    }
+		  statbuf.st_mode = S_IFDIR;
+		}
+	      else
+#endif
 	      // Do not follow links
 #ifdef S_IFLNK
 #ifdef _WIN32
@@ -3101,6 +3285,578 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
 }
 @end
 
+#if	!defined(_WIN32)
+/* Copies size bytes from one open file to another without passing the
+ * data through a buffer in this process where the system allows it;
+ * first by asking the filesystem to share the data (a reflink, which
+ * needs no copying at all), then with copy_file_range() which copies
+ * within the kernel.
+ * Returns the number of bytes copied, zero if neither mechanism works
+ * for this pair of files (nothing has been written and the caller must
+ * copy the data itself), or -1 on error with errno set.
+ */
+static long long
+gsCopyFileData(int from, int to, unsigned long long size)
+{
+#if	defined(__linux__)
+  if (size > 0 && ioctl(to, FICLONE, from) == 0)
+    {
+      return (long long)size;
+    }
+#if	defined(SYS_copy_file_range)
+  {
+    unsigned long long	done = 0;
+
+    while (done < size)
+      {
+	long	n;
+
+	n = syscall(SYS_copy_file_range, from, NULL, to, NULL,
+	  (size_t)(size - done), 0);
+	if (n < 0)
+	  {
+	    if (0 == done && (ENOSYS == errno || EXDEV == errno
+	      || EINVAL == errno || EOPNOTSUPP == errno))
+	      {
+		return 0;
+	      }
+	    return -1;
+	  }
+	if (0 == n)
+	  {
+	    break;	// File shorter than expected, or not supported
+	  }
+	done += n;
+      }
+    return (long long)done;
+  }
+#endif
+#endif
+  return 0;
+}
+#endif
+
+#if	defined(USE_TREE_WALKER)
+
+/* A directory in a tree being copied or removed.
+ */
+typedef struct _GSTreeNode {
+  struct _GSTreeNode	*parent;
+  struct _GSTreeNode	*next;		/* Next in queue */
+  struct _GSTreeNode	*link;		/* Next of all nodes */
+  NSUInteger		pending;	/* Unfinished work in directory */
+  BOOL			hasAttributes;
+  struct stat		st;		/* Copy: source attributes */
+  char			*dst;		/* Copy: destination path */
+  char			src[0];
+} GSTreeNode;
+
+/* The tree is processed one directory at a time.  A thread dealing with
+ * a directory copies or removes its files directly and queues each of
+ * its subdirectories as a new piece of work, so that the threads in the
+ * pool can take work from anywhere in the tree.
+ */
+@interface	GSTreeWalker (Private)
+- (GSTreeNode*) _node: (GSTreeNode*)parent
+		 name: (const char*)name
+		 stat: (struct stat*)st;
+- (void) _helper: (id)ignored;
+- (void) _push: (GSTreeNode*)node;
+- (void) _run: (GSTreeNode*)root;
+- (void) _work;
+@end
+
+@implementation	GSTreeWalker
+
+static NSUInteger	maxHelpers = NSNotFound;
+
++ (int) copyTree: (const char*)src to: (const char*)dst
+{
+  GSTreeWalker	*w = [self new];
+  GSTreeNode	*root;
+  int		result;
+
+  w->copying = YES;
+  root = [w _node: NULL name: src stat: NULL];
+  root->dst = strdup(dst);
+  [w _run: root];
+  if (0 == (result = w->error))
+    {
+      GSTreeNode	*n;
+
+      /* Now that they have all been filled, the directories can be
+       * given the permissions and times of the originals.  Deeper
+       * directories come first in the list.
+       */
+      for (n = w->all; n != NULL; n = n->link)
+	{
+	  if (n->hasAttributes)
+	    {
+	      struct timespec	times[2];
+
+	      times[0].tv_sec = 0;
+	      times[0].tv_nsec = UTIME_OMIT;
+	      times[1] = n->st.st_mtim;
+	      /* As with -changeFileAttributes:atPath: the owner is set where
+	       * we are allowed to, and failure to do so is not an error.
+	       */
+	      (void)chown(n->dst, n->st.st_uid, n->st.st_gid);
+	      if (chmod(n->dst, n->st.st_mode & 07777) != 0
+		|| utimensat(AT_FDCWD, n->dst, times, 0) != 0)
+		{
+		  result = errno;
+		  break;
+		}
+	    }
+	}
+    }
+  RELEASE(w);
+  return result;
+}
+
++ (int) removeTree: (const char*)path
+{
+  GSTreeWalker	*w = [self new];
+  int		result;
+
+  [w _run: [w _node: NULL name: path stat: NULL]];
+  result = w->error;
+  RELEASE(w);
+  return result;
+}
+
+- (void) dealloc
+{
+  while (all != NULL)
+    {
+      GSTreeNode	*n = all;
+
+      all = n->link;
+      free(n->dst);
+      free(n);
+    }
+  DESTROY(cond);
+  [super dealloc];
+}
+
+- (id) init
+{
+  if (nil != (self = [super init]))
+    {
+      if (NSNotFound == maxHelpers)
+	{
+	  NSUInteger	cpus;
+
+	  cpus = [[NSProcessInfo processInfo] activeProcessorCount];
+	  maxHelpers = (cpus > 8) ? 7 : ((cpus > 0) ? cpus - 1 : 0);
+	}
+      cond = [NSCondition new];
+    }
+  return self;
+}
+
+/* Records the first failure and wakes any thread waiting for work so
+ * that it can stop.
+ */
+- (void) _fail: (int)err
+{
+  [cond lock];
+  if (0 == error)
+    {
+      error = err;
+    }
+  [cond broadcast];
+  [cond unlock];
+}
+
+/* Removal of a directory (or one of its subdirectories) has finished.
+ * The last piece of work to finish in each directory removes it.
+ */
+- (void) _finished: (GSTreeNode*)n
+{
+  while (n != NULL)
+    {
+      BOOL	last;
+
+      [cond lock];
+      last = (0 == --n->pending && 0 == error);
+      [cond unlock];
+      if (NO == last)
+	{
+	  break;
+	}
+      if (rmdir(n->src) != 0)
+	{
+	  [self _fail: errno];
+	  break;
+	}
+      n = n->parent;
+    }
+}
+
+- (void) _copyDirectory: (GSTreeNode*)n
+{
+  struct dirent	*entry;
+  DIR		*d;
+  int		sfd;
+  int		dfd;
+  int		err = 0;
+
+  sfd = open(n->src, O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+  if (sfd < 0 || (d = fdopendir(sfd)) == NULL)
+    {
+      err = errno;
+      if (sfd >= 0)
+	{
+	  close(sfd);
+	}
+      [self _fail: err];
+      return;
+    }
+  dfd = open(n->dst, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+  if (dfd < 0)
+    {
+      [self _fail: errno];
+      closedir(d);
+      return;
+    }
+  while (0 == err && (entry = readdir(d)) != NULL)
+    {
+      const char	*name = entry->d_name;
+      unsigned char	type = entry->d_type;
+      struct stat	st;
+
+      if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+	{
+	  continue;
+	}
+      if (DT_UNKNOWN == type || DT_DIR == type)
+	{
+	  if (fstatat(sfd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+	    {
+	      err = errno;
+	      break;
+	    }
+	  type = S_ISDIR(st.st_mode) ? DT_DIR
+	    : S_ISREG(st.st_mode) ? DT_REG
+	    : S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+	}
+      if (DT_DIR == type)
+	{
+	  /* Create the directory so that we can write into it, setting
+	   * its real permissions once the whole tree has been copied.
+	   */
+	  if (mkdirat(dfd, name, S_IRWXU) != 0)
+	    {
+	      err = errno;
+	    }
+	  else
+	    {
+	      [self _push: [self _node: n name: name stat: &st]];
+	    }
+	}
+      else if (DT_REG == type)
+	{
+	  struct stat	before;
+	  int		in;
+	  int		out;
+
+	  in = openat(sfd, name, O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+	  if (in < 0 || fstat(in, &before) != 0)
+	    {
+	      err = errno;
+	      if (in >= 0)
+		{
+		  close(in);
+		}
+	      break;
+	    }
+	  out = openat(dfd, name, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,
+	    before.st_mode & 07777);
+	  if (out < 0)
+	    {
+	      err = errno;
+	    }
+	  else
+	    {
+	      long long	done = gsCopyFileData(in, out, before.st_size);
+
+	      if (done < 0)
+		{
+		  err = errno;
+		}
+	      else
+		{
+		  char	buffer[8192];
+		  ssize_t	r = 1;
+
+		  while (done < before.st_size && r > 0)
+		    {
+		      r = read(in, buffer, sizeof(buffer));
+		      if (r < 0 || (r > 0 && write(out, buffer, r) != r))
+			{
+			  err = errno;
+			}
+		      else
+			{
+			  done += r;
+			}
+		    }
+		}
+	      if (0 == err)
+		{
+		  struct timespec	times[2];
+
+		  times[0].tv_sec = 0;
+		  times[0].tv_nsec = UTIME_OMIT;
+		  times[1] = before.st_mtim;
+		  /* A file which changes while we copy it (a log, say) is
+		   * copied as far as it had got when we started, just as
+		   * the slow path would copy whatever it managed to read.
+		   * The owner is set where we are allowed to, as
+		   * -changeFileAttributes:atPath: does.
+		   */
+		  (void)fchown(out, before.st_uid, before.st_gid);
+		  if (fchmod(out, before.st_mode & 07777) != 0
+		    || futimens(out, times) != 0)
+		    {
+		      err = errno;
+		    }
+		}
+	      close(out);
+	    }
+	  close(in);
+	}
+      else if (DT_LNK == type)
+	{
+	  char		buf[PATH_MAX];
+	  ssize_t	len;
+
+	  /* A link which fills the buffer may have been truncated.
+	   */
+	  len = readlinkat(sfd, name, buf, sizeof(buf));
+	  if (len < 0)
+	    {
+	      err = errno;
+	    }
+	  else if (len >= (ssize_t)sizeof(buf))
+	    {
+	      err = ENAMETOOLONG;
+	    }
+	  else
+	    {
+	      buf[len] = '\0';
+	      if (symlinkat(buf, dfd, name) != 0)
+		{
+		  err = errno;
+		}
+	      else if (fstatat(sfd, name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+		{
+		  (void)fchownat(dfd, name, st.st_uid, st.st_gid,
+		    AT_SYMLINK_NOFOLLOW);
+		}
+	    }
+	}
+      /* Other file types are not copied.
+       */
+    }
+  closedir(d);
+  close(dfd);
+  if (err != 0)
+    {
+      [self _fail: err];
+    }
+}
+
+- (void) _removeDirectory: (GSTreeNode*)n
+{
+  struct dirent	*entry;
+  DIR		*d;
+  int		fd;
+
+  fd = open(n->src, O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+  if (fd < 0 || (d = fdopendir(fd)) == NULL)
+    {
+      int	err = errno;
+
+      if (fd >= 0)
+	{
+	  close(fd);
+	}
+      [self _fail: err];
+      return;
+    }
+  while ((entry = readdir(d)) != NULL)
+    {
+      const char	*name = entry->d_name;
+      BOOL		isDir;
+
+      if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+	{
+	  continue;
+	}
+      if (DT_UNKNOWN == entry->d_type)
+	{
+	  struct stat	st;
+
+	  if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+	    {
+	      [self _fail: errno];
+	      break;
+	    }
+	  isDir = S_ISDIR(st.st_mode);
+	}
+      else
+	{
+	  isDir = (DT_DIR == entry->d_type);
+	}
+      if (YES == isDir)
+	{
+	  [self _push: [self _node: n name: name stat: NULL]];
+	}
+      else if (unlinkat(fd, name, 0) != 0)
+	{
+	  [self _fail: errno];
+	  break;
+	}
+    }
+  closedir(d);
+  [self _finished: n];
+}
+
+- (GSTreeNode*) _node: (GSTreeNode*)parent
+		 name: (const char*)name
+		 stat: (struct stat*)st
+{
+  size_t	plen = (NULL == parent) ? 0 : strlen(parent->src) + 1;
+  size_t	nlen = strlen(name);
+  GSTreeNode	*n;
+
+  n = malloc(sizeof(GSTreeNode) + plen + nlen + 1);
+  memset(n, '\0', sizeof(GSTreeNode));
+  if (plen > 0)
+    {
+      memcpy(n->src, parent->src, plen - 1);
+      n->src[plen - 1] = '/';
+    }
+  memcpy(n->src + plen, name, nlen + 1);
+  if (parent != NULL && parent->dst != NULL)
+    {
+      size_t	dlen = strlen(parent->dst);
+
+      n->dst = malloc(dlen + nlen + 2);
+      memcpy(n->dst, parent->dst, dlen);
+      n->dst[dlen] = '/';
+      memcpy(n->dst + dlen + 1, name, nlen + 1);
+    }
+  if (st != NULL)
+    {
+      n->st = *st;
+      n->hasAttributes = YES;
+    }
+  n->parent = parent;
+  n->pending = 1;
+  [cond lock];
+  if (parent != NULL)
+    {
+      parent->pending++;
+    }
+  n->link = all;
+  all = n;
+  [cond unlock];
+  return n;
+}
+
+/* Queues a directory to be processed, starting another thread if more
+ * work is waiting than there are threads available to take it.
+ */
+- (void) _push: (GSTreeNode*)n
+{
+  BOOL	spawn = NO;
+
+  [cond lock];
+  n->next = queue;
+  queue = n;
+  if (n->next != NULL && threads < maxHelpers)
+    {
+      threads++;
+      spawn = YES;
+    }
+  [cond signal];
+  [cond unlock];
+  if (YES == spawn)
+    {
+      [NSThread detachNewThreadSelector: @selector(_helper:)
+			       toTarget: self
+			     withObject: nil];
+    }
+}
+
+- (void) _helper: (id)ignored
+{
+  ENTER_POOL
+  [self _work];
+  LEAVE_POOL
+  [cond lock];
+  threads--;
+  [cond broadcast];
+  [cond unlock];
+}
+
+/* Processes the tree starting at root and returns once all the threads
+ * working on it have finished.
+ */
+- (void) _run: (GSTreeNode*)root
+{
+  [self _push: root];
+  [self _work];
+  [cond lock];
+  while (threads > 0)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+}
+
+- (void) _work
+{
+  [cond lock];
+  for (;;)
+    {
+      GSTreeNode	*n;
+
+      while (NULL == queue && active > 0 && 0 == error)
+	{
+	  [cond wait];
+	}
+      if (NULL == queue || error != 0)
+	{
+	  break;	// Finished (or failed)
+	}
+      n = queue;
+      queue = n->next;
+      active++;
+      [cond unlock];
+      if (YES == copying)
+	{
+	  [self _copyDirectory: n];
+	}
+      else
+	{
+	  [self _removeDirectory: n];
+	}
+      [cond lock];
+      if (0 == --active && NULL == queue)
+	{
+	  [cond broadcast];
+	}
+    }
+  [cond unlock];
+}
+@end
+
+#endif	/* USE_TREE_WALKER */
+
 @implementation NSFileManager (PrivateMethods)
 
 - (BOOL) _copyFile: (NSString*)source
@@ -3192,9 +3948,30 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
 				       toPath: destination];
     }
 
+  /* Let the kernel copy the data if it can.
+   */
+  i = 0;
+  if (sourceFd >= 0)
+    {
+      long long	copied = gsCopyFileData(sourceFd, destFd, fileSize);
+
+      if (copied < 0)
+	{
+          close (sourceFd);
+          close (destFd);
+
+          return [self _proceedAccordingToHandler: handler
+					 forError: @"cannot write to file"
+					   inPath: destination
+					 fromPath: source
+					   toPath: destination];
+	}
+      i = (unsigned long long)copied;
+    }
+
   /* Read bufsize bytes from source file and write them into the destination
      file. In case of errors call the handler and abort the operation. */
-  for (i = 0; i < fileSize; i += rbytes)
+  for (; i < fileSize; i += rbytes)
     {
 #ifdef __ANDROID__
       if (asset)
@@ -3280,9 +4057,27 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
   NSDirectoryEnumerator	*enumerator;
   NSString		*dirEntry;
   BOOL			result = YES;
-  ENTER_POOL
 
+#if	defined(USE_TREE_WALKER)
+  if (nil == handler)
+    {
+      int	err;
+
+      err = [GSTreeWalker
+	copyTree: [self fileSystemRepresentationWithPath: source]
+	      to: [self fileSystemRepresentationWithPath: destination]];
+      if (err != 0)
+	{
+	  errno = err;
+	  return NO;
+	}
+      return YES;
+    }
+#endif
+
+  ENTER_POOL
   enumerator = [self enumeratorAtPath: source];
+  [enumerator _setPrefetchAttributes: YES];
   while ((dirEntry = [enumerator nextObject]))
     {
       NSString		*sourceFile;
@@ -3401,6 +4196,7 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
   ENTER_POOL
 
   enumerator = [self enumeratorAtPath: source];
+  [enumerator _setPrefetchAttributes: YES];
   while ((dirEntry = [enumerator nextObject]))
     {
       NSString		*sourceFile;
@@ -3592,8 +4388,180 @@ static inline void gsedRelease(GSEnumeratedDirectory X)
 
 static NSSet	*fileKeys = nil;
 
+/* Whether the receiver holds the attribute for key K.  When it was made
+ * for a limited set of keys, the information for other keys may not have
+ * been fetched, so the accessors must not report it.
+ */
+#define	WANTS(K)	(nil == keys || nil != [keys member: (K)])
+
++ (NSDictionary*) attributesAt: (NSString *)path
+		  traverseLink: (BOOL)traverse
+{
+  NSMutableDictionary	*cache;
+  GSAttrDictionary	*d;
+  NSTimeInterval	now;
+
+  if (attrCacheInterval <= 0.0 || nil == path)
+    {
+      return [self _attributesAt: path traverseLink: traverse];
+    }
+  now = GSPrivateTimeNow();
+  cache = attrCache[traverse ? 1 : 0];
+  [attrCacheLock lock];
+  d = [cache objectForKey: path];
+  if (d != nil && now - d->fetched < attrCacheInterval)
+    {
+      d = RETAIN(d);
+      [attrCacheLock unlock];
+      return AUTORELEASE(d);
+    }
+  [attrCacheLock unlock];
+
+  d = (GSAttrDictionary*)[self _attributesAt: path traverseLink: traverse];
+  if (d != nil)
+    {
+      d->fetched = now;
+      [attrCacheLock lock];
+      if ([cache count] >= 4096)
+	{
+	  [cache removeAllObjects];
+	}
+      [cache setObject: d forKey: path];
+      [attrCacheLock unlock];
+    }
+  return d;
+}
+
+#if	defined(__linux__) && defined(STATX_BASIC_STATS)
+static void
+statxToStat(struct statx *x, struct stat *s)
+{
+  memset(s, '\0', sizeof(*s));
+  s->st_dev = makedev(x->stx_dev_major, x->stx_dev_minor);
+  s->st_rdev = makedev(x->stx_rdev_major, x->stx_rdev_minor);
+  s->st_ino = x->stx_ino;
+  s->st_mode = x->stx_mode;
+  s->st_nlink = x->stx_nlink;
+  s->st_uid = x->stx_uid;
+  s->st_gid = x->stx_gid;
+  s->st_size = x->stx_size;
+  s->st_blksize = x->stx_blksize;
+  s->st_blocks = x->stx_blocks;
+  s->st_atim.tv_sec = x->stx_atime.tv_sec;
+  s->st_atim.tv_nsec = x->stx_atime.tv_nsec;
+  s->st_mtim.tv_sec = x->stx_mtime.tv_sec;
+  s->st_mtim.tv_nsec = x->stx_mtime.tv_nsec;
+  s->st_ctim.tv_sec = x->stx_ctime.tv_sec;
+  s->st_ctim.tv_nsec = x->stx_ctime.tv_nsec;
+}
+#endif
+
+/* Returns attributes of the file at path restricted to the keys in the
+ * wanted set (which must contain only valid attribute keys).  Where the
+ * system supports it, only the information needed for those keys is
+ * requested (letting the filesystem skip the rest).
+ */
 + (NSDictionary*) attributesAt: (NSString *)path
+			  keys: (NSSet*)wanted
 		  traverseLink: (BOOL)traverse
+{
+  GSAttrDictionary	*d = nil;
+
+#if	defined(__linux__) && defined(STATX_BASIC_STATS)
+  static BOOL	noStatx = NO;
+
+  if (NO == noStatx)
+    {
+      const _CHAR	*lpath;
+      struct statx	stx;
+      unsigned		mask = 0;
+      unsigned		l = 0;
+      unsigned		i;
+
+      lpath = [defaultManager fileSystemRepresentationWithPath: path];
+      if (lpath == 0 || *lpath == 0)
+	{
+	  return nil;
+	}
+      if (nil == wanted)
+	{
+	  mask = STATX_BASIC_STATS;
+	}
+      else
+	{
+	  if ([wanted member: NSFileType] != nil
+	    || [wanted member: NSFilePosixPermissions] != nil)
+	    {
+	      mask |= STATX_TYPE | STATX_MODE;
+	    }
+	  if ([wanted member: NSFileSize] != nil)
+	    {
+	      mask |= STATX_SIZE;
+	    }
+	  if ([wanted member: NSFileModificationDate] != nil)
+	    {
+	      mask |= STATX_MTIME;
+	    }
+	  if ([wanted member: NSFileCreationDate] != nil)
+	    {
+	      mask |= STATX_MTIME | STATX_CTIME;
+	    }
+	  if ([wanted member: NSFileOwnerAccountID] != nil
+	    || [wanted member: NSFileOwnerAccountName] != nil)
+	    {
+	      mask |= STATX_UID;
+	    }
+	  if ([wanted member: NSFileGroupOwnerAccountID] != nil
+	    || [wanted member: NSFileGroupOwnerAccountName] != nil)
+	    {
+	      mask |= STATX_GID;
+	    }
+	  if ([wanted member: NSFileReferenceCount] != nil)
+	    {
+	      mask |= STATX_NLINK;
+	    }
+	  if ([wanted member: NSFileSystemFileNumber] != nil)
+	    {
+	      mask |= STATX_INO;
+	    }
+	}
+      if (statx(AT_FDCWD, lpath, (traverse ? 0 : AT_SYMLINK_NOFOLLOW),
+	mask, &stx) != 0)
+	{
+	  if (ENOSYS != errno)
+	    {
+	      return nil;
+	    }
+	  noStatx = YES;
+	}
+      else
+	{
+	  while (lpath[l] != 0)
+	    {
+	      l++;
+	    }
+	  d = (GSAttrDictionary*)NSAllocateObject(self, (l+1)*sizeof(_CHAR),
+	    NSDefaultMallocZone());
+	  statxToStat(&stx, &d->statbuf);
+	  for (i = 0; i <= l; i++)
+	    {
+	      d->_path[i] = lpath[i];
+	    }
+	  d->keys = RETAIN(wanted);
+	  return AUTORELEASE(d);
+	}
+    }
+#endif
+  d = (GSAttrDictionary*)[self _attributesAt: path traverseLink: traverse];
+  if (d != nil)
+    {
+      d->keys = RETAIN(wanted);
+    }
+  return d;
+}
+
++ (NSDictionary*) _attributesAt: (NSString *)path
+		   traverseLink: (BOOL)traverse
 {
   GSAttrDictionary	*d;
   unsigned		l = 0;
@@ -3660,6 +4628,44 @@ static NSSet	*fileKeys = nil;
   return AUTORELEASE(d);
 }
 
+#if	!defined(_WIN32) && defined(AT_SYMLINK_NOFOLLOW)
+/* Like +attributesAt:traverseLink: but using the name of the file in an
+ * open directory, which saves the system looking up the whole path.
+ */
++ (NSDictionary*) attributesAt: (NSString *)path
+		     directory: (int)dirFd
+			  name: (const char*)name
+		  traverseLink: (BOOL)traverse
+{
+  GSAttrDictionary	*d;
+  unsigned		l = 0;
+  unsigned		i;
+  const _CHAR *lpath = [defaultManager fileSystemRepresentationWithPath: path];
+
+  if (lpath == 0 || *lpath == 0)
+    {
+      return nil;
+    }
+  while (lpath[l] != 0)
+    {
+      l++;
+    }
+  d = (GSAttrDictionary*)NSAllocateObject(self, (l+1)*sizeof(_CHAR),
+    NSDefaultMallocZone());
+  if (fstatat(dirFd, name, &d->statbuf,
+    (traverse ? 0 : AT_SYMLINK_NOFOLLOW)) != 0)
+    {
+      DESTROY(d);
+      return nil;
+    }
+  for (i = 0; i <= l; i++)
+    {
+      d->_path[i] = lpath[i];
+    }
+  return AUTORELEASE(d);
+}
+#endif
+
 + (void) initialize
 {
   if (fileKeys == nil)
@@ -3685,16 +4691,33 @@ static NSSet	*fileKeys = nil;
 	NSFileType,
 	nil];
       [[NSObject leakAt: &fileKeys] release];
+      attrCacheLock = [NSLock new];
+      attrCache[0] = [NSMutableDictionary new];
+      attrCache[1] = [NSMutableDictionary new];
     }
 }
 
 - (NSUInteger) count
 {
+  if (keys != nil)
+    {
+      return [keys count];
+    }
   return [fileKeys count];
 }
 
+- (void) dealloc
+{
+  RELEASE(keys);
+  [super dealloc];
+}
+
 - (NSDate*) fileCreationDate
 {
+  if (!WANTS(NSFileCreationDate))
+    {
+      return nil;
+    }
 #if defined(_WIN32)
   return [NSDate dateWithTimeIntervalSince1970: statbuf.st_ctime];
 #elif defined (HAVE_STRUCT_STAT_ST_BIRTHTIM)
@@ -3725,10 +4748,23 @@ static NSSet	*fileKeys = nil;
 
 - (NSNumber*) fileGroupOwnerAccountID
 {
+  if (!WANTS(NSFileGroupOwnerAccountID))
+    {
+      return nil;
+    }
   return [NSNumber numberWithInt: statbuf.st_gid];
 }
 
 - (NSString*) fileGroupOwnerAccountName
+{
+  if (!WANTS(NSFileGroupOwnerAccountName))
+    {
+      return nil;
+    }
+  return [self _fileGroupOwnerAccountName];
+}
+
+- (NSString*) _fileGroupOwnerAccountName
 {
   NSString	*group = @"UnknownGroup";
 
@@ -3872,20 +4908,41 @@ static NSSet	*fileKeys = nil;
 
 - (NSDate*) fileModificationDate
 {
+  if (!WANTS(NSFileModificationDate))
+    {
+      return nil;
+    }
   return [NSDate dateWithTimeIntervalSince1970: statbuf.st_mtime];
 }
 
 - (NSUInteger) filePosixPermissions
 {
+  if (!WANTS(NSFilePosixPermissions))
+    {
+      return 0;
+    }
   return (statbuf.st_mode & ~S_IFMT);
 }
 
 - (NSNumber*) fileOwnerAccountID
 {
+  if (!WANTS(NSFileOwnerAccountID))
+    {
+      return nil;
+    }
   return [NSNumber numberWithInt: statbuf.st_uid];
 }
 
 - (NSString*) fileOwnerAccountName
+{
+  if (!WANTS(NSFileOwnerAccountName))
+    {
+      return nil;
+    }
+  return [self _fileOwnerAccountName];
+}
+
+- (NSString*) _fileOwnerAccountName
 {
   NSString	*owner = @"UnknownUser";
 
@@ -4009,11 +5066,19 @@ static NSSet	*fileKeys = nil;
 
 - (unsigned long long) fileSize
 {
+  if (!WANTS(NSFileSize))
+    {
+      return 0;
+    }
   return statbuf.st_size;
 }
 
 - (NSUInteger) fileSystemFileNumber
 {
+  if (!WANTS(NSFileSystemFileNumber))
+    {
+      return 0;
+    }
   return statbuf.st_ino;
 }
 
@@ -4022,6 +5087,11 @@ static NSSet	*fileKeys = nil;
 #if defined(_WIN32)
   DWORD volumeSerialNumber = 0;
   _CHAR volumePathName[128];
+
+  if (!WANTS(NSFileSystemNumber))
+    {
+      return 0;
+    }
   if (GetVolumePathNameW(_path,volumePathName,128))
   {
     GetVolumeInformationW(volumePathName,NULL,0,&volumeSerialNumber,NULL,NULL,NULL,0);
@@ -4029,12 +5099,20 @@ static NSSet	*fileKeys = nil;
 
   return (NSUInteger)volumeSerialNumber;
 #else
+  if (!WANTS(NSFileSystemNumber))
+    {
+      return 0;
+    }
   return statbuf.st_dev;
 #endif
 }
 
 - (NSString*) fileType
 {
+  if (!WANTS(NSFileType))
+    {
+      return nil;
+    }
   switch (statbuf.st_mode & S_IFMT)
     {
       case S_IFREG: return NSFileTypeRegular;
@@ -4054,6 +5132,10 @@ static NSSet	*fileKeys = nil;
 
 - (NSEnumerator*) keyEnumerator
 {
+  if (keys != nil)
+    {
+      return [keys objectEnumerator];
+    }
   return [fileKeys objectEnumerator];
 }
 
@@ -4066,6 +5148,10 @@ static NSSet	*fileKeys = nil;
 {
   int	count = 0;
 
+  if (keys != nil && nil == [keys member: key])
+    {
+      return nil;
+    }
   while (key != 0 && count < 2)
     {
       if (key == NSFileAppendOnly)
@@ -4122,6 +5208,61 @@ static NSSet	*fileKeys = nil;
 
 @end	/* GSAttrDictionary */
 
+@implementation	NSFileManager (GNUstepBase)
+
++ (NSTimeInterval) attributesCacheInterval
+{
+  return attrCacheInterval;
+}
+
++ (void) setAttributesCacheInterval: (NSTimeInterval)seconds
+{
+  [GSAttrDictionary class];	// Make sure the cache is set up
+  if (seconds < 0.0)
+    {
+      seconds = 0.0;
+    }
+  [attrCacheLock lock];
+  attrCacheInterval = seconds;
+  [attrCache[0] removeAllObjects];
+  [attrCache[1] removeAllObjects];
+  [attrCacheLock unlock];
+}
+
+- (NSArray*) attributesOfItemsAtPaths: (NSArray*)paths
+				 keys: (NSArray*)keys
+			 traverseLink: (BOOL)flag
+{
+  NSUInteger		count = [paths count];
+  NSMutableArray	*result = [NSMutableArray arrayWithCapacity: count];
+  NSNull		*null = [NSNull null];
+  NSSet			*wanted = nil;
+  NSUInteger		i;
+
+  [GSAttrDictionary class];	// Make sure fileKeys is set up
+  if (keys != nil)
+    {
+      NSMutableSet	*m = [NSMutableSet setWithArray: keys];
+
+      [m intersectSet: fileKeys];
+      wanted = AUTORELEASE([m copy]);
+    }
+  for (i = 0; i < count; i++)
+    {
+      NSDictionary	*d;
+      ENTER_POOL
+
+      d = [GSAttrDictionaryClass attributesAt: [paths objectAtIndex: i]
+					 keys: wanted
+				 traverseLink: flag];
+      [result addObject: (nil == d) ? (id)null : (id)d];
+      LEAVE_POOL
+    }
+  return result;
+}
+
+@end
+
 @implementation	GSAttrDictionaryEnumerator
 + (NSEnumerator*) enumeratorFor: (NSDictionary*)d
 {
@@ -4130,7 +5271,7 @@ static NSSet	*fileKeys = nil;
   e = (GSAttrDictionaryEnumerator*)
     NSAllocateObject(self, 0, NSDefaultMallocZone());
   e->dictionary = RETAIN(d);
-  e->enumerator = RETAIN([fileKeys objectEnumerator]);
+  e->enumerator = RETAIN([d keyEnumerator]);
   return AUTORELEASE(e);
 }
 
@@ -30,6 +30,7 @@
 #import	"Foundation/NSIndexSet.h"
 #import	"Foundation/NSException.h"
 #import "GSDispatch.h"
+#import "GSPrivate.h"
 
 #define	GSI_ARRAY_TYPE	NSRange
 
@@ -853,6 +854,32 @@ static NSUInteger posForIndex(GSIArray array, NSUInteger index)
 }
 
 
+/* Enumerates the indexes in range concurrently, passing the parts of the
+ * ranges of the set which lie within it to the shared code.
+ */
+static void
+enumerateConcurrently(GSIArray array, NSRange range,
+  GSIndexSetEnumerationBlock aBlock)
+{
+  NSUInteger	ranges = GSIArrayCount(array);
+  NSRange	*pieces = malloc(ranges * sizeof(NSRange));
+  NSUInteger	count = 0;
+  NSUInteger	i;
+
+  for (i = 0; i < ranges; i++)
+    {
+      NSRange	r = NSIntersectionRange(GSIArrayItemAtIndex(array, i).ext,
+	range);
+
+      if (r.length > 0)
+	{
+	  pieces[count++] = r;
+	}
+    }
+  GSPrivateEnumerateConcurrently(GSEnumerateIndexes, pieces, count,
+    (id)aBlock);
+}
+
 - (void) enumerateIndexesInRange: (NSRange)range
                          options: (NSEnumerationOptions)opts
 		      usingBlock: (GSIndexSetEnumerationBlock)aBlock
@@ -869,6 +896,11 @@ static NSUInteger posForIndex(GSIArray array, NSUInteger index)
     {
       return;
     }
+  if (opts & NSEnumerationConcurrent)
+    {
+      enumerateConcurrently(_array, range, aBlock);
+      return;
+    }
 
   startArrayIndex = posForIndex(_array, range.location);
   if (NSNotFound == startArrayIndex)
@@ -35,6 +35,9 @@
 #import "Foundation/NSNull.h"
 #import "Foundation/NSSet.h"
 #import "Foundation/NSValue.h"
+#import "GSPrivate.h"
+
+#include <pthread.h>
 
 /* For the NSKeyValueMutableArray and NSKeyValueMutableSet classes
  */
@@ -77,13 +80,310 @@ static inline void setupCompat()
 
 #endif
 
+/* Each thread keeps a small cache of the accessors found for each class
+ * and key, so that repeated key-value coding with objects of the same
+ * class needs neither selector lookups nor method signatures.  Being per
+ * thread, the caches need no locking.  Entries are discarded when methods
+ * are added to classes (GSPrivateMethodsGeneration changes).
+ */
+#define	KVC_CACHE_SIZE	128	/* Entries per cache (a power of two) */
+#define	KVC_KEY_MAX	32	/* Keys must be shorter than this */
+
+typedef struct {
+  Class		cls;		/* Zero if the entry is unused */
+  unsigned	generation;
+  unsigned	length;		/* Length of key */
+  SEL		sel;		/* Accessor method or zero */
+  IMP		imp;
+  const char	*ivarType;	/* Type of instance variable */
+  BOOL		plain;		/* Class uses standard -valueForKey: */
+  unsigned	size;		/* Size of instance variable */
+  int		offset;		/* Offset of instance variable */
+  char		type;		/* Type of value (zero if key undefined) */
+  char		key[KVC_KEY_MAX];
+} GSKVCAccessor;
+
+typedef struct {
+  GSKVCAccessor	get[KVC_CACHE_SIZE];
+  GSKVCAccessor	set[KVC_CACHE_SIZE];
+} GSKVCCache;
+
+static pthread_key_t	kvcCacheKey;
+static pthread_once_t	kvcCacheOnce = PTHREAD_ONCE_INIT;
+
+static void
+kvcCacheSetup(void)
+{
+  pthread_key_create(&kvcCacheKey, free);
+}
+
+static inline GSKVCCache *
+kvcCache(void)
+{
+  GSKVCCache	*c;
+
+  pthread_once(&kvcCacheOnce, kvcCacheSetup);
+  c = (GSKVCCache*)pthread_getspecific(kvcCacheKey);
+  if (NULL == c)
+    {
+      c = (GSKVCCache*)calloc(1, sizeof(GSKVCCache));
+      pthread_setspecific(kvcCacheKey, c);
+    }
+  return c;
+}
+
+/* Returns the entry in table to use for the key in objects of class cls,
+ * setting *hit to say whether it already holds the accessor for them.
+ */
+static inline GSKVCAccessor *
+kvcEntry(GSKVCAccessor *table, Class cls, const char *key, unsigned length,
+  BOOL *hit)
+{
+  uintptr_t	h = ((uintptr_t)cls) >> 3;
+  GSKVCAccessor	*a;
+  unsigned	i;
+
+  for (i = 0; i < length; i++)
+    {
+      h = h * 31 + (unsigned char)key[i];
+    }
+  a = &table[h & (KVC_CACHE_SIZE - 1)];
+  *hit = (a->cls == cls && a->length == length
+    && a->generation == GSPrivateMethodsGeneration
+    && memcmp(a->key, key, length) == 0) ? YES : NO;
+  return a;
+}
+
+/* Stores the accessor found for a key in the entry a.  Returns NO (and
+ * leaves the entry unused) if the accessor method is unsuitable, so
+ * that the caller can leave it to GSObjCGetVal() or GSObjCSetVal() to
+ * report the problem.
+ */
+static BOOL
+kvcFill(NSObject *self, GSKVCAccessor *a, const char *key, unsigned length,
+  SEL sel, const char *type, unsigned size, int offset, BOOL setter)
+{
+  a->cls = 0;
+  if (sel != 0)
+    {
+      NSMethodSignature	*sig = [self methodSignatureForSelector: sel];
+
+      if ([sig numberOfArguments] != (setter ? 3 : 2))
+	{
+	  return NO;
+	}
+      type = setter ? [sig getArgumentTypeAtIndex: 2] : [sig methodReturnType];
+      a->imp = [self methodForSelector: sel];
+      a->ivarType = NULL;
+    }
+  else
+    {
+      a->imp = 0;
+      a->ivarType = type;
+    }
+  if (NO == setter)
+    {
+      static IMP	vfk = 0;
+      static IMP	vfkp = 0;
+
+      if (0 == vfk)
+	{
+	  vfk = [NSObject instanceMethodForSelector: @selector(valueForKey:)];
+	  vfkp = [NSObject instanceMethodForSelector:
+	    @selector(valueForKeyPath:)];
+	}
+      a->plain = ([self methodForSelector: @selector(valueForKey:)] == vfk
+	&& [self methodForSelector: @selector(valueForKeyPath:)] == vfkp)
+	? YES : NO;
+    }
+  a->sel = sel;
+  a->type = (NULL == type) ? 0 : *type;
+  a->size = size;
+  a->offset = offset;
+  memcpy(a->key, key, length);
+  a->length = length;
+  a->generation = GSPrivateMethodsGeneration;
+  a->cls = object_getClass(self);
+  return YES;
+}
+
+#define	KVC_GET(T, M) \
+  { \
+    T	v; \
+    if (0 == a->sel) \
+      v = *(T*)((char*)self + a->offset); \
+    else \
+      v = ((T (*)(id, SEL))a->imp)(self, a->sel); \
+    return [NSNumber M: v]; \
+  }
+
+/* Gets a value using a cached accessor, dealing with the common types
+ * directly and leaving anything else to GSObjCGetVal().
+ */
+static id
+kvcGet(NSObject *self, GSKVCAccessor *a, const char *key)
+{
+  switch (a->type)
+    {
+      case 0:
+	return [self valueForUndefinedKey: [NSString stringWithUTF8String: key]];
+      case _C_ID:
+      case _C_CLASS:
+	if (0 == a->sel)
+	  {
+	    return *(id*)((char*)self + a->offset);
+	  }
+	return ((id (*)(id, SEL))a->imp)(self, a->sel);
+      case _C_CHR:	KVC_GET(signed char, numberWithChar)
+      case _C_UCHR:	KVC_GET(unsigned char, numberWithUnsignedChar)
+#if __GNUC__ > 2 && defined(_C_BOOL)
+      case _C_BOOL:	KVC_GET(_Bool, numberWithBool)
+#endif
+      case _C_SHT:	KVC_GET(short, numberWithShort)
+      case _C_USHT:	KVC_GET(unsigned short, numberWithUnsignedShort)
+      case _C_INT:	KVC_GET(int, numberWithInt)
+      case _C_UINT:	KVC_GET(unsigned int, numberWithUnsignedInt)
+      case _C_LNG:	KVC_GET(long, numberWithLong)
+      case _C_ULNG:	KVC_GET(unsigned long, numberWithUnsignedLong)
+      case _C_LNG_LNG:	KVC_GET(long long, numberWithLongLong)
+      case _C_ULNG_LNG:	KVC_GET(unsigned long long, numberWithUnsignedLongLong)
+      case _C_FLT:	KVC_GET(float, numberWithFloat)
+      case _C_DBL:	KVC_GET(double, numberWithDouble)
+      default:
+	return GSObjCGetVal(self, key, a->sel, a->ivarType, a->size,
+	  a->offset);
+    }
+}
+
+#define	KVC_NUM(T, M, K) \
+  { \
+    if (0 == a->sel) \
+      n->M = *(T*)((char*)obj + a->offset); \
+    else \
+      n->M = ((T (*)(id, SEL))a->imp)(obj, a->sel); \
+    return K; \
+  }
+
+char
+GSPrivateKVCNumberForKey(id obj, const char *key, unsigned length,
+  GSPrivateNumber *n)
+{
+  GSKVCAccessor	*a;
+  BOOL		hit;
+
+  if (nil == obj || 0 == length || length >= KVC_KEY_MAX)
+    {
+      return 0;
+    }
+  a = kvcEntry(kvcCache()->get, object_getClass(obj), key, length, &hit);
+  if (NO == hit || NO == a->plain)
+    {
+      return 0;
+    }
+  switch (a->type)
+    {
+      case _C_CHR:	KVC_NUM(signed char, i, 'i')
+      case _C_UCHR:	KVC_NUM(unsigned char, i, 'i')
+#if __GNUC__ > 2 && defined(_C_BOOL)
+      case _C_BOOL:	KVC_NUM(_Bool, i, 'i')
+#endif
+      case _C_SHT:	KVC_NUM(short, i, 'i')
+      case _C_USHT:	KVC_NUM(unsigned short, i, 'i')
+      case _C_INT:	KVC_NUM(int, i, 'i')
+      case _C_UINT:	KVC_NUM(unsigned int, i, 'i')
+      case _C_LNG:	KVC_NUM(long, i, 'i')
+      case _C_ULNG:	KVC_NUM(unsigned long, u, 'u')
+      case _C_LNG_LNG:	KVC_NUM(long long, i, 'i')
+      case _C_ULNG_LNG:	KVC_NUM(unsigned long long, u, 'u')
+      case _C_FLT:	KVC_NUM(float, d, 'd')
+      case _C_DBL:	KVC_NUM(double, d, 'd')
+      default:
+	return 0;
+    }
+}
+
+#define	KVC_SET(T, M) \
+  { \
+    T	v = (T)[anObject M]; \
+    if (0 == a->sel) \
+      *(T*)((char*)self + a->offset) = v; \
+    else \
+      ((void (*)(id, SEL, T))a->imp)(self, a->sel, v); \
+    return; \
+  }
+
+/* Sets a value using a cached accessor, dealing with the common types
+ * directly and leaving anything else to GSObjCSetVal().
+ */
+static void
+kvcSet(NSObject *self, GSKVCAccessor *a, const char *key, id anObject)
+{
+  if (a->type != _C_ID && a->type != _C_CLASS && a->type != 0
+    && (nil == anObject || [NSNull null] == anObject))
+    {
+      [self setNilValueForKey: [NSString stringWithUTF8String: key]];
+      return;
+    }
+  switch (a->type)
+    {
+      case 0:
+	[self setValue: anObject
+	  forUndefinedKey: [NSString stringWithUTF8String: key]];
+	return;
+      case _C_ID:
+      case _C_CLASS:
+	if (0 == a->sel)
+	  {
+	    id	*ptr = (id*)((char*)self + a->offset);
+
+	    ASSIGN(*ptr, anObject);
+	  }
+	else
+	  {
+	    ((void (*)(id, SEL, id))a->imp)(self, a->sel, anObject);
+	  }
+	return;
+      case _C_CHR:	KVC_SET(char, charValue)
+      case _C_UCHR:	KVC_SET(unsigned char, unsignedCharValue)
+#if __GNUC__ > 2 && defined(_C_BOOL)
+      case _C_BOOL:	KVC_SET(_Bool, boolValue)
+#endif
+      case _C_SHT:	KVC_SET(short, shortValue)
+      case _C_USHT:	KVC_SET(unsigned short, unsignedShortValue)
+      case _C_INT:	KVC_SET(int, intValue)
+      case _C_UINT:	KVC_SET(unsigned int, unsignedIntValue)
+      case _C_LNG:	KVC_SET(long, longValue)
+      case _C_ULNG:	KVC_SET(unsigned long, unsignedLongValue)
+      case _C_LNG_LNG:	KVC_SET(long long, longLongValue)
+      case _C_ULNG_LNG:	KVC_SET(unsigned long long, unsignedLongLongValue)
+      case _C_FLT:	KVC_SET(float, floatValue)
+      case _C_DBL:	KVC_SET(double, doubleValue)
+      default:
+	GSObjCSetVal(self, key, anObject, a->sel, a->ivarType, a->size,
+	  a->offset);
+    }
+}
+
 static void
 SetValueForKey(NSObject *self, id anObject, const char *key, unsigned size)
 {
   SEL		sel = 0;
   const char	*type = 0;
   int		off = 0;
+  unsigned	length = size;
+  GSKVCAccessor	*a = NULL;
+
+  if (size > 0 && size < KVC_KEY_MAX)
+    {
+      BOOL	hit;
 
+      a = kvcEntry(kvcCache()->set, object_getClass(self), key, size, &hit);
+      if (YES == hit)
+	{
+	  kvcSet(self, a, key, anObject);
+	  return;
+	}
+    }
   if (size > 0)
     {
       const char	*name;
@@ -147,7 +447,14 @@ SetValueForKey(NSObject *self, id anObject, const char *key, unsigned size)
 	    }
 	}
     }
-  GSObjCSetVal(self, key, anObject, sel, type, size, off);
+  if (a != NULL && kvcFill(self, a, key, length, sel, type, size, off, YES))
+    {
+      kvcSet(self, a, key, anObject);
+    }
+  else
+    {
+      GSObjCSetVal(self, key, anObject, sel, type, size, off);
+    }
 }
 
 static id ValueForKey(NSObject *self, const char *key, unsigned size)
@@ -155,7 +462,19 @@ static id ValueForKey(NSObject *self, const char *key, unsigned size)
   SEL		sel = 0;
   int		off = 0;
   const char	*type = NULL;
+  unsigned	length = size;
+  GSKVCAccessor	*a = NULL;
+
+  if (size > 0 && size < KVC_KEY_MAX)
+    {
+      BOOL	hit;
 
+      a = kvcEntry(kvcCache()->get, object_getClass(self), key, size, &hit);
+      if (YES == hit)
+	{
+	  return kvcGet(self, a, key);
+	}
+    }
   if (size > 0)
     {
       const char	*name;
@@ -233,6 +552,10 @@ static id ValueForKey(NSObject *self, const char *key, unsigned size)
 	    }
 	}
     }
+  if (a != NULL && kvcFill(self, a, key, length, sel, type, size, off, NO))
+    {
+      return kvcGet(self, a, key);
+    }
   return GSObjCGetVal(self, key, sel, type, size, off);
 }
 
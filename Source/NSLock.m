@@ -62,6 +62,146 @@ static Class    untracedRecursiveLockClass = Nil;
 
 static BOOL     traceLocks = NO;
 
+/* The number of times we check a busy mutex before going to sleep on it.
+ * This is set up when NSLock is initialised, and is left at zero if there
+ * is only one processor (so the holder cannot run while we spin).
+ */
+static unsigned	lockSpins = 0;
+
+#if	defined(__i386__) || defined(__x86_64__)
+#define	GS_CPU_RELAX()	__asm__ __volatile__ ("pause")
+#elif	defined(__aarch64__)
+#define	GS_CPU_RELAX()	__asm__ __volatile__ ("yield")
+#else
+#define	GS_CPU_RELAX()
+#endif
+
+/* Locks a mutex, spinning for a short while if it is busy, in the hope
+ * that the holder is in a short critical section and will release it
+ * sooner than we could sleep in the kernel and be woken again.
+ * Where we can see the owner of the mutex we only try to take it when
+ * it looks free, and we give up spinning as soon as we see it pass to
+ * another thread, since the lock is then too contended for spinning to
+ * be worthwhile.  We never spin if the current thread is the owner (as
+ * the lock must then be reported as a deadlock), and recursive mutexes
+ * are not spun on at all (spin is NO for them), since they are usually
+ * held for longer and are often just being locked again by their owner.
+ */
+static inline int
+gs_mutex_lock(pthread_mutex_t *m, BOOL spin)
+{
+  if (lockSpins > 0 && YES == spin)
+    {
+#if     defined(HAVE_PTHREAD_MUTEX_OWNER)
+      int	holder = *(volatile int*)&m->__data.__owner;
+#endif
+      unsigned	i;
+
+#if     defined(HAVE_PTHREAD_MUTEX_OWNER)
+      if (holder != 0 && (NSUInteger)holder == GSPrivateThreadID())
+	{
+	  return pthread_mutex_lock(m);
+	}
+#endif
+
+      for (i = 0; i < lockSpins; i++)
+	{
+#if     defined(HAVE_PTHREAD_MUTEX_OWNER)
+	  int	owner = *(volatile int*)&m->__data.__owner;
+
+	  if (owner != 0)
+	    {
+	      if (holder != 0 && owner != holder)
+		{
+		  break;
+		}
+	      holder = owner;
+	      GS_CPU_RELAX();
+	      continue;
+	    }
+#endif
+	  if (0 == pthread_mutex_trylock(m))
+	    {
+	      return 0;
+	    }
+	  GS_CPU_RELAX();
+	}
+    }
+  return pthread_mutex_lock(m);
+}
+
+/* Locks a mutex while lock profiling is on, telling the profiler whether
+ * we had to wait for it and for how long.  The profile record is found
+ * before the mutex is held.
+ */
+static int
+gs_mutex_lock_profiled(id lock, NSString *name, pthread_mutex_t *m,
+  BOOL spin)
+{
+  void		*sample = GSPrivateLockProfileSample(lock, name, NO, NO);
+  uint64_t	start;
+  int		err;
+
+  if (0 == pthread_mutex_trylock(m))
+    {
+      GSPrivateLockProfileAcquired(lock, sample, NO, 0);
+      return 0;
+    }
+  if (0 == sample)
+    {
+      sample = GSPrivateLockProfileSample(lock, name, NO, YES);
+    }
+  start = GSPrivateLockProfileClock();
+  err = gs_mutex_lock(m, spin);
+  if (0 == err)
+    {
+      GSPrivateLockProfileAcquired(lock, sample, YES,
+	GSPrivateLockProfileClock() - start);
+    }
+  return err;
+}
+
+/* Tell the profiler (if it is on) about an attempt to take a lock without
+ * waiting (before the lock is held), about the lock being taken, about it
+ * being about to be released, and about a wait on a condition.
+ */
+#define	PROFILE_SAMPLE \
+  void *sample = (GSPrivateLockProfiling > 0) \
+    ? GSPrivateLockProfileSample(self, _name, NO, NO) : 0;
+#define	PROFILE_ACQUIRED \
+  if (0 != sample) \
+    GSPrivateLockProfileAcquired(self, sample, NO, 0);
+
+/* As above, for a lock taken by retrying until a time limit.  When the
+ * first attempt fails the profiler is asked for a contended sample and
+ * the wait is timed from then, as in gs_mutex_lock_profiled().
+ */
+#define	PROFILE_TIMED_SAMPLE \
+  PROFILE_SAMPLE \
+  uint64_t start = 0; \
+  BOOL contended = NO;
+#define	PROFILE_CONTENDED \
+  if (NO == contended && GSPrivateLockProfiling > 0) \
+    { \
+      if (0 == sample) \
+	sample = GSPrivateLockProfileSample(self, _name, NO, YES); \
+      start = GSPrivateLockProfileClock(); \
+      contended = YES; \
+    }
+#define	PROFILE_TIMED_ACQUIRED \
+  if (0 != sample) \
+    GSPrivateLockProfileAcquired(self, sample, contended, \
+      (YES == contended) ? GSPrivateLockProfileClock() - start : 0);
+#define	PROFILE_RELEASED \
+  if (GSPrivateLockProfiling > 0) \
+    GSPrivateLockProfileReleased(self);
+#define	PROFILE_WAITING \
+  if (GSPrivateLockProfiling > 0) \
+    GSPrivateLockProfileWaiting(self);
+#define	PROFILE_WOKEN \
+  if (GSPrivateLockProfiling > 0) \
+    GSPrivateLockProfileWoken(self);
+
 @implementation NSObject (GSTraceLocks)
 
 + (BOOL) shouldCreateTraceableLocks: (BOOL)shouldTrace
@@ -181,10 +321,17 @@ static BOOL     traceLocks = NO;
   pthread_mutex_destroy(&_mutex);\
 }
 
+/* MLOCK spins before sleeping (see gs_mutex_lock()) if MSPIN is YES.
+ * The recursive lock classes set it to NO before using MLOCK.
+ */
+#define	MSPIN	YES
+
 #define	MLOCK \
 - (void) lock\
 {\
-  int err = pthread_mutex_lock(&_mutex);\
+  int err = (GSPrivateLockProfiling > 0)\
+    ? gs_mutex_lock_profiled(self, _name, &_mutex, MSPIN)\
+    : gs_mutex_lock(&_mutex, MSPIN);\
   if (EDEADLK == err)\
     {\
       (*_NSLock_error_handler)(self, _cmd, YES, @"deadlock");\
@@ -198,14 +345,17 @@ static BOOL     traceLocks = NO;
 #define	MLOCKBEFOREDATE \
 - (BOOL) lockBeforeDate: (NSDate*)limit\
 {\
+  PROFILE_TIMED_SAMPLE \
   do\
     {\
       int err = pthread_mutex_trylock(&_mutex);\
       if (0 == err)\
 	{\
           CHK(Hold) \
+          PROFILE_TIMED_ACQUIRED \
 	  return YES;\
 	}\
+      PROFILE_CONTENDED \
       sched_yield();\
     } while ([limit timeIntervalSinceNow] > 0);\
   return NO;\
@@ -230,10 +380,12 @@ static BOOL     traceLocks = NO;
 #define	MTRYLOCK \
 - (BOOL) tryLock\
 {\
+  PROFILE_SAMPLE \
   int err = pthread_mutex_trylock(&_mutex);\
   if (0 == err) \
     { \
       CHK(Hold) \
+      PROFILE_ACQUIRED \
       return YES; \
     } \
   else \
@@ -245,6 +397,7 @@ static BOOL     traceLocks = NO;
 #define	MUNLOCK \
 - (void) unlock\
 {\
+  PROFILE_RELEASED \
   if (0 != pthread_mutex_unlock(&_mutex))\
     {\
       [NSException raise: NSLockException\
@@ -321,6 +474,14 @@ NSString *NSLockException = @"NSLockException";
       pthread_mutex_init(&deadlock, &attr_normal);
       pthread_mutex_lock(&deadlock);
 
+#if	defined(_SC_NPROCESSORS_ONLN)
+      if (sysconf(_SC_NPROCESSORS_ONLN) > 1)
+	{
+	  lockSpins = 100;
+	}
+#endif
+      GSPrivateLockProfileSetup();
+
       baseConditionClass = [NSCondition class];
       baseConditionLockClass = [NSConditionLock class];
       baseLockClass = [NSLock class];
@@ -362,18 +523,21 @@ MLOCK
 
 - (BOOL) lockBeforeDate: (NSDate*)limit
 {
+  PROFILE_TIMED_SAMPLE
   do
     {
       int err = pthread_mutex_trylock(&_mutex);
       if (0 == err)
 	{
           CHK(Hold)
+          PROFILE_TIMED_ACQUIRED
 	  return YES;
 	}
       if (EDEADLK == err)
 	{
 	  (*_NSLock_error_handler)(self, _cmd, NO, @"deadlock");
 	}
+      PROFILE_CONTENDED
       sched_yield();
     } while ([limit timeIntervalSinceNow] > 0);
   return NO;
@@ -419,7 +583,11 @@ MFINALIZE
 }
 
 MISLOCKED
+#undef	MSPIN
+#define	MSPIN	NO
 MLOCK
+#undef	MSPIN
+#define	MSPIN	YES
 MLOCKBEFOREDATE
 MNAME
 MSTACK
@@ -490,7 +658,9 @@ MUNLOCK
 
 - (void) wait
 {
+  PROFILE_WAITING
   pthread_cond_wait(&_condition, &_mutex);
+  PROFILE_WOKEN
 }
 
 - (BOOL) waitUntilDate: (NSDate*)limit
@@ -509,7 +679,9 @@ MUNLOCK
   /* NB. On timeout the lock is still held even through condition is not met
    */
 
+  PROFILE_WAITING
   retVal = pthread_cond_timedwait(&_condition, &_mutex, &timeout);
+  PROFILE_WOKEN
   if (retVal == 0)
     {
       return YES;
@@ -624,7 +796,20 @@ MUNLOCK
   return NO;            // Not locked
 }
 
-MNAME
+- (NSString*) name
+{
+  return _name;
+}
+
+/* The condition takes the same name, so that it is the name which shows
+ * up when the lock is profiled.
+ */
+- (void) setName: (NSString*)newName
+{
+  ASSIGNCOPY(_name, newName);
+  [_condition setName: newName];
+}
+
 MSTACK
 
 - (BOOL) tryLock
@@ -694,7 +879,9 @@ MSTACK
   NSThread      *t = GSCurrentThread(); \
   int		err; \
   CHKT(t,Wait) \
-  err = pthread_mutex_lock(&_mutex);\
+  err = (GSPrivateLockProfiling > 0)\
+    ? gs_mutex_lock_profiled(self, _name, &_mutex, MSPIN)\
+    : gs_mutex_lock(&_mutex, MSPIN);\
   if (EDEADLK == err)\
     {\
       CHKT(t,Drop) \
@@ -735,7 +922,9 @@ MTRYLOCK
   NSThread      *t = GSCurrentThread();
   CHKT(t,Drop)
   CHKT(t,Wait)
+  PROFILE_WAITING
   pthread_cond_wait(&_condition, &_mutex);
+  PROFILE_WOKEN
   CHKT(t,Hold)
 }
 
@@ -757,7 +946,9 @@ MTRYLOCK
    */
 
   CHKT(t,Drop)
+  PROFILE_WAITING
   retVal = pthread_cond_timedwait(&_condition, &_mutex, &timeout);
+  PROFILE_WOKEN
   if (retVal == 0)
     {
       CHKT(t,Hold)
@@ -819,7 +1010,11 @@ MUNLOCK
   return class_createInstance(tracedRecursiveLockClass, 0);
 }
 MDEALLOC
+#undef	MSPIN
+#define	MSPIN	NO
 MLOCK
+#undef	MSPIN
+#define	MSPIN	YES
 MLOCKBEFOREDATE
 MSTACK
 MTRYLOCK
@@ -73,6 +73,19 @@
 
 #include <sys/stat.h>
 
+#if	defined(HAVE_MMAP)
+#  include	<sys/mman.h>
+#endif
+
+/*
+ * Where the system supports anonymous memory files and passing descriptors
+ * over local sockets, large data items are sent in a memory file rather
+ * than being copied through the socket.
+ */
+#if	defined(HAVE_MMAP) && defined(MFD_CLOEXEC) && defined(SCM_RIGHTS)
+#  define	GS_MSG_FD	1
+#endif
+
 /*
  *	Stuff for setting the sockets into non-blocking mode.
  */
@@ -126,7 +139,9 @@ typedef	enum {
   GSP_NONE,
   GSP_PORT,		/* Simple port item.			*/
   GSP_DATA,		/* Simple data item.			*/
-  GSP_HEAD		/* Port message header + initial data.	*/
+  GSP_HEAD,		/* Port message header + initial data.	*/
+  GSP_FD,		/* Data item passed in a descriptor.	*/
+  GSP_CAPS		/* Peer accepts GSP_FD items.		*/
 } GSPortItemType;
 
 /*
@@ -154,14 +169,22 @@ typedef	struct {
   unsigned char	addr[0];	/* name of the port on the local host	*/
 } GSPortInfo;
 
+/*
+ * When a connection is made, the port information sent may have a byte
+ * of capability flags after the nul terminated port name.  Older versions
+ * ignore anything after the name.
+ */
+#define	GS_CAP_FD	1	/* Connecting end accepts GSP_FD items.	*/
+
 /*
  * Utility functions for encoding and decoding ports.
  */
 static NSMessagePort*
-decodePort(NSData *data)
+decodePort(NSData *data, unsigned char *caps)
 {
   GSPortItemHeader	*pih;
   GSPortInfo		*pi;
+  unsigned		plen;
 
   pih = (GSPortItemHeader*)[data bytes];
   NSCAssert(GSSwapBigI32ToHost(pih->type) == GSP_PORT,
@@ -173,6 +196,20 @@ decodePort(NSData *data)
 	pi->version);
       return nil;
     }
+  plen = GSSwapBigI32ToHost(pih->length);
+  if (caps != 0)
+    {
+      *caps = 0;
+      if (plen > 2)
+	{
+	  unsigned	nlen = strnlen((char*)pi->addr, plen - 1);
+
+	  if (plen > nlen + 2)
+	    {
+	      *caps = pi->addr[nlen + 1];
+	    }
+	}
+    }
 
   NSDebugFLLog(@"NSMessagePort", @"Decoded port as '%s'", pi->addr);
 
@@ -181,7 +218,7 @@ decodePort(NSData *data)
 }
 
 static NSData*
-newDataWithEncodedPort(NSMessagePort *port)
+newDataWithEncodedPort(NSMessagePort *port, unsigned char caps)
 {
   GSPortItemHeader	*pih;
   GSPortInfo		*pi;
@@ -190,6 +227,10 @@ newDataWithEncodedPort(NSMessagePort *port)
   const unsigned char	*name = [port _name];
 
   plen = 2 + strlen((char*)name);
+  if (caps != 0)
+    {
+      plen++;
+    }
 
   data = [[NSMutableData alloc] initWithLength: sizeof(GSPortItemHeader)+plen];
   pih = (GSPortItemHeader*)[data mutableBytes];
@@ -197,12 +238,158 @@ newDataWithEncodedPort(NSMessagePort *port)
   pih->length = GSSwapHostI32ToBig(plen);
   pi = (GSPortInfo*)&pih[1];
   strncpy((char*)pi->addr, (char*)name, strlen((char*)name) + 1);
+  if (caps != 0)
+    {
+      pi->addr[strlen((char*)name) + 1] = caps;
+    }
 
   NSDebugFLLog(@"NSMessagePort", @"Encoded port as '%s'", pi->addr);
 
   return data;
 }
 
+#if	defined(GS_MSG_FD)
+/*
+ * Data items at least this large are sent in a memory file.
+ */
+#define	FDBLOCK	(64 * 1024)
+
+/*
+ * GSMessageDescriptorItem takes the place of a large data item in the
+ * components being written.  It provides the item header bytes to be
+ * written to the socket, and the descriptor of the memory file holding
+ * the data, which is passed along with the header.
+ */
+@interface	GSMessageDescriptorItem : NSObject
+{
+@public
+  GSPortItemHeader	header;
+  int			fd;
+}
+- (const void*) bytes;
+- (NSUInteger) length;
+@end
+
+@implementation	GSMessageDescriptorItem
+- (const void*) bytes
+{
+  return &header;
+}
+
+- (void) dealloc
+{
+  if (fd >= 0)
+    {
+      close(fd);
+    }
+  [super dealloc];
+}
+
+- (NSUInteger) length
+{
+  return sizeof(header);
+}
+@end
+
+/*
+ * Copy the data into a new memory file, sealed so that the receiver can
+ * safely map it.  Returns nil if that is not possible, in which case the
+ * data should be sent inline.
+ */
+static GSMessageDescriptorItem*
+newDescriptorItem(NSData *data)
+{
+  GSMessageDescriptorItem	*item;
+  const char			*b = [data bytes];
+  NSUInteger			l = [data length];
+  NSUInteger			done = 0;
+  int				fd;
+
+  fd = memfd_create("NSMessagePort", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0)
+    {
+      return nil;
+    }
+  while (done < l)
+    {
+      ssize_t	res = write(fd, b + done, l - done);
+
+      if (res < 0)
+	{
+	  if (errno == EINTR)
+	    {
+	      continue;
+	    }
+	  close(fd);
+	  return nil;
+	}
+      done += res;
+    }
+#if	defined(F_ADD_SEALS)
+  (void)fcntl(fd, F_ADD_SEALS,
+    F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+  item = (GSMessageDescriptorItem*)NSAllocateObject(
+    [GSMessageDescriptorItem class], 0, NSDefaultMallocZone());
+  item->fd = fd;
+  item->header.type = GSSwapHostI32ToBig(GSP_FD);
+  item->header.length = GSSwapHostI32ToBig(l);
+  return item;
+}
+
+/*
+ * Build a data item from l bytes of a memory file passed by the peer.
+ * The file is mapped only if it is sealed against shrinking (so that
+ * accessing the mapping can not fault) and against writing (so that the
+ * peer can not change the immutable data behind our back).  Otherwise it
+ * is read into private memory.  The descriptor is closed.
+ */
+static NSData*
+newDataWithDescriptor(int fd, uint32_t l)
+{
+  NSData	*d = nil;
+  struct stat	sb;
+
+  if (fstat(fd, &sb) == 0 && sb.st_size >= (off_t)l)
+    {
+#if	defined(F_GET_SEALS)
+      int	seals = fcntl(fd, F_GET_SEALS);
+
+      if (seals >= 0 && (seals & (F_SEAL_SHRINK | F_SEAL_WRITE))
+	== (F_SEAL_SHRINK | F_SEAL_WRITE))
+	{
+	  d = RETAIN(GSPrivateDataWithDescriptor(fd, l));
+	}
+#endif
+      if (d == nil)
+	{
+	  NSMutableData	*m = [[NSMutableData alloc] initWithLength: l];
+	  char		*b = [m mutableBytes];
+	  uint32_t	done = 0;
+
+	  while (done < l)
+	    {
+	      ssize_t	res = pread(fd, b + done, l - done, done);
+
+	      if (res <= 0)
+		{
+		  if (res < 0 && errno == EINTR)
+		    {
+		      continue;
+		    }
+		  DESTROY(m);
+		  break;
+		}
+	      done += res;
+	    }
+	  d = m;
+	}
+    }
+  close(fd);
+  return d;
+}
+#endif
+
 /* Older systems (Solaris) compatibility */
 #ifndef AF_LOCAL
 #define AF_LOCAL AF_UNIX
@@ -233,6 +420,11 @@ newDataWithEncodedPort(NSMessagePort *port)
  * consists of an item of type GSP_HEAD followed by zero or more items
  * of type GSP_PORT or GSP_DATA.  The number of items in a port message
  * is encoded in the 'nItems' field of the header.
+ * If the connecting process says (in its initial GSP_PORT item) that it
+ * can accept descriptors, the other end replies with a GSP_CAPS item and
+ * thereafter each end may send large data items as GSP_FD items, which
+ * carry only the data length while the data itself is in a memory file
+ * whose descriptor is passed along with the item header.
  */
 
 typedef enum {
@@ -253,6 +445,7 @@ typedef enum {
   uint32_t		rLength;	/* Amount read so far.		*/
   uint32_t		rWant;		/* Amount desired.		*/
   NSMutableArray	*rItems;	/* Message in progress.		*/
+  NSMutableData		*rFds;		/* Descriptors received.	*/
   GSPortItemType	rType;		/* Type of data being read.	*/
   uint32_t		rId;		/* Id of incoming message.	*/
   unsigned		nItems;		/* Number of items to be read.	*/
@@ -262,6 +455,7 @@ typedef enum {
   NSRecursiveLock	*myLock;	/* Lock for this handle.	*/
   BOOL			caller;		/* Did we connect to other end?	*/
   BOOL			valid;
+  BOOL			fdOut;		/* May send GSP_FD items.	*/
   NSMessagePort		*recvPort;
   NSMessagePort		*sendPort;
   struct sockaddr_un 	sockAddr;	/* Far end of connection.	*/
@@ -291,6 +485,9 @@ static Class	mutableArrayClass;
 static Class	mutableDataClass;
 static Class	portMessageClass;
 static Class	runLoopClass;
+#if	defined(GS_MSG_FD)
+static Class	descriptorItemClass;
+#endif
 
 
 + (id) allocWithZone: (NSZone*)zone
@@ -342,6 +539,9 @@ static Class	runLoopClass;
       mutableDataClass = [NSMutableData class];
       portMessageClass = [NSPortMessage class];
       runLoopClass = [NSRunLoop class];
+#if	defined(GS_MSG_FD)
+      descriptorItemClass = [GSMessageDescriptorItem class];
+#endif
     }
 }
 
@@ -471,6 +671,7 @@ static Class	runLoopClass;
   [self finalize];
   DESTROY(rData);
   DESTROY(rItems);
+  DESTROY(rFds);
   DESTROY(wMsgs);
   DESTROY(myLock);
   [super dealloc];
@@ -492,6 +693,17 @@ static Class	runLoopClass;
   [self invalidate];
   (void)close(desc);
   desc = -1;
+  if (rFds != nil)
+    {
+      const int	*fds = (const int*)[rFds bytes];
+      NSUInteger	count = [rFds length] / sizeof(int);
+
+      while (count-- > 0)
+	{
+	  (void)close(fds[count]);
+	}
+      [rFds setLength: 0];
+    }
 }
 
 - (void) invalidate
@@ -596,7 +808,55 @@ static Class	runLoopClass;
        * Now try to fill the buffer with data.
        */
       bytes = [rData mutableBytes];
+#if	defined(GS_MSG_FD)
+      {
+	struct msghdr	msg;
+	struct iovec	iov;
+	struct cmsghdr	*cmsg;
+	union {
+	  struct cmsghdr	cm;
+	  char			control[CMSG_SPACE(sizeof(int) * 8)];
+	} ctl;
+
+	/* Read with recvmsg() so that we collect any descriptors passed
+	 * with GSP_FD items.  They are queued until their items are read.
+	 */
+	iov.iov_base = bytes + rLength;
+	iov.iov_len = want - rLength;
+	memset(&msg, '\0', sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctl.control;
+	msg.msg_controllen = sizeof(ctl.control);
+	res = recvmsg(desc, &msg, MSG_CMSG_CLOEXEC);
+	if (res > 0)
+	  {
+	    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != 0;
+	      cmsg = CMSG_NXTHDR(&msg, cmsg))
+	      {
+		if (cmsg->cmsg_level == SOL_SOCKET
+		  && cmsg->cmsg_type == SCM_RIGHTS)
+		  {
+		    if (rFds == nil)
+		      {
+			rFds = [mutableDataClass new];
+		      }
+		    [rFds appendBytes: CMSG_DATA(cmsg)
+			       length: cmsg->cmsg_len - CMSG_LEN(0)];
+		  }
+	      }
+	    if (msg.msg_flags & MSG_CTRUNC)
+	      {
+		NSLog(@"%@ - too many descriptors received", self);
+		M_UNLOCK(myLock);
+		[self invalidate];
+		return;
+	      }
+	  }
+      }
+#else
       res = read(desc, bytes + rLength, want - rLength);
+#endif
       if (res <= 0)
 	{
 	  if (res == 0)
@@ -703,6 +963,65 @@ static Class	runLoopClass;
 			  rWant = l;
 			}
 		    }
+#if	defined(GS_MSG_FD)
+		  else if (rType == GSP_FD)
+		    {
+		      NSData	*d;
+		      int	fd;
+
+		      /*
+		       * The data is in the memory file whose descriptor
+		       * was received with this item header.  There is no
+		       * limit on the size, as nothing is buffered here.
+		       */
+		      rType = GSP_NONE;	/* ready for a new item	*/
+		      rLength -= rWant;
+		      if (rLength > 0)
+			{
+			  memmove(bytes, bytes + rWant, rLength);
+			}
+		      rWant = sizeof(GSPortItemHeader);
+		      if ([rFds length] < sizeof(int))
+			{
+			  NSLog(@"%@ - descriptor missing for data", self);
+			  M_UNLOCK(myLock);
+			  [self invalidate];
+			  return;
+			}
+		      memcpy(&fd, [rFds bytes], sizeof(int));
+		      [rFds replaceBytesInRange: NSMakeRange(0, sizeof(int))
+				      withBytes: 0
+					 length: 0];
+		      d = newDataWithDescriptor(fd, l);
+		      if (d == nil)
+			{
+			  NSLog(@"%@ - unable to read data descriptor", self);
+			  M_UNLOCK(myLock);
+			  [self invalidate];
+			  return;
+			}
+		      [rItems addObject: d];
+		      RELEASE(d);
+		      if (nItems == [rItems count])
+			{
+			  shouldDispatch = YES;
+			}
+		    }
+		  else if (rType == GSP_CAPS)
+		    {
+		      /*
+		       * The other end will accept GSP_FD items from us.
+		       */
+		      rType = GSP_NONE;	/* ready for a new item	*/
+		      rLength -= rWant;
+		      if (rLength > 0)
+			{
+			  memmove(bytes, bytes + rWant, rLength);
+			}
+		      rWant = sizeof(GSPortItemHeader);
+		      fdOut = YES;
+		    }
+#endif
 		  else if (rType == GSP_HEAD)
 		    {
 		      if (l > maxDataLength)
@@ -818,9 +1137,10 @@ static Class	runLoopClass;
 	      case GSP_PORT:
 		{
 		  NSMessagePort	*p;
+		  unsigned char	caps = 0;
 
 		  rType = GSP_NONE;	/* ready for a new item	*/
-		  p = decodePort(rData);
+		  p = decodePort(rData, (state == GS_H_ACCEPT) ? &caps : 0);
 		  if (p == nil)
 		    {
 		      NSLog(@"%@ - unable to decode remote port", self);
@@ -846,6 +1166,24 @@ static Class	runLoopClass;
 		       */
 		      state = GS_H_CONNECTED;
 		      [p addHandle: self forSend: YES];
+#if	defined(GS_MSG_FD)
+		      if (caps & GS_CAP_FD)
+			{
+			  GSPortItemHeader	ih;
+
+			  /*
+			   * Nothing else has been written on this new
+			   * connection, so we can tell the other end that
+			   * we accept descriptors too.
+			   */
+			  ih.type = GSSwapHostI32ToBig(GSP_CAPS);
+			  ih.length = 0;
+			  if (write(desc, &ih, sizeof(ih)) == sizeof(ih))
+			    {
+			      fdOut = YES;
+			    }
+			}
+#endif
 		    }
 		  else
 		    {
@@ -924,7 +1262,13 @@ static Class	runLoopClass;
 	  else
 #endif
 	    {
-	      NSData	*d = newDataWithEncodedPort([self recvPort]);
+	      NSData	*d;
+
+#if	defined(GS_MSG_FD)
+	      d = newDataWithEncodedPort([self recvPort], GS_CAP_FD);
+#else
+	      d = newDataWithEncodedPort([self recvPort], 0);
+#endif
 
 	      len = write(desc, [d bytes], [d length]);
 	      if (len == (int)[d length])
@@ -966,6 +1310,37 @@ static Class	runLoopClass;
 	    }
 	  b = [wData bytes];
 	  l = [wData length];
+#if	defined(GS_MSG_FD)
+	  if (wLength == 0 && object_getClass(wData) == descriptorItemClass)
+	    {
+	      struct msghdr	msg;
+	      struct iovec	iov;
+	      struct cmsghdr	*cmsg;
+	      union {
+		struct cmsghdr	cm;
+		char		control[CMSG_SPACE(sizeof(int))];
+	      } ctl;
+
+	      /* Pass the memory file descriptor along with the first
+	       * byte of the item header.
+	       */
+	      iov.iov_base = (void*)b;
+	      iov.iov_len = l;
+	      memset(&msg, '\0', sizeof(msg));
+	      msg.msg_iov = &iov;
+	      msg.msg_iovlen = 1;
+	      msg.msg_control = ctl.control;
+	      msg.msg_controllen = sizeof(ctl.control);
+	      cmsg = CMSG_FIRSTHDR(&msg);
+	      cmsg->cmsg_level = SOL_SOCKET;
+	      cmsg->cmsg_type = SCM_RIGHTS;
+	      cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	      memcpy(CMSG_DATA(cmsg),
+		&((GSMessageDescriptorItem*)wData)->fd, sizeof(int));
+	      res = sendmsg(desc, &msg, 0);
+	    }
+	  else
+#endif
 	  res = write(desc, b + wLength,  l - wLength);
 	  if (res < 0)
 	    {
@@ -1822,6 +2197,9 @@ typedef	struct {
       unsigned		c = [components count];
       unsigned		i;
       BOOL		pack = YES;
+#if	defined(GS_MSG_FD)
+      BOOL		fdOut = h->fdOut;
+#endif
 
       /*
        * Ok - ensure we have space to insert header info.
@@ -1873,6 +2251,20 @@ typedef	struct {
 	      unsigned		l = [o length];
 	      void		*b;
 
+#if	defined(GS_MSG_FD)
+	      if (fdOut == YES && l >= FDBLOCK)
+		{
+		  GSMessageDescriptorItem	*item = newDescriptorItem(o);
+
+		  if (item != nil)
+		    {
+		      pack = NO;
+		      [components replaceObjectAtIndex: i withObject: item];
+		      RELEASE(item);
+		      continue;
+		    }
+		}
+#endif
 	      if (pack == YES && hLength + l + h <= NETBLOCK)
 		{
 		  [header setLength: hLength + l + h];
@@ -1927,7 +2319,7 @@ typedef	struct {
 	    }
 	  else if ([o isKindOfClass: messagePortClass])
 	    {
-	      NSData	*d = newDataWithEncodedPort(o);
+	      NSData	*d = newDataWithEncodedPort(o, 0);
 	      unsigned	dLength = [d length];
 
 	      if (pack == YES && hLength + dLength <= NETBLOCK)
@@ -224,14 +224,17 @@ static void GSLogZombie(id o, SEL sel)
 #undef GS_ARC_COMPATIBLE
 #endif
 
-#if defined(__llvm__) || (defined(USE_ATOMIC_BUILTINS) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1)))
-/* Use the GCC atomic operations with recent GCC versions */
+#if defined(__llvm__) || (defined(USE_ATOMIC_BUILTINS) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))) || (defined(__GCC_ATOMIC_POINTER_LOCK_FREE) && __GCC_ATOMIC_POINTER_LOCK_FREE == 2)
+/* Use the GCC atomic operations with recent GCC versions, or whenever
+ * the compiler tells us they are lock free for pointer sized values.
+ */
 
 typedef intptr_t volatile *gsatomic_t;
 typedef intptr_t gsrefcount_t;
 #define GSATOMICREAD(X) (*(X))
 #define GSAtomicIncrement(X)    __sync_add_and_fetch(X, 1)
 #define GSAtomicDecrement(X)    __sync_sub_and_fetch(X, 1)
+#define GSAtomicAdd(X, N)       __sync_add_and_fetch(X, N)
 #define GS_ARC_COMPATIBLE 1
 
 #elif	defined(_WIN32)
@@ -457,18 +460,477 @@ typedef struct obj_layout_unpadded {
 #define	__BIGGEST_ALIGNMENT__ (SIZEOF_VOIDP * 2)
 #endif
 
+#define	PADDING	(__BIGGEST_ALIGNMENT__ - ((UNP % __BIGGEST_ALIGNMENT__) \
+  ? (UNP % __BIGGEST_ALIGNMENT__) : __BIGGEST_ALIGNMENT__))
+
+/* Biased reference counting keeps its fields in the padding, so it is
+ * only available where there is room for them.
+ */
+#if	defined(GSAtomicAdd) && defined(__SIZEOF_POINTER__) \
+  && (__BIGGEST_ALIGNMENT__ >= __SIZEOF_POINTER__ + 8)
+#define	GS_BIASED_RC	1
+
+typedef struct obj_brc {
+  volatile uint16_t	owner;		/* Owning thread if not merged */
+  uint8_t		brc;		/* Uses biased counting */
+  uint8_t		unused;
+  uint32_t		biased;		/* Count held by the owner */
+} brc_t;
+
+/* Fails to compile if the fields do not fit in the padding.
+ */
+typedef char	brc_fits[(sizeof(brc_t) <= PADDING) ? 1 : -1];
+#endif
+
 /*
  *	Now do the REAL version - using the other version to determine
  *	what padding (if any) is required to get the alignment of the
  *	structure correct.
  */
 struct obj_layout {
-  char	padding[__BIGGEST_ALIGNMENT__ - ((UNP % __BIGGEST_ALIGNMENT__)
-    ? (UNP % __BIGGEST_ALIGNMENT__) : __BIGGEST_ALIGNMENT__)];
+#if	defined(GS_BIASED_RC)
+  union {
+    char	padding[PADDING];
+    brc_t	b;
+  } u;
+#else
+  char	padding[PADDING];
+#endif
   gsrefcount_t	retained;
 };
 typedef	struct obj_layout *obj;
 
+#if	defined(GSAtomicAdd)
+/* When the inline reference count of an object reaches GS_RC_SPILL_AT,
+ * GS_RC_SPILL of it is moved to a side table, and it is moved back when
+ * a release takes the inline count below zero.  So a retain or release
+ * is a single atomic operation on the inline count except on the rare
+ * occasions when an object has been retained millions of times, and
+ * there is no limit on the count.  The side table is split into shards,
+ * each with its own lock, so that objects in different shards never
+ * contend, and it is not looked at all while no object is in it.
+ * An object keeps its entry (perhaps with a zero count) until it is
+ * deallocated, so that a release racing with another which has just
+ * emptied the entry still finds the table in use.
+ */
+#define	GS_RC_SPILL_AT	0x800000
+#define	GS_RC_SPILL	0x400000
+#define	GS_RC_SHARDS	64
+
+typedef struct gs_rc_overflow {
+  struct gs_rc_overflow	*next;
+  id			object;
+  NSUInteger		count;
+} gs_rc_overflow;
+
+typedef struct {
+  pthread_mutex_t	lock;
+  gs_rc_overflow	*entries;
+} gs_rc_shard;
+
+static gs_rc_shard		rcShards[GS_RC_SHARDS];
+static gsrefcount_t volatile	rcOverflowed = 0; /* Objects in the table */
+
+static inline gs_rc_shard *
+rcShardForObject(id anObject)
+{
+  return &rcShards[(((uintptr_t)anObject) >> 4) & (GS_RC_SHARDS - 1)];
+}
+
+/* Moves GS_RC_SPILL of the inline count of anObject to the side table.
+ * The count is added to the table before it is taken from the object,
+ * so the total is never too small.
+ */
+static void
+rcSpill(id anObject)
+{
+  gs_rc_shard		*shard = rcShardForObject(anObject);
+  gs_rc_overflow	*e;
+
+  pthread_mutex_lock(&shard->lock);
+  for (e = shard->entries; e != 0; e = e->next)
+    {
+      if (e->object == anObject)
+	{
+	  break;
+	}
+    }
+  if (0 == e && 0 != (e = malloc(sizeof(gs_rc_overflow))))
+    {
+      e->object = anObject;
+      e->count = 0;
+      e->next = shard->entries;
+      shard->entries = e;
+      GSAtomicIncrement((gsatomic_t)&rcOverflowed);
+    }
+  if (0 != e)
+    {
+      e->count += GS_RC_SPILL;
+      GSAtomicAdd((gsatomic_t)&(((obj)anObject)[-1].retained), -GS_RC_SPILL);
+    }
+  pthread_mutex_unlock(&shard->lock);
+}
+
+/* Called when a release has taken the inline count of anObject below
+ * zero.  Returns YES if the release is covered by the side table (or by
+ * another thread having moved a count back from it meanwhile), NO if the
+ * object has no references left, in which case its entry is removed.
+ */
+static BOOL
+rcBorrow(id anObject)
+{
+  gs_rc_shard		*shard = rcShardForObject(anObject);
+  gs_rc_overflow	**p;
+  BOOL			covered = NO;
+
+  pthread_mutex_lock(&shard->lock);
+  if (GSATOMICREAD(&(((obj)anObject)[-1].retained)) >= 0)
+    {
+      covered = YES;
+    }
+  else
+    {
+      for (p = &shard->entries; *p != 0; p = &(*p)->next)
+	{
+	  gs_rc_overflow	*e = *p;
+
+	  if (e->object == anObject)
+	    {
+	      if (0 == e->count)
+		{
+		  *p = e->next;
+		  free(e);
+		  GSAtomicDecrement((gsatomic_t)&rcOverflowed);
+		}
+	      else
+		{
+		  e->count -= GS_RC_SPILL;
+		  GSAtomicAdd((gsatomic_t)&(((obj)anObject)[-1].retained),
+		    GS_RC_SPILL);
+		  covered = YES;
+		}
+	      break;
+	    }
+	}
+    }
+  pthread_mutex_unlock(&shard->lock);
+  return covered;
+}
+
+/* Returns the part of the count of anObject held in the side table.
+ */
+static NSUInteger
+rcOverflow(id anObject)
+{
+  gs_rc_shard		*shard = rcShardForObject(anObject);
+  gs_rc_overflow	*e;
+  NSUInteger		count = 0;
+
+  pthread_mutex_lock(&shard->lock);
+  for (e = shard->entries; e != 0; e = e->next)
+    {
+      if (e->object == anObject)
+	{
+	  count = e->count;
+	  break;
+	}
+    }
+  pthread_mutex_unlock(&shard->lock);
+  return count;
+}
+#endif	/* GSAtomicAdd */
+
+#if	defined(GS_BIASED_RC)
+/* Biased reference counting, enabled by setting GNUSTEP_BIASED_REFCOUNT
+ * in the environment.  An object is owned by the thread which allocated
+ * it, and retains and releases in that thread update a plain counter in
+ * the object header without any atomic operation.  Other threads use
+ * the (atomic) shared count.  While an object is biased its shared count
+ * never goes below zero: a release in another thread which would take
+ * it there is queued for the owner instead, and the owner performs it
+ * (merging its own count into the shared one) when its autorelease pool
+ * is next emptied or when it exits.  Once the owner has released all of
+ * its references the counts are merged for good and the object behaves
+ * like any other.  A merged count is stored offset by GS_BRC_MERGED, so
+ * any thread can tell from the shared count alone whether the object
+ * has been merged.
+ */
+#define	GS_BRC_MERGED	((gsrefcount_t)1 << (sizeof(gsrefcount_t) * 8 - 3))
+#define	GS_BRC_THREADS	4096
+
+typedef struct gs_brc_thread {
+  pthread_mutex_t	lock;
+  id			*pending;	/* Releases queued by other threads */
+  NSUInteger		count;
+  NSUInteger		capacity;
+  uint16_t		ident;
+  BOOL			exited;		/* No thread has this ident */
+  struct gs_brc_thread	*nextFree;
+} gs_brc_thread;
+
+static BOOL		brcEnabled = NO;
+static pthread_key_t	brcKey;
+static pthread_mutex_t	brcLock = PTHREAD_MUTEX_INITIALIZER;
+static gs_brc_thread	*brcThreads[GS_BRC_THREADS];
+static gs_brc_thread	*brcFree = 0;
+static uint16_t		brcNext = 1;
+
+/* Returns the state of the current thread, creating it if necessary, or
+ * zero if all thread numbers are in use.  A thread number is reused once
+ * its thread has exited, and the new thread takes over ownership of any
+ * objects still biased towards the old one.
+ */
+static gs_brc_thread *
+brcCurrent(void)
+{
+  gs_brc_thread	*t = pthread_getspecific(brcKey);
+
+  if (0 == t)
+    {
+      pthread_mutex_lock(&brcLock);
+      if (0 != (t = brcFree))
+	{
+	  brcFree = t->nextFree;
+	}
+      else if (brcNext < GS_BRC_THREADS
+	&& 0 != (t = calloc(1, sizeof(gs_brc_thread))))
+	{
+	  pthread_mutex_init(&t->lock, NULL);
+	  t->ident = brcNext++;
+	  brcThreads[t->ident] = t;
+	}
+      pthread_mutex_unlock(&brcLock);
+      if (0 != t)
+	{
+	  pthread_mutex_lock(&t->lock);
+	  t->exited = NO;
+	  pthread_mutex_unlock(&t->lock);
+	  pthread_setspecific(brcKey, t);
+	}
+    }
+  return t;
+}
+
+/* Releases a merged object, returning YES if it should be deallocated.
+ */
+static BOOL
+brcReleaseMerged(id anObject)
+{
+  obj		h = &((obj)anObject)[-1];
+  gsrefcount_t	result;
+
+  result = GSAtomicDecrement((gsatomic_t)&h->retained) - GS_BRC_MERGED;
+  if (result < 0)
+    {
+      if (result != -1)
+	{
+	  [NSException raise: NSInternalInconsistencyException
+	    format: @"NSDecrementExtraRefCount() decremented too far"];
+	}
+      h->retained = GS_BRC_MERGED;
+#  ifdef OBJC_CAP_ARC
+      objc_delete_weak_refs(anObject);
+#  endif
+      return YES;
+    }
+  return NO;
+}
+
+/* Performs the releases queued for the objects owned by t, merging the
+ * counts of any which are still biased.  Returns YES if there were any.
+ */
+static BOOL
+brcProcess(gs_brc_thread *t)
+{
+  BOOL	found = NO;
+
+  for (;;)
+    {
+      id		*pending;
+      NSUInteger	count;
+      NSUInteger	i;
+
+      pthread_mutex_lock(&t->lock);
+      pending = t->pending;
+      count = t->count;
+      t->pending = 0;
+      t->count = 0;
+      t->capacity = 0;
+      pthread_mutex_unlock(&t->lock);
+      if (0 == count)
+	{
+	  free(pending);
+	  return found;
+	}
+      found = YES;
+      for (i = 0; i < count; i++)
+	{
+	  id	o = pending[i];
+	  obj	h = &((obj)o)[-1];
+
+	  if (h->u.b.owner == t->ident)
+	    {
+	      h->u.b.owner = 0;
+	      GSAtomicAdd((gsatomic_t)&h->retained,
+		GS_BRC_MERGED + h->u.b.biased);
+	    }
+	  if (YES == brcReleaseMerged(o))
+	    {
+	      [o dealloc];
+	    }
+	}
+      free(pending);
+    }
+}
+
+/* Performs the releases queued for an exiting thread, then marks it as
+ * exited so that other threads perform any later releases themselves
+ * rather than queueing them where nothing would ever process them.
+ */
+static void
+brcThreadExit(void *data)
+{
+  gs_brc_thread	*t = (gs_brc_thread*)data;
+
+  for (;;)
+    {
+      brcProcess(t);
+      pthread_mutex_lock(&t->lock);
+      if (0 == t->count)
+	{
+	  t->exited = YES;
+	  pthread_mutex_unlock(&t->lock);
+	  break;
+	}
+      pthread_mutex_unlock(&t->lock);
+    }
+  pthread_mutex_lock(&brcLock);
+  t->nextFree = brcFree;
+  brcFree = t;
+  pthread_mutex_unlock(&brcLock);
+}
+
+static void
+brcRetain(id anObject)
+{
+  obj		h = &((obj)anObject)[-1];
+  gs_brc_thread	*t;
+
+  if (h->u.b.owner != 0 && 0 != (t = pthread_getspecific(brcKey))
+    && h->u.b.owner == t->ident && h->u.b.biased < UINT32_MAX)
+    {
+      h->u.b.biased++;
+    }
+  else
+    {
+      GSAtomicIncrement((gsatomic_t)&h->retained);
+    }
+}
+
+/* Releases an object using biased counting, returning YES if it should
+ * be deallocated.
+ */
+static BOOL
+brcRelease(id anObject)
+{
+  obj		h = &((obj)anObject)[-1];
+  gs_brc_thread	*t;
+
+  if (h->u.b.owner != 0 && 0 != (t = pthread_getspecific(brcKey))
+    && h->u.b.owner == t->ident)
+    {
+      gsrefcount_t	result;
+
+      if (h->u.b.biased > 0)
+	{
+	  h->u.b.biased--;
+	  return NO;
+	}
+      /* The owner has released all its references, so merge for good.
+       */
+      h->u.b.owner = 0;
+      result = GSAtomicAdd((gsatomic_t)&h->retained, GS_BRC_MERGED - 1)
+	- GS_BRC_MERGED;
+      if (result < 0)
+	{
+	  if (result != -1)
+	    {
+	      [NSException raise: NSInternalInconsistencyException
+		format: @"NSDecrementExtraRefCount() decremented too far"];
+	    }
+	  h->retained = GS_BRC_MERGED;
+#  ifdef OBJC_CAP_ARC
+	  objc_delete_weak_refs(anObject);
+#  endif
+	  return YES;
+	}
+      return NO;
+    }
+  for (;;)
+    {
+      gsrefcount_t	v = GSATOMICREAD(&h->retained);
+      uint16_t		owner;
+
+      if (v >= GS_BRC_MERGED / 2)
+	{
+	  return brcReleaseMerged(anObject);
+	}
+      if (v > 0)
+	{
+	  if (__sync_bool_compare_and_swap(&h->retained, v, v - 1))
+	    {
+	      return NO;
+	    }
+	}
+      else if ((owner = h->u.b.owner) != 0)
+	{
+	  gs_brc_thread	*o = brcThreads[owner];
+	  BOOL		queued = NO;
+
+	  /* The reference being released may be counted by the owner,
+	   * so leave the release for the owner to perform.  If the owner
+	   * has exited nothing else can use its count, so merge it here.
+	   */
+	  pthread_mutex_lock(&o->lock);
+	  if (YES == o->exited)
+	    {
+	      if (h->u.b.owner == owner)
+		{
+		  h->u.b.owner = 0;
+		  GSAtomicAdd((gsatomic_t)&h->retained,
+		    GS_BRC_MERGED + h->u.b.biased);
+		}
+	      pthread_mutex_unlock(&o->lock);
+	      return brcReleaseMerged(anObject);
+	    }
+	  if (o->count == o->capacity)
+	    {
+	      NSUInteger	c = (0 == o->capacity) ? 64 : o->capacity * 2;
+	      id		*p = realloc(o->pending, c * sizeof(id));
+
+	      if (0 != p)
+		{
+		  o->pending = p;
+		  o->capacity = c;
+		}
+	    }
+	  if (o->count < o->capacity)
+	    {
+	      o->pending[o->count++] = anObject;
+	      queued = YES;
+	    }
+	  pthread_mutex_unlock(&o->lock);
+	  if (NO == queued)
+	    {
+	      [NSException raise: NSMallocException
+			  format: @"Unable to queue release"];
+	    }
+	  return NO;
+	}
+    }
+}
+#endif	/* GS_BIASED_RC */
+
 /*
  * These symbols are provided by newer versions of the GNUstep Objective-C
  * runtime.  When linked against an older version, we will use our internal
@@ -502,9 +964,21 @@ static BOOL objc_release_fast_no_destroy_internal(id anObject)
 #if	defined(GSATOMICREAD)
     gsrefcount_t	result;
 
+#  if	defined(GS_BIASED_RC)
+    if (((obj)anObject)[-1].u.b.brc)
+      {
+        return brcRelease(anObject);
+      }
+#  endif
     result = GSAtomicDecrement((gsatomic_t)&(((obj)anObject)[-1].retained));
     if (result < 0)
       {
+#  if	defined(GSAtomicAdd)
+        if (GSATOMICREAD(&rcOverflowed) > 0 && YES == rcBorrow(anObject))
+          {
+            return NO;
+          }
+#  endif
         if (result != -1)
           {
             [NSException raise: NSInternalInconsistencyException
@@ -582,6 +1056,23 @@ static void release_fast(id anObject)
     }
 }
 
+BOOL
+GSPrivateReleaseDeferred(void)
+{
+#if	defined(GS_BIASED_RC)
+  if (YES == brcEnabled)
+    {
+      gs_brc_thread	*t = pthread_getspecific(brcKey);
+
+      if (0 != t && t->count > 0)
+	{
+	  return brcProcess(t);
+	}
+    }
+#endif
+  return NO;
+}
+
 /**
  * Examines the extra reference count for the object and, if non-zero
  * decrements it, otherwise leaves it unchanged.<br />
@@ -596,6 +1087,27 @@ NSDecrementExtraRefCountWasZero(id anObject)
 
 size_t object_getRetainCount_np_internal(id anObject)
 {
+#if	defined(GS_BIASED_RC)
+  if (((obj)anObject)[-1].u.b.brc)
+    {
+      obj		h = &((obj)anObject)[-1];
+      gsrefcount_t	v = h->retained;
+
+      if (v >= GS_BRC_MERGED / 2)
+	{
+	  return v - GS_BRC_MERGED + 1;
+	}
+      /* Only exact when called in the owning thread.
+       */
+      return v + h->u.b.biased + 1;
+    }
+#endif
+#if	defined(GSAtomicAdd)
+  if (GSATOMICREAD(&rcOverflowed) > 0)
+    {
+      return ((obj)anObject)[-1].retained + 1 + rcOverflow(anObject);
+    }
+#endif
   return ((obj)anObject)[-1].retained + 1;
 }
 
@@ -634,7 +1146,20 @@ static id objc_retain_fast_np_internal(id anObject)
 {
   BOOL  tooFar = NO;
 
-#if	defined(GSATOMICREAD)
+#if	defined(GS_BIASED_RC)
+  if (((obj)anObject)[-1].u.b.brc)
+    {
+      brcRetain(anObject);
+      return anObject;
+    }
+#endif
+#if	defined(GSAtomicAdd)
+  if (GSAtomicIncrement((gsatomic_t)&(((obj)anObject)[-1].retained))
+    == GS_RC_SPILL_AT)
+    {
+      rcSpill(anObject);
+    }
+#elif	defined(GSATOMICREAD)
   /* I've seen comments saying that some platforms only support up to
    * 24 bits in atomic locking, so raise an exception if we try to
    * go beyond 0xfffffe.
@@ -681,7 +1206,7 @@ static id objc_retain_fast_np_internal(id anObject)
         {
           tooFar = NO;
         }
-      [gnustep_global_lock lock];
+      [gnustep_global_lock unlock];
       if (YES == tooFar)
         {
           NSString      *base;
@@ -799,6 +1324,18 @@ NSAllocateObject(Class aClass, NSUInteger extraBytes, NSZone *zone)
   if (new != nil)
     {
       memset (new, 0, size);
+#if	defined(GS_BIASED_RC)
+      if (YES == brcEnabled)
+	{
+	  gs_brc_thread	*t = brcCurrent();
+
+	  if (0 != t)
+	    {
+	      ((obj)new)->u.b.owner = t->ident;
+	      ((obj)new)->u.b.brc = 1;
+	    }
+	}
+#endif
       new = (id)&((obj)new)[1];
       object_setClass(new, aClass);
       AADD(aClass, new);
@@ -1061,6 +1598,29 @@ static id gs_weak_load(id obj)
           }
       }
 #endif
+#if defined(GSAtomicAdd)
+      {
+        NSUInteger	i;
+
+        for (i = 0; i < GS_RC_SHARDS; i++)
+          {
+            pthread_mutex_init(&rcShards[i].lock, NULL);
+          }
+      }
+#endif
+#if defined(GS_BIASED_RC)
+      /* Biased counting is only possible when we manage the counts
+       * rather than the runtime.
+       */
+      if (YES == GSPrivateEnvironmentFlag("GNUSTEP_BIASED_REFCOUNT", NO)
+#  ifdef SUPPORT_WEAK
+        && 0 == objc_retain_fast_np
+#  endif
+        && 0 == pthread_key_create(&brcKey, brcThreadExit))
+        {
+          brcEnabled = YES;
+        }
+#endif
 
       /* Create the global lock.
        * NB. Ths is one of the first things we do ... setting up a new lock
@@ -128,6 +128,8 @@ extern void     GSPropertyListMake(id,NSDictionary*,BOOL,BOOL,unsigned,id*);
 {
   @public
   NSString	*_keyPath;
+  char		*_key;		/* UTF-8 key if the path is a simple key */
+  unsigned	_keyLength;
 }
 @end
 
@@ -1069,10 +1071,71 @@ GSICUStringMatchesRegex(NSString *string, NSString *regex, NSStringCompareOption
     }
 }
 
+/* Evaluates an ordering comparison of a simple key with a number without
+ * boxing the value of the key, if the object has a numeric accessor for
+ * the key.  Returns NO if the normal evaluation must be used instead.
+ */
+- (BOOL) _evaluateNumericKey: (GSKeyPathExpression*)left
+		  withObject: (id)object
+		      result: (BOOL*)result
+{
+  GSPrivateNumber	n;
+  double		ld;
+  double		rd;
+  id			rightValue;
+
+  switch (GSPrivateKVCNumberForKey(object, left->_key, left->_keyLength, &n))
+    {
+      case 'i':	ld = (double)n.i; break;
+      case 'u':	ld = (double)n.u; break;
+      case 'd':	ld = n.d; break;
+      default:	return NO;
+    }
+  rightValue = [_right expressionValueWithObject: object context: nil];
+  if (nil == rightValue || [rightValue isEqual: [NSNull null]])
+    {
+      return NO;
+    }
+  rd = [self doubleValueFor: rightValue];
+  switch (_type)
+    {
+      case NSLessThanPredicateOperatorType:
+	*result = (ld < rd) ? YES : NO;
+	break;
+      case NSLessThanOrEqualToPredicateOperatorType:
+	*result = (ld <= rd) ? YES : NO;
+	break;
+      case NSGreaterThanPredicateOperatorType:
+	*result = (ld > rd) ? YES : NO;
+	break;
+      default:
+	*result = (ld >= rd) ? YES : NO;
+	break;
+    }
+  return YES;
+}
+
 - (BOOL) evaluateWithObject: (id)object
 {
-  id leftValue = [_left expressionValueWithObject: object context: nil];
-  id rightValue = [_right expressionValueWithObject: object context: nil];
+  id leftValue;
+  id rightValue;
+
+  if (_modifier == NSDirectPredicateModifier
+    && _type <= NSGreaterThanOrEqualToPredicateOperatorType
+    && object_getClass(_left) == [GSKeyPathExpression class]
+    && ((GSKeyPathExpression*)_left)->_key != 0)
+    {
+      BOOL	result;
+
+      if ([self _evaluateNumericKey: (GSKeyPathExpression*)_left
+			 withObject: object
+			     result: &result])
+	{
+	  return result;
+	}
+    }
+  leftValue = [_left expressionValueWithObject: object context: nil];
+  rightValue = [_right expressionValueWithObject: object context: nil];
 
   if (_modifier == NSDirectPredicateModifier)
     {
@@ -1201,6 +1264,13 @@ GSICUStringMatchesRegex(NSString *string, NSString *regex, NSStringCompareOption
   e = [[GSKeyPathExpression alloc] 
           initWithExpressionType: NSKeyPathExpressionType];
   ASSIGN(e->_keyPath, path);
+  if ([path rangeOfString: @"."].length == 0 && NO == [path hasPrefix: @"@"])
+    {
+      const char	*k = [path UTF8String];
+
+      e->_keyLength = strlen(k);
+      e->_key = strdup(k);
+    }
   return AUTORELEASE(e);
 }
 
@@ -1456,6 +1526,10 @@ GSICUStringMatchesRegex(NSString *string, NSString *regex, NSStringCompareOption
 - (void) dealloc;
 {
   RELEASE(_keyPath);
+  if (_key != 0)
+    {
+      free(_key);
+    }
   [super dealloc];
 }
 
@@ -1465,6 +1539,10 @@ GSICUStringMatchesRegex(NSString *string, NSString *regex, NSStringCompareOption
 
   copy = (GSKeyPathExpression *)[super copyWithZone: zone];
   copy->_keyPath = [_keyPath copyWithZone: zone];
+  if (_key != 0)
+    {
+      copy->_key = strdup(_key);
+    }
   return copy;
 }
 
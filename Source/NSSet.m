@@ -903,6 +903,27 @@ static Class NSMutableSet_concrete_class;
 {
   BLOCK_SCOPE BOOL shouldStop = NO;
   id<NSFastEnumeration> enumerator = self;
+  NSUInteger count;
+
+  /* For a concurrent enumeration, take the objects out of the set and
+   * enumerate chunks of them (several per thread) all at once.
+   */
+  if ((opts & NSEnumerationConcurrent) && (count = [self count]) > 1)
+    {
+      id		*objects = malloc(count * sizeof(id));
+      NSUInteger	i = 0;
+
+      FOR_IN (id, obj, enumerator)
+	{
+	  if (i < count)
+	    {
+	      objects[i++] = obj;
+	    }
+	}
+      END_FOR_IN(enumerator)
+      GSPrivateEnumerateConcurrently(GSEnumerateSet, objects, i, (id)aBlock);
+      return;
+    }
 
   GS_DISPATCH_CREATE_QUEUE_AND_GROUP_FOR_ENUMERATION(enumQueue, opts)
   FOR_IN (id, obj, enumerator)
@@ -205,6 +205,8 @@ typedef enum {
   NSMutableData		*wData;		/* Data object being written.	*/
   unsigned		wLength;	/* Ammount written so far.	*/
   NSMutableArray	*wMsgs;		/* Message in progress.		*/
+  NSMutableArray	*wBatch;	/* Messages in wBuffer.		*/
+  NSMutableData		*wBuffer;	/* Several messages together.	*/
   NSMutableData		*rData;		/* Buffer for incoming data	*/
   uint32_t		rLength;	/* Amount read so far.		*/
   uint32_t		rWant;		/* Amount desired.		*/
@@ -697,6 +699,8 @@ static Class	runLoopClass;
   DESTROY(rData);
   DESTROY(rItems);
   DESTROY(wMsgs);
+  DESTROY(wBatch);
+  DESTROY(wBuffer);
   DESTROY(myLock);
   [super dealloc];
 }
@@ -1148,7 +1152,60 @@ static Class	runLoopClass;
 
       if (wData == nil)
         {
-          if ([wMsgs count] > 0)
+	  NSUInteger	count = [wMsgs count];
+	  NSUInteger	batch = 0;
+	  NSUInteger	total = 0;
+
+	  /*
+	   * Several messages may be waiting to be sent (from different
+	   * threads).  Small ones are worth copying into a single buffer
+	   * to write them with as few system calls as possible, but a
+	   * large message is sent directly from its own data.
+	   */
+	  while (batch < count && total < NETBLOCK * 8)
+	    {
+	      NSArray	*components = [wMsgs objectAtIndex: batch];
+	      NSUInteger	c = [components count];
+	      NSUInteger	size = 0;
+	      NSUInteger	i;
+
+	      for (i = 0; i < c; i++)
+		{
+		  size += [[components objectAtIndex: i] length];
+		}
+	      if (size > NETBLOCK)
+		{
+		  break;
+		}
+	      total += size;
+	      batch++;
+	    }
+          if (batch > 1)
+	    {
+	      NSUInteger	index;
+
+	      if (wBatch == nil)
+		{
+		  wBatch = [NSMutableArray new];
+		  wBuffer = [[mutableDataClass alloc]
+		    initWithCapacity: NETBLOCK];
+		}
+	      for (index = 0; index < batch; index++)
+		{
+		  NSArray	*components = [wMsgs objectAtIndex: index];
+		  NSUInteger	c = [components count];
+		  NSUInteger	i;
+
+		  for (i = 0; i < c; i++)
+		    {
+		      [wBuffer appendData: [components objectAtIndex: i]];
+		    }
+		  [wBatch addObject: components];
+		}
+	      wData = wBuffer;
+	      wLength = 0;
+	    }
+          else if (count > 0)
             {
 	      NSArray	*components = [wMsgs objectAtIndex: 0];
 
@@ -1189,7 +1246,25 @@ static Class	runLoopClass;
           NSDebugMLLog(@"GSTcpHandle",
             @"wrote %d bytes on 0x%"PRIxPTR, res, (NSUInteger)self);
 	  wLength += res;
-          if (wLength == l)
+          if (wLength == l && wData == wBuffer)
+	    {
+	      NSUInteger	count = [wBatch count];
+
+	      /*
+	       * Completed a batch of messages ... remove them all.
+	       */
+	      while (count-- > 0)
+		{
+		  [wMsgs removeObjectIdenticalTo:
+		    [wBatch objectAtIndex: count]];
+		}
+	      [wBatch removeAllObjects];
+	      [wBuffer setLength: 0];
+	      wData = nil;
+	      wLength = 0;
+	      wItem = 0;
+	    }
+          else if (wLength == l)
             {
 	      NSArray	*components;
 
@@ -2432,6 +2507,13 @@ static Class		tcpPortClass;
        */
       sent = [h sendMessage: components beforeDate: when];
     }
+  if (sent == NO)
+    {
+      /* The remote process may have gone away and another registered
+       * the name, so do not let a lookup return this port again.
+       */
+      [NSSocketPortNameServer _forgetPort: self];
+    }
   return sent;
 }
 
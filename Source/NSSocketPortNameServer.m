@@ -32,7 +32,9 @@
 
 #import "common.h"
 #define	EXPOSE_NSSocketPortNameServer_IVARS	1
+#import "Foundation/NSArray.h"
 #import "Foundation/NSData.h"
+#import "Foundation/NSDictionary.h"
 #import "Foundation/NSByteOrder.h"
 #import "Foundation/NSException.h"
 #import "Foundation/NSAutoreleasePool.h"
@@ -52,6 +54,7 @@
 #import "Foundation/NSTimer.h"
 #import "Foundation/NSPathUtilities.h"
 #import "Foundation/NSPortNameServer.h"
+#import "Foundation/NSUserDefaults.h"
 
 #import "GSPortPrivate.h"
 
@@ -96,6 +99,59 @@ static NSSocketPortNameServer *defaultServer = nil;
 static NSString		*launchCmd = nil;
 static Class		portClass = 0;
 
+/*
+ * Results of recent lookups, so that a process looking up the same
+ * names repeatedly (eg while many processes start at once) does not
+ * ask gdomap each time.  Only used if the GSPortLookupCache default
+ * gives the number of seconds to keep a result.  Failed lookups are
+ * cached for no more than a second as the name is likely to be
+ * registered soon.  Protected by serverLock.
+ */
+static NSMutableDictionary	*lookupCache = nil;
+static NSTimeInterval		cacheTTL = -1.0;	/* Not yet known. */
+static NSTimeInterval		missTTL = 0.0;
+#define	MAX_CACHED	1000
+
+/*
+ * Return the port for a successful lookup.
+ */
+static NSPort *
+portFor(NSString *addr, unsigned portNum)
+{
+  if (portClass == [NSSocketPort class])
+    {
+      NSHost	*host;
+
+      host = [NSHost hostWithAddress: addr];
+      return (NSPort*)[NSSocketPort portWithNumber: portNum
+					    onHost: host
+				      forceAddress: addr
+					  listener: NO];
+    }
+  else
+    {
+      NSLog(@"Unknown port class (%@) set for new port!", portClass);
+      return nil;
+    }
+}
+
+@interface	GSPortLookup : NSObject
+{
+@public
+  NSString		*addr;
+  unsigned		port;
+  NSTimeInterval	expires;
+}
+@end
+
+@implementation	GSPortLookup
+- (void) dealloc
+{
+  RELEASE(addr);
+  [super dealloc];
+}
+@end
+
 
 
 typedef enum {
@@ -577,6 +633,8 @@ typedef enum {
       [[NSObject leakAt: &serverPort] release];
 #endif
       portClass = [NSSocketPort class];
+      lookupCache = [NSMutableDictionary new];
+      [[NSObject leakAt: &lookupCache] release];
     }
 }
 
@@ -845,34 +903,111 @@ typedef enum {
 - (NSPort*) portForName: (NSString*)name
 		 onHost: (NSString*)host
 {
-  NSString	*addr;
-  unsigned	portNum = 0;
+  NSString		*addr = nil;
+  unsigned		portNum = 0;
+  NSArray		*key;
+  GSPortLookup		*entry;
+  NSTimeInterval	now;
+  BOOL			found;
 
-  if ([self _lookupName: name
-		 onHost: host
-	    intoAddress: &addr
-	        andPort: &portNum] == YES)
+  if (name == nil)
     {
-      if (portClass == [NSSocketPort class])
+      [NSException raise: NSInvalidArgumentException
+		  format: @"attempt to lookup port with nil name"];
+    }
+  if (cacheTTL < 0.0)
+    {
+      NSTimeInterval	ttl;
+
+      ttl = [[NSUserDefaults standardUserDefaults]
+	doubleForKey: @"GSPortLookupCache"];
+      if (ttl < 0.0)
 	{
-	  NSHost	*host;
+	  ttl = 0.0;
+	}
+      missTTL = (ttl < 1.0) ? ttl : 1.0;
+      cacheTTL = ttl;
+    }
+  if (cacheTTL == 0.0)
+    {
+      found = [self _lookupName: name
+			 onHost: host
+		    intoAddress: &addr
+			andPort: &portNum];
+      return (found == YES) ? portFor(addr, portNum) : nil;
+    }
+
+  key = [NSArray arrayWithObjects: name, (host ? host : @""), nil];
+  now = [NSDate timeIntervalSinceReferenceDate];
+  [serverLock lock];
+  entry = [lookupCache objectForKey: key];
+  if (entry != nil && entry->expires > now)
+    {
+      portNum = entry->port;
+      addr = AUTORELEASE(RETAIN(entry->addr));
+      found = (portNum != 0) ? YES : NO;
+    }
+  else
+    {
+      entry = nil;
+    }
+  [serverLock unlock];
 
-	  host = [NSHost hostWithAddress: addr];
-	  return (NSPort*)[NSSocketPort portWithNumber: portNum
-						onHost: host
-					  forceAddress: addr
-					      listener: NO];
+  if (entry == nil)
+    {
+      found = [self _lookupName: name
+			 onHost: host
+		    intoAddress: &addr
+			andPort: &portNum];
+      entry = [GSPortLookup new];
+      if (found == YES)
+	{
+	  entry->addr = RETAIN(addr);
+	  entry->port = portNum;
+	  entry->expires = now + cacheTTL;
 	}
       else
 	{
-	  NSLog(@"Unknown port class (%@) set for new port!", portClass);
-	  return nil;
+	  entry->expires = now + missTTL;
 	}
-    }	
-  else
+      [serverLock lock];
+      if ([lookupCache count] >= MAX_CACHED)
+	{
+	  [lookupCache removeAllObjects];
+	}
+      [lookupCache setObject: entry forKey: key];
+      [serverLock unlock];
+      RELEASE(entry);
+    }
+  return (found == YES) ? portFor(addr, portNum) : nil;
+}
+
+/*
+ * Remove any cached lookups which found the port, so that the next
+ * lookup of the name asks gdomap again.
+ */
++ (void) _forgetPort: (NSSocketPort*)port
+{
+  NSString	*addr = [port address];
+  uint16_t	num = [port portNumber];
+
+  [serverLock lock];
+  if ([lookupCache count] > 0)
     {
-      return nil;
+      NSEnumerator	*e = [[lookupCache allKeys] objectEnumerator];
+      NSArray		*key;
+
+      while ((key = [e nextObject]) != nil)
+	{
+	  GSPortLookup	*entry = [lookupCache objectForKey: key];
+
+	  if (entry->port == num && [entry->addr isEqual: addr])
+	    {
+	      [lookupCache removeObjectForKey: key];
+	    }
+	}
     }
+  [serverLock unlock];
 }
 
 /**
@@ -1040,6 +1175,7 @@ typedef enum {
 	       */
 	      [known addObject: name];
 	      NSMapInsert(_nameMap, name, port);
+	      [lookupCache removeAllObjects];
 	    }
 	}
       DESTROY(com);
@@ -1131,6 +1267,7 @@ typedef enum {
 	   *	Find the port that was registered for this name and
 	   *	remove the mapping table entries.
 	   */
+	  [lookupCache removeAllObjects];
 	  port = NSMapGet(_nameMap, name);
 	  if (port)
 	    {
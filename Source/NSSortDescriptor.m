@@ -27,11 +27,14 @@
 #define	EXPOSE_NSSortDescriptor_IVARS	1
 #import "Foundation/NSSortDescriptor.h"
 
+#import "Foundation/NSAutoreleasePool.h"
 #import "Foundation/NSCoder.h"
+#import "Foundation/NSDecimalNumber.h"
 #import "Foundation/NSException.h"
 #import "Foundation/NSKeyValueCoding.h"
 #import "Foundation/NSNotification.h"
 #import "Foundation/NSUserDefaults.h"
+#import "Foundation/NSValue.h"
 
 #import "GNUstepBase/GSObjCRuntime.h"
 #import "GSPrivate.h"
@@ -43,6 +46,18 @@ static BOOL     initialized = NO;
 #pragma clang diagnostic ignored "-Wreceiver-forward-class"
 #endif
 
+/* What a descriptor compares with, for use when sorting.
+ */
+typedef struct {
+  BOOL		ascending;
+  SEL		selector;
+  NSComparator	comparator;
+} GSSortInfo;
+
+@interface NSSortDescriptor (Private)
+- (void) _getSortInfo: (GSSortInfo*)info;
+@end
+
 @interface GSTimSortPlaceHolder : NSObject
 + (void) setUnstable;
 @end
@@ -107,6 +122,13 @@ static BOOL     initialized = NO;
   return _ascending;
 }
 
+- (void) _getSortInfo: (GSSortInfo*)info
+{
+  info->ascending = _ascending;
+  info->selector = _selector;
+  info->comparator = (NSComparator)_comparator;
+}
+
 - (NSComparisonResult) compareObject: (id) object1 toObject: (id) object2
 {
   NSComparisonResult result;
@@ -448,6 +470,264 @@ GSSortUnstableConcurrent(id* buffer, NSRange range, id descriptorOrComparator,
 
 @end
 
+/* When sorting with a descriptor each object is paired with the value
+ * of its key, so that the key path is evaluated once per object rather
+ * than twice per comparison.  Where the descriptor compares numbers with
+ * -compare: the values are held and compared as C scalars, and a simple
+ * key whose accessor returns a scalar is read without boxing at all.
+ */
+typedef struct {
+  id			object;
+  id			value;	/* The key value unless held in number */
+  GSPrivateNumber	number;
+  char			kind;	/* 'i', 'u' or 'd' if number is set */
+} GSSortRecord;
+
+static inline NSComparisonResult
+Ordered(NSComparisonResult r, GSSortInfo *info)
+{
+  if (NO == info->ascending)
+    {
+      if (r == NSOrderedAscending)
+	{
+	  r = NSOrderedDescending;
+	}
+      else if (r == NSOrderedDescending)
+	{
+	  r = NSOrderedAscending;
+	}
+    }
+  return r;
+}
+
+#define	COMPARE_NUMBERS(NAME, M) \
+static NSInteger \
+NAME(id r1, id r2, void *context) \
+{ \
+  GSSortRecord	*a = (GSSortRecord*)r1; \
+  GSSortRecord	*b = (GSSortRecord*)r2; \
+  NSComparisonResult	r = NSOrderedSame; \
+\
+  if (a->number.M < b->number.M) \
+    r = NSOrderedAscending; \
+  else if (a->number.M > b->number.M) \
+    r = NSOrderedDescending; \
+  return Ordered(r, (GSSortInfo*)context); \
+}
+
+COMPARE_NUMBERS(CompareSigned, i)
+COMPARE_NUMBERS(CompareUnsigned, u)
+COMPARE_NUMBERS(CompareDouble, d)
+
+static NSInteger
+CompareValues(id r1, id r2, void *context)
+{
+  GSSortInfo		*info = (GSSortInfo*)context;
+  id			v1 = ((GSSortRecord*)r1)->value;
+  id			v2 = ((GSSortRecord*)r2)->value;
+  NSComparisonResult	r;
+
+  if (info->comparator == NULL)
+    {
+      r = (NSComparisonResult)[v1 performSelector: info->selector
+				       withObject: v2];
+    }
+  else
+    {
+      r = CALL_BLOCK(info->comparator, v1, v2);
+    }
+  return Ordered(r, info);
+}
+
+/* Stores a number in the record if the value is one which -compare:
+ * can be expected to order numerically.
+ */
+static void
+SetNumber(GSSortRecord *r, id value)
+{
+  static Class	numberClass = Nil;
+  static Class	decimalClass = Nil;
+
+  if (Nil == numberClass)
+    {
+      numberClass = [NSNumber class];
+      decimalClass = [NSDecimalNumber class];
+    }
+  r->kind = 0;
+  if ([value isKindOfClass: numberClass]
+    && NO == [value isKindOfClass: decimalClass])
+    {
+      switch (*[value objCType])
+	{
+	  case _C_ULNG:
+	  case _C_ULNG_LNG:
+	    r->number.u = [value unsignedLongLongValue];
+	    r->kind = 'u';
+	    break;
+	  case _C_FLT:
+	  case _C_DBL:
+	    r->number.d = [value doubleValue];
+	    r->kind = 'd';
+	    break;
+	  default:
+	    r->number.i = [value longLongValue];
+	    r->kind = 'i';
+	}
+    }
+}
+
+/* Fills in the records for count objects and returns the function to
+ * compare them with.
+ */
+static NSInteger (*
+LoadRecords(GSSortRecord *records, id *objects, NSUInteger count,
+  NSString *key, GSSortInfo *info))(id, id, void*)
+{
+  const char	*ckey = 0;
+  unsigned	clen = 0;
+  BOOL		numeric;
+  BOOL		hasSigned = NO;
+  BOOL		hasNegative = NO;
+  BOOL		hasUnsigned = NO;
+  BOOL		hasLarge = NO;
+  BOOL		hasDouble = NO;
+  NSUInteger	i;
+
+  numeric = (info->comparator == NULL
+    && sel_isEqual(info->selector, @selector(compare:))) ? YES : NO;
+  if (YES == numeric && [key rangeOfString: @"."].length == 0
+    && NO == [key hasPrefix: @"@"])
+    {
+      ckey = [key UTF8String];
+      clen = strlen(ckey);
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      GSSortRecord	*r = &records[i];
+
+      r->object = objects[i];
+      r->value = nil;
+      r->kind = 0;
+      if (clen > 0)
+	{
+	  r->kind = GSPrivateKVCNumberForKey(r->object, ckey, clen, &r->number);
+	}
+      if (0 == r->kind)
+	{
+	  r->value = [r->object valueForKeyPath: key];
+	  if (YES == numeric)
+	    {
+	      SetNumber(r, r->value);
+	    }
+	}
+      switch (r->kind)
+	{
+	  case 'i':
+	    hasSigned = YES;
+	    if (r->number.i < 0)
+	      {
+		hasNegative = YES;
+	      }
+	    if (r->number.i > (1LL << 53) || r->number.i < -(1LL << 53))
+	      {
+		hasLarge = YES;
+	      }
+	    break;
+	  case 'u':
+	    hasUnsigned = YES;
+	    if (r->number.u > (1ULL << 53))
+	      {
+		hasLarge = YES;
+	      }
+	    break;
+	  case 'd':
+	    hasDouble = YES;
+	    if (r->number.d != r->number.d)
+	      {
+		numeric = NO;	/* NaN */
+	      }
+	    break;
+	  default:
+	    numeric = NO;
+	}
+    }
+
+  /* Pick a representation which holds every value exactly, or fall back
+   * to comparing the values as objects.
+   */
+  if (YES == numeric)
+    {
+      if (YES == hasDouble)
+	{
+	  if (NO == hasLarge)
+	    {
+	      for (i = 0; i < count; i++)
+		{
+		  GSSortRecord	*r = &records[i];
+
+		  if ('i' == r->kind)
+		    {
+		      r->number.d = (double)r->number.i;
+		    }
+		  else if ('u' == r->kind)
+		    {
+		      r->number.d = (double)r->number.u;
+		    }
+		}
+	      return CompareDouble;
+	    }
+	}
+      else if (NO == hasUnsigned)
+	{
+	  return CompareSigned;
+	}
+      else if (NO == hasNegative)
+	{
+	  for (i = 0; i < count; i++)
+	    {
+	      if ('i' == records[i].kind)
+		{
+		  records[i].number.u = (unsigned long long)records[i].number.i;
+		}
+	    }
+	  return CompareUnsigned;
+	}
+      else
+	{
+	  BOOL	fits = YES;
+
+	  for (i = 0; i < count && YES == fits; i++)
+	    {
+	      if ('u' == records[i].kind
+		&& records[i].number.u > (unsigned long long)LLONG_MAX)
+		{
+		  fits = NO;
+		}
+	    }
+	  if (YES == fits)
+	    {
+	      for (i = 0; i < count; i++)
+		{
+		  if ('u' == records[i].kind)
+		    {
+		      records[i].number.i = (long long)records[i].number.u;
+		    }
+		}
+	      return CompareSigned;
+	    }
+	}
+    }
+  for (i = 0; i < count; i++)
+    {
+      if (nil == records[i].value)
+	{
+	  records[i].value = [records[i].object valueForKeyPath: key];
+	}
+    }
+  return CompareValues;
+}
+
 /* Sort the objects in range using the first descriptor and, if there
  * are more descriptors, recursively call the function to sort each range
  * of adhacent equal objects using the remaining descriptors.
@@ -456,7 +736,105 @@ static void
 SortRange(id *objects, NSRange range, id *descriptors,
   NSUInteger numDescriptors)
 {
+  static IMP		standard = 0;
   NSSortDescriptor	*sd = (NSSortDescriptor*)descriptors[0];
+  NSUInteger		count = range.length;
+
+  if (0 == standard)
+    {
+      standard = [NSSortDescriptor instanceMethodForSelector:
+	@selector(compareObject:toObject:)];
+    }
+  if (count > 1 && NO == [sd isProxy] && [sd key] != nil
+    && [sd methodForSelector: @selector(compareObject:toObject:)] == standard)
+    {
+      GSSortRecord	stackRecords[GS_MAX_OBJECTS_FROM_STACK];
+      id		stackItems[GS_MAX_OBJECTS_FROM_STACK];
+      GSSortRecord	*records = stackRecords;
+      id		*items = stackItems;
+      GSSortInfo	info;
+
+      [sd _getSortInfo: &info];
+
+      /* The key value accessors and the comparison may raise, so the
+       * buffers are freed by a handler rather than at the end of a scope.
+       */
+      if (count > GS_MAX_OBJECTS_FROM_STACK)
+	{
+	  records = malloc(count * sizeof(GSSortRecord));
+	  items = malloc(count * sizeof(id));
+	}
+      NS_DURING
+	{
+	  NSInteger	(*cmp)(id, id, void*);
+	  NSUInteger	i;
+
+	  ENTER_POOL
+	  cmp = LoadRecords(records, objects + range.location, count,
+	    [sd key], &info);
+	  for (i = 0; i < count; i++)
+	    {
+	      items[i] = (id)&records[i];
+	    }
+	  if (CompareValues == cmp)
+	    {
+	      GSSortUnstable(items, NSMakeRange(0, count), (id)cmp,
+		GSComparisonTypeFunction, &info);
+	    }
+	  else
+	    {
+	      /* Comparing numbers is safe in any thread, so large ranges
+	       * can be sorted concurrently.
+	       */
+	      GSSortUnstableConcurrent(items, NSMakeRange(0, count), (id)cmp,
+		GSComparisonTypeFunction, &info);
+	    }
+	  for (i = 0; i < count; i++)
+	    {
+	      objects[range.location + i] = ((GSSortRecord*)items[i])->object;
+	    }
+
+	  if (numDescriptors > 1)
+	    {
+	      NSUInteger	start = 0;
+
+	      while (start < count)
+		{
+		  NSUInteger	pos = start + 1;
+
+		  while (pos < count && NSOrderedSame
+		    == (*cmp)(items[start], items[pos], &info))
+		    {
+		      pos++;
+		    }
+		  if (pos - start > 1)
+		    {
+		      SortRange(objects,
+			NSMakeRange(range.location + start, pos - start),
+			descriptors + 1, numDescriptors - 1);
+		    }
+		  start = pos;
+		}
+	    }
+	  LEAVE_POOL
+	}
+      NS_HANDLER
+	{
+	  if (records != stackRecords)
+	    {
+	      free(records);
+	      free(items);
+	    }
+	  [localException raise];
+	}
+      NS_ENDHANDLER
+      if (records != stackRecords)
+	{
+	  free(records);
+	  free(items);
+	}
+      return;
+    }
 
   GSSortUnstable(objects, range, sd, GSComparisonTypeSortDescriptor, NULL);
   if (numDescriptors > 1)
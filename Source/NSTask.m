@@ -93,6 +93,29 @@
 #include <sys/stropts.h>
 #endif
 
+/*
+ *	Where the C library lets posix_spawn() do everything the child needs
+ *	(new session, close descriptors, change directory) we use it rather
+ *	than doing that work in a vforked child.
+ */
+#if	defined(__GLIBC__) && !defined(_WIN32)
+#include <spawn.h>
+#if	__GLIBC_PREREQ(2,34) && defined(POSIX_SPAWN_SETSID)
+#define	USE_POSIX_SPAWN	1
+#endif
+#endif
+
+/*
+ *	On linux a pidfd lets us wait for a child in the run loop, and
+ *	close_range() closes all the extra descriptors in one call.
+ */
+#if	defined(__linux__)
+#include <sys/syscall.h>
+#if	defined(SYS_pidfd_open)
+#define	USE_PIDFD	1
+#endif
+#endif
+
 /*
  *	If we don't have NOFILE, default to 2048 open descriptors.
  */
@@ -131,6 +154,8 @@ static void handleSignal(int sig)
 {
   char	slave_name[32];
   BOOL	_usePseudoTerminal;
+  int	_pidfd;		/* Readable when the child exits, or -1	*/
+  int	_pidfdWatchers;	/* Run loops watching _pidfd		*/
 }
 @end
 #define NSConcreteTask NSConcreteUnixTask
@@ -222,6 +247,7 @@ pty_slave(const char* name)
 @interface NSTask (Private)
 - (NSString *) _fullLaunchPath;
 - (void) _collectChild;
+- (BOOL) _monitorTermination: (BOOL)flag;
 - (void) _notifyOfTermination;
 - (void) _terminatedChild: (int)status reason: (NSTaskTerminationReason)reason;
 @end
@@ -850,13 +876,17 @@ pty_slave(const char* name)
   NSTimer	*timer = nil;
   NSDate	*limit = nil;
 
+  BOOL		monitored;
+
   IF_NO_GC([[self retain] autorelease];)
+  monitored = [self _monitorTermination: YES];
   while ([self isRunning])
     {
-      /* Poll at 0.1 second intervals.
+      /* Poll at 0.1 second intervals unless the run loop will be woken
+       * as soon as the child exits.
        */
       limit = [[NSDate alloc] initWithTimeIntervalSinceNow: 0.1];
-      if (timer == nil)
+      if (timer == nil && monitored == NO)
 	{
 	  timer = [NSTimer scheduledTimerWithTimeInterval: 0.1
 						   target: nil
@@ -868,6 +898,10 @@ pty_slave(const char* name)
       DESTROY(limit);
     }
   [timer invalidate];
+  if (monitored == YES)
+    {
+      [self _monitorTermination: NO];
+    }
 
   /* Run loop one last time (with limit date in past) so that any
    * notification about the task ending is sent immediately.
@@ -904,6 +938,15 @@ pty_slave(const char* name)
   [self subclassResponsibility: _cmd];
 }
 
+/* Start (or stop) watching for termination of the child in the current
+ * run loop.  Returns NO if this is not supported, in which case the
+ * caller must poll.
+ */
+- (BOOL) _monitorTermination: (BOOL)flag
+{
+  return NO;
+}
+
 - (void) _notifyOfTermination
 {
   NSNotificationQueue   *q;
@@ -1372,6 +1415,62 @@ quotedFromString(NSString *aString)
 
 #else /* !_WIN32 */
 
+#if	defined(USE_POSIX_SPAWN)
+/* Start a child in its own session with default signal handling, the
+ * given standard descriptors, no others open, and the given working
+ * directory.  Returns the process id or -1 with errno set.
+ */
+static pid_t
+spawnChild(const char *executable, const char **args, const char **envl,
+  const char *path, int idesc, int odesc, int edesc)
+{
+  posix_spawn_file_actions_t	actions;
+  posix_spawnattr_t		attr;
+  sigset_t			sigs;
+  pid_t				pid;
+  int				err;
+
+  posix_spawn_file_actions_init(&actions);
+  posix_spawnattr_init(&attr);
+  sigfillset(&sigs);
+  posix_spawnattr_setsigdefault(&attr, &sigs);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGDEF);
+
+  if (idesc != 0)
+    {
+      posix_spawn_file_actions_adddup2(&actions, idesc, 0);
+    }
+  if (odesc != 1)
+    {
+      posix_spawn_file_actions_adddup2(&actions, odesc, 1);
+    }
+  if (edesc != 2)
+    {
+      posix_spawn_file_actions_adddup2(&actions, edesc, 2);
+    }
+  posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+  /* A child started with vfork() ignores failure to change directory
+   * and runs in our directory, so we keep that behaviour rather than
+   * have the spawn fail.
+   */
+  if (0 != path && 0 == access(path, X_OK))
+    {
+      posix_spawn_file_actions_addchdir_np(&actions, path);
+    }
+
+  err = posix_spawn(&pid, executable, &actions, &attr,
+    (char**)args, (char**)envl);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  if (err != 0)
+    {
+      errno = err;
+      return -1;
+    }
+  return pid;
+}
+#endif
+
 @implementation NSConcreteUnixTask
 
 BOOL
@@ -1453,6 +1552,38 @@ GSPrivateCheckTasks()
   return found;
 }
 
+/* Closes the pidfd once the child has been reaped and no run loop is
+ * watching it, so that finished tasks do not keep descriptors open.
+ * Must be called with tasksLock held.
+ */
+- (void) _closePidfd
+{
+  if (_pidfd >= 0 && YES == _hasCollected && 0 == _pidfdWatchers)
+    {
+      (void)close(_pidfd);
+      _pidfd = -1;
+    }
+}
+
+- (void) finalize
+{
+  if (_pidfd >= 0)
+    {
+      (void)close(_pidfd);
+      _pidfd = -1;
+    }
+  [super finalize];
+}
+
+- (id) init
+{
+  if ((self = [super init]) != nil)
+    {
+      _pidfd = -1;
+    }
+  return self;
+}
+
 - (void) launch
 {
   NSMutableArray	*toClose;
@@ -1548,7 +1679,25 @@ GSPrivateCheckTasks()
    */
 #define vfork fork
 #endif
-  pid = vfork();
+#if	defined(USE_POSIX_SPAWN)
+  /* A pseudo terminal must be opened by the child after setsid() to
+   * become its controlling terminal, so that still needs vfork().
+   */
+  if (_usePseudoTerminal == NO)
+    {
+      pid = spawnChild(executable, args, envl, path, idesc, odesc, edesc);
+      if (pid < 0)
+	{
+	  [NSException raise: NSInvalidArgumentException
+		      format: @"NSTask - failed to create child process: %@",
+	    [NSError _last]];
+	}
+    }
+  else
+#endif
+    {
+      pid = vfork();
+    }
   if (pid < 0)
     {
       [NSException raise: NSInvalidArgumentException
@@ -1645,9 +1794,14 @@ GSPrivateCheckTasks()
       /*
        * Close any extra descriptors.
        */
-      for (i = 3; i < NOFILE; i++)
+#if	defined(SYS_close_range)
+      if (syscall(SYS_close_range, 3, ~0U, 0) != 0)
+#endif
 	{
-	  (void) close(i);
+	  for (i = 3; i < NOFILE; i++)
+	    {
+	      (void) close(i);
+	    }
 	}
 
       (void)chdir(path);
@@ -1659,6 +1813,11 @@ GSPrivateCheckTasks()
       _taskId = pid;
       _hasLaunched = YES;
       ASSIGN(_launchPath, lpath);	// Actual path used.
+#if	defined(USE_PIDFD)
+      /* The child cannot have been reaped yet, so the pid is still ours.
+       */
+      _pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+#endif
 
       [tasksLock lock];
       NSMapInsert(activeTasks, (void*)(intptr_t)_taskId, (void*)self);
@@ -1744,6 +1903,51 @@ GSPrivateCheckTasks()
     }
 }
 
+- (BOOL) _monitorTermination: (BOOL)flag
+{
+  [tasksLock lock];
+  if (flag == YES)
+    {
+      if (_pidfd < 0)
+	{
+	  [tasksLock unlock];
+	  return NO;
+	}
+      _pidfdWatchers++;
+      [[NSRunLoop currentRunLoop] addEvent: (void*)(uintptr_t)_pidfd
+				      type: ET_RDESC
+				   watcher: self
+				   forMode: NSDefaultRunLoopMode];
+    }
+  else
+    {
+      [[NSRunLoop currentRunLoop] removeEvent: (void*)(uintptr_t)_pidfd
+					 type: ET_RDESC
+				      forMode: NSDefaultRunLoopMode
+					  all: NO];
+      _pidfdWatchers--;
+      [self _closePidfd];
+    }
+  [tasksLock unlock];
+  return YES;
+}
+
+- (void) receivedEvent: (void*)data
+		  type: (RunLoopEventType)type
+		 extra: (void*)extra
+	       forMode: (NSString*)mode
+{
+  [self _collectChild];
+}
+
+- (void) _terminatedChild: (int)status reason: (NSTaskTerminationReason)reason
+{
+  [super _terminatedChild: status reason: reason];
+  [tasksLock lock];
+  [self _closePidfd];
+  [tasksLock unlock];
+}
+
 - (BOOL) usePseudoTerminal
 {
   int		desc;
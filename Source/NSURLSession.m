@@ -153,6 +153,7 @@ static int nextSessionIdentifier()
   DESTROY(_taskRegistry);
   DESTROY(_configuration);
   DESTROY(_delegateQueue);
+  [_multiHandle invalidate];
   DESTROY(_multiHandle);
   [super dealloc];
 }
@@ -22,21 +22,51 @@
    Boston, MA 02111 USA.
 */
 
+#import "common.h"
 #include <stdlib.h>
+#include <pthread.h>
 #include "objc/objc.h"
 #include "objc/objc-api.h"
-#include "objc/thr.h"
+#import "GSPrivate.h"
+
+/*
+ * About this implementation.
+ *
+ * Each object used with @synchronized gets a node holding a recursive
+ * mutex.  The nodes live in a hash table keyed by object address, where
+ * they are never removed, so the table can be searched without locking.
+ * Adding a node locks only the shard of the table it goes in.
+ *
+ * Each thread also keeps a small cache of the objects it currently has
+ * locked, with a count of how many times it has entered each.  Entering
+ * or leaving a @synchronized block for an object the thread already
+ * holds just changes that count, and only the outermost enter and exit
+ * use the mutex.  If the cache is full the mutex (being recursive) keeps
+ * the count instead.
+ */
 
 /*
  * Node structure...
  */
 typedef struct lock_node {
-  id obj;
-  objc_mutex_t lock;
-  struct lock_node *next;
-  struct lock_node *prev;
+  id			obj;
+  pthread_mutex_t	lock;
+  struct lock_node	*next;
 } lock_node_t;
 
+/*
+ * Entry in the per-thread cache of locks held.
+ */
+typedef struct {
+  id		obj;
+  lock_node_t	*node;
+  unsigned	count;
+} lock_held_t;
+
+#define	SYNC_BUCKETS	1024	/* Hash table size */
+#define	SYNC_SHARDS	64	/* Number of locks for adding to the table */
+#define	SYNC_CACHE	8	/* Size of the per-thread cache */
+
 /*
  * Return types for the locks...
  */
@@ -47,43 +77,80 @@ typedef enum {
   OBJC_SYNC_NOT_INITIALIZED = -3		
 } sync_return_t;
 
-static lock_node_t *lock_list = NULL;
-static objc_mutex_t table_lock = NULL; 
+static lock_node_t * volatile	buckets[SYNC_BUCKETS];
+static pthread_mutex_t		shards[SYNC_SHARDS];
+static pthread_mutexattr_t	recursive;
+static pthread_key_t		heldKey;
+static pthread_once_t		syncOnce = PTHREAD_ONCE_INIT;
+static BOOL			heldKeyOK = NO;
 
 /**
- * Initialize the table lock.
+ * Initialize the shard locks and the key for the per-thread cache.
  */
 static void
-sync_lock_init()
+sync_init(void)
+{
+  unsigned	i;
+
+  for (i = 0; i < SYNC_SHARDS; i++)
+    {
+      pthread_mutex_init(&shards[i], NULL);
+    }
+  pthread_mutexattr_init(&recursive);
+  pthread_mutexattr_settype(&recursive, PTHREAD_MUTEX_RECURSIVE);
+  if (0 == pthread_key_create(&heldKey, free))
+    {
+      heldKeyOK = YES;
+    }
+}
+
+static inline unsigned
+sync_bucket(id obj)
 {
-  if (table_lock == NULL)
+  uintptr_t	h = (uintptr_t)obj;
+
+  h ^= h >> 4;
+  h ^= h >> 12;
+  return h % SYNC_BUCKETS;
+}
+
+/**
+ * Return the cache of locks held by the current thread (or NULL).
+ */
+static lock_held_t*
+sync_held(BOOL create)
+{
+  lock_held_t	*held;
+
+  if (NO == heldKeyOK)
     {
-      table_lock = objc_mutex_allocate();
+      return NULL;
     }
+  held = (lock_held_t*)pthread_getspecific(heldKey);
+  if (NULL == held && YES == create)
+    {
+      held = (lock_held_t*)calloc(SYNC_CACHE, sizeof(lock_held_t));
+      if (NULL != held)
+	{
+	  pthread_setspecific(heldKey, held);
+	}
+    }
+  return held;
 }
 
 /**
- * Find the node in the list.
+ * Find the node in the table, without locking.
  */
 static lock_node_t*
 sync_find_node(id obj)
 {
-  lock_node_t *current = lock_list;
+  lock_node_t	*current;
 
-  if (lock_list != NULL)
+  for (current = buckets[sync_bucket(obj)]; current; current = current->next)
     {
-      // iterate over the list looking for the end...
-      while (current != NULL)
+      if (current->obj == obj)
 	{
-	  // if the current object is the one, breal and
-	  // return that node.
-	  if (current->obj == obj)
-	    {
-	      break;
-	    }
-
-	  // get the next one...
-	  current = current->next;
+	  break;
 	}
     }
   return current;
@@ -95,57 +162,41 @@ sync_find_node(id obj)
 static lock_node_t*
 sync_add_node(id obj)
 {
-  lock_node_t *current = NULL;
-
-  // get the lock...
-  sync_lock_init();
-  
-  // if the list hasn't been initialized, initialize it.
-  if (lock_list == NULL)
-    {
-      // instantiate the new node and set the list...
-      lock_list = malloc(sizeof(lock_node_t));
-
-      // set the current node to the last in the list...
-      current = lock_list;
+  unsigned	b = sync_bucket(obj);
+  lock_node_t	*current;
 
-      // set next and prev...
-      current->prev = NULL;
-      current->next = NULL;
-    }
-  else 
+  pthread_mutex_lock(&shards[b % SYNC_SHARDS]);
+  /* Another thread may have added it since we looked.
+   */
+  for (current = buckets[b]; current; current = current->next)
     {
-      lock_node_t *new_node = NULL;
-      current = lock_list;
-
-      // look for the end of the list.
-      while (current->next)
-	{
-	  current = current->next;
-	}
-
-      // instantiate the new node...
-      new_node = malloc(sizeof(lock_node_t));
-
-      if (new_node != NULL)
+      if (current->obj == obj)
 	{
-	  // set next and prev...
-	  current->next = new_node;
-	  new_node->prev = current;
-	  new_node->next = NULL;
-	  
-	  // set the current node to the last in the list...
-	  current = new_node;
+	  break;
 	}
     }
-
-  if (current != NULL)
+  if (NULL == current)
     {
-      // add the object and it's lock
-      current->obj = obj;
-      current->lock = objc_mutex_allocate();
+      current = malloc(sizeof(lock_node_t));
+      if (NULL != current)
+	{
+	  current->obj = obj;
+	  if (0 != pthread_mutex_init(&current->lock, &recursive))
+	    {
+	      free(current);
+	      current = NULL;
+	    }
+	  else
+	    {
+	      /* Make sure the node is complete before readers can see it.
+	       */
+	      current->next = buckets[b];
+	      __sync_synchronize();
+	      buckets[b] = current;
+	    }
+	}
     }
-
+  pthread_mutex_unlock(&shards[b % SYNC_SHARDS]);
   return current;
 }
 
@@ -155,38 +206,90 @@ sync_add_node(id obj)
 int
 objc_sync_enter(id obj)
 {
-  lock_node_t *node = NULL;
-  int status = 0;
+  lock_node_t	*node;
+  lock_held_t	*held;
+  lock_held_t	*slot = NULL;
+  int		status;
+  unsigned	i;
+
+  /* As on other systems, @synchronized(nil) does nothing.
+   */
+  if (nil == obj)
+    {
+      return OBJC_SYNC_SUCCESS;
+    }
+  pthread_once(&syncOnce, sync_init);
 
-  // lock access to the table until we're done....
-  sync_lock_init();
-  objc_mutex_lock(table_lock);
+  held = sync_held(YES);
+  if (NULL != held)
+    {
+      for (i = 0; i < SYNC_CACHE; i++)
+	{
+	  if (held[i].obj == obj)
+	    {
+	      held[i].count++;
+	      return OBJC_SYNC_SUCCESS;
+	    }
+	  if (NULL == slot && nil == held[i].obj)
+	    {
+	      slot = &held[i];
+	    }
+	}
+    }
 
   node = sync_find_node(obj);
-  if (node == NULL)
+  if (NULL == node)
     {
       node = sync_add_node(obj);
-      if (node == NULL)
+      if (NULL == node)
 	{
-	  // unlock the table....
-	  objc_mutex_unlock(table_lock);  
 	  return OBJC_SYNC_NOT_INITIALIZED;
 	}
     }
 
-  // unlock the table....
-  objc_mutex_unlock(table_lock);  
+  if (GSPrivateLockProfiling > 0)
+    {
+      void	*sample = GSPrivateLockProfileSample(obj, nil, YES, NO);
 
-  status = objc_mutex_lock(node->lock);
+      /* See whether we have to wait, and for how long.
+       */
+      status = pthread_mutex_trylock(&node->lock);
+      if (EBUSY == status)
+	{
+	  uint64_t	start;
 
-  // if the status is more than one, then another thread
-  // has this section locked, so we abort.  A status of -1
-  // indicates that an error occurred.
-  if (status > 1 || status == -1)
+	  if (0 == sample)
+	    {
+	      sample = GSPrivateLockProfileSample(obj, nil, YES, YES);
+	    }
+	  start = GSPrivateLockProfileClock();
+	  status = pthread_mutex_lock(&node->lock);
+	  if (0 == status)
+	    {
+	      GSPrivateLockProfileAcquired(obj, sample, YES,
+		GSPrivateLockProfileClock() - start);
+	    }
+	}
+      else if (0 == status)
+	{
+	  GSPrivateLockProfileAcquired(obj, sample, NO, 0);
+	}
+    }
+  else
+    {
+      status = pthread_mutex_lock(&node->lock);
+    }
+  if (0 != status)
     {
       return OBJC_SYNC_NOT_OWNING_THREAD_ERROR;
     }
 
+  if (NULL != slot)
+    {
+      slot->obj = obj;
+      slot->node = node;
+      slot->count = 1;
+    }
   return OBJC_SYNC_SUCCESS;
 }
 
@@ -196,34 +299,54 @@ objc_sync_enter(id obj)
 int
 objc_sync_exit(id obj)
 {
-  lock_node_t *node = NULL;
-  int status = 0;
-
-  // lock access to the table until we're done....
-  sync_lock_init();
-  objc_mutex_lock(table_lock);
+  lock_node_t	*node = NULL;
+  lock_held_t	*held;
+  unsigned	i;
 
-  node = sync_find_node(obj);
-  if (node == NULL)
+  if (nil == obj)
     {
-      // unlock the table....
-      objc_mutex_unlock(table_lock);  
-      return OBJC_SYNC_NOT_INITIALIZED;
+      return OBJC_SYNC_SUCCESS;
     }
+  pthread_once(&syncOnce, sync_init);
 
-  status = objc_mutex_unlock(node->lock);
+  held = sync_held(NO);
+  if (NULL != held)
+    {
+      for (i = 0; i < SYNC_CACHE; i++)
+	{
+	  if (held[i].obj == obj)
+	    {
+	      if (--held[i].count > 0)
+		{
+		  return OBJC_SYNC_SUCCESS;
+		}
+	      node = held[i].node;
+	      held[i].obj = nil;
+	      held[i].node = NULL;
+	      break;
+	    }
+	}
+    }
 
-  // unlock the table....
-  objc_mutex_unlock(table_lock);  
+  if (NULL == node)
+    {
+      node = sync_find_node(obj);
+      if (NULL == node)
+	{
+	  return OBJC_SYNC_NOT_INITIALIZED;
+	}
+    }
 
-  // if the status is not zero, then we are not the sole
-  // owner of this node.  Also if -1 is returned, this indicates and error
-  // condition.
-  if (status > 0 || status == -1)
+  if (GSPrivateLockProfiling > 0)
+    {
+      GSPrivateLockProfileReleased(obj);
+    }
+  /* The mutex is recursive, so unlocking fails if this thread does not
+   * hold it.
+   */
+  if (0 != pthread_mutex_unlock(&node->lock))
     {
       return OBJC_SYNC_NOT_OWNING_THREAD_ERROR;      
     }
- 
   return OBJC_SYNC_SUCCESS;  
 }
-
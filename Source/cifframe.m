@@ -39,6 +39,9 @@
 #include <alloca.h>
 #endif
 
+#include <ctype.h>
+#include <pthread.h>
+
 #include "cifframe.h"
 #import "Foundation/NSException.h"
 #import "Foundation/NSData.h"
@@ -94,6 +97,157 @@
 
 ffi_type *cifframe_type(const char *typePtr, const char **advance);
 
+/* Prepared frames and closures are kept in a table keyed by the type
+ * encoding of the method signature (and by the callback function in the
+ * case of a closure), so that the ffi types are built and ffi_prep_cif()
+ * is called only once for each distinct layout.  Encodings which differ
+ * only in qualifiers, offsets or structure names share an entry, but the
+ * lengths of arrays and widths of bitfields are part of the layout.
+ * Entries are never removed (a closure may be in use by any thread once
+ * its address has been handed out), so lookups need no lock and the
+ * lock is only taken to add an entry.
+ */
+typedef struct cifframe_entry {
+  struct cifframe_entry	*next;
+  unsigned		hash;
+  void			(*func)();
+  char			*types;
+  id			value;	/* Template frame or closure */
+} cifframe_entry;
+
+#define	CIFFRAME_BUCKETS	256
+
+static cifframe_entry * volatile	cache[CIFFRAME_BUCKETS];
+static pthread_mutex_t		cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Returns the next character of an encoding which matters to the layout
+ * of a frame and advances *ref past it, or returns nul at the end.
+ * Qualifiers, offsets and structure names are skipped, but the digits
+ * after '[' (the array length) and 'b' (the bit position and, in the GNU
+ * encoding, the type and width which follow it) are kept.
+ * The state is zero at the start of an encoding.
+ */
+static char
+cifframe_next(const char **ref, int *state)
+{
+  const char	*t = *ref;
+  char		c;
+
+  if (*state != 0 && isdigit((unsigned char)*t))
+    {
+      c = *t++;
+    }
+  else if (*state == _C_BFLD && *t != '\0' && *t != _C_STRUCT_E
+    && *t != _C_UNION_E && *t != _C_ARY_E && isdigit((unsigned char)t[1]))
+    {
+      c = *t++;		/* Type of a GNU bitfield, followed by its width */
+      *state = _C_ARY_B;
+    }
+  else
+    {
+      *state = 0;
+      t = GSSkipTypeQualifierAndLayoutInfo(t);
+      c = *t;
+      if (c == _C_STRUCT_B)
+	{
+	  t++;
+	  while (*t != '=' && *t != _C_STRUCT_E && *t != '\0')
+	    {
+	      t++;
+	    }
+	}
+      else if (c != '\0')
+	{
+	  t++;
+	  if (c == _C_ARY_B || c == _C_BFLD)
+	    {
+	      *state = c;
+	    }
+	}
+    }
+  *ref = t;
+  return c;
+}
+
+static unsigned
+cifframe_hash(const char *types)
+{
+  unsigned	hash = 0;
+  int		state = 0;
+  char		c;
+
+  while ((c = cifframe_next(&types, &state)) != '\0')
+    {
+      hash = (hash << 5) + hash + c;
+    }
+  return hash;
+}
+
+static BOOL
+cifframe_match(const char *types1, const char *types2)
+{
+  int		state1 = 0;
+  int		state2 = 0;
+  char		c;
+
+  do
+    {
+      c = cifframe_next(&types1, &state1);
+      if (c != cifframe_next(&types2, &state2))
+	{
+	  return NO;
+	}
+    }
+  while (c != '\0');
+  return YES;
+}
+
+static id
+cifframe_lookup(const char *types, unsigned hash, void (*func)())
+{
+  cifframe_entry	*e = cache[hash % CIFFRAME_BUCKETS];
+
+  while (e != 0)
+    {
+      if (e->hash == hash && e->func == func
+	&& cifframe_match(e->types, types))
+	{
+	  return e->value;
+	}
+      e = e->next;
+    }
+  return nil;
+}
+
+/* Adds a value to the table unless another thread has added an
+ * equivalent one meanwhile, and returns the value which is in the table.
+ */
+static id
+cifframe_insert(const char *types, unsigned hash, void (*func)(), id value)
+{
+  id	found;
+
+  pthread_mutex_lock(&cacheLock);
+  found = cifframe_lookup(types, hash, func);
+  if (nil == found)
+    {
+      cifframe_entry	*e = malloc(sizeof(cifframe_entry));
+
+      e->hash = hash;
+      e->func = func;
+      e->types = strdup(types);
+      e->value = RETAIN(value);
+      e->next = cache[hash % CIFFRAME_BUCKETS];
+      /* Make sure the entry is complete before it can be seen.
+       */
+      __sync_synchronize();
+      cache[hash % CIFFRAME_BUCKETS] = e;
+      found = value;
+    }
+  pthread_mutex_unlock(&cacheLock);
+  return found;
+}
+
 /* Best guess at the space needed for a structure, since we don't know
    for sure until it's calculated in ffi_prep_cif, which is too late */
 int
@@ -124,8 +278,8 @@ cifframe_guess_struct_size(ffi_type *stype)
 }
 
 
-NSMutableData *
-cifframe_from_signature (NSMethodSignature *info)
+static NSMutableData *
+cifframe_build (NSMethodSignature *info)
 {
   unsigned      size = sizeof(cifframe_t);
   unsigned      align = __alignof(double);
@@ -139,10 +293,10 @@ cifframe_from_signature (NSMethodSignature *info)
   ffi_type      *arg_types[numargs];
   cifframe_t    *cframe;
 
-  /* FIXME: in cifframe_type, return values/arguments that are structures
-     have custom ffi_types with are allocated separately. We should allocate
-     them in our cifframe so we don't leak memory. Or maybe we could
-     cache structure types? */
+  /* In cifframe_type, return values/arguments that are structures
+     have custom ffi_types which are allocated separately.  They are
+     never freed, but since the frame built here is cached that happens
+     only once for each distinct signature. */
   rtype = cifframe_type([info methodReturnType], NULL);
   for (i = 0; i < numargs; i++)
     {
@@ -224,6 +378,66 @@ cifframe_from_signature (NSMethodSignature *info)
   return result;
 }
 
+/* Returns the prepared frame for the signature, which is shared and must
+ * not be modified.
+ */
+static NSMutableData *
+cifframe_template (NSMethodSignature *info)
+{
+  const char	*types = [info methodType];
+  unsigned	hash = cifframe_hash(types);
+  NSMutableData	*frame;
+
+  frame = cifframe_lookup(types, hash, 0);
+  if (nil == frame)
+    {
+      frame = cifframe_build(info);
+      if (nil != frame)
+	{
+	  frame = cifframe_insert(types, hash, 0, frame);
+	}
+    }
+  return frame;
+}
+
+NSMutableData *
+cifframe_copy (NSMutableData *frame)
+{
+  NSMutableData	*copy;
+  cifframe_t	*from;
+  cifframe_t	*to;
+  int		i;
+
+  if (nil == frame)
+    {
+      return nil;
+    }
+  copy = [NSMutableData dataWithBytes: [frame bytes] length: [frame length]];
+  from = (cifframe_t*)[frame bytes];
+  to = (cifframe_t*)[copy mutableBytes];
+
+  /* The copy has the same layout, so its pointers into itself must be
+   * moved by the same distance as the frame.
+   */
+  if (to->nargs > 0)
+    {
+      to->arg_types = (void*)to + ((void*)from->arg_types - (void*)from);
+      to->cif.arg_types = to->arg_types;
+      to->values = (void*)to + ((void*)from->values - (void*)from);
+      for (i = 0; i < to->nargs; i++)
+	{
+	  to->values[i] = (void*)to + (from->values[i] - (void*)from);
+	}
+    }
+  return copy;
+}
+
+NSMutableData *
+cifframe_from_signature (NSMethodSignature *info)
+{
+  return cifframe_copy(cifframe_template(info));
+}
+
 void
 cifframe_set_arg(cifframe_t *cframe, int index, void *buffer, int size)
 {
@@ -557,19 +771,34 @@ cifframe_type(const char *typePtr, const char **advance)
   return ftype;
 }
 
+GSCodeBuffer*
+cifframe_cached_closure (const char *types, void (*cb)())
+{
+  return cifframe_lookup(types, cifframe_hash(types), cb);
+}
+
 GSCodeBuffer*
 cifframe_closure (NSMethodSignature *sig, void (*cb)())
 {
+  const char		*types = [sig methodType];
+  unsigned		hash = cifframe_hash(types);
   NSMutableData		*frame;
   cifframe_t            *cframe;
   ffi_closure           *cclosure;
   void			*executable;
   GSCodeBuffer          *memory;
 
-  /* Construct the frame (stored in an NSMutableDate object) and sety it
-   * in a new closure.
+  memory = cifframe_lookup(types, hash, cb);
+  if (nil != memory)
+    {
+      return memory;
+    }
+
+  /* Set the shared frame (stored in an NSMutableData object) in a new
+   * closure.  The callback gets the frame as its user data and must copy
+   * it rather than changing it.
    */
-  frame = cifframe_from_signature(sig);
+  frame = cifframe_template(sig);
   cframe = [frame mutableBytes];
   memory = [GSCodeBuffer memoryWithSize: sizeof(ffi_closure)];
   [memory setFrame: frame];
@@ -594,7 +823,7 @@ cifframe_closure (NSMethodSignature *sig, void (*cb)())
     }
 #endif
   [memory protect];
-  return memory;
+  return cifframe_insert(types, hash, cb, memory);
 }
 
 /*-------------------------------------------------------------------------*/
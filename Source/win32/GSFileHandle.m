@@ -1804,6 +1804,16 @@ NSString * const GSSOCKSRecvAddr = @"GSSOCKSRecvAddr";
   return NO;
 }
 
+/* Abandons any background read without posting a notification.  This
+ * must be called in the thread whose run loop is watching for the read.
+ */
+- (void) cancelRead
+{
+  [self ignoreReadDescriptor];
+  DESTROY(readInfo);
+  readMax = 0;
+}
+
 - (void) ignoreReadDescriptor
 {
   NSRunLoop	*l;
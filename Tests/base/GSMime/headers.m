@@ -0,0 +1,117 @@
+#if     defined(GNUSTEP_BASE_LIBRARY)
+#import <Foundation/Foundation.h>
+#import <GNUstepBase/GSMime.h>
+#import "Testing.h"
+
+static GSMimeDocument	*shared = nil;
+static NSCondition	*cond = nil;
+static unsigned		running = 0;
+static BOOL		mismatch = NO;
+
+@interface	Looker : NSObject
++ (void) run: (id)ignored;
+@end
+@implementation	Looker
++ (void) run: (id)ignored
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  unsigned		i;
+
+  for (i = 0; i < 10000; i++)
+    {
+      if (NO == [[[shared headerNamed: @"Subject"] value] isEqual: @"hello"]
+	|| nil != [shared headerNamed: @"x-missing"])
+	{
+	  mismatch = YES;
+	}
+    }
+  [cond lock];
+  running--;
+  [cond broadcast];
+  [cond unlock];
+  [arp release];
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool   *arp = [NSAutoreleasePool new];
+  GSMimeDocument        *doc;
+  GSMimeDocument        *copy;
+  GSMimeHeader          *h1;
+  GSMimeHeader          *h2;
+  GSMimeHeader          *h3;
+  unsigned              i;
+
+  doc = [GSMimeDocument new];
+  PASS([doc headerNamed: @"x-test"] == nil, "no header in empty document")
+  PASS([[doc headersNamed: @"x-test"] count] == 0,
+    "no headers in empty document")
+
+  h1 = [doc addHeader: @"X-Test" value: @"one" parameters: nil];
+  h2 = [doc addHeader: @"Received" value: @"two" parameters: nil];
+  h3 = [doc addHeader: @"x-test" value: @"three" parameters: nil];
+  PASS_EQUAL([h1 name], @"x-test", "header name is lowercase")
+  PASS_EQUAL([h1 namePreservingCase: YES], @"X-Test",
+    "header name case is preserved")
+  PASS_EQUAL([h2 name], @"received", "well known header name is lowercase")
+  PASS([doc headerNamed: @"X-TEST"] == h1, "lookup is case insensitive")
+  PASS([doc headerNamed: @"x-test"] == h1, "lookup finds first header")
+  PASS([doc headerNamed: @"RECEIVED"] == h2, "lookup finds well known name")
+  PASS([[doc headersNamed: @"X-Test"] count] == 2, "finds all headers")
+  PASS([[doc headersNamed: @"X-Test"] lastObject] == h3,
+    "headers are found in order")
+
+  [doc deleteHeader: h1];
+  PASS([doc headerNamed: @"x-test"] == h3, "deletion exposes later header")
+  h1 = [doc addHeader: @"X-Test" value: @"four" parameters: nil];
+  PASS([doc headerNamed: @"x-test"] == h3, "addition keeps first header")
+
+  copy = [doc copy];
+  PASS([[copy headerNamed: @"x-test"] isEqual: h3], "copy finds header")
+  [copy release];
+
+  [doc deleteHeaderNamed: @"X-TEST"];
+  PASS([doc headerNamed: @"x-test"] == nil, "deletion by name works")
+  PASS([doc headerNamed: @"received"] == h2, "other headers unaffected")
+
+  h1 = [doc setHeader: @"Subject" value: @"first" parameters: nil];
+  h3 = [doc setHeader: @"subject" value: @"second" parameters: nil];
+  PASS([doc headerNamed: @"Subject"] == h3, "set header replaces header")
+  PASS([[doc headersNamed: @"subject"] count] == 1, "only one subject")
+  h1 = [doc addHeader: @"Subject" value: @"third" parameters: nil];
+  PASS([doc headerNamed: @"subject"] == h1, "add subject replaces header")
+  [doc release];
+
+  /* Looking headers up does not modify a document, so a parsed document
+   * may be shared between threads which only look.
+   */
+  shared = [GSMimeParser documentFromData:
+    [@"Subject: hello\r\nX-Test: one\r\n\r\nbody"
+      dataUsingEncoding: NSASCIIStringEncoding]];
+  cond = [NSCondition new];
+  running = 4;
+  for (i = 0; i < 4; i++)
+    {
+      [NSThread detachNewThreadSelector: @selector(run:)
+			       toTarget: [Looker class]
+			     withObject: nil];
+    }
+  [cond lock];
+  while (running > 0)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  PASS(NO == mismatch, "headers of a shared document are found by threads")
+  [cond release];
+
+  [arp release]; arp = nil;
+  return 0;
+}
+#else
+int main(int argc,char **argv)
+{
+  return 0;
+}
+#endif
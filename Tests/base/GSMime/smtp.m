@@ -0,0 +1,382 @@
+#if     defined(GNUSTEP_BASE_LIBRARY)
+#import <Foundation/Foundation.h>
+#import <GNUstepBase/GSMime.h>
+#import "Testing.h"
+
+/* A minimal SMTP server used to check the behavior of the client.
+ * If holdUntil is non-zero, replies to mail transaction commands are
+ * withheld until that many message bodies have been received, so the
+ * client can only complete if it pipelines its commands.
+ * A RCPT naming the reject address is refused, and so is the body of
+ * the message it belongs to, as a real server would.
+ */
+@interface      SMTPServer : NSObject
+{
+@public
+  NSFileHandle          *listener;
+  NSFileHandle          *conn;
+  NSString              *port;
+  NSString              *reject;
+  NSMutableData         *ibuf;
+  NSMutableData         *body;
+  NSMutableData         *held;
+  NSMutableArray        *commands;
+  NSMutableArray        *bodies;
+  NSUInteger            want;
+  NSUInteger            holdUntil;
+  BOOL                  extensions;
+  BOOL                  rejected;
+}
+@end
+
+@implementation SMTPServer
+- (void) accept: (NSNotification*)n
+{
+  ASSIGN(conn, [[n userInfo] objectForKey:
+    NSFileHandleNotificationFileHandleItem]);
+  [ibuf setLength: 0];
+  DESTROY(body);
+  want = 0;
+  [[NSNotificationCenter defaultCenter] addObserver: self
+    selector: @selector(read:)
+    name: NSFileHandleReadCompletionNotification
+    object: conn];
+  [conn readInBackgroundAndNotify];
+  [conn writeData: [@"220 localhost ready\r\n"
+    dataUsingEncoding: NSASCIIStringEncoding]];
+  [listener acceptConnectionInBackgroundAndNotify];
+}
+- (void) dealloc
+{
+  [[NSNotificationCenter defaultCenter] removeObserver: self];
+  [listener release];
+  [conn release];
+  [port release];
+  [reject release];
+  [ibuf release];
+  [body release];
+  [held release];
+  [commands release];
+  [bodies release];
+  [super dealloc];
+}
+- (id) init
+{
+  if ((self = [super init]) != nil)
+    {
+      ibuf = [NSMutableData new];
+      held = [NSMutableData new];
+      commands = [NSMutableArray new];
+      bodies = [NSMutableArray new];
+      listener = [[NSFileHandle fileHandleAsServerAtAddress: @"127.0.0.1"
+                                                    service: @"0"
+                                                   protocol: @"tcp"] retain];
+      port = [[listener socketLocalService] retain];
+      [[NSNotificationCenter defaultCenter] addObserver: self
+        selector: @selector(accept:)
+        name: NSFileHandleConnectionAcceptedNotification
+        object: listener];
+      [listener acceptConnectionInBackgroundAndNotify];
+    }
+  return self;
+}
+- (void) reply: (NSString*)s
+{
+  [held appendData: [s dataUsingEncoding: NSASCIIStringEncoding]];
+  if (holdUntil <= [bodies count])
+    {
+      [conn writeData: held];
+      [held setLength: 0];
+    }
+}
+- (void) send: (NSString*)s
+{
+  [conn writeData: [s dataUsingEncoding: NSASCIIStringEncoding]];
+}
+- (void) process
+{
+  for (;;)
+    {
+      const char        *b = [ibuf bytes];
+      NSUInteger        l = [ibuf length];
+      NSUInteger        i;
+      NSString          *line;
+
+      if (want > 0)
+        {
+          if (l < want)
+            {
+              return;
+            }
+          [bodies addObject: [ibuf subdataWithRange: NSMakeRange(0, want)]];
+          [ibuf replaceBytesInRange: NSMakeRange(0, want)
+                          withBytes: 0
+                             length: 0];
+          want = 0;
+          if (YES == rejected)
+            {
+              rejected = NO;
+              [self reply: @"554 no valid recipients\r\n"];
+            }
+          else
+            {
+              [self reply: @"250 OK\r\n"];
+            }
+          continue;
+        }
+      for (i = 0; i + 1 < l; i++)
+        {
+          if (b[i] == '\r' && b[i+1] == '\n')
+            {
+              break;
+            }
+        }
+      if (i + 1 >= l)
+        {
+          return;
+        }
+      line = [[[NSString alloc] initWithBytes: b
+                                       length: i
+                                     encoding: NSASCIIStringEncoding]
+        autorelease];
+      [ibuf replaceBytesInRange: NSMakeRange(0, i + 2)
+                      withBytes: 0
+                         length: 0];
+      if (body != nil)
+        {
+          if ([line isEqual: @"."])
+            {
+              [bodies addObject: body];
+              DESTROY(body);
+              [self reply: @"250 OK\r\n"];
+            }
+          else
+            {
+              if ([line hasPrefix: @"."])
+                {
+                  line = [line substringFromIndex: 1];
+                }
+              [body appendData:
+                [line dataUsingEncoding: NSASCIIStringEncoding]];
+              [body appendBytes: "\r\n" length: 2];
+            }
+          continue;
+        }
+      [commands addObject: line];
+      if ([line hasPrefix: @"EHLO"])
+        {
+          if (YES == extensions)
+            {
+              [self send: @"250-localhost\r\n250-PIPELINING\r\n"
+                @"250 CHUNKING\r\n"];
+            }
+          else
+            {
+              [self send: @"250 localhost\r\n"];
+            }
+        }
+      else if ([line hasPrefix: @"MAIL"])
+        {
+          rejected = NO;
+          [self reply: @"250 OK\r\n"];
+        }
+      else if ([line hasPrefix: @"RCPT"] && reject != nil
+        && [line rangeOfString: reject].length > 0)
+        {
+          rejected = YES;
+          [self reply: @"550 no such user\r\n"];
+        }
+      else if ([line hasPrefix: @"DATA"])
+        {
+          if (YES == rejected)
+            {
+              rejected = NO;
+              [self reply: @"554 no valid recipients\r\n"];
+            }
+          else
+            {
+              body = [NSMutableData new];
+              [self reply: @"354 go ahead\r\n"];
+            }
+        }
+      else if ([line hasPrefix: @"BDAT"])
+        {
+          want = [[[line componentsSeparatedByString: @" "]
+            objectAtIndex: 1] intValue];
+        }
+      else if ([line hasPrefix: @"QUIT"])
+        {
+          [self send: @"221 bye\r\n"];
+        }
+      else
+        {
+          [self reply: @"250 OK\r\n"];
+        }
+    }
+}
+- (void) read: (NSNotification*)n
+{
+  NSData        *d;
+
+  d = [[n userInfo] objectForKey: NSFileHandleNotificationDataItem];
+  if ([d length] > 0)
+    {
+      [ibuf appendData: d];
+      [self process];
+      [conn readInBackgroundAndNotify];
+    }
+}
+@end
+
+@interface      Delegate : NSObject
+{
+@public
+  NSUInteger    sent;
+  NSUInteger    failed;
+  NSString      *failedTo;
+}
+@end
+
+@implementation Delegate
+- (void) dealloc
+{
+  [failedTo release];
+  [super dealloc];
+}
+- (void) smtpClient: (GSMimeSMTPClient*)client
+	 mimeFailed: (GSMimeDocument*)doc
+{
+  ASSIGN(failedTo, [[doc headerNamed: @"To"] value]);
+  failed++;
+}
+- (void) smtpClient: (GSMimeSMTPClient*)client
+	   mimeSent: (GSMimeDocument*)doc
+{
+  sent++;
+}
+@end
+
+static GSMimeDocument *
+messageTo(NSString *to, NSString *text)
+{
+  GSMimeDocument        *doc = [[GSMimeDocument new] autorelease];
+
+  [doc setHeader: @"From" value: @"sender@localhost" parameters: nil];
+  [doc setHeader: @"To" value: to parameters: nil];
+  [doc setHeader: @"Subject" value: @"test" parameters: nil];
+  [doc setContent: text type: @"text/plain"];
+  return doc;
+}
+
+static GSMimeDocument *
+message(NSString *text)
+{
+  return messageTo(@"recipient@localhost", text);
+}
+
+/* Returns the number of commands starting with the prefix.
+ */
+static NSUInteger
+count(NSArray *commands, NSString *prefix)
+{
+  NSEnumerator  *e = [commands objectEnumerator];
+  NSString      *s;
+  NSUInteger    n = 0;
+
+  while ((s = [e nextObject]) != nil)
+    {
+      if ([s hasPrefix: prefix])
+        {
+          n++;
+        }
+    }
+  return n;
+}
+
+static NSString *
+text(NSData *d)
+{
+  return [[GSMimeParser documentFromData: d] convertToText];
+}
+
+int main()
+{
+  NSAutoreleasePool     *arp = [NSAutoreleasePool new];
+  NSDate                *limit;
+  SMTPServer            *server;
+  GSMimeSMTPClient      *client;
+  Delegate              *delegate;
+
+  server = [[SMTPServer new] autorelease];
+  delegate = [[Delegate new] autorelease];
+
+  /* A server supporting pipelining and chunking only replies once it has
+   * all three messages, so this only completes if the client pipelines.
+   */
+  server->extensions = YES;
+  server->holdUntil = 3;
+  client = [[GSMimeSMTPClient new] autorelease];
+  [client setDelegate: delegate];
+  [client setHostname: @"127.0.0.1"];
+  [client setPort: server->port];
+  [client send: message(@"first")];
+  [client send: message(@"second")];
+  [client send: message(@"third")];
+  limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+  PASS([client flush: limit], "pipelined messages are sent")
+  PASS(delegate->sent == 3 && delegate->failed == 0,
+    "delegate told of pipelined messages")
+  PASS([server->commands containsObject: @"DATA"] == NO,
+    "chunking server is not sent DATA")
+  PASS([server->bodies count] == 3, "server received three bodies")
+  PASS_EQUAL(text([server->bodies objectAtIndex: 1]), @"second",
+    "BDAT body is intact")
+
+  /* A recipient refused while the commands for the following message
+   * are already in flight fails only its own message.
+   */
+  [server->commands removeAllObjects];
+  [server->bodies removeAllObjects];
+  ASSIGN(server->reject, @"nobody@localhost");
+  delegate->sent = 0;
+  [client send: message(@"before")];
+  [client send: messageTo(@"nobody@localhost", @"refused")];
+  [client send: message(@"after")];
+  limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+  PASS([client flush: limit], "pipeline with a refused recipient completes")
+  PASS(delegate->sent == 2 && delegate->failed == 1,
+    "delegate told of one failed and two sent messages")
+  PASS_EQUAL(delegate->failedTo, @"nobody@localhost",
+    "the message with the refused recipient is the one which failed")
+  PASS(count(server->commands, @"EHLO") == 0
+    && count(server->commands, @"MAIL") == 3,
+    "the connection is kept open after the refusal")
+  DESTROY(server->reject);
+
+  /* A server without extensions gets one command at a time and the
+   * body escaped and sent after DATA.
+   */
+  [server->commands removeAllObjects];
+  [server->bodies removeAllObjects];
+  server->extensions = NO;
+  server->holdUntil = 0;
+  delegate->sent = 0;
+  delegate->failed = 0;
+  [client send: message(@"line\r\n.dot line")];
+  limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+  PASS([client flush: limit], "plain message is sent")
+  PASS(delegate->sent == 1, "delegate told of plain message")
+  PASS([server->commands containsObject: @"DATA"], "plain server gets DATA")
+  PASS([server->bodies count] == 1, "server received body")
+  PASS([text([server->bodies lastObject]) hasPrefix: @"line\r\n.dot line"],
+    "DATA body is unescaped by the server")
+
+  [arp release]; arp = nil;
+  return 0;
+}
+#else
+int main(int argc,char **argv)
+{
+  return 0;
+}
+#endif
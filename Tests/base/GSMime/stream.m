@@ -0,0 +1,137 @@
+#if     defined(GNUSTEP_BASE_LIBRARY)
+#import <Foundation/Foundation.h>
+#import <GNUstepBase/GSMime.h>
+#import "Testing.h"
+
+@interface      Collector : NSObject
+{
+@public
+  NSMutableArray        *parts;
+  NSMutableArray        *bodies;
+  NSUInteger            headers;
+  GSMimeParser          *seen;
+}
+@end
+
+@implementation Collector
+- (void) dealloc
+{
+  [parts release];
+  [bodies release];
+  [super dealloc];
+}
+- (id) init
+{
+  if ((self = [super init]) != nil)
+    {
+      parts = [NSMutableArray new];
+      bodies = [NSMutableArray new];
+    }
+  return self;
+}
+- (void) mimeParser: (GSMimeParser*)parser
+        headersDone: (GSMimeDocument*)part
+{
+  seen = parser;
+  headers++;
+}
+- (void) mimeParser: (GSMimeParser*)parser
+	       part: (GSMimeDocument*)part
+	    addData: (NSData*)data
+{
+  if ([parts lastObject] != part)
+    {
+      [parts addObject: part];
+      [bodies addObject: [NSMutableData data]];
+    }
+  [[bodies lastObject] appendData: data];
+}
+- (void) mimeParser: (GSMimeParser*)parser
+           partDone: (GSMimeDocument*)part
+{
+  if (NO == [parts containsObject: part] && [part contentType] != nil
+    && NO == [[part contentType] isEqual: @"multipart"])
+    {
+      [parts addObject: part];
+      [bodies addObject: [NSMutableData data]];
+    }
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool   *arp = [NSAutoreleasePool new];
+  NSStringEncoding      enc = NSASCIIStringEncoding;
+  NSString              *raw;
+  NSData                *data;
+  NSUInteger            pos;
+  GSMimeParser          *parser;
+  GSMimeDocument        *doc;
+  Collector             *c;
+
+  raw = @"Content-Type: multipart/mixed; boundary=\"XyZ\"\r\n"
+    @"\r\n"
+    @"preamble\r\n"
+    @"--XyZ\r\n"
+    @"Content-Type: application/octet-stream\r\n"
+    @"Content-Transfer-Encoding: base64\r\n"
+    @"\r\n"
+    @"Zm9vYmFyYmF6cXV4Zm9vYmFyYmF6cXV4Zm9vYmFyYmF6cXV4\r\n"
+    @"Zm9vYmFyYmF6cXV4\r\n"
+    @"--XyZ\r\n"
+    @"Content-Type: text/plain\r\n"
+    @"\r\n"
+    @"line one\r\n"
+    @"-- not a boundary\r\n"
+    @"line three\r\n"
+    @"--XyZ--\r\n";
+  data = [raw dataUsingEncoding: enc];
+
+  /* Parse the document in small pieces so that parts are split across
+   * many calls, collecting the streamed data.
+   */
+  c = [Collector new];
+  parser = [GSMimeParser mimeParser];
+  [parser setDelegate: c];
+  PASS([parser delegate] == c, "parser delegate can be set");
+  for (pos = 0; pos < [data length]; pos += 3)
+    {
+      NSUInteger        l = [data length] - pos;
+
+      if (l > 3) l = 3;
+      [parser parse: [data subdataWithRange: NSMakeRange(pos, l)]];
+    }
+  [parser parse: nil];
+
+  PASS([parser isComplete], "streamed multipart document is complete");
+  PASS(c->seen == parser, "callbacks identify the top level parser");
+  PASS(c->headers == 3, "headers reported for document and both parts");
+  PASS([c->bodies count] == 2, "both parts streamed");
+  PASS_EQUAL([c->bodies objectAtIndex: 0],
+    [@"foobarbazquxfoobarbazquxfoobarbazquxfoobarbazqux"
+    dataUsingEncoding: enc], "base64 part decoded while streaming")
+  PASS_EQUAL([c->bodies objectAtIndex: 1],
+    [@"line one\r\n-- not a boundary\r\nline three" dataUsingEncoding: enc],
+    "text part streamed without the boundary")
+  PASS([[[parser mimeDocument] content] count] == 0,
+    "streamed parts are not retained in the document")
+
+  /* The same document parsed normally gives the same part contents.
+   */
+  doc = [GSMimeParser documentFromData: data];
+  PASS_EQUAL([[[doc content] objectAtIndex: 0] content],
+    [c->bodies objectAtIndex: 0], "non-streamed parse matches (data)")
+  PASS_EQUAL([[[doc content] objectAtIndex: 1] content],
+    @"line one\r\n-- not a boundary\r\nline three",
+    "non-streamed parse matches (text)")
+  [c release];
+
+  [arp release]; arp = nil;
+  return 0;
+}
+#else
+int main(int argc,char **argv)
+{
+  return 0;
+}
+#endif
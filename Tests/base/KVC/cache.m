@@ -0,0 +1,92 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSKeyValueCoding.h>
+#import <Foundation/NSValue.h>
+
+@interface CacheTest : NSObject
+{
+  NSString	*name;
+  int		count;
+  double	ratio;
+  char		flag;
+  unsigned long long	big;
+}
+- (int) count;
+- (void) setCount: (int)c;
+@end
+
+@implementation CacheTest
+- (int) count
+{
+  return count;
+}
+- (void) setCount: (int)c
+{
+  count = c + 1;
+}
+- (void) dealloc
+{
+  [name release];
+  [super dealloc];
+}
+@end
+
+@interface CacheTestSub : CacheTest
+@end
+
+@implementation CacheTestSub
+- (int) count
+{
+  return -count;
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  CacheTest		*t = [[CacheTest new] autorelease];
+  CacheTestSub		*s = [[CacheTestSub new] autorelease];
+  BOOL			ok;
+  int			i;
+
+  ok = YES;
+  for (i = 0; i < 100; i++)
+    {
+      [t setValue: [NSNumber numberWithInt: i] forKey: @"count"];
+      [t setValue: [NSNumber numberWithDouble: i / 2.0] forKey: @"ratio"];
+      [t setValue: [NSNumber numberWithChar: (char)i] forKey: @"flag"];
+      [t setValue: [NSNumber numberWithUnsignedLongLong: 1ULL << 40]
+	   forKey: @"big"];
+      [t setValue: [NSString stringWithFormat: @"%d", i] forKey: @"name"];
+      if ([[t valueForKey: @"count"] intValue] != i + 1
+	|| [[t valueForKey: @"ratio"] doubleValue] != i / 2.0
+	|| [[t valueForKey: @"flag"] charValue] != (char)i
+	|| [[t valueForKey: @"big"] unsignedLongLongValue] != 1ULL << 40
+	|| [[t valueForKey: @"name"] intValue] != i)
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "repeated access through methods and variables works")
+
+  [s setValue: [NSNumber numberWithInt: 4] forKey: @"count"];
+  PASS([[s valueForKey: @"count"] intValue] == -5,
+    "a subclass uses its own accessor")
+  PASS([[t valueForKey: @"count"] intValue] == 100,
+    "the superclass still uses its accessor")
+
+  PASS_EXCEPTION([t valueForKey: @"missing"],
+    NSUndefinedKeyException, "an undefined key raises")
+  PASS_EXCEPTION([t valueForKey: @"missing"],
+    NSUndefinedKeyException, "an undefined key raises when repeated")
+  PASS_EXCEPTION([t setValue: @"x" forKey: @"missing"],
+    NSUndefinedKeyException, "setting an undefined key raises when repeated")
+  PASS_EXCEPTION([t setValue: nil forKey: @"count"],
+    NSInvalidArgumentException, "setting a scalar to nil raises")
+  PASS_EXCEPTION([t setValue: nil forKey: @"count"],
+    NSInvalidArgumentException, "setting a scalar to nil raises when repeated")
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,157 @@
+#import "Testing.h"
+#import <Foundation/NSArray.h>
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSIndexSet.h>
+#import <Foundation/NSLock.h>
+#import <Foundation/NSSet.h>
+#import <Foundation/NSValue.h>
+
+int main()
+{
+  START_SET("concurrent enumeration")
+# ifndef __has_feature
+# define __has_feature(x) 0
+# endif
+# if __has_feature(blocks)
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableArray	*array = [NSMutableArray array];
+  NSMutableDictionary	*dict = [NSMutableDictionary dictionary];
+  NSMutableIndexSet	*indexes = [NSMutableIndexSet indexSet];
+  NSLock		*lock = [[NSLock new] autorelease];
+  __block NSUInteger	visits = 0;
+  __block NSUInteger	sum = 0;
+  __block BOOL		indexOk = YES;
+  NSUInteger		i;
+
+  for (i = 0; i < 10000; i++)
+    {
+      NSNumber	*n = [NSNumber numberWithUnsignedInteger: i];
+
+      [array addObject: n];
+      [dict setObject: n forKey: [NSString stringWithFormat: @"%lu",
+	(unsigned long)i]];
+    }
+  [indexes addIndexesInRange: NSMakeRange(5, 1000)];
+  [indexes addIndexesInRange: NSMakeRange(2000, 3000)];
+  [indexes addIndex: 9000];
+
+  [array enumerateObjectsWithOptions: NSEnumerationConcurrent
+			  usingBlock: ^(id obj, NSUInteger idx, BOOL *stop) {
+    [lock lock];
+    visits++;
+    sum += [obj unsignedIntegerValue];
+    if ([obj unsignedIntegerValue] != idx)
+      {
+	indexOk = NO;
+      }
+    [lock unlock];
+  }];
+  PASS(visits == 10000 && sum == 49995000 && indexOk,
+    "concurrent array enumeration visits every object once with its index")
+
+  visits = 0;
+  [array enumerateObjectsWithOptions: NSEnumerationConcurrent
+			  usingBlock: ^(id obj, NSUInteger idx, BOOL *stop) {
+    [lock lock];
+    visits++;
+    [lock unlock];
+    *stop = YES;
+  }];
+  PASS(visits < 10000, "concurrent array enumeration can be stopped")
+
+  PASS_EXCEPTION([array enumerateObjectsWithOptions: NSEnumerationConcurrent
+    usingBlock: ^(id obj, NSUInteger idx, BOOL *stop) {
+      if (idx == 5000)
+	{
+	  [NSException raise: NSGenericException format: @"stop here"];
+	}
+    }], NSGenericException,
+    "an exception raised by a concurrent block reaches the caller")
+  PASS_EXCEPTION([dict enumerateKeysAndObjectsWithOptions:
+    NSEnumerationConcurrent usingBlock: ^(id key, id obj, BOOL *stop) {
+      if ([key intValue] == 5000)
+	{
+	  [NSException raise: NSGenericException format: @"stop here"];
+	}
+    }], NSGenericException,
+    "an exception raised by a concurrent dictionary block reaches the caller")
+
+  visits = 0;
+  sum = 0;
+  [[NSSet setWithArray: array] enumerateObjectsWithOptions:
+    NSEnumerationConcurrent usingBlock: ^(id obj, BOOL *stop) {
+    [lock lock];
+    visits++;
+    sum += [obj unsignedIntegerValue];
+    [lock unlock];
+  }];
+  PASS(visits == 10000 && sum == 49995000,
+    "concurrent set enumeration visits every object once")
+
+  visits = 0;
+  indexOk = YES;
+  [dict enumerateKeysAndObjectsWithOptions: NSEnumerationConcurrent
+				usingBlock: ^(id key, id obj, BOOL *stop) {
+    [lock lock];
+    visits++;
+    if ([key intValue] != [obj intValue])
+      {
+	indexOk = NO;
+      }
+    [lock unlock];
+  }];
+  PASS(visits == 10000 && indexOk,
+    "concurrent dictionary enumeration pairs each key with its object")
+
+  visits = 0;
+  sum = 0;
+  [indexes enumerateIndexesWithOptions: NSEnumerationConcurrent
+			    usingBlock: ^(NSUInteger idx, BOOL *stop) {
+    [lock lock];
+    visits++;
+    sum += idx;
+    [lock unlock];
+  }];
+  PASS(visits == 4001 && sum == 504500 + 10498500 + 9000,
+    "concurrent index set enumeration visits every index once")
+
+  visits = 0;
+  [indexes enumerateIndexesInRange: NSMakeRange(900, 1200)
+			   options: NSEnumerationConcurrent
+			usingBlock: ^(NSUInteger idx, BOOL *stop) {
+    [lock lock];
+    visits++;
+    [lock unlock];
+  }];
+  PASS(visits == 105 + 100,
+    "concurrent index set enumeration is limited to the range")
+
+  /* A sparse set has many ranges, which are merged into a few chunks.
+   */
+  [indexes removeAllIndexes];
+  for (i = 0; i < 5000; i++)
+    {
+      [indexes addIndex: i * 2];
+    }
+  visits = 0;
+  sum = 0;
+  [indexes enumerateIndexesInRange: NSMakeRange(1001, 8000)
+			   options: NSEnumerationConcurrent
+			usingBlock: ^(NSUInteger idx, BOOL *stop) {
+    [lock lock];
+    visits++;
+    sum += idx;
+    [lock unlock];
+  }];
+  PASS(visits == 4000 && sum == 20004000,
+    "concurrent sparse index set enumeration visits every index once")
+
+  [arp release]; arp = nil;
+# else
+  SKIP("No Blocks support in the compiler.")
+# endif
+  END_SET("concurrent enumeration")
+  return 0;
+}
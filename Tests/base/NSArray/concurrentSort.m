@@ -0,0 +1,89 @@
+#import "Testing.h"
+#import <Foundation/NSArray.h>
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSSet.h>
+#import <Foundation/NSSortDescriptor.h>
+#import <Foundation/NSValue.h>
+
+int main()
+{
+  START_SET("NSArray concurrent sorting")
+# ifndef __has_feature
+# define __has_feature(x) 0
+# endif
+# if __has_feature(blocks)
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableArray	*array = [NSMutableArray array];
+  NSArray		*sorted;
+  NSUInteger		i;
+  BOOL			ok;
+  NSComparator		byValue = ^ NSComparisonResult (id a, id b) {
+    return [[a objectAtIndex: 0] compare: [b objectAtIndex: 0]];
+  };
+
+  /* Pairs of a key with few distinct values and the original position,
+   * so that stability can be checked.
+   */
+  for (i = 0; i < 200000; i++)
+    {
+      [array addObject: [NSArray arrayWithObjects:
+	[NSNumber numberWithUnsignedInteger: (i * 7919) % 97],
+	[NSNumber numberWithUnsignedInteger: i],
+	nil]];
+    }
+
+  sorted = [array sortedArrayWithOptions: NSSortConcurrent | NSSortStable
+			 usingComparator: byValue];
+  ok = ([sorted count] == [array count]) ? YES : NO;
+  for (i = 1; ok && i < [sorted count]; i++)
+    {
+      NSArray	*a = [sorted objectAtIndex: i - 1];
+      NSArray	*b = [sorted objectAtIndex: i];
+      NSComparisonResult	r = byValue(a, b);
+
+      if (r == NSOrderedDescending || (r == NSOrderedSame
+	&& [[a objectAtIndex: 1] compare: [b objectAtIndex: 1]]
+	!= NSOrderedAscending))
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "a concurrent stable sort is sorted and stable")
+
+  sorted = [array sortedArrayWithOptions: NSSortConcurrent
+			 usingComparator: byValue];
+  ok = ([sorted count] == [array count]) ? YES : NO;
+  for (i = 1; ok && i < [sorted count]; i++)
+    {
+      if (byValue([sorted objectAtIndex: i - 1], [sorted objectAtIndex: i])
+	== NSOrderedDescending)
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "a concurrent unstable sort is sorted")
+
+  PASS([[NSSet setWithArray: sorted] count] == [array count],
+    "a concurrent sort keeps every object")
+
+  [array sortWithOptions: NSSortConcurrent
+	 usingComparator: ^ NSComparisonResult (id a, id b) {
+    return [[b objectAtIndex: 1] compare: [a objectAtIndex: 1]];
+  }];
+  PASS([[[array objectAtIndex: 0] objectAtIndex: 1] unsignedIntegerValue]
+    == 199999, "a mutable array can be sorted concurrently in place")
+
+  PASS_EXCEPTION([array sortedArrayWithOptions: NSSortConcurrent
+			       usingComparator: ^ NSComparisonResult (id a, id b) {
+    [NSException raise: @"SortTest" format: @"failed"];
+    return NSOrderedSame;
+  }], @"SortTest", "an exception in a comparator reaches the caller")
+
+  [arp release]; arp = nil;
+# else
+  SKIP("No Blocks support in the compiler.")
+# endif
+  END_SET("NSArray concurrent sorting")
+  return 0;
+}
@@ -0,0 +1,174 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSConnection.h>
+#import <Foundation/NSDate.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSInvocation.h>
+#import <Foundation/NSLock.h>
+#import <Foundation/NSPort.h>
+#import <Foundation/NSRunLoop.h>
+#import <Foundation/NSThread.h>
+
+@protocol Server
+- (int) add: (int)a to: (int)b;
+- (int) fail;
+@end
+
+@interface Server : NSObject <Server>
++ (void) serve: (NSArray*)ports;
+@end
+
+static NSCondition	*cond = nil;
+static BOOL		ready = NO;
+
+@implementation Server
++ (void) serve: (NSArray*)ports
+{
+  NSAutoreleasePool	*pool = [NSAutoreleasePool new];
+  NSConnection		*c;
+
+  c = [NSConnection connectionWithReceivePort: [ports objectAtIndex: 0]
+				     sendPort: [ports objectAtIndex: 1]];
+  [c setRootObject: [[self new] autorelease]];
+  [cond lock];
+  ready = YES;
+  [cond broadcast];
+  [cond unlock];
+  [[NSRunLoop currentRunLoop] run];
+  [pool release];
+}
+
+- (int) add: (int)a to: (int)b
+{
+  return a + b;
+}
+
+- (int) fail
+{
+  [NSException raise: NSGenericException format: @"failed"];
+  return 0;
+}
+@end
+
+int main()
+{
+  START_SET("asynchronous requests")
+# ifndef __has_feature
+# define __has_feature(x) 0
+# endif
+# if __has_feature(blocks)
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSConnection		*c;
+  NSPort		*p1;
+  NSPort		*p2;
+  NSInvocation		*inv;
+  id			proxy;
+  NSDate		*limit;
+  __block NSThread	*thread = nil;
+  __block NSException	*exc = nil;
+  __block unsigned	done = 0;
+  int			a = 40;
+  int			b = 2;
+  int			result = 0;
+  int			j;
+
+  p1 = [NSPort port];
+  p2 = [NSPort port];
+  cond = [NSCondition new];
+
+  /* Ports switched here. */
+  [NSThread detachNewThreadSelector: @selector(serve:)
+			   toTarget: [Server class]
+			 withObject: [NSArray arrayWithObjects: p2, p1, nil]];
+  [cond lock];
+  while (NO == ready)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+
+  c = [NSConnection connectionWithReceivePort: p1 sendPort: p2];
+  proxy = [c rootProxy];
+  [proxy setProtocolForProxy: @protocol(Server)];
+
+  inv = [NSInvocation invocationWithMethodSignature:
+    [proxy methodSignatureForSelector: @selector(add:to:)]];
+  [inv setTarget: proxy];
+  [inv setSelector: @selector(add:to:)];
+  [inv setArgument: &a atIndex: 2];
+  [inv setArgument: &b atIndex: 3];
+  [c sendInvocation: inv completion: ^(NSInvocation *i, NSException *e) {
+    thread = [NSThread currentThread];
+    exc = [e retain];
+    done++;
+  }];
+  limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+  while (0 == done && [limit timeIntervalSinceNow] > 0)
+    {
+      [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			       beforeDate: limit];
+    }
+  [inv getReturnValue: &result];
+  PASS(1 == done && nil == exc && 42 == result,
+    "a request sent without waiting completes with its result")
+  PASS(thread == [NSThread currentThread],
+    "the completion is called by the thread running the connection")
+
+  inv = [NSInvocation invocationWithMethodSignature:
+    [proxy methodSignatureForSelector: @selector(fail)]];
+  [inv setTarget: proxy];
+  [inv setSelector: @selector(fail)];
+  done = 0;
+  [c sendInvocation: inv completion: ^(NSInvocation *i, NSException *e) {
+    exc = [e retain];
+    done++;
+  }];
+  limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+  while (0 == done && [limit timeIntervalSinceNow] > 0)
+    {
+      [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			       beforeDate: limit];
+    }
+  PASS(1 == done && [[exc reason] isEqual: @"failed"],
+    "an exception raised by the remote end is passed to the completion")
+  [exc release];
+  exc = nil;
+
+  /* Several requests may be outstanding at once.
+   */
+  done = 0;
+  for (j = 0; j < 10; j++)
+    {
+      inv = [NSInvocation invocationWithMethodSignature:
+	[proxy methodSignatureForSelector: @selector(add:to:)]];
+      [inv setTarget: proxy];
+      [inv setSelector: @selector(add:to:)];
+      [inv setArgument: &a atIndex: 2];
+      [inv setArgument: &j atIndex: 3];
+      [c sendInvocation: inv completion: ^(NSInvocation *i, NSException *e) {
+	int	r;
+
+	[i getReturnValue: &r];
+	if (nil == e && r >= 40 && r < 50)
+	  {
+	    done++;
+	  }
+      }];
+    }
+  limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+  while (done < 10 && [limit timeIntervalSinceNow] > 0)
+    {
+      [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			       beforeDate: limit];
+    }
+  PASS(10 == done, "many requests may be outstanding at once")
+
+  [cond release];
+  [arp release]; arp = nil;
+# else
+  SKIP("No Blocks support in the compiler.")
+# endif
+  END_SET("asynchronous requests")
+  return 0;
+}
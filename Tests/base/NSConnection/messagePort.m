@@ -0,0 +1,126 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSConnection.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSFileManager.h>
+#import <Foundation/NSLock.h>
+#import <Foundation/NSPort.h>
+#import <Foundation/NSRunLoop.h>
+#import <Foundation/NSThread.h>
+
+@protocol Server
+- (bycopy NSData*) echo: (bycopy NSData*)d;
+@end
+
+@interface Server : NSObject <Server>
++ (void) serve: (NSArray*)ports;
+@end
+
+static NSCondition	*cond = nil;
+static BOOL		ready = NO;
+
+@implementation Server
++ (void) serve: (NSArray*)ports
+{
+  NSAutoreleasePool	*pool = [NSAutoreleasePool new];
+  NSConnection		*c;
+
+  c = [NSConnection connectionWithReceivePort: [ports objectAtIndex: 0]
+				     sendPort: [ports objectAtIndex: 1]];
+  [c setRootObject: [[self new] autorelease]];
+  [cond lock];
+  ready = YES;
+  [cond broadcast];
+  [cond unlock];
+  [[NSRunLoop currentRunLoop] run];
+  [pool release];
+}
+
+- (NSData*) echo: (NSData*)d
+{
+  return d;
+}
+@end
+
+/* Returns the number of descriptors open in this process, or NSNotFound
+ * if the system does not tell us.
+ */
+static NSUInteger
+openDescriptors()
+{
+  NSArray	*a;
+
+  a = [[NSFileManager defaultManager] directoryContentsAtPath:
+    @"/proc/self/fd"];
+  return (nil == a) ? NSNotFound : [a count];
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+#if	!defined(_WIN32)
+  NSConnection		*c;
+  NSMutableData		*big;
+  NSPort		*p1;
+  NSPort		*p2;
+  id			proxy;
+  NSUInteger		before;
+  NSUInteger		after;
+  BOOL			ok;
+  unsigned		i;
+
+  p1 = [NSMessagePort port];
+  p2 = [NSMessagePort port];
+  cond = [NSCondition new];
+
+  /* Ports switched here. */
+  [NSThread detachNewThreadSelector: @selector(serve:)
+			   toTarget: [Server class]
+			 withObject: [NSArray arrayWithObjects: p2, p1, nil]];
+  [cond lock];
+  while (NO == ready)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+
+  c = [NSConnection connectionWithReceivePort: p1 sendPort: p2];
+  proxy = [c rootProxy];
+  [proxy setProtocolForProxy: @protocol(Server)];
+
+  /* Large items are passed in memory files where the system allows.
+   */
+  big = [NSMutableData dataWithLength: 2 * 1024 * 1024];
+  for (i = 0; i < [big length]; i++)
+    {
+      ((unsigned char*)[big mutableBytes])[i] = (unsigned char)(i % 253);
+    }
+  PASS_EQUAL([proxy echo: big], big,
+    "a large data item is passed intact in both directions")
+  PASS_EQUAL([proxy echo: [NSData dataWithBytes: "small" length: 5]],
+    [NSData dataWithBytes: "small" length: 5],
+    "a small data item is passed intact")
+
+  before = openDescriptors();
+  ok = YES;
+  for (i = 0; i < 50; i++)
+    {
+      NSAutoreleasePool	*pool = [NSAutoreleasePool new];
+
+      if (NO == [[proxy echo: big] isEqual: big])
+	{
+	  ok = NO;
+	}
+      [pool release];
+    }
+  after = openDescriptors();
+  PASS(ok, "many large items are passed intact")
+  PASS(NSNotFound == before || after <= before + 2,
+    "memory files passed between ports are closed")
+
+  [cond release];
+#endif
+  [arp release]; arp = nil;
+  return 0;
+}
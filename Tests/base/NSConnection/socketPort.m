@@ -0,0 +1,141 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSConnection.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSLock.h>
+#import <Foundation/NSPort.h>
+#import <Foundation/NSRange.h>
+#import <Foundation/NSRunLoop.h>
+#import <Foundation/NSThread.h>
+
+@protocol Server
+- (NSUInteger) lengthOf: (bycopy NSData*)d;
+- (NSRange) shift: (NSRange)r by: (NSUInteger)n;
+@end
+
+@interface Server : NSObject <Server>
++ (void) client: (id)ignored;
++ (void) serve: (NSArray*)ports;
+@end
+
+static NSCondition	*cond = nil;
+static id		proxy = nil;
+static unsigned		running = 0;
+static BOOL		ready = NO;
+static BOOL		mismatch = NO;
+
+@implementation Server
++ (void) serve: (NSArray*)ports
+{
+  NSAutoreleasePool	*pool = [NSAutoreleasePool new];
+  NSConnection		*c;
+
+  c = [NSConnection connectionWithReceivePort: [ports objectAtIndex: 0]
+				     sendPort: [ports objectAtIndex: 1]];
+  [c setRootObject: [[self new] autorelease]];
+  [cond lock];
+  ready = YES;
+  [cond broadcast];
+  [cond unlock];
+  [[NSRunLoop currentRunLoop] run];
+  [pool release];
+}
+
+/* Each client thread sends a mixture of small and large messages so that
+ * the port has both to send at once.
+ */
++ (void) client: (id)ignored
+{
+  NSAutoreleasePool	*pool = [NSAutoreleasePool new];
+  NSData		*big;
+  unsigned		i;
+
+  big = [NSMutableData dataWithLength: 3 * 1024 * 1024];
+  for (i = 0; i < 20; i++)
+    {
+      NSRange	r = [proxy shift: NSMakeRange(i, 2) by: 5];
+
+      if (r.location != i + 5 || r.length != 2)
+	{
+	  mismatch = YES;
+	}
+      if ([proxy lengthOf: (i % 5) ? [NSData data] : big]
+	!= ((i % 5) ? 0 : [big length]))
+	{
+	  mismatch = YES;
+	}
+    }
+  [cond lock];
+  running--;
+  [cond broadcast];
+  [cond unlock];
+  [pool release];
+}
+
+- (NSUInteger) lengthOf: (NSData*)d
+{
+  return [d length];
+}
+
+- (NSRange) shift: (NSRange)r by: (NSUInteger)n
+{
+  r.location += n;
+  return r;
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSConnection		*c;
+  NSPort		*p1;
+  NSPort		*p2;
+  unsigned		i;
+
+  p1 = [NSSocketPort port];
+  p2 = [NSSocketPort port];
+  cond = [NSCondition new];
+
+  /* Ports switched here. */
+  [NSThread detachNewThreadSelector: @selector(serve:)
+			   toTarget: [Server class]
+			 withObject: [NSArray arrayWithObjects: p2, p1, nil]];
+  [cond lock];
+  while (NO == ready)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+
+  c = [NSConnection connectionWithReceivePort: p1 sendPort: p2];
+  [c enableMultipleThreads];
+  proxy = [[c rootProxy] retain];
+  [proxy setProtocolForProxy: @protocol(Server)];
+  PASS([proxy lengthOf: [NSData data]] == 0,
+    "a request is sent over a socket port")
+  PASS(NSEqualRanges([proxy shift: NSMakeRange(1, 2) by: 3],
+    NSMakeRange(4, 2)), "a structure is passed and returned")
+
+  running = 4;
+  for (i = 0; i < 4; i++)
+    {
+      [NSThread detachNewThreadSelector: @selector(client:)
+			       toTarget: [Server class]
+			     withObject: nil];
+    }
+  [cond lock];
+  while (running > 0)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  PASS(NO == mismatch,
+    "large and small messages sent together from several threads arrive intact")
+
+  [proxy release];
+  [cond release];
+  [arp release]; arp = nil;
+  return 0;
+}
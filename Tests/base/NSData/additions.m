@@ -63,6 +63,44 @@ int main()
 
   PASS(0 == [data length], "Complete gunzip is empty");
 
+  ref = [NSData dataWithBytes: "\xfb\xff" length: 2];
+  PASS_EQUAL([ref base64URLEncodedStringWithPadding: NO], @"-_8",
+    "base64url uses the URL safe alphabet without padding");
+  PASS_EQUAL([ref base64URLEncodedStringWithPadding: YES], @"-_8=",
+    "base64url may be padded");
+  ref = [NSData dataWithBytes: "foob" length: 4];
+  PASS_EQUAL([ref base64URLEncodedStringWithPadding: NO], @"Zm9vYg",
+    "base64url omits two padding characters");
+  data = [[[NSData alloc] initWithBase64URLEncodedString: @"Zm9vYg"]
+    autorelease];
+  PASS_EQUAL(data, ref, "base64url decodes without padding");
+  data = [[[NSData alloc] initWithBase64URLEncodedString: @"Zm9vYg=="]
+    autorelease];
+  PASS_EQUAL(data, ref, "base64url decodes with padding");
+  data = [[[NSData alloc] initWithBase64URLEncodedString: @"-_8"]
+    autorelease];
+  PASS_EQUAL(data, [NSData dataWithBytes: "\xfb\xff" length: 2],
+    "base64url decodes the URL safe characters");
+  PASS(nil == [[NSData alloc] initWithBase64URLEncodedString: @"+/8="],
+    "base64url rejects the standard alphabet");
+  PASS(nil == [[NSData alloc] initWithBase64URLEncodedString: @"Zm9vY"],
+    "base64url rejects an impossible length");
+  PASS(nil == [[NSData alloc] initWithBase64URLEncodedString: @"Zg="],
+    "base64url rejects incomplete padding");
+  {
+    NSMutableData       *m = [NSMutableData dataWithLength: 1000];
+    unsigned char       *b = [m mutableBytes];
+    unsigned            i;
+
+    for (i = 0; i < 1000; i++)
+      {
+        b[i] = (unsigned char)(i * 7);
+      }
+    data = [[[NSData alloc] initWithBase64URLEncodedString:
+      [m base64URLEncodedStringWithPadding: NO]] autorelease];
+    PASS_EQUAL(data, m, "base64url encode / decode all byte values");
+  }
+
   [arp release]; arp = nil;
   return 0;
 }
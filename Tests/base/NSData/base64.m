@@ -127,6 +127,33 @@ int main()
   PASS_EQUAL(data, ref, "base64 decoding Yml0bWFya2V0cyB1c2VyIGluZGVudGl0eQ==")
   [data release];
 
+  {
+    NSMutableData       *m = [NSMutableData dataWithLength: 1000];
+    unsigned char       *b = [m mutableBytes];
+    NSString            *s;
+    NSArray             *a;
+    unsigned            i;
+
+    for (i = 0; i < 1000; i++)
+      {
+        b[i] = (unsigned char)(i * 7);
+      }
+    strEnc = [m base64EncodedStringWithOptions: 0];
+    PASS([strEnc length] == 1336, "encoded length is correct")
+    data = [[NSData alloc] initWithBase64EncodedString: strEnc options: 0];
+    PASS_EQUAL(data, m, "Encode / Decode all byte values")
+    [data release];
+
+    s = [m base64EncodedStringWithOptions:
+      NSDataBase64Encoding76CharacterLineLength
+      | NSDataBase64EncodingEndLineWithLineFeed];
+    a = [s componentsSeparatedByString: @"\n"];
+    PASS([a count] == 18 && [[a objectAtIndex: 0] length] == 76
+      && [[a objectAtIndex: 17] length] == 44, "76 character lines")
+    PASS_EQUAL([a componentsJoinedByString: @""], strEnc,
+      "line breaks are the only difference")
+  }
+
   [arp release]; arp = nil;
   return 0;
 }
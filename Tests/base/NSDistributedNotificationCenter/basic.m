@@ -0,0 +1,127 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSDate.h>
+#import <Foundation/NSDistributedNotificationCenter.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSRunLoop.h>
+
+@interface	Observer : NSObject
+{
+@public
+  unsigned	count;
+}
+- (void) notified: (NSNotification*)n;
+@end
+@implementation	Observer
+- (void) notified: (NSNotification*)n
+{
+  count++;
+}
+@end
+
+/* Runs the run loop until the observer has been sent count notifications,
+ * then a little longer in case any more arrive.
+ */
+static void
+waitFor(Observer *o, unsigned count)
+{
+  NSDate	*limit = [NSDate dateWithTimeIntervalSinceNow: 10.0];
+
+  while (o->count < count && [limit timeIntervalSinceNow] > 0)
+    {
+      [[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+			       beforeDate: limit];
+    }
+  [[NSRunLoop currentRunLoop] runUntilDate:
+    [NSDate dateWithTimeIntervalSinceNow: 0.5]];
+}
+
+int main()
+{
+  NSAutoreleasePool		*arp = [NSAutoreleasePool new];
+  NSDistributedNotificationCenter	*dnc;
+  Observer			*byName;
+  Observer			*byPair;
+  Observer			*byObject;
+  BOOL				connected = YES;
+  unsigned			i;
+
+  START_SET("distributed notifications")
+  dnc = (NSDistributedNotificationCenter*)
+    [NSDistributedNotificationCenter defaultCenter];
+  byName = [[Observer new] autorelease];
+  byPair = [[Observer new] autorelease];
+  byObject = [[Observer new] autorelease];
+
+  PASS_EXCEPTION([dnc addObserver: byName
+			 selector: @selector(notified:)
+			     name: nil
+			   object: nil];,
+    NSInvalidArgumentException,
+    "an observer may not have both name and object nil")
+
+  NS_DURING
+    {
+      [dnc addObserver: byName
+	      selector: @selector(notified:)
+		  name: @"GSTestDNC"
+		object: nil];
+    }
+  NS_HANDLER
+    {
+      connected = NO;
+    }
+  NS_ENDHANDLER
+  if (NO == connected)
+    {
+      SKIP("Unable to connect to gdnc")
+    }
+  [dnc addObserver: byPair
+	  selector: @selector(notified:)
+	      name: @"GSTestDNC"
+	    object: @"one"];
+  [dnc addObserver: byObject
+	  selector: @selector(notified:)
+	      name: nil
+	    object: @"one"];
+
+  /* Identical notifications are all delivered unless the server has been
+   * told to coalesce them.
+   */
+  for (i = 0; i < 3; i++)
+    {
+      [dnc postNotificationName: @"GSTestDNC"
+			 object: @"one"
+		       userInfo: nil
+	     deliverImmediately: YES];
+    }
+  [dnc postNotificationName: @"GSTestDNC"
+		     object: @"two"
+		   userInfo: nil
+	 deliverImmediately: YES];
+  [dnc postNotificationName: @"GSTestOther"
+		     object: @"one"
+		   userInfo: nil
+	 deliverImmediately: YES];
+  waitFor(byName, 4);
+  PASS(4 == byName->count, "an observer of a name is sent each posting")
+  PASS(3 == byPair->count, "an observer of a name and object is sent those")
+  PASS(4 == byObject->count, "an observer of an object is sent those")
+
+  [dnc removeObserver: byPair name: @"GSTestDNC" object: @"one"];
+  byName->count = byPair->count = byObject->count = 0;
+  [dnc postNotificationName: @"GSTestDNC"
+		     object: @"one"
+		   userInfo: nil
+	 deliverImmediately: YES];
+  waitFor(byName, 1);
+  PASS(1 == byName->count && 0 == byPair->count && 1 == byObject->count,
+    "a removed observer is sent nothing")
+
+  [dnc removeObserver: byName];
+  [dnc removeObserver: byObject];
+  END_SET("distributed notifications")
+
+  [arp release]; arp = nil;
+  return 0;
+}
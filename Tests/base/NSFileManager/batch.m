@@ -0,0 +1,87 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSFileManager.h>
+#import <Foundation/NSNull.h>
+#import <Foundation/NSValue.h>
+#import <GNUstepBase/NSFileManager+GNUstepBase.h>
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSFileManager		*mgr = [NSFileManager defaultManager];
+  NSString		*dir = @"NSFileManagerBatchDir";
+  NSString		*file1;
+  NSString		*file2;
+  NSArray		*paths;
+  NSArray		*result;
+  NSDictionary		*d;
+  NSDictionary		*full;
+
+  [mgr removeFileAtPath: dir handler: nil];
+  [mgr createDirectoryAtPath: dir attributes: nil];
+  file1 = [dir stringByAppendingPathComponent: @"one"];
+  file2 = [dir stringByAppendingPathComponent: @"two"];
+  [[NSData dataWithBytes: "hello" length: 5] writeToFile: file1
+					      atomically: NO];
+  [[NSData data] writeToFile: file2 atomically: NO];
+
+  paths = [NSArray arrayWithObjects: file1, @"NoSuchFile", dir, file2, nil];
+  result = [mgr attributesOfItemsAtPaths: paths
+				    keys: [NSArray arrayWithObjects:
+    NSFileSize, NSFileType, @"NotAnAttribute", nil]
+			    traverseLink: NO];
+  PASS([result count] == 4, "a result is returned for each path")
+  PASS([result objectAtIndex: 1] == [NSNull null],
+    "a missing file gives NSNull")
+
+  d = [result objectAtIndex: 0];
+  PASS([d count] == 2, "only the requested attributes are present")
+  PASS([d fileSize] == 5, "file size is returned")
+  PASS_EQUAL([d fileType], NSFileTypeRegular, "file type is returned")
+  PASS([d objectForKey: NSFileModificationDate] == nil,
+    "an attribute which was not requested is absent")
+  PASS([d fileModificationDate] == nil && [d fileOwnerAccountID] == nil
+    && [d filePosixPermissions] == 0,
+    "accessors for attributes which were not requested return nothing")
+  PASS_EQUAL([[result objectAtIndex: 2] fileType], NSFileTypeDirectory,
+    "directory type is returned")
+  PASS([[result objectAtIndex: 3] fileSize] == 0, "empty file has no size")
+
+  result = [mgr attributesOfItemsAtPaths: [NSArray arrayWithObject: file1]
+				    keys: nil
+			    traverseLink: NO];
+  full = [mgr fileAttributesAtPath: file1 traverseLink: NO];
+  PASS_EQUAL([result lastObject], full,
+    "all attributes are returned when no keys are given")
+
+  PASS([NSFileManager attributesCacheInterval] == 0.0,
+    "attributes are not cached by default")
+  [NSFileManager setAttributesCacheInterval: 60.0];
+  full = [mgr fileAttributesAtPath: file1 traverseLink: NO];
+  PASS([mgr fileAttributesAtPath: file1 traverseLink: NO] == full,
+    "cached attributes are reused")
+  [mgr changeFileAttributes: [NSDictionary dictionaryWithObject:
+    [NSNumber numberWithInt: 0600] forKey: NSFilePosixPermissions]
+		     atPath: file1];
+  PASS([[mgr fileAttributesAtPath: file1 traverseLink: NO]
+    filePosixPermissions] == 0600,
+    "changing attributes empties the cache")
+  full = [mgr fileAttributesAtPath: @"." traverseLink: NO];
+  [mgr changeCurrentDirectoryPath: dir];
+  PASS([[mgr fileAttributesAtPath: @"." traverseLink: NO]
+    fileSystemFileNumber] != [full fileSystemFileNumber],
+    "changing directory empties the cache")
+  [mgr changeCurrentDirectoryPath: @".."];
+  full = [mgr fileAttributesAtPath: file1 traverseLink: NO];
+  [NSFileManager setAttributesCacheInterval: 0.0];
+  PASS([mgr fileAttributesAtPath: file1 traverseLink: NO] != full,
+    "attributes are not reused once the cache is disabled")
+
+  [mgr removeFileAtPath: dir handler: nil];
+  [arp release]; arp = nil;
+  return 0;
+}
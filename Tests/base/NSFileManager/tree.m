@@ -0,0 +1,132 @@
+#import "Testing.h"
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSError.h>
+#import <Foundation/NSFileManager.h>
+#import <Foundation/NSURL.h>
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSFileManager		*mgr = [NSFileManager defaultManager];
+  NSString		*src = @"NSFileManagerTreeSrc";
+  NSString		*dst = @"NSFileManagerTreeDst";
+  NSDirectoryEnumerator	*e;
+  NSMutableData		*big;
+  NSString		*file;
+  NSString		*path;
+  NSError		*err;
+  BOOL			ok;
+  unsigned		i;
+  unsigned		j;
+
+  [mgr removeItemAtPath: src error: NULL];
+  [mgr removeItemAtPath: dst error: NULL];
+
+  big = [NSMutableData dataWithLength: 200000];
+  for (i = 0; i < [big length]; i++)
+    {
+      ((char*)[big mutableBytes])[i] = (char)(i % 251);
+    }
+
+  /* Build a tree wide and deep enough for the work to be shared.
+   */
+  ok = YES;
+  for (i = 0; i < 10; i++)
+    {
+      path = [src stringByAppendingPathComponent:
+	[NSString stringWithFormat: @"dir%u/sub/deeper", i]];
+      ok = ok && [mgr createDirectoryAtPath: path
+		withIntermediateDirectories: YES
+				 attributes: nil
+				      error: NULL];
+      for (j = 0; j < 5; j++)
+	{
+	  file = [path stringByAppendingPathComponent:
+	    [NSString stringWithFormat: @"file%u", j]];
+	  ok = ok && [[file dataUsingEncoding: NSUTF8StringEncoding]
+	    writeToFile: file atomically: NO];
+	}
+    }
+  ok = ok && [big writeToFile: [src stringByAppendingPathComponent: @"big"]
+		   atomically: NO];
+  ok = ok && [mgr createSymbolicLinkAtPath:
+    [src stringByAppendingPathComponent: @"link"]
+    withDestinationPath: @"dir0/sub" error: NULL];
+  PASS(ok, "can create a directory tree")
+
+  PASS([mgr copyItemAtPath: src toPath: dst error: &err],
+    "-copyItemAtPath:toPath:error: copies a directory tree")
+
+  PASS_EQUAL([NSData dataWithContentsOfFile:
+    [dst stringByAppendingPathComponent: @"big"]], big,
+    "a large file is copied intact")
+  PASS_EQUAL([mgr pathContentOfSymbolicLinkAtPath:
+    [dst stringByAppendingPathComponent: @"link"]], @"dir0/sub",
+    "a symbolic link is copied as a link")
+
+  ok = YES;
+  e = [mgr enumeratorAtPath: src];
+  while ((file = [e nextObject]) != nil)
+    {
+      NSDictionary	*a = [e fileAttributes];
+      NSDictionary	*b;
+
+      b = [mgr fileAttributesAtPath: [dst stringByAppendingPathComponent: file]
+		       traverseLink: NO];
+      if (b == nil || NO == [[a fileType] isEqual: [b fileType]]
+	|| [a fileSize] != [b fileSize]
+	|| [a filePosixPermissions] != [b filePosixPermissions]
+	|| NO == [[a fileOwnerAccountID] isEqual: [b fileOwnerAccountID]]
+	|| NO == [[a fileGroupOwnerAccountID]
+	  isEqual: [b fileGroupOwnerAccountID]])
+	{
+	  ok = NO;
+	}
+      if ([[a fileType] isEqual: NSFileTypeRegular]
+	&& NO == [[NSData dataWithContentsOfFile:
+	  [src stringByAppendingPathComponent: file]]
+	isEqual: [NSData dataWithContentsOfFile:
+	  [dst stringByAppendingPathComponent: file]]])
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "every file in the copy matches the original and its owner")
+
+  ok = YES;
+  i = 0;
+  e = [mgr enumeratorAtURL: [NSURL fileURLWithPath: dst]
+    includingPropertiesForKeys: [NSArray arrayWithObject: NSURLFileSizeKey]
+		       options: 0
+		  errorHandler: NULL];
+  while ((file = [e nextObject]) != nil)
+    {
+      NSDictionary	*a = [e fileAttributes];
+      NSDictionary	*b;
+
+      b = [mgr fileAttributesAtPath: [dst stringByAppendingPathComponent: file]
+		       traverseLink: NO];
+      if (NO == [a isEqual: b])
+	{
+	  ok = NO;
+	}
+      i++;
+    }
+  PASS(ok && i == 82, "prefetched attributes match those of each file")
+
+  PASS([mgr removeItemAtPath: dst error: &err]
+    && NO == [mgr fileExistsAtPath: dst],
+    "-removeItemAtPath:error: removes a directory tree")
+  PASS([mgr removeItemAtPath: src error: &err]
+    && NO == [mgr fileExistsAtPath: src],
+    "-removeItemAtPath:error: removes a tree containing a link")
+
+  PASS(NO == [mgr removeItemAtPath: src error: &err] && err != nil,
+    "-removeItemAtPath:error: fails for a missing tree")
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,192 @@
+#import <Foundation/Foundation.h>
+#import "Testing.h"
+
+static NSLock		*lock = nil;
+static NSCondition	*cond = nil;
+static BOOL		held = NO;
+
+@interface Holder : NSObject
++ (void) hold: (id)ignored;
+@end
+
+/* A name which takes the lock it names when it is asked for its text.
+ */
+@interface LockingName : NSString
+{
+  NSString	*s;
+}
+@end
+
+@implementation LockingName
+- (id) copyWithZone: (NSZone*)z
+{
+  return [self retain];
+}
+- (void) dealloc
+{
+  [s release];
+  [super dealloc];
+}
+- (id) initWithString: (NSString*)str
+{
+  if (nil != (self = [super init]))
+    {
+      s = [str copy];
+    }
+  return self;
+}
+- (NSUInteger) length
+{
+  return [s length];
+}
+- (unichar) characterAtIndex: (NSUInteger)i
+{
+  return [s characterAtIndex: i];
+}
+- (const char*) UTF8String
+{
+  [lock lock];
+  [lock unlock];
+  return [s UTF8String];
+}
+@end
+
+@implementation Holder
++ (void) hold: (id)ignored
+{
+  [lock lock];
+  [cond lock];
+  held = YES;
+  [cond broadcast];
+  [cond unlock];
+  [NSThread sleepForTimeInterval: 0.2];
+  [lock unlock];
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool   *arp = [NSAutoreleasePool new];
+  NSRecursiveLock	*r;
+  NSCondition		*c;
+  NSString		*n;
+  NSDictionary		*p;
+  NSDictionary		*d;
+  NSArray		*h;
+  NSUInteger		total;
+  double		wait;
+  unsigned		i;
+
+  [NSObject setLockProfileSampleInterval: 1];
+  [NSObject resetLockProfile];
+
+  lock = [NSLock new];
+  [lock setName: @"profiled"];
+  for (i = 0; i < 100; i++)
+    {
+      [lock lock];
+      [lock unlock];
+    }
+  p = [NSObject lockProfile];
+  d = [p objectForKey: @"profiled"];
+  PASS([[d objectForKey: @"Acquisitions"] unsignedIntegerValue] == 100,
+    "acquisitions of a named lock are counted")
+  PASS([[d objectForKey: @"Contended"] unsignedIntegerValue] == 0,
+    "an uncontended lock has no contended acquisitions")
+  h = [d objectForKey: @"HoldTimes"];
+  total = 0;
+  for (i = 0; i < [h count]; i++)
+    {
+      total += [[h objectAtIndex: i] unsignedIntegerValue];
+    }
+  PASS([h count] == 16 && total == 100, "hold times are recorded")
+
+  r = [NSRecursiveLock new];
+  [r lock];
+  [r lock];
+  [r unlock];
+  [r unlock];
+  d = [[NSObject lockProfile] objectForKey: @"NSRecursiveLock (unnamed)"];
+  PASS([[d objectForKey: @"Acquisitions"] unsignedIntegerValue] >= 2,
+    "unnamed locks are counted by class")
+  [r release];
+
+  cond = [NSCondition new];
+  [NSThread detachNewThreadSelector: @selector(hold:)
+			   toTarget: [Holder class]
+			 withObject: nil];
+  [cond lock];
+  while (NO == held)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  [lock lock];
+  [lock unlock];
+  d = [[NSObject lockProfile] objectForKey: @"profiled"];
+  PASS([[d objectForKey: @"Contended"] unsignedIntegerValue] == 1
+    && [[d objectForKey: @"WaitTime"] doubleValue] > 0.05,
+    "waiting for a lock is recorded")
+
+  /* A wait with a time limit is recorded as contention too.
+   */
+  wait = [[d objectForKey: @"WaitTime"] doubleValue];
+  held = NO;
+  [NSThread detachNewThreadSelector: @selector(hold:)
+			   toTarget: [Holder class]
+			 withObject: nil];
+  [cond lock];
+  while (NO == held)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  PASS([lock lockBeforeDate: [NSDate dateWithTimeIntervalSinceNow: 10.0]],
+    "a lock is taken before a date")
+  [lock unlock];
+  d = [[NSObject lockProfile] objectForKey: @"profiled"];
+  PASS([[d objectForKey: @"Contended"] unsignedIntegerValue] == 2
+    && [[d objectForKey: @"WaitTime"] doubleValue] > wait + 0.05,
+    "waiting for a lock before a date is recorded")
+
+  c = [NSCondition new];
+  [c setName: @"condition"];
+  [c lock];
+  [c waitUntilDate: [NSDate dateWithTimeIntervalSinceNow: 0.1]];
+  [c unlock];
+  [c release];
+  d = [[NSObject lockProfile] objectForKey: @"condition"];
+  h = [d objectForKey: @"HoldTimes"];
+  total = 0;
+  for (i = 0; i < [h count]; i++)
+    {
+      total += [[h objectAtIndex: i] unsignedIntegerValue];
+    }
+  PASS(2 == total && 0 == [[h lastObject] unsignedIntegerValue],
+    "a wait on a condition ends one hold and starts another")
+
+  n = [[[LockingName alloc] initWithString: @"self naming"] autorelease];
+  [lock setName: n];
+  [lock lock];
+  [lock unlock];
+  PASS([[[[NSObject lockProfile] objectForKey: @"self naming"]
+    objectForKey: @"Acquisitions"] unsignedIntegerValue] > 0,
+    "a lock whose name uses the lock itself is profiled")
+  [lock setName: @"profiled"];
+
+  [NSObject resetLockProfile];
+  PASS(nil == [[NSObject lockProfile] objectForKey: @"profiled"],
+    "the profile can be reset")
+
+  PASS([NSObject setLockProfileSampleInterval: 0] == 1,
+    "setting the sample interval returns the old one")
+  [lock lock];
+  [lock unlock];
+  PASS(nil == [[NSObject lockProfile] objectForKey: @"profiled"],
+    "nothing is recorded when profiling is off")
+
+  [cond release];
+  [lock release];
+  [arp release]; arp = nil;
+  return 0;
+}
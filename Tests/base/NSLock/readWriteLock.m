@@ -0,0 +1,100 @@
+#import <Foundation/Foundation.h>
+#import <GNUstepBase/GSLock.h>
+#import "Testing.h"
+
+static GSReadWriteLock	*rw = nil;
+static NSCondition	*cond = nil;
+static unsigned		running = 0;
+static unsigned		a = 0;
+static unsigned		b = 0;
+static BOOL		torn = NO;
+
+@interface Worker : NSObject
++ (void) finished;
++ (void) read: (id)ignored;
++ (void) write: (id)ignored;
+@end
+
+@implementation Worker
++ (void) finished
+{
+  [cond lock];
+  running--;
+  [cond broadcast];
+  [cond unlock];
+}
++ (void) read: (id)ignored
+{
+  unsigned	i;
+
+  for (i = 0; i < 100000; i++)
+    {
+      [rw lockForReading];
+      if (a != b)
+	{
+	  torn = YES;
+	}
+      [rw unlock];
+    }
+  [self finished];
+}
++ (void) write: (id)ignored
+{
+  unsigned	i;
+
+  for (i = 0; i < 100000; i++)
+    {
+      [rw lockForWriting];
+      a++;
+      b++;
+      [rw unlock];
+    }
+  [self finished];
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool   *arp = [NSAutoreleasePool new];
+  unsigned		i;
+
+  rw = [GSReadWriteLock new];
+  [rw setName: @"test"];
+  PASS_EQUAL([rw name], @"test", "a read-write lock can be named")
+
+  [rw lockForReading];
+  PASS([rw tryLockForReading], "several readers may hold the lock")
+  PASS(NO == [rw tryLockForWriting], "a writer may not join readers")
+  [rw unlock];
+  [rw unlock];
+  PASS([rw tryLockForWriting], "the lock may be written once readers leave")
+  PASS(NO == [rw tryLockForReading], "a reader may not join a writer")
+  PASS(NO == [rw tryLockForWriting], "a writer may not join a writer")
+  [rw unlock];
+  [rw lock];
+  PASS(NO == [rw tryLockForReading], "-lock locks for writing")
+  [rw unlock];
+
+  cond = [NSCondition new];
+  running = 8;
+  for (i = 0; i < 8; i++)
+    {
+      [NSThread detachNewThreadSelector: (i % 2) ? @selector(read:)
+						 : @selector(write:)
+			       toTarget: [Worker class]
+			     withObject: nil];
+    }
+  [cond lock];
+  while (running > 0)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  PASS(NO == torn && 400000 == a && 400000 == b,
+    "readers never see a half finished write")
+
+  [cond release];
+  [rw release];
+  [arp release]; arp = nil;
+  return 0;
+}
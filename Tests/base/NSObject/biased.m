@@ -0,0 +1,157 @@
+#import "Testing.h"
+#import <Foundation/NSArray.h>
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSLock.h>
+#import <Foundation/NSObject.h>
+#import <Foundation/NSThread.h>
+
+static unsigned	deallocated = 0;
+
+@interface Counted : NSObject
+@end
+
+@implementation Counted
+- (void) dealloc
+{
+  @synchronized([Counted class])
+    {
+      deallocated++;
+    }
+  [super dealloc];
+}
+@end
+
+static NSCondition	*cond = nil;
+static unsigned		running = 0;
+
+static id		made = nil;
+
+@interface Worker : NSObject
++ (void) make: (id)ignored;
++ (void) run: (NSArray*)objects;
+@end
+
+@implementation Worker
+/* Create an object, owned by this thread, and leave it for the main
+ * thread to release after we have exited.
+ */
++ (void) make: (id)ignored
+{
+  made = [Counted new];
+}
+
++ (void) run: (NSArray*)objects
+{
+  NSUInteger	i;
+
+  /* Retain and release each object a few times, then release the
+   * reference we were given.
+   */
+  for (i = 0; i < [objects count]; i++)
+    {
+      id	o = [objects objectAtIndex: i];
+
+      [o retain];
+      [o retain];
+      [o release];
+      [o release];
+      [o release];
+    }
+  [objects release];
+  [cond lock];
+  running--;
+  [cond broadcast];
+  [cond unlock];
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp;
+  NSMutableArray	*a;
+  NSThread		*thread;
+  Counted		*o;
+  unsigned		i;
+
+  /* Biased counting must be chosen before NSObject is initialised.
+   */
+  setenv("GNUSTEP_BIASED_REFCOUNT", "YES", 1);
+  arp = [NSAutoreleasePool new];
+
+  o = [Counted new];
+  for (i = 0; i < 10; i++)
+    {
+      [o retain];
+    }
+  PASS([o retainCount] == 11, "retain count is correct in the owning thread")
+  for (i = 0; i < 10; i++)
+    {
+      [o release];
+    }
+  PASS([o retainCount] == 1, "releases in the owning thread are counted")
+  [o release];
+  PASS(deallocated == 1, "last release in the owning thread deallocates")
+
+  /* Give each worker its own reference to every object, and drop ours,
+   * so that the last release of each object happens in some thread.
+   */
+  deallocated = 0;
+  cond = [NSCondition new];
+  a = [NSMutableArray array];
+  for (i = 0; i < 1000; i++)
+    {
+      o = [Counted new];
+      [a addObject: o];
+      [o release];
+    }
+  running = 4;
+  for (i = 0; i < 4; i++)
+    {
+      NSArray	*objects = [a copy];
+      NSUInteger	j;
+
+      for (j = 0; j < [objects count]; j++)
+	{
+	  [[objects objectAtIndex: j] retain];
+	}
+      [NSThread detachNewThreadSelector: @selector(run:)
+			       toTarget: [Worker class]
+			     withObject: objects];
+    }
+  [a removeAllObjects];
+  [cond lock];
+  while (running > 0)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  /* Emptying a pool performs any releases queued for this thread.
+   */
+  [arp release];
+  PASS(deallocated == 1000,
+    "objects released last by other threads are deallocated")
+
+  arp = [NSAutoreleasePool new];
+  deallocated = 0;
+  thread = [[NSThread alloc] initWithTarget: [Worker class]
+				   selector: @selector(make:)
+				     object: nil];
+  [thread start];
+  while (NO == [thread isFinished])
+    {
+      [NSThread sleepForTimeInterval: 0.01];
+    }
+  [NSThread sleepForTimeInterval: 0.1];
+  [made release];
+  for (i = 0; i < 100 && 0 == deallocated; i++)
+    {
+      [NSThread sleepForTimeInterval: 0.05];
+    }
+  PASS(deallocated == 1,
+    "an object released after its owning thread exited is deallocated")
+  [thread release];
+
+  [cond release];
+  [arp release]; arp = nil;
+  return 0;
+}
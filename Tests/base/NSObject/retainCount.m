@@ -0,0 +1,109 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSLock.h>
+#import <Foundation/NSObject.h>
+#import <Foundation/NSThread.h>
+
+static BOOL	deallocated = NO;
+
+@interface Counted : NSObject
+@end
+
+@implementation Counted
+- (void) dealloc
+{
+  deallocated = YES;
+  [super dealloc];
+}
+@end
+
+static id		shared = nil;
+static NSCondition	*cond = nil;
+static unsigned		running = 0;
+
+@interface Worker : NSObject
++ (void) run: (id)ignored;
+@end
+
+@implementation Worker
++ (void) run: (id)ignored
+{
+  unsigned	i;
+  unsigned	j;
+
+  for (i = 0; i < 1000; i++)
+    {
+      for (j = 0; j < 1000; j++)
+	{
+	  [shared retain];
+	}
+      for (j = 0; j < 1000; j++)
+	{
+	  [shared release];
+	}
+    }
+  [cond lock];
+  running--;
+  [cond broadcast];
+  [cond unlock];
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  Counted		*o = [Counted new];
+  NSUInteger		count = 9000000;
+  NSUInteger		i;
+
+  /* Go well past the point where part of the count is kept elsewhere.
+   */
+  for (i = 0; i < count; i++)
+    {
+      [o retain];
+    }
+  PASS([o retainCount] == count + 1, "a very large retain count is kept")
+  for (i = 0; i < count; i++)
+    {
+      [o release];
+    }
+  PASS([o retainCount] == 1 && NO == deallocated,
+    "releasing a very large retain count leaves the object alive")
+
+  /* Now have several threads move the count back and forth across that
+   * point at once.
+   */
+  for (i = 0; i < 0x7ff000; i++)
+    {
+      [o retain];
+    }
+  shared = o;
+  cond = [NSCondition new];
+  running = 8;
+  for (i = 0; i < 8; i++)
+    {
+      [NSThread detachNewThreadSelector: @selector(run:)
+			       toTarget: [Worker class]
+			     withObject: nil];
+    }
+  [cond lock];
+  while (running > 0)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  PASS([o retainCount] == 0x7ff001 && NO == deallocated,
+    "concurrent retains and releases keep a large count intact")
+  for (i = 0; i < 0x7ff000; i++)
+    {
+      [o release];
+    }
+  PASS([o retainCount] == 1 && NO == deallocated,
+    "the count returns to one")
+  [o release];
+  PASS(YES == deallocated, "the object is deallocated by the last release")
+
+  [cond release];
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,118 @@
+#import "Testing.h"
+#import <Foundation/NSArray.h>
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSLock.h>
+#import <Foundation/NSObject.h>
+#import <Foundation/NSThread.h>
+
+int objc_sync_enter(id obj);
+int objc_sync_exit(id obj);
+
+static NSArray		*objects = nil;
+static unsigned		counts[16];
+static NSCondition	*cond = nil;
+static unsigned		running = 0;
+
+@interface Worker : NSObject
++ (void) run: (id)ignored;
+@end
+
+@implementation Worker
++ (void) run: (id)ignored
+{
+  unsigned	i;
+
+  for (i = 0; i < 100000; i++)
+    {
+      unsigned	k = i % 16;
+      id	o = [objects objectAtIndex: k];
+
+      @synchronized(o)
+	{
+	  @synchronized(o)
+	    {
+	      counts[k]++;
+	    }
+	}
+    }
+  [cond lock];
+  running--;
+  [cond broadcast];
+  [cond unlock];
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableArray	*a = [NSMutableArray array];
+  id			o;
+  unsigned		total;
+  unsigned		i;
+  BOOL			ok;
+
+  for (i = 0; i < 16; i++)
+    {
+      [a addObject: [[NSObject new] autorelease]];
+    }
+  objects = a;
+
+  /* Hold more objects at once than a thread keeps track of cheaply.
+   */
+  ok = YES;
+  for (i = 0; i < 16; i++)
+    {
+      if (0 != objc_sync_enter([objects objectAtIndex: i]))
+	{
+	  ok = NO;
+	}
+    }
+  for (i = 16; i > 0; i--)
+    {
+      if (0 != objc_sync_exit([objects objectAtIndex: i - 1]))
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "many objects may be synchronized on at once")
+
+  o = [objects objectAtIndex: 0];
+  NS_DURING
+    {
+      @synchronized(o)
+	{
+	  [NSException raise: NSGenericException format: @"test"];
+	}
+    }
+  NS_HANDLER
+  NS_ENDHANDLER
+
+  /* The workers would never finish if leaving the block above by an
+   * exception had left the object locked.
+   */
+  cond = [NSCondition new];
+  running = 4;
+  for (i = 0; i < 4; i++)
+    {
+      [NSThread detachNewThreadSelector: @selector(run:)
+			       toTarget: [Worker class]
+			     withObject: nil];
+    }
+  [cond lock];
+  while (running > 0)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  total = 0;
+  for (i = 0; i < 16; i++)
+    {
+      total += counts[i];
+    }
+  PASS(total == 400000, "nested @synchronized excludes other threads")
+
+  [cond release];
+  [arp release]; arp = nil;
+  return 0;
+}
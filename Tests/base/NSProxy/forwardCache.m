@@ -0,0 +1,125 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSInvocation.h>
+#import <Foundation/NSMethodSignature.h>
+#import <Foundation/NSProxy.h>
+
+#include <string.h>
+
+/* Structures whose encodings differ only in the array length.
+ */
+typedef struct { char c[4]; } Small;
+typedef struct { char c[64]; } Large;
+
+@interface Adder : NSObject
+- (double) add: (double)a to: (NSRange)r;
+- (Large) large: (Large)l;
+- (Small) small: (Small)s;
+@end
+
+@implementation Adder
+- (double) add: (double)a to: (NSRange)r
+{
+  return a + r.location + r.length;
+}
+- (Large) large: (Large)l
+{
+  l.c[63]++;
+  return l;
+}
+- (Small) small: (Small)s
+{
+  s.c[3]++;
+  return s;
+}
+@end
+
+@interface Forwarder : NSProxy
+{
+@public
+  id		target;
+  Forwarder	*nested;
+}
+@end
+
+@implementation Forwarder
+- (NSMethodSignature*) methodSignatureForSelector: (SEL)aSelector
+{
+  return [target methodSignatureForSelector: aSelector];
+}
+- (void) forwardInvocation: (NSInvocation*)anInvocation
+{
+  if (nested != nil)
+    {
+      /* Forward the same method while this invocation is in use.
+       */
+      [(Adder*)nested add: 100.0 to: NSMakeRange(1000, 1000)];
+    }
+  [anInvocation invokeWithTarget: target];
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  Adder			*adder = [[Adder new] autorelease];
+  Forwarder		*outer = [Forwarder alloc];
+  Forwarder		*inner = [Forwarder alloc];
+  Small			small;
+  Large			large;
+  NSMethodSignature	*sig;
+  NSInvocation		*inv1;
+  NSInvocation		*inv2;
+  double		a;
+  double		b;
+  BOOL			ok;
+  int			i;
+
+  inner->target = adder;
+  outer->target = adder;
+  outer->nested = inner;
+
+  PASS([(Adder*)inner add: 1.0 to: NSMakeRange(2, 3)] == 6.0,
+    "a message is forwarded")
+  ok = YES;
+  for (i = 0; i < 1000; i++)
+    {
+      if ([(Adder*)inner add: i to: NSMakeRange(i, 1)] != 2.0 * i + 1)
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "repeatedly forwarded messages get their own arguments")
+  PASS([(Adder*)outer add: 1.0 to: NSMakeRange(2, 3)] == 6.0,
+    "arguments survive a nested forward of the same method")
+
+  /* Forwarding the small structure first must not give the large one
+   * its frame.
+   */
+  memset(&small, 1, sizeof(small));
+  memset(&large, 2, sizeof(large));
+  small = [(Adder*)inner small: small];
+  large = [(Adder*)inner large: large];
+  PASS(small.c[0] == 1 && small.c[3] == 2,
+    "a structure with a short array is forwarded")
+  PASS(large.c[0] == 2 && large.c[4] == 2 && large.c[62] == 2
+    && large.c[63] == 3,
+    "a structure differing only in array length is forwarded whole")
+
+  sig = [adder methodSignatureForSelector: @selector(add:to:)];
+  inv1 = [NSInvocation invocationWithMethodSignature: sig];
+  inv2 = [NSInvocation invocationWithMethodSignature: sig];
+  a = 1.0;
+  [inv1 setArgument: &a atIndex: 2];
+  a = 2.0;
+  [inv2 setArgument: &a atIndex: 2];
+  [inv1 getArgument: &a atIndex: 2];
+  [inv2 getArgument: &b atIndex: 2];
+  PASS(a == 1.0 && b == 2.0,
+    "invocations with the same signature have their own arguments")
+
+  [outer release];
+  [inner release];
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,121 @@
+#import "Testing.h"
+#import <Foundation/NSArray.h>
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSDate.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSPort.h>
+#import <Foundation/NSPortMessage.h>
+#import <Foundation/NSPortNameServer.h>
+#import <Foundation/NSProcessInfo.h>
+#import <Foundation/NSTask.h>
+#import <Foundation/NSUserDefaults.h>
+#import <GNUstepBase/NSTask+GNUstepBase.h>
+
+#if	!defined(_WIN32)
+#include	<netinet/in.h>
+#include	<sys/socket.h>
+#include	<unistd.h>
+
+static NSString	*gdomap = nil;
+
+/* Runs gdomap to change a registration behind the back of the name
+ * server object in this process, as another process would.
+ */
+static BOOL
+gdomapRun(NSString *option, NSString *name, unsigned port)
+{
+  NSTask	*task = AUTORELEASE([NSTask new]);
+
+  [task setLaunchPath: gdomap];
+  [task setArguments: [NSArray arrayWithObjects:
+    @"-P", [NSString stringWithFormat: @"%u", port], option, name, nil]];
+  [task launch];
+  [task waitUntilExit];
+  return [task terminationStatus] == 0 ? YES : NO;
+}
+
+/* Returns a socket listening on a port of the loopback address.
+ */
+static int
+listener(unsigned *port)
+{
+  struct sockaddr_in	sin;
+  socklen_t		len = sizeof(sin);
+  int			s;
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  s = socket(AF_INET, SOCK_STREAM, 0);
+  if (s < 0
+    || bind(s, (struct sockaddr*)&sin, sizeof(sin)) < 0
+    || listen(s, 8) < 0
+    || getsockname(s, (struct sockaddr*)&sin, &len) < 0)
+    {
+      return -1;
+    }
+  *port = ntohs(sin.sin_port);
+  return s;
+}
+#endif
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+
+  START_SET("NSSocketPortNameServer lookup cache")
+#if	!defined(_WIN32)
+  NSSocketPortNameServer	*ns;
+  NSSocketPort			*port;
+  NSPortMessage			*msg;
+  NSString			*name;
+  unsigned			oldNum;
+  unsigned			newNum;
+  int				s;
+
+  [[NSUserDefaults standardUserDefaults] registerDefaults:
+    [NSDictionary dictionaryWithObject: @"60"
+				forKey: @"GSPortLookupCache"]];
+  gdomap = [NSTask launchPathForTool: @"gdomap"];
+  name = [NSString stringWithFormat: @"GSTestCache%d",
+    [[NSProcessInfo processInfo] processIdentifier]];
+  ns = [NSSocketPortNameServer sharedInstance];
+
+  /* Make sure gdomap is running before we talk to it directly.
+   */
+  [ns portForName: @"GSTestNoSuchName" onHost: nil];
+  s = listener(&oldNum);
+  if (nil == gdomap || s < 0 || NO == gdomapRun(@"-R", name, oldNum))
+    {
+      SKIP("Unable to register names with gdomap")
+    }
+
+  port = (NSSocketPort*)[ns portForName: name onHost: nil];
+  PASS([port portNumber] == oldNum, "a registered name is found")
+
+  /* The process serving the name goes away and another registers it.
+   */
+  close(s);
+  s = listener(&newNum);
+  gdomapRun(@"-U", name, oldNum);
+  gdomapRun(@"-R", name, newNum);
+  port = (NSSocketPort*)[ns portForName: name onHost: nil];
+  PASS([port portNumber] == oldNum, "a lookup is kept when the cache is on")
+
+  msg = AUTORELEASE([[NSPortMessage alloc] initWithSendPort: port
+    receivePort: [NSSocketPort port]
+    components: [NSMutableArray arrayWithObject: [NSMutableData data]]]);
+  PASS(NO == [msg sendBeforeDate: [NSDate dateWithTimeIntervalSinceNow: 5.0]],
+    "a send to the old port fails")
+  port = (NSSocketPort*)[ns portForName: name onHost: nil];
+  PASS([port portNumber] == newNum,
+    "the lookup is dropped once a send to its port has failed")
+
+  gdomapRun(@"-U", name, newNum);
+  close(s);
+#endif
+  END_SET("NSSocketPortNameServer lookup cache")
+
+  [arp release]; arp = nil;
+  return 0;
+}
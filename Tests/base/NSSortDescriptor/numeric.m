@@ -0,0 +1,159 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSException.h>
+#import <Foundation/NSKeyValueCoding.h>
+#import <Foundation/NSPredicate.h>
+#import <Foundation/NSSortDescriptor.h>
+#import <Foundation/NSValue.h>
+
+@interface Record : NSObject
+{
+  int		rank;
+  double	score;
+  NSString	*name;
+}
++ (id) rank: (int)r score: (double)s name: (NSString*)n;
+- (int) rank;
+@end
+
+@implementation Record
++ (id) rank: (int)r score: (double)s name: (NSString*)n
+{
+  Record	*o = [[self new] autorelease];
+
+  o->rank = r;
+  o->score = s;
+  o->name = [n copy];
+  return o;
+}
+- (int) rank
+{
+  return rank;
+}
+- (void) dealloc
+{
+  [name release];
+  [super dealloc];
+}
+@end
+
+static BOOL
+ordered(NSArray *a, NSString *key, BOOL ascending)
+{
+  NSUInteger	i;
+
+  for (i = 1; i < [a count]; i++)
+    {
+      NSComparisonResult	r;
+
+      r = [[[a objectAtIndex: i - 1] valueForKey: key]
+	compare: [[a objectAtIndex: i] valueForKey: key]];
+      if (r == (ascending ? NSOrderedDescending : NSOrderedAscending))
+	{
+	  return NO;
+	}
+    }
+  return YES;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSMutableArray	*records = [NSMutableArray array];
+  NSMutableArray	*numbers = [NSMutableArray array];
+  NSArray		*sorted;
+  NSArray		*descriptors;
+  NSPredicate		*p;
+  unsigned		i;
+
+  for (i = 0; i < 500; i++)
+    {
+      [records addObject: [Record rank: (int)((i * 7919) % 101) - 50
+				 score: ((i * 31) % 97) / 4.0
+				  name: [NSString stringWithFormat: @"%u", i]]];
+    }
+
+  sorted = [records sortedArrayUsingDescriptors: [NSArray arrayWithObject:
+    [NSSortDescriptor sortDescriptorWithKey: @"rank" ascending: YES]]];
+  PASS([sorted count] == 500 && ordered(sorted, @"rank", YES),
+    "sorting by a scalar method works")
+
+  sorted = [records sortedArrayUsingDescriptors: [NSArray arrayWithObject:
+    [NSSortDescriptor sortDescriptorWithKey: @"score" ascending: NO]]];
+  PASS(ordered(sorted, @"score", NO),
+    "sorting descending by a scalar variable works")
+
+  descriptors = [NSArray arrayWithObject:
+    [NSSortDescriptor sortDescriptorWithKey: @"missing" ascending: YES]];
+  PASS_EXCEPTION([records sortedArrayUsingDescriptors: descriptors],
+    NSUndefinedKeyException,
+    "an exception raised by a key value accessor leaves the sort")
+  sorted = [records sortedArrayUsingDescriptors: [NSArray arrayWithObject:
+    [NSSortDescriptor sortDescriptorWithKey: @"rank" ascending: YES]]];
+  PASS(ordered(sorted, @"rank", YES), "sorting works after an exception")
+
+  descriptors = [NSArray arrayWithObjects:
+    [NSSortDescriptor sortDescriptorWithKey: @"rank" ascending: YES],
+    [NSSortDescriptor sortDescriptorWithKey: @"score" ascending: YES],
+    nil];
+  sorted = [records sortedArrayUsingDescriptors: descriptors];
+  {
+    BOOL	ok = ordered(sorted, @"rank", YES);
+
+    for (i = 1; i < [sorted count]; i++)
+      {
+	Record	*a = [sorted objectAtIndex: i - 1];
+	Record	*b = [sorted objectAtIndex: i];
+
+	if ([a rank] == [b rank]
+	  && [[a valueForKey: @"score"] doubleValue]
+	  > [[b valueForKey: @"score"] doubleValue])
+	  {
+	    ok = NO;
+	  }
+      }
+    PASS(ok, "sorting with a second descriptor orders equal ranks")
+  }
+
+  [numbers addObject: [NSNumber numberWithUnsignedLongLong: 18446744073709551615ULL]];
+  [numbers addObject: [NSNumber numberWithLongLong: -3]];
+  [numbers addObject: [NSNumber numberWithDouble: 2.5]];
+  [numbers addObject: [NSNumber numberWithInt: 7]];
+  [numbers addObject: [NSNumber numberWithLongLong: 9007199254740993LL]];
+  sorted = [numbers sortedArrayUsingDescriptors: [NSArray arrayWithObject:
+    [NSSortDescriptor sortDescriptorWithKey: @"self" ascending: YES]]];
+  PASS(ordered(sorted, @"self", YES), "sorting mixed boxed numbers works")
+
+  sorted = [[NSArray arrayWithObjects: @"b", @"c", @"a", nil]
+    sortedArrayUsingDescriptors: [NSArray arrayWithObject:
+    [NSSortDescriptor sortDescriptorWithKey: @"self" ascending: NO]]];
+  PASS_EQUAL(sorted, ([NSArray arrayWithObjects: @"c", @"b", @"a", nil]),
+    "sorting strings descending works")
+
+  p = [NSPredicate predicateWithFormat: @"rank >= 0 AND score < 10"];
+  sorted = [records filteredArrayUsingPredicate: p];
+  {
+    BOOL	ok = ([sorted count] > 0) ? YES : NO;
+
+    for (i = 0; i < [records count]; i++)
+      {
+	Record	*r = [records objectAtIndex: i];
+	BOOL	match = ([r rank] >= 0
+	  && [[r valueForKey: @"score"] doubleValue] < 10) ? YES : NO;
+
+	if (match != [sorted containsObject: r])
+	  {
+	    ok = NO;
+	  }
+      }
+    PASS(ok, "filtering by numeric keys matches the expected objects")
+  }
+  p = [NSPredicate predicateWithFormat: @"rank > nil"];
+  PASS([[records filteredArrayUsingPredicate: p] count] == 0,
+    "comparing a numeric key with nil matches nothing")
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,106 @@
+#import <Foundation/Foundation.h>
+#import <GNUstepBase/NSTask+GNUstepBase.h>
+
+#import "ObjectTesting.h"
+
+#include <time.h>
+
+int main()
+{
+#if	!defined(_WIN32)
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+  NSFileManager		*mgr;
+  NSString		*helpers;
+  NSString		*echo;
+  NSMutableArray	*tasks;
+  NSArray		*results;
+  NSDictionary		*d;
+  NSString		*s;
+  NSTask		*task;
+  clock_t		cpu;
+  unsigned		i;
+  BOOL			ok;
+
+  mgr = [NSFileManager defaultManager];
+  helpers = [mgr currentDirectoryPath];
+  helpers = [helpers stringByAppendingPathComponent: @"Helpers"];
+  helpers = [helpers stringByAppendingPathComponent: @"obj"];
+  echo = [helpers stringByAppendingPathComponent: @"testecho"];
+
+  tasks = [NSMutableArray array];
+  for (i = 0; i < 20; i++)
+    {
+      task = [[NSTask new] autorelease];
+      [task setLaunchPath: echo];
+      [task setArguments: [NSArray arrayWithObject:
+	[NSString stringWithFormat: @"task%u", i]]];
+      [tasks addObject: task];
+    }
+  task = [[NSTask new] autorelease];
+  [task setLaunchPath: @"/bin/sh"];
+  [task setArguments: [NSArray arrayWithObjects:
+    @"-c", @"echo failed >&2; exit 3", nil]];
+  [tasks addObject: task];
+
+  results = [NSTask runTasks: tasks maxConcurrent: 4];
+  PASS([results count] == 21, "a result is returned for each task")
+
+  ok = YES;
+  for (i = 0; i < 20; i++)
+    {
+      d = [results objectAtIndex: i];
+      s = [[[NSString alloc]
+	initWithData: [d objectForKey: @"StandardOutput"]
+	encoding: NSUTF8StringEncoding] autorelease];
+      if (NO == [s hasSuffix: [NSString stringWithFormat: @" task%u\n", i]]
+	|| [[d objectForKey: @"TerminationStatus"] intValue] != 0
+	|| [[tasks objectAtIndex: i] isRunning] == YES)
+	{
+	  ok = NO;
+	}
+    }
+  PASS(ok, "output of each task is captured in order")
+
+  d = [results lastObject];
+  PASS_EQUAL([d objectForKey: @"StandardError"],
+    [@"failed\n" dataUsingEncoding: NSASCIIStringEncoding],
+    "standard error is captured")
+  PASS([[d objectForKey: @"StandardOutput"] length] == 0,
+    "standard output is separate from standard error")
+  PASS([[d objectForKey: @"TerminationStatus"] intValue] == 3,
+    "exit status is returned")
+  PASS([[d objectForKey: @"Duration"] doubleValue] >= 0.0,
+    "duration is returned")
+
+  task = [[NSTask new] autorelease];
+  [task setLaunchPath: [helpers stringByAppendingPathComponent: @"missing"]];
+  results = [NSTask runTasks: [NSArray arrayWithObject: task]
+	       maxConcurrent: 0];
+  PASS([[results lastObject] objectForKey: @"Exception"] != nil,
+    "a task which cannot be launched reports an exception")
+
+  PASS([[NSTask runTasks: [NSArray array] maxConcurrent: 1] count] == 0,
+    "an empty array of tasks gives an empty result")
+
+  /* A task which closes its output and runs on must be waited for
+   * without keeping this process busy.
+   */
+  task = [[NSTask new] autorelease];
+  [task setLaunchPath: @"/bin/sh"];
+  [task setArguments: [NSArray arrayWithObjects:
+    @"-c", @"exec >&- 2>&-; sleep 2; exit 5", nil]];
+  cpu = clock();
+  results = [NSTask runTasks: [NSArray arrayWithObject: task]
+	       maxConcurrent: 1];
+  cpu = clock() - cpu;
+  d = [results lastObject];
+  PASS([[d objectForKey: @"TerminationStatus"] intValue] == 5
+    && [[d objectForKey: @"Duration"] doubleValue] >= 2.0,
+    "a task which closes its output is waited for")
+  PASS((double)cpu / CLOCKS_PER_SEC < 0.1,
+    "waiting for a task which closed its output uses little time")
+
+  [arp release];
+#endif
+  return 0;
+}
@@ -0,0 +1,109 @@
+#import <Foundation/NSArray.h>
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSFileHandle.h>
+#import <Foundation/NSFileManager.h>
+#import <Foundation/NSString.h>
+#import <Foundation/NSTask.h>
+
+#import "ObjectTesting.h"
+
+/* Returns the number of descriptors open in this process, or NSNotFound
+ * if the system does not tell us.
+ */
+static NSUInteger
+openDescriptors()
+{
+  NSArray	*a;
+
+  a = [[NSFileManager defaultManager] directoryContentsAtPath:
+    @"/proc/self/fd"];
+  return (nil == a) ? NSNotFound : [a count];
+}
+
+static NSTask *
+shellTask(NSString *command)
+{
+  NSTask	*task = [[NSTask new] autorelease];
+
+  [task setLaunchPath: @"/bin/sh"];
+  [task setArguments: [NSArray arrayWithObjects: @"-c", command, nil]];
+  return task;
+}
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+
+#if	!defined(_WIN32)
+  NSMutableArray	*tasks;
+  NSString		*here;
+  NSString		*str;
+  NSPipe		*pipe;
+  NSTask		*task;
+  NSData		*data;
+  NSUInteger		before;
+  NSUInteger		after;
+  BOOL			ok;
+  int			i;
+
+  task = shellTask(@"pwd");
+  pipe = [NSPipe pipe];
+  [task setStandardOutput: pipe];
+  [task setCurrentDirectoryPath: @"/"];
+  [task launch];
+  data = [[pipe fileHandleForReading] readDataToEndOfFile];
+  [task waitUntilExit];
+  str = [[[NSString alloc] initWithData: data
+			       encoding: NSUTF8StringEncoding] autorelease];
+  PASS_EQUAL(str, @"/\n", "a task runs in its current directory path")
+
+  /* A directory which does not exist is ignored, as it always has been,
+   * and the task runs in our own directory.
+   */
+  here = [[NSFileManager defaultManager] currentDirectoryPath];
+  task = shellTask(@"pwd");
+  pipe = [NSPipe pipe];
+  [task setStandardOutput: pipe];
+  [task setCurrentDirectoryPath: @"/no/such/directory/at/all"];
+  PASS_RUNS([task launch];, "a task with a bad directory is launched")
+  data = [[pipe fileHandleForReading] readDataToEndOfFile];
+  [task waitUntilExit];
+  str = [[[NSString alloc] initWithData: data
+			       encoding: NSUTF8StringEncoding] autorelease];
+  PASS_EQUAL(str, [here stringByAppendingString: @"\n"],
+    "a task with a bad directory runs in ours")
+  PASS([task terminationStatus] == 0, "that task exits normally")
+
+  /* Finished tasks which are still referenced must be reaped and must not
+   * keep descriptors open.
+   */
+  tasks = [NSMutableArray array];
+  before = openDescriptors();
+  ok = YES;
+  for (i = 0; i < 200; i++)
+    {
+      task = shellTask(@"exit 3");
+      [tasks addObject: task];
+      [task launch];
+      [task waitUntilExit];
+      if ([task isRunning] || [task terminationStatus] != 3)
+	{
+	  ok = NO;
+	}
+    }
+  after = openDescriptors();
+  PASS(ok, "many tasks are launched and reaped")
+  PASS(NSNotFound == before || after <= before + 2,
+    "finished tasks do not keep descriptors open")
+
+  task = shellTask(@"kill -9 $$");
+  [task launch];
+  [task waitUntilExit];
+  PASS([task terminationReason] == NSTaskTerminationReasonUncaughtSignal
+    && [task terminationStatus] == 9, "a signalled task is reaped")
+#endif
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,202 @@
+#import <Foundation/Foundation.h>
+#import "Testing.h"
+#import "ObjectTesting.h"
+
+#if	!defined(_WIN32)
+#include	<netinet/in.h>
+#include	<sys/socket.h>
+#include	<poll.h>
+
+#define	MAX_CONNECTIONS	64
+
+static int		listener = -1;
+static NSData		*response = nil;
+static volatile int	accepted = 0;
+
+/* Answer every request with the same response, keeping the connection
+ * open except after a request for /close.
+ */
+static void
+serve(void)
+{
+  struct pollfd	fds[MAX_CONNECTIONS];
+  int		count = 1;
+
+  fds[0].fd = listener;
+  fds[0].events = POLLIN;
+  for (;;)
+    {
+      int	i;
+
+      if (poll(fds, count, -1) <= 0)
+	{
+	  continue;
+	}
+      for (i = count - 1; i > 0; i--)
+	{
+	  char		buf[8192];
+	  ssize_t	len;
+	  ssize_t	pos;
+	  BOOL		closing;
+
+	  if (fds[i].revents == 0)
+	    {
+	      continue;
+	    }
+	  len = read(fds[i].fd, buf, sizeof(buf));
+	  closing = (len >= 10 && strncmp(buf, "GET /close", 10) == 0);
+	  for (pos = 3; pos < len; pos++)
+	    {
+	      if (buf[pos] == '\n' && buf[pos-1] == '\r'
+		&& buf[pos-2] == '\n' && buf[pos-3] == '\r')
+		{
+		  (void)write(fds[i].fd, [response bytes], [response length]);
+		}
+	    }
+	  if (len <= 0 || closing)
+	    {
+	      close(fds[i].fd);
+	      fds[i] = fds[--count];
+	    }
+	}
+      if ((fds[0].revents & POLLIN) && count < MAX_CONNECTIONS)
+	{
+	  int	s = accept(listener, 0, 0);
+
+	  if (s >= 0)
+	    {
+	      fds[count].fd = s;
+	      fds[count].events = POLLIN;
+	      count++;
+	      accepted++;
+	    }
+	}
+    }
+}
+
+@interface	NSObject (GSHTTPPool)
++ (void) setPoolTimeout: (NSTimeInterval)seconds;
+@end
+
+@interface	Server : NSObject
++ (void) fetch: (NSURL*)url;
++ (void) run: (id)ignored;
+@end
+
+static NSCondition	*cond = nil;
+static BOOL		loaded = NO;
+
+/* Loads the URL with a handle which is then released, leaving its
+ * connection in the pool.
+ */
+static NSData *
+load(NSURL *url)
+{
+  NSAutoreleasePool	*pool = [NSAutoreleasePool new];
+  NSURLHandle		*handle;
+  NSData		*d;
+
+  handle = [[NSURLHandle URLHandleClassForURL: url] alloc];
+  handle = [handle initWithURL: url cached: NO];
+  d = [[handle loadInForeground] retain];
+  [handle release];
+  [pool release];
+  return [d autorelease];
+}
+
+@implementation	Server
++ (void) fetch: (NSURL*)url
+{
+  NSAutoreleasePool	*pool = [NSAutoreleasePool new];
+
+  load(url);
+  [cond lock];
+  loaded = YES;
+  [cond broadcast];
+  [cond unlock];
+  [pool release];
+}
++ (void) run: (id)ignored
+{
+  serve();
+}
+@end
+#endif
+
+int main()
+{
+  NSAutoreleasePool	*arp = [NSAutoreleasePool new];
+
+  START_SET("GSHTTPURLHandle connection pool")
+#if	!defined(_WIN32)
+  struct sockaddr_in	sin;
+  socklen_t		len = sizeof(sin);
+  NSString		*head;
+  NSString		*base;
+  NSData		*hello;
+  Class			cls;
+  int			before;
+
+  head = @"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+    @"Content-Length: 5\r\n\r\nhello";
+  response = [[head dataUsingEncoding: NSASCIIStringEncoding] retain];
+  hello = [@"hello" dataUsingEncoding: NSASCIIStringEncoding];
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0
+    || bind(listener, (struct sockaddr*)&sin, sizeof(sin)) < 0
+    || listen(listener, 64) < 0
+    || getsockname(listener, (struct sockaddr*)&sin, &len) < 0)
+    {
+      SKIP("Unable to start local HTTP server")
+    }
+  [NSThread detachNewThreadSelector: @selector(run:)
+			   toTarget: [Server class]
+			 withObject: nil];
+  base = [NSString stringWithFormat: @"http://127.0.0.1:%d/",
+    ntohs(sin.sin_port)];
+  cls = [NSURLHandle URLHandleClassForURL: [NSURL URLWithString: base]];
+
+  PASS_EQUAL(load([NSURL URLWithString: base]), hello, "a page is loaded")
+  before = accepted;
+  PASS_EQUAL(load([NSURL URLWithString: base]), hello, "it is loaded again")
+  PASS(accepted == before, "an idle connection is reused by another handle")
+
+  cond = [NSCondition new];
+  [NSThread detachNewThreadSelector: @selector(fetch:)
+			   toTarget: [Server class]
+			 withObject: [NSURL URLWithString: base]];
+  [cond lock];
+  while (NO == loaded)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+  PASS_EQUAL(load([NSURL URLWithString: base]), hello,
+    "a page is loaded after a load in another thread")
+  PASS(accepted == before,
+    "a connection pooled by another thread is reused")
+
+  load([NSURL URLWithString: [base stringByAppendingString: @"close"]]);
+  [NSThread sleepForTimeInterval: 0.2];
+  PASS_EQUAL(load([NSURL URLWithString: base]), hello,
+    "a page is loaded after the server closed the connection")
+  PASS(accepted == before + 1,
+    "a connection closed by the server is not reused")
+
+  before = accepted;
+  [cls setPoolTimeout: 0.0];
+  [NSThread sleepForTimeInterval: 0.1];
+  PASS_EQUAL(load([NSURL URLWithString: base]), hello,
+    "a page is loaded after the connection expired")
+  PASS(accepted == before + 1, "an expired connection is not reused")
+  [cls setPoolTimeout: 30.0];
+  [cond release];
+#endif
+  END_SET("GSHTTPURLHandle connection pool")
+
+  [arp release]; arp = nil;
+  return 0;
+}
@@ -0,0 +1,238 @@
+#import <Foundation/Foundation.h>
+#import "Testing.h"
+#import "ObjectTesting.h"
+
+#if	!defined(_WIN32)
+#include	<netinet/in.h>
+#include	<sys/socket.h>
+#include	<poll.h>
+
+#define	MAX_CONNECTIONS	64
+
+static int		listener = -1;
+static NSData		*response = nil;
+
+/* Answer every request on every connection with the same response,
+ * supporting keep-alive, using a single poll() loop.
+ */
+static void
+serve(void)
+{
+  struct pollfd	fds[MAX_CONNECTIONS];
+  int		count = 1;
+
+  fds[0].fd = listener;
+  fds[0].events = POLLIN;
+  for (;;)
+    {
+      int	i;
+
+      if (poll(fds, count, -1) <= 0)
+	{
+	  continue;
+	}
+      for (i = count - 1; i > 0; i--)
+	{
+	  char		buf[8192];
+	  ssize_t	len;
+	  ssize_t	pos;
+
+	  if (fds[i].revents == 0)
+	    {
+	      continue;
+	    }
+	  len = read(fds[i].fd, buf, sizeof(buf));
+	  if (len <= 0)
+	    {
+	      close(fds[i].fd);
+	      fds[i] = fds[--count];
+	      continue;
+	    }
+	  for (pos = 3; pos < len; pos++)
+	    {
+	      if (buf[pos] == '\n' && buf[pos-1] == '\r'
+		&& buf[pos-2] == '\n' && buf[pos-3] == '\r')
+		{
+		  (void)write(fds[i].fd, [response bytes], [response length]);
+		}
+	    }
+	}
+      if ((fds[0].revents & POLLIN) && count < MAX_CONNECTIONS)
+	{
+	  int	s = accept(listener, 0, 0);
+
+	  if (s >= 0)
+	    {
+	      fds[count].fd = s;
+	      fds[count].events = POLLIN;
+	      count++;
+	    }
+	}
+    }
+}
+
+@interface	Server : NSObject
++ (void) run: (id)ignored;
+@end
+@implementation	Server
++ (void) run: (id)ignored
+{
+  serve();
+}
+@end
+
+/* Counts completed tasks.  If blocked is set, the first data received
+ * waits until it is cleared, holding up the delegate queue.
+ */
+@interface	Counter : NSObject <NSURLSessionDataDelegate>
+{
+@public
+  NSCondition	*cond;
+  NSUInteger	completed;
+  NSUInteger	failed;
+  BOOL		blocked;
+}
+@end
+@implementation	Counter
+- (void) dealloc
+{
+  [cond release];
+  [super dealloc];
+}
+- (id) init
+{
+  if (nil != (self = [super init]))
+    {
+      cond = [NSCondition new];
+    }
+  return self;
+}
+- (void) URLSession: (NSURLSession*)session
+	   dataTask: (NSURLSessionDataTask*)dataTask
+     didReceiveData: (NSData*)data
+{
+  [cond lock];
+  while (YES == blocked)
+    {
+      [cond wait];
+    }
+  [cond unlock];
+}
+- (void) URLSession: (NSURLSession*)session
+	       task: (NSURLSessionTask*)task
+didCompleteWithError: (NSError*)error
+{
+  [cond lock];
+  if (error != nil)
+    {
+      failed++;
+    }
+  completed++;
+  [cond broadcast];
+  [cond unlock];
+}
+/* Waits for the number of tasks to complete, returning NO on timeout.
+ */
+- (BOOL) waitFor: (NSUInteger)count
+{
+  NSDate	*limit = [NSDate dateWithTimeIntervalSinceNow: 30.0];
+  BOOL		ok = YES;
+
+  [cond lock];
+  while (ok && completed < count)
+    {
+      ok = [cond waitUntilDate: limit];
+    }
+  [cond unlock];
+  return ok && completed >= count;
+}
+@end
+
+static NSURLSession *
+makeSession(Counter *counter)
+{
+  NSURLSessionConfiguration	*config;
+  NSOperationQueue		*queue;
+
+  queue = AUTORELEASE([NSOperationQueue new]);
+  [queue setMaxConcurrentOperationCount: 1];
+  config = [NSURLSessionConfiguration defaultSessionConfiguration];
+  return [NSURLSession sessionWithConfiguration: config
+				       delegate: counter
+				  delegateQueue: queue];
+}
+#endif
+
+int main()
+{
+  START_SET("NSURLSession run loop driver")
+#if	!defined(_WIN32)
+  NSURLSession		*session;
+  NSURLSession		*stuck;
+  Counter		*counter;
+  Counter		*blocked;
+  NSURL			*url;
+  struct sockaddr_in	sin;
+  socklen_t		len = sizeof(sin);
+  NSString		*head;
+  unsigned		i;
+
+  [[NSUserDefaults standardUserDefaults] registerDefaults:
+    [NSDictionary dictionaryWithObject: @"YES"
+				forKey: @"GSURLSessionRunLoop"]];
+
+  head = @"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+    @"Content-Length: 5\r\n\r\nhello";
+  response = RETAIN([head dataUsingEncoding: NSASCIIStringEncoding]);
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0
+    || bind(listener, (struct sockaddr*)&sin, sizeof(sin)) < 0
+    || listen(listener, 64) < 0
+    || getsockname(listener, (struct sockaddr*)&sin, &len) < 0)
+    {
+      SKIP("Unable to start local HTTP server")
+    }
+  [NSThread detachNewThreadSelector: @selector(run:)
+			   toTarget: [Server class]
+			 withObject: nil];
+  url = [NSURL URLWithString: [NSString stringWithFormat:
+    @"http://127.0.0.1:%d/", ntohs(sin.sin_port)]];
+
+  counter = AUTORELEASE([Counter new]);
+  session = makeSession(counter);
+  for (i = 0; i < 50; i++)
+    {
+      [[session dataTaskWithURL: url] resume];
+    }
+  PASS([counter waitFor: 50] && 0 == counter->failed,
+    "many tasks complete with the run loop driver")
+
+  /* A session whose delegate is stuck must not hold up another.
+   */
+  blocked = AUTORELEASE([Counter new]);
+  blocked->blocked = YES;
+  stuck = makeSession(blocked);
+  [[stuck dataTaskWithURL: url] resume];
+  [NSThread sleepForTimeInterval: 0.5];
+  counter->completed = 0;
+  for (i = 0; i < 10; i++)
+    {
+      [[session dataTaskWithURL: url] resume];
+    }
+  PASS([counter waitFor: 10] && 0 == counter->failed,
+    "tasks complete while another session is held up")
+  [blocked->cond lock];
+  blocked->blocked = NO;
+  [blocked->cond broadcast];
+  [blocked->cond unlock];
+  PASS([blocked waitFor: 1], "the held up session then completes")
+
+  [stuck finishTasksAndInvalidate];
+  [session finishTasksAndInvalidate];
+#endif
+  END_SET("NSURLSession run loop driver")
+  return 0;
+}
@@ -27,6 +27,12 @@
 			    userInfo: (NSData*)info
 			    selector: (NSString*)aSelector
 				  to: (uint64_t)observer;
+/* Deliver a batch of count notifications archived one after another
+ * as name, object, userInfo, selector and observer.  Only sent to
+ * clients registered with -registerClient:batching: YES.
+ */
+- (oneway void) postNotifications: (NSData*)batch
+			    count: (unsigned)count;
 @end
 
 @protocol	GDNCProtocol
@@ -45,6 +51,9 @@
 
 - (void) registerClient: (id<GDNCClient>)client;
 
+- (void) registerClient: (id<GDNCClient>)client
+	       batching: (BOOL)flag;
+
 - (void) removeObserver: (uint64_t)anObserver
 		   name: (NSString*)notificationname
 		 object: (NSString*)anObject
@@ -21,11 +21,13 @@
 
 #include <stdio.h>
 
+#import	"Foundation/NSArchiver.h"
 #import	"Foundation/NSArray.h"
 #import	"Foundation/NSAutoreleasePool.h"
 #import	"Foundation/NSBundle.h"
 #import	"Foundation/NSConnection.h"
 #import	"Foundation/NSData.h"
+#import	"Foundation/NSDictionary.h"
 #import	"Foundation/NSDistantObject.h"
 #import	"Foundation/NSDistributedNotificationCenter.h"
 #import	"Foundation/NSException.h"
@@ -69,6 +71,7 @@
 static BOOL	debugging = NO;
 static BOOL	is_daemon = NO;		/* Currently running as daemon.	 */
 static BOOL	auto_stop = NO;		/* Should we shut down when unused? */
+static BOOL	coalesce = NO;		/* Drop duplicate pending messages? */
 
 static NSTimer  *timer = nil;           /* When to shut down. */
 
@@ -205,6 +208,8 @@ ihandler(int sig)
                             userInfo: (NSData*)info
                             selector: (NSString*)aSelector
                                   to: (uint64_t)observer;
+- (oneway void) postNotifications: (NSData*)batch
+                            count: (unsigned)count;
 @end
 @implementation	NSDistributedNotificationCenterGDNCDummy
 - (oneway void) postNotificationName: (NSString*)name
@@ -215,6 +220,11 @@ ihandler(int sig)
 {
   return;
 }
+- (oneway void) postNotifications: (NSData*)batch
+                            count: (unsigned)count
+{
+  return;
+}
 @end
 
 @interface	GDNCNotification : NSObject
@@ -242,6 +252,40 @@ ihandler(int sig)
   return [NSString stringWithFormat: @"%@ Name:'%@' Object:'%@' Info:'%@'",
     [super description], name, object, info];
 }
+- (NSUInteger) hash
+{
+  return [name hash];
+}
+/*
+ *	Two notifications are equal if they would be delivered identically,
+ *	so one of them may be dropped when coalescing a queue.
+ */
+- (BOOL) isEqual: (id)other
+{
+  GDNCNotification	*o = (GDNCNotification*)other;
+
+  if (o == self)
+    {
+      return YES;
+    }
+  if ([o isKindOfClass: [GDNCNotification class]] == NO)
+    {
+      return NO;
+    }
+  if ([name isEqualToString: o->name] == NO)
+    {
+      return NO;
+    }
+  if (object != o->object && [object isEqual: o->object] == NO)
+    {
+      return NO;
+    }
+  if (info != o->info && [info isEqual: o->info] == NO)
+    {
+      return NO;
+    }
+  return YES;
+}
 + (GDNCNotification*) notificationWithName: (NSString*)notificationName
 				    object: (NSString*)notificationObject
 				      data: (NSData*)notificationData
@@ -263,8 +307,10 @@ ihandler(int sig)
 {
 @public
   BOOL			suspended;
+  BOOL			batching;	/* Accepts -postNotifications:count: */
   id <GDNCClient>	client;
   NSMutableArray	*observers;
+  NSMutableArray	*pending;	/* Observers with queues to deliver. */
 }
 @end
 
@@ -272,12 +318,14 @@ ihandler(int sig)
 - (void) dealloc
 {
   RELEASE(observers);
+  RELEASE(pending);
   [super dealloc];
 }
 
 - (id) init
 {
   observers = [NSMutableArray new];
+  pending = [NSMutableArray new];
   return self;
 }
 @end
@@ -297,6 +345,7 @@ ihandler(int sig)
   GDNCClient		*client;
   NSMutableArray	*queue;
   NSNotificationSuspensionBehavior	behavior;
+  BOOL			pending;	/* In the pending list of client. */
 }
 @end
 
@@ -324,8 +373,12 @@ ihandler(int sig)
   NSConnection		*conn;
   NSMapTable		*connections;
   NSHashTable		*allObservers;
-  NSMutableDictionary	*observersForNames;
-  NSMutableDictionary	*observersForObjects;
+  NSMutableArray	*observersForAll;	/* No name or object.	*/
+  NSMutableDictionary	*observersForNames;	/* Name but no object.	*/
+  NSMutableDictionary	*observersForObjects;	/* Object but no name.	*/
+  NSMutableDictionary	*observersForPairs;	/* Name then object.	*/
+  NSMutableArray	*pendingClients;
+  BOOL			flushScheduled;
 }
 
 - (void) addObserver: (uint64_t)anObserver
@@ -340,6 +393,12 @@ ihandler(int sig)
 
 - (id) connectionBecameInvalid: (NSNotification*)notification;
 
+- (void) flush;
+
+- (NSMutableArray*) observersForName: (NSString*)notificationName
+			      object: (NSString*)notificationObject
+			      create: (BOOL)create;
+
 - (oneway void) postNotificationName: (NSString*)notificationName
 			      object: (NSString*)notificationObject
 			    userInfo: (NSData*)d
@@ -355,6 +414,8 @@ ihandler(int sig)
 		 object: (NSString*)notificationObject
 		    for: (id<GDNCClient>)client;
 
+- (void) schedule: (GDNCObserver*)obs;
+
 - (void) setSuspended: (BOOL)flag
 		  for: (id<GDNCClient>)client;
 @end
@@ -414,8 +475,11 @@ ihandler(int sig)
   /*
    *	And release the maps of notification names and objects.
    */
+  RELEASE(observersForAll);
   RELEASE(observersForNames);
   RELEASE(observersForObjects);
+  RELEASE(observersForPairs);
+  RELEASE(pendingClients);
   [super dealloc];
 }
 
@@ -432,10 +496,14 @@ ihandler(int sig)
   connections = NSCreateMapTable(NSObjectMapKeyCallBacks,
 		NSNonOwnedPointerMapValueCallBacks, 0);
   allObservers = NSCreateHashTable(NSNonOwnedPointerHashCallBacks, 0);
+  observersForAll = [NSMutableArray new];
   observersForNames = [NSMutableDictionary new];
   observersForObjects = [NSMutableDictionary new];
+  observersForPairs = [NSMutableDictionary new];
+  pendingClients = [NSMutableArray new];
 
   defs = [NSUserDefaults standardUserDefaults];
+  coalesce = [defs boolForKey: @"GDNCCoalesce"];
   hostname = [defs stringForKey: @"NSHost"];
   if ([hostname length] > 0 || [defs boolForKey: @"GSPublic"] == YES)
     {
@@ -591,57 +659,14 @@ ihandler(int sig)
   NSHashInsert(allObservers, obs);
 
   /*
-   *	Now add the observer to the lists of observers interested in it's
-   *	particular notification names and objects.
+   *	Now add the observer to the list of observers interested in its
+   *	particular combination of notification name and object.
    */
-  if (anObject)
-    {
-      NSMutableArray	*objList;
-
-      objList = [observersForObjects objectForKey: anObject];
-      if (objList == nil)
-	{
-	  objList = [NSMutableArray new];
-	  [observersForObjects setObject: objList forKey: anObject];
-	  RELEASE(objList);
-	}
-      /*
-       *	If possible use an existing string as the key.
-       */
-      if ([objList count] > 0)
-	{
-	  GDNCObserver	*tmp = [objList objectAtIndex: 0];
-
-	  anObject = tmp->notificationObject;
-	}
-      obs->notificationObject = RETAIN(anObject);
-      [objList addObject: obs];
-    }
-
-  if (notificationName)
-    {
-      NSMutableArray	*namList;
-
-      namList = [observersForNames objectForKey: notificationName];
-      if (namList == nil)
-	{
-	  namList = [NSMutableArray new];
-	  [observersForNames setObject: namList forKey: notificationName];
-	  RELEASE(namList);
-	}
-      /*
-       *	If possible use an existing string as the key.
-       */
-      if ([namList count] > 0)
-	{
-	  GDNCObserver	*tmp = [namList objectAtIndex: 0];
-
-	  notificationName = tmp->notificationName;
-	}
-      obs->notificationName = RETAIN(notificationName);
-      [namList addObject: obs];
-    }
-
+  obs->notificationName = [notificationName copy];
+  obs->notificationObject = [anObject copy];
+  [[self observersForName: obs->notificationName
+		   object: obs->notificationObject
+		   create: YES] addObject: obs];
 }
 
 - (BOOL) connection: (NSConnection*)ancestor
@@ -721,7 +746,185 @@ ihandler(int sig)
   return nil;
 }
 
+/*
+ *	Deliver the queued notifications of all pending observers, sending
+ *	a single message to each client which supports batching.
+ */
+- (void) flush
+{
+  NSMutableArray	*clients = pendingClients;
+  unsigned		count = [clients count];
+  unsigned		index;
+
+  flushScheduled = NO;
+  pendingClients = [NSMutableArray new];
+  for (index = 0; index < count; index++)
+    {
+      GDNCClient	*info = [clients objectAtIndex: index];
+      NSMutableArray	*observers = info->pending;
+      unsigned		pos;
+
+      info->pending = [NSMutableArray new];
+      for (pos = 0; pos < [observers count]; pos++)
+	{
+	  GDNCObserver	*obs = [observers objectAtIndex: pos];
+
+	  obs->pending = NO;
+	}
+
+      if (info->batching == YES)
+	{
+	  NSMutableData	*d = [NSMutableData dataWithCapacity: 1024];
+	  NSArchiver	*a;
+	  unsigned	total = 0;
+
+	  a = [[NSArchiver alloc] initForWritingWithMutableData: d];
+	  for (pos = 0; pos < [observers count]; pos++)
+	    {
+	      GDNCObserver	*obs = [observers objectAtIndex: pos];
+	      unsigned		c = [obs->queue count];
+	      unsigned		i;
+
+	      if (NSHashGet(allObservers, obs) == 0)
+		{
+		  continue;	// Removed since it was scheduled.
+		}
+	      for (i = 0; i < c; i++)
+		{
+		  GDNCNotification	*n = [obs->queue objectAtIndex: i];
+
+		  if (debugging)
+		    NSLog(@"Batching to observer %llu with %@",
+		      (unsigned long long)obs->observer, n);
+		  [a encodeObject: n->name];
+		  [a encodeObject: n->object];
+		  [a encodeObject: n->info];
+		  [a encodeObject: obs->selector];
+		  [a encodeValueOfObjCType: @encode(uint64_t)
+					at: &obs->observer];
+		}
+	      [obs->queue removeAllObjects];
+	      total += c;
+	    }
+	  RELEASE(a);
+	  if (total > 0)
+	    {
+	      NS_DURING
+		{
+		  [info->client postNotifications: d count: total];
+		}
+	      NS_HANDLER
+		{
+		  NSLog(@"Problem posting notifications to client: %@",
+		    localException);
+		}
+	      NS_ENDHANDLER
+	    }
+	}
+      else
+	{
+	  for (pos = 0; pos < [observers count]; pos++)
+	    {
+	      GDNCObserver	*obs = [observers objectAtIndex: pos];
+
+	      /*
+	       *	Post notifications to the observer until:
+	       *		an exception		(obs is set to nil)
+	       *		the queue is empty	([obs->queue count] == 0)
+	       *		the observer is removed	(obs is not in allObservers)
+	       */
+	      while (obs != nil && [obs->queue count] > 0
+		&& NSHashGet(allObservers, obs) != 0)
+		{
+		  GDNCNotification *n;
+
+		  n = RETAIN([obs->queue objectAtIndex: 0]);
+		  NS_DURING
+		    {
+		      [obs->queue removeObjectAtIndex: 0];
+		      if (debugging)
+			NSLog(@"Posting to observer %llu with %@",
+			  (unsigned long long)obs->observer, n);
+		      [obs->client->client postNotificationName: n->name
+							 object: n->object
+						       userInfo: n->info
+						       selector: obs->selector
+							     to: obs->observer];
+		    }
+		  NS_HANDLER
+		    {
+		      obs = nil;
+		      NSLog(@"Problem posting notification to client: %@",
+			localException);
+		    }
+		  NS_ENDHANDLER
+		  RELEASE(n);
+		}
+	    }
+	}
+      RELEASE(observers);
+    }
+  RELEASE(clients);
+}
+
+/*
+ *	Return the index list holding observers registered for exactly this
+ *	combination of name and object (either of which may be nil).
+ */
+- (NSMutableArray*) observersForName: (NSString*)notificationName
+			      object: (NSString*)notificationObject
+			      create: (BOOL)create
+{
+  NSMutableDictionary	*d;
+  NSMutableArray	*list;
+  NSString		*key;
+
+  if (notificationName == nil)
+    {
+      if (notificationObject == nil)
+	{
+	  return observersForAll;
+	}
+      d = observersForObjects;
+      key = notificationObject;
+    }
+  else if (notificationObject == nil)
+    {
+      d = observersForNames;
+      key = notificationName;
+    }
+  else
+    {
+      d = [observersForPairs objectForKey: notificationName];
+      if (d == nil)
+	{
+	  if (create == NO)
+	    {
+	      return nil;
+	    }
+	  d = [NSMutableDictionary new];
+	  [observersForPairs setObject: d forKey: notificationName];
+	  RELEASE(d);
+	}
+      key = notificationObject;
+    }
+  list = [d objectForKey: key];
+  if (list == nil && create == YES)
+    {
+      list = [NSMutableArray new];
+      [d setObject: list forKey: key];
+      RELEASE(list);
+    }
+  return list;
+}
+
+- (void) registerClient: (id<GDNCClient>)client
+{
+  [self registerClient: client batching: NO];
+}
+
 - (void) registerClient: (id<GDNCClient>)client
+	       batching: (BOOL)flag
 {
   NSMapTable	*table;
   GDNCClient	*info;
@@ -745,6 +948,7 @@ ihandler(int sig)
       [(id)client setProtocolForProxy: p];
     }
   info->client = client;
+  info->batching = flag;
   NSMapInsert(table, client, info);
   RELEASE(info);
 }
@@ -755,125 +959,81 @@ ihandler(int sig)
 		  deliverImmediately: (BOOL)deliverImmediately
 				 for: (id<GDNCClient>)client
 {
-  NSMutableArray	*observers = [NSMutableArray array];
-  NSMutableArray	*byName;
-  NSMutableArray	*byObject;
-  unsigned		pos;
-  GDNCNotification	*notification;
-
-  byName = [observersForNames objectForKey: notificationName];
-  byObject = [observersForObjects objectForKey: notificationObject];
+  GDNCNotification	*notification = nil;
+  NSArray		*lists[3];
+  unsigned		l;
+
   /*
-   *	Build up a list of all those observers that should get sent this.
+   *	The observers which should get sent this are exactly those in the
+   *	index lists for the name, the object and the name/object pair, so
+   *	no further filtering is needed.  As before, an observer registered
+   *	with neither a name nor an object is sent nothing.
    */
-  for (pos = [byName count]; pos > 0; pos--)
-    {
-      GDNCObserver	*obs = [byName objectAtIndex: pos - 1];
-
-      if (obs->notificationObject == nil
-	|| [obs->notificationObject isEqual: notificationObject])
-	{
-	  [observers addObject: obs];
-	}
-    }
-  for (pos = [byObject count]; pos > 0; pos--)
-    {
-      GDNCObserver	*obs = [byObject objectAtIndex: pos - 1];
-
-      if (obs->notificationName == nil
-	|| [obs->notificationName isEqual: notificationName])
-	{
-	  if ([observers indexOfObjectIdenticalTo: obs] == NSNotFound)
-	    {
-	      [observers addObject: obs];
-	    }
-	}
-    }
-
-  if ([observers count] == 0)
+  lists[0] = [self observersForName: notificationName
+			     object: nil
+			     create: NO];
+  lists[1] = [self observersForName: nil
+			     object: notificationObject
+			     create: NO];
+  lists[2] = nil;
+  if (notificationName != nil && notificationObject != nil)
     {
-      return;
+      lists[2] = [self observersForName: notificationName
+				 object: notificationObject
+				 create: NO];
     }
 
-  /*
-   *	Build notification object to queue for observer.
-   */
-  notification = [GDNCNotification notificationWithName: notificationName
-                                                 object: notificationObject
-                                                   data: d];
-
-  /*
-   *	Add the object to the queue for this observer depending on suspension
-   *	state of the client NSDistributedNotificationCenter etc.
-   */
-  for (pos = [observers count]; pos > 0; pos--)
+  for (l = 0; l < 3; l++)
     {
-      GDNCObserver	*obs = [observers objectAtIndex: pos - 1];
+      NSArray	*list = lists[l];
+      unsigned	count = [list count];
+      unsigned	pos;
 
-      if (obs->client->suspended == NO || deliverImmediately == YES)
+      if (list == nil || list == observersForAll)
 	{
-	  [obs->queue addObject: notification];
+	  continue;	// Index is missing or is the one for neither.
 	}
-      else
+      for (pos = 0; pos < count; pos++)
 	{
-	  switch (obs->behavior)
+	  GDNCObserver	*obs = [list objectAtIndex: pos];
+
+	  if (notification == nil)
 	    {
-	      case NSNotificationSuspensionBehaviorDrop:
-		break;
-	      case NSNotificationSuspensionBehaviorCoalesce:
-		[obs->queue removeAllObjects];
-		[obs->queue addObject: notification];
-		break;
-	      case NSNotificationSuspensionBehaviorHold:
-		[obs->queue addObject: notification];
-		break;
-	      case NSNotificationSuspensionBehaviorDeliverImmediately:
-		[obs->queue addObject: notification];
-		break;
+	      notification = [GDNCNotification notificationWithName:
+		notificationName object: notificationObject data: d];
 	    }
-	}
-    }
-
-  /*
-   *	Now perform the actual posting of the notification to the observers in
-   *	our array.
-   */
-  for (pos = [observers count]; pos > 0; pos--)
-    {
-      GDNCObserver	*obs = [observers objectAtIndex: pos - 1];
 
-      if (obs->client->suspended == NO || deliverImmediately == YES)
-	{
 	  /*
-	   *	Post notifications to the observer until:
-	   *		an exception		(obs is set to nil)
-	   *		the queue is empty	([obs->queue count] == 0)
-	   *		the observer is removed	(obs is not in allObservers)
+	   *	Add the notification to the queue for this observer depending
+	   *	on suspension state of the client etc.  Anything to go out now
+	   *	is sent at the end of this pass of the run loop.  If coalescing
+	   *	is turned on we drop it when an identical one is still waiting.
 	   */
-	  while (obs != nil && [obs->queue count] > 0
-	    && NSHashGet(allObservers, obs) != 0)
+	  if (obs->client->suspended == NO || deliverImmediately == YES
+	    || obs->behavior == NSNotificationSuspensionBehaviorDeliverImmediately)
 	    {
-	      GDNCNotification *n;
-	      n = RETAIN([obs->queue objectAtIndex: 0]);
-	      NS_DURING
+	      if (coalesce == NO || obs->pending == NO
+		|| [obs->queue containsObject: notification] == NO)
 		{
-		  [obs->queue removeObjectAtIndex: 0];
-  if (debugging)
-    NSLog(@"Posting to observer %llu with %@", (unsigned long long)obs->observer, n);
-		  [obs->client->client postNotificationName: n->name
-						     object: n->object
-						   userInfo: n->info
-						   selector: obs->selector
-							 to: obs->observer];
+		  [obs->queue addObject: notification];
 		}
-	      NS_HANDLER
+	      [self schedule: obs];
+	    }
+	  else
+	    {
+	      switch (obs->behavior)
 		{
-		  obs = nil;
-		  NSLog(@"Problem posting notification to client: %@",
-		    localException);
+		  case NSNotificationSuspensionBehaviorDrop:
+		    break;
+		  case NSNotificationSuspensionBehaviorCoalesce:
+		    [obs->queue removeAllObjects];
+		    [obs->queue addObject: notification];
+		    break;
+		  case NSNotificationSuspensionBehaviorHold:
+		  default:
+		    [obs->queue addObject: notification];
+		    break;
 		}
-	      NS_ENDHANDLER
-	      RELEASE(n);
 	    }
 	}
     }
@@ -881,29 +1041,38 @@ ihandler(int sig)
 
 - (void) removeObserver: (GDNCObserver*)observer
 {
+  NSString		*name;
+  NSString		*object;
+  NSMutableArray	*list;
+
   if (debugging)
     NSLog(@"Removing observer %llu for %@ %@",
       (unsigned long long)observer->observer, observer->notificationName,
       observer->notificationObject);
 
-  if (observer->notificationObject)
+  name = observer->notificationName;
+  object = observer->notificationObject;
+  list = [self observersForName: name object: object create: NO];
+  [list removeObjectIdenticalTo: observer];
+  if (list != nil && list != observersForAll && [list count] == 0)
     {
-      NSMutableArray	*objList;
-
-      objList= [observersForObjects objectForKey: observer->notificationObject];
-      if (objList != nil)
+      if (name == nil)
 	{
-	  [objList removeObjectIdenticalTo: observer];
+	  [observersForObjects removeObjectForKey: object];
 	}
-    }
-  if (observer->notificationName)
-    {
-      NSMutableArray	*namList;
-
-      namList = [observersForNames objectForKey: observer->notificationName];
-      if (namList != nil)
+      else if (object == nil)
 	{
-	  [namList removeObjectIdenticalTo: observer];
+	  [observersForNames removeObjectForKey: name];
+	}
+      else
+	{
+	  NSMutableDictionary	*d = [observersForPairs objectForKey: name];
+
+	  [d removeObjectForKey: object];
+	  if ([d count] == 0)
+	    {
+	      [observersForPairs removeObjectForKey: name];
+	    }
 	}
     }
   NSHashRemove(allObservers, observer);
@@ -934,69 +1103,60 @@ ihandler(int sig)
 {
   if (anObserver == 0)
     {
-      if (notificationName == nil)
-	{
-	  NSMutableArray	*observers;
+      NSMutableArray	*observers = [NSMutableArray array];
+      NSEnumerator	*enumerator;
+      NSDictionary	*d;
+      NSArray		*list;
+      unsigned		pos;
 
+      if (notificationName == nil && notificationObject == nil)
+	{
+	  return;
+	}
+      else if (notificationName == nil)
+	{
 	  /*
 	   *	No notification name - so remove all with matching object.
 	   */
-	  observers = [observersForObjects objectForKey: notificationObject];
-	  while ([observers count] > 0)
+	  [observers addObjectsFromArray:
+	    [observersForObjects objectForKey: notificationObject]];
+	  enumerator = [observersForPairs objectEnumerator];
+	  while ((d = [enumerator nextObject]) != nil)
 	    {
-	      GDNCObserver	*obs;
-
-	      obs = [observers objectAtIndex: 0];
-	      [self removeObserver: obs];
+	      list = [d objectForKey: notificationObject];
+	      if (list != nil)
+		{
+		  [observers addObjectsFromArray: list];
+		}
 	    }
 	}
       else if (notificationObject == nil)
 	{
-	  NSMutableArray	*observers;
-
 	  /*
 	   *	No notification object - so remove all with matching name.
 	   */
-	  observers = [observersForObjects objectForKey: notificationName];
-	  while ([observers count] > 0)
+	  [observers addObjectsFromArray:
+	    [observersForNames objectForKey: notificationName]];
+	  enumerator = [[observersForPairs objectForKey: notificationName]
+	    objectEnumerator];
+	  while ((list = [enumerator nextObject]) != nil)
 	    {
-	      GDNCObserver	*obs;
-
-	      obs = [observers objectAtIndex: 0];
-	      [self removeObserver: obs];
+	      [observers addObjectsFromArray: list];
 	    }
 	}
       else
 	{
-	  NSMutableArray	*byName;
-	  NSMutableArray	*byObject;
-	  unsigned		pos;
-
 	  /*
 	   *	Remove observers that match both name and object.
 	   */
-	  byName = [observersForObjects objectForKey: notificationName];
-	  byObject = [observersForObjects objectForKey: notificationName];
-	  for (pos = [byName count]; pos > 0; pos--)
-	    {
-	      GDNCObserver	*obs;
-
-	      obs = [byName objectAtIndex: pos - 1];
-	      if ([byObject indexOfObjectIdenticalTo: obs] != NSNotFound)
-		{
-		  [self removeObserver: obs];
-		}
-	    }
-	  for (pos = [byObject count]; pos > 0; pos--)
-	    {
-	      GDNCObserver	*obs;
-
-	      obs = [byObject objectAtIndex: pos - 1];
-	      if ([byName indexOfObjectIdenticalTo: obs] != NSNotFound)
-		{
-		  [self removeObserver: obs];
-		}
-	    }
+	  [observers addObjectsFromArray:
+	    [self observersForName: notificationName
+			    object: notificationObject
+			    create: NO]];
+	}
+      for (pos = 0; pos < [observers count]; pos++)
+	{
+	  [self removeObserver: [observers objectAtIndex: pos]];
 	}
     }
   else
@@ -1042,6 +1202,35 @@ ihandler(int sig)
     }
 }
 
+/*
+ *	Mark the observer as having a queue to be delivered and arrange for
+ *	delivery to take place once the current pass of the run loop is done.
+ */
+- (void) schedule: (GDNCObserver*)obs
+{
+  GDNCClient	*info = obs->client;
+
+  if (obs->pending == NO)
+    {
+      obs->pending = YES;
+      if ([info->pending count] == 0)
+	{
+	  [pendingClients addObject: info];
+	}
+      [info->pending addObject: obs];
+    }
+  if (flushScheduled == NO)
+    {
+      flushScheduled = YES;
+      [[NSRunLoop currentRunLoop] performSelector: @selector(flush)
+					   target: self
+					 argument: nil
+					    order: 0
+					    modes: [NSArray arrayWithObject:
+					      NSDefaultRunLoopMode]];
+    }
+}
+
 - (void) setSuspended: (BOOL)flag
 		  for: (id<GDNCClient>)client
 {
@@ -1061,6 +1250,23 @@ ihandler(int sig)
 		  format: @"setSuspended: with unregistered client"];
     }
   info->suspended = flag;
+  if (flag == NO)
+    {
+      unsigned	pos;
+
+      /*
+       *	Deliver anything held or coalesced while suspended.
+       */
+      for (pos = 0; pos < [info->observers count]; pos++)
+	{
+	  GDNCObserver	*obs = [info->observers objectAtIndex: pos];
+
+	  if ([obs->queue count] > 0)
+	    {
+	      [self schedule: obs];
+	    }
+	}
+    }
 }
 
 - (void) unregisterClient: (id<GDNCClient>)client
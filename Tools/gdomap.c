@@ -63,6 +63,14 @@
 #include <signal.h>
 #include <sys/socket.h>
 #include <sys/file.h>
+#if	defined(__linux__)
+/*
+ *	Use epoll rather than select so that we are not limited to
+ *	FD_SETSIZE descriptors and do not scan them all on each wakeup.
+ */
+#include <sys/epoll.h>
+#define	USE_EPOLL	1
+#endif
 #if	defined(HAVE_TIME_H)
 #include <time.h>
 #endif
@@ -196,6 +204,7 @@ static void	dump_stats();
 static void	dump_tables();
 #endif
 static void	handle_accept();
+static void	handle_idle();
 static void	handle_io();
 static void	handle_read(int);
 static void	handle_recv();
@@ -453,8 +462,13 @@ is_local_net(struct in_addr a)
  */
 static int	tcp_desc = -1;	/* Socket for incoming TCP connections.	*/
 static int	udp_desc = -1;	/* Socket for UDP communications.	*/
+#if	defined(USE_EPOLL)
+static int	epoll_desc = -1;/* Descriptor for epoll interest list.	*/
+#define	GDO_EVENTS	64	/* Events handled per epoll_wait().	*/
+#else
 static fd_set	read_fds;	/* Descriptors which are readable.	*/
 static fd_set	write_fds;	/* Descriptors which are writable.	*/
+#endif
 
 
 /* Internal info structures. Rewritten Wed Jul 12 14:51:19  2000 by
@@ -548,7 +562,7 @@ getRInfo(int s, int make)
 	    {
 	      RInfo	*tmp;
 
-	      _rInfoCapacity = _rInfoCount + 1;
+	      _rInfoCapacity = _rInfoCount + _rInfoCount / 2 + 8;
 	      tmp = (RInfo *)calloc(_rInfoCapacity, sizeof(RInfo));
 	      if (_rInfoCount > 0)
 		{
@@ -622,7 +636,7 @@ getWInfo(int s, int make)
 	    {
 	      WInfo	*tmp;
 
-	      _wInfoCapacity = _wInfoCount + 1;
+	      _wInfoCapacity = _wInfoCount + _wInfoCount / 2 + 8;
 	      tmp = (WInfo *)calloc(_wInfoCapacity, sizeof(WInfo));
 	      if (_wInfoCount > 0)
 		{
@@ -1052,6 +1066,51 @@ prb_tim(time_t when)
     }
 }
 
+/*
+ *	Name -		set_chan()
+ *	Purpose -	Say whether we want to read from and/or write to a
+ *			channel.  With neither, the channel is ignored.
+ */
+static void
+set_chan(int desc, int rd, int wr)
+{
+#if	defined(USE_EPOLL)
+  struct epoll_event	ev;
+
+  memset(&ev, '\0', sizeof(ev));
+  ev.data.fd = desc;
+  ev.events = (rd ? EPOLLIN : 0) | (wr ? EPOLLOUT : 0);
+  if (ev.events == 0)
+    {
+      (void)epoll_ctl(epoll_desc, EPOLL_CTL_DEL, desc, &ev);
+    }
+  else if (epoll_ctl(epoll_desc, EPOLL_CTL_MOD, desc, &ev) < 0
+    && (errno != ENOENT || epoll_ctl(epoll_desc, EPOLL_CTL_ADD, desc, &ev) < 0))
+    {
+      snprintf(ebuf, sizeof(ebuf), "unable to watch chan %d - %s",
+	desc, strerror(errno));
+      gdomap_log(LOG_ERR);
+    }
+#else
+  if (rd)
+    {
+      FD_SET(desc, &read_fds);
+    }
+  else
+    {
+      FD_CLR(desc, &read_fds);
+    }
+  if (wr)
+    {
+      FD_SET(desc, &write_fds);
+    }
+  else
+    {
+      FD_CLR(desc, &write_fds);
+    }
+#endif
+}
+
 /*
  *	Name -		clear_chan()
  *	Purpose -	Release all resources associated with a channel
@@ -1063,20 +1122,21 @@ clear_chan(int desc)
 {
 #if	defined(__MINGW__)
   if (desc != INVALID_SOCKET)
+#elif	defined(USE_EPOLL)
+  if (desc >= 0)
 #else
   if (desc >= 0 && desc < FD_SETSIZE)
 #endif
     {
       WInfo	*wi;
 
-      FD_CLR(desc, &write_fds);
       if (desc == tcp_desc || desc == udp_desc)
 	{
-	  FD_SET(desc, &read_fds);
+	  set_chan(desc, 1, 0);
 	}
       else
 	{
-	  FD_CLR(desc, &read_fds);
+	  set_chan(desc, 0, 0);
 #if	defined(__MINGW__)
 	  closesocket(desc);
 #else
@@ -2009,14 +2069,25 @@ init_ports()
   /*
    *	Set up masks to say we are interested in these descriptors.
    */
+#if	defined(USE_EPOLL)
+  epoll_desc = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_desc < 0)
+    {
+      snprintf(ebuf, sizeof(ebuf),
+	"Unable to create epoll descriptor - %s", strerror(errno));
+      gdomap_log(LOG_CRIT);
+      exit(EXIT_FAILURE);
+    }
+#else
   memset(&read_fds, '\0', sizeof(read_fds));
   memset(&write_fds, '\0', sizeof(write_fds));
+#endif
 
   getRInfo(tcp_desc, 1);
   getRInfo(udp_desc, 1);
 
-  FD_SET(tcp_desc, &read_fds);
-  FD_SET(udp_desc, &read_fds);
+  set_chan(tcp_desc, 1, 0);
+  set_chan(udp_desc, 1, 0);
 
 #ifndef __MINGW__
   /*
@@ -2343,7 +2414,17 @@ handle_accept()
       int		r;
 #endif /* !__MINGW__ */
 
-      FD_SET(desc, &read_fds);
+#if	!defined(__MINGW__) && !defined(USE_EPOLL)
+      if (desc >= FD_SETSIZE)
+	{
+	  snprintf(ebuf, sizeof(ebuf),
+	    "too many connections - refusing chan %d", desc);
+	  gdomap_log(LOG_ERR);
+	  close(desc);
+	  return;
+	}
+#endif
+      set_chan(desc, 1, 0);
       ri = getRInfo(desc, 1);
       ri->pos = 0;
       memcpy((char*)&ri->addr, (char*)&sa, sizeof(sa));
@@ -2407,11 +2488,131 @@ handle_accept()
     }
 }
 
+/*
+ *	Name -		handle_idle()
+ *	Purpose -	Periodic housekeeping when there has been no I/O
+ *			for a while.
+ */
+static void
+handle_idle()
+{
+  long		now = time(0);
+
+  prb_tim(now);	/* Remove dead servers	*/
+  if (udp_pending == 0 && (now - last_probe) >= interval)
+    {
+      /*
+       *	If there is no output pending on the udp channel and
+       *	it is at least five minutes since we sent out a probe
+       *	we can re-probe the network for other name servers.
+       */
+      init_probe();
+    }
+}
+
 /*
  *	Name -		handle_io()
  *	Purpose -	Main loop to handle I/O on multiple simultaneous
  *			connections.  All non-blocking stuff.
  */
+#if	defined(USE_EPOLL)
+static void
+handle_io()
+{
+  struct epoll_event	events[GDO_EVENTS];
+  int			udp_writing = 0;
+  int			rval = 0;
+  int			i;
+
+  while (rval >= 0)
+    {
+      int	accepting = 0;
+
+      /*
+       *	If there is anything waiting to be sent on the UDP socket
+       *	we must check to see if it is writable.
+       */
+      if ((u_queue != 0) != udp_writing)
+	{
+	  udp_writing = (u_queue != 0);
+	  set_chan(udp_desc, 1, udp_writing);
+	}
+
+      soft_int = 0;
+      rval = epoll_wait(epoll_desc, events, GDO_EVENTS, 10000);
+
+      if (rval < 0)
+	{
+	  if (soft_int > 0 || errno == EINTR)
+	    {
+	      /*
+	       * We were interrupted - but it was one we were expecting.
+	       */
+	      rval = 0;
+	    }
+	  else
+	    {
+	      snprintf(ebuf, sizeof(ebuf),
+		"Interrupted in epoll_wait: %s", strerror(errno));
+	      gdomap_log(LOG_CRIT);
+	      exit(EXIT_FAILURE);
+	    }
+	}
+      else if (rval == 0)
+	{
+	  handle_idle();
+	}
+      else
+	{
+	  /*
+	   *	Got some descriptor activity - deal with it.
+	   */
+	  for (i = 0; i < rval; i++)
+	    {
+	      int	desc = events[i].data.fd;
+	      uint32_t	e = events[i].events;
+
+	      if (desc == tcp_desc)
+		{
+		  /* Accept after dealing with the other events, so that
+		   * a descriptor closed in this pass can not be reused
+		   * by a new connection while events for it remain.
+		   */
+		  accepting = 1;
+		}
+	      else if (desc == udp_desc)
+		{
+		  if (e & (EPOLLIN | EPOLLERR))
+		    {
+		      handle_recv();
+		    }
+		  if ((e & EPOLLOUT) && u_queue != 0)
+		    {
+		      handle_send();
+		    }
+		}
+	      else if ((e & EPOLLOUT)
+		|| ((e & (EPOLLERR | EPOLLHUP)) && getWInfo(desc, 0) != 0))
+		{
+		  handle_write(desc);
+		}
+	      else
+		{
+		  handle_read(desc);
+		}
+	      if (debug > 2)
+		{
+		  dump_stats();
+		}
+	    }
+	  if (accepting)
+	    {
+	      handle_accept();
+	    }
+	}
+    }
+}
+#else
 static void
 handle_io()
 {
@@ -2505,21 +2706,10 @@ handle_io()
 	}
       else if (rval == 0)
 	{
-	  long		now = time(0);
-
 	  /*
 	   *	Let's handle a timeout.
 	   */
-	  prb_tim(now);	/* Remove dead servers	*/
-	  if (udp_pending == 0 && (now - last_probe) >= interval)
-	    {
-	      /*
-	       *	If there is no output pending on the udp channel and
-	       *	it is at least five minutes since we sent out a probe
-	       *	we can re-probe the network for other name servers.
-	       */
-	      init_probe();
-	    }
+	  handle_idle();
 	}
       else
 	{
@@ -2600,6 +2790,7 @@ handle_io()
 	}
     }
 }
+#endif	/* USE_EPOLL */
 
 /*
  *	Name -		handle_read()
@@ -2749,8 +2940,7 @@ handle_request(int desc)
   port = ntohl(ri->buf.r.port);
   buf = (unsigned char*)ri->buf.r.name;
 
-  FD_CLR(desc, &read_fds);
-  FD_SET(desc, &write_fds);
+  set_chan(desc, 0, 1);
 
   if (debug > 1)
     {